@@ -0,0 +1,1076 @@
+// ***********************************************************************
+// Copyright © 2018 Shawn Amir
+// All Rights Reserved
+// ***********************************************************************
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, version 3 or later of the License.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+// ***********************************************************************
+
+// ***********************************************************************
+// sc_Bench.c
+// Headless benchmark driver for scEmacs (make bench)
+// ***********************************************************************
+//
+// scBench links the unmodified editor (sc_Editor.c) and scheduler/main loop
+// (sc_Main.c, built with sc_BENCH so its main is left out) against the STUB
+// DISPLAY LAYER below, instead of XLib/Xft.  No X server is needed.
+//
+// The stub hands out XIDs, keeps Atoms and Selection owners, and has a small
+// event queue that sc_MainEventLoop reads with XPending/XNextEvent.  Drawing
+// calls do nothing, so what gets timed is the editor's own work: the Gap,
+// FindLoc/RowCache, ISearch, Filter, Undo, KillRing, etc.
+//
+// Each SCENARIO is a trace of keys, replayed as KeyPress events on the Frame
+// (one key, then the main loop runs until idle, just like a user typing).  Each
+// runs in a forked child on a freshly generated file (a trace may save over it),
+// so the parent gets its peak RSS through wait4.  The file, and any save temp
+// a crashed child left, is removed after each run--or when the bench is killed.
+// Results go to stdout, one JSON object per line:
+//
+//	{"scenario":"type","bytes":1048576,"ops":2000,"ns":..,"ns_per_op":..,"peak_rss_kb":..,"status":"ok"}
+//
+// Usage:	scBench [-s Size]... [-n Ops] [-t TraceFile]... [Scenario]...
+//		Size is bytes, with optional K/M/G suffix (default 1M).
+//		Ops sizes the synthetic traces (default 2000).
+//		Scenarios are open, type, scroll, isearch, qreplace, killyank, undo
+//		(default all), plus one per TraceFile.
+//
+// A TraceFile holds whitespace separated keys, '#' starts a comment:
+//	a  SPC  RET  TAB  BS  DEL  ESC  UP  DOWN  LEFT  RIGHT  PGUP  PGDN  HOME  END
+//	C-x  M-%  C-M-y			Ctrl/Meta prefixes, any order
+//	"some text"			Each char typed in turn
+
+#define		XLIB_ILLEGAL_ACCESS		// Need struct _XDisplay for the fake Display
+#include	<X11/Xlib.h>
+#include	<X11/Xutil.h>
+#include	<X11/Xatom.h>
+#include	<X11/keysym.h>
+#include	<poll.h>
+#include	<unistd.h>
+#include	<fcntl.h>
+#include	<signal.h>
+#include	<dirent.h>
+#include	<stdarg.h>
+#include	<sys/stat.h>
+#include	<sys/wait.h>
+#include	<sys/resource.h>
+
+#include	<X11/Xft/Xft.h>
+#include	<X11/extensions/Xrender.h>
+
+#include	"sc_Public.h"
+#include	"sc_Error.h"
+#include	"sc_Editor.h"
+#include	"sc_Main.h"
+
+// ***********************************************************************
+
+#define		sc_BENCHFIRSTXID	0x00400000	// Client XID base
+#define		sc_BENCHQUEUECOUNT	256		// Pending events, power of 2
+#define		sc_BENCHQUEUEMASK	(sc_BENCHQUEUECOUNT - 1)
+#define		sc_BENCHATOMBASE	256		// Above the predefined Atoms
+#define		sc_BENCHATOMCOUNT	64
+#define		sc_BENCHSELCOUNT	8
+#define		sc_BENCHSTRCOUNT	4		// XKeysymToString buffers
+
+#define		sc_BENCHDISPWIDTH	1920
+#define		sc_BENCHDISPHEIGHT	1080
+#define		sc_BENCHMAXSIZES	16
+#define		sc_BENCHMAXTRACES	16
+#define		sc_BENCHDEFOPS		2000
+#define		sc_BENCHDEFSIZE		(1 << 20)
+#define		sc_BENCHCHUNKLEN	(1 << 16)	// Generated file is written in chunks
+#define		sc_BENCHTRACEINITLEN	1024
+
+typedef struct _sc_BenchKeyRecord {
+    KeySym			KS;			// Goes in xkey.keycode
+    Uns32			Mods;			// xkey.state
+} sc_BenchKeyRecord, *sc_BenchKeyPointer;
+
+typedef struct _sc_BenchTraceRecord {
+    sc_BenchKeyPointer		KeyArrP;
+    Int32			KeyCount;
+    Int32			KeyMax;
+} sc_BenchTraceRecord, *sc_BenchTracePointer;
+
+typedef void (*sc_BenchMakeFPointer)(sc_BenchTracePointer, Int64, Int32);
+
+typedef struct _sc_BenchScenarioRecord {
+    char *			NameP;
+    sc_BenchMakeFPointer	MakeFP;			// NULL == time the file Open
+} sc_BenchScenarioRecord, *sc_BenchScenarioPointer;
+
+typedef struct _sc_BenchResultRecord {
+    Int64			Ns;
+    Int32			Ops;
+} sc_BenchResultRecord, *sc_BenchResultPointer;
+
+// Defined in sc_Main.c
+extern Display *	XDispP;
+extern Int16		sc_MainContinue;
+
+// ***********************************************************************
+
+Display			sc_BenchDisplay;
+Screen			sc_BenchScreen;
+Visual			sc_BenchVisual;
+XftFont			sc_BenchFont;
+char			sc_BenchXIM, sc_BenchXIC, sc_BenchXftDraw;	// Only the address is used
+
+XID			sc_BenchNextXID = sc_BENCHFIRSTXID;
+Window			sc_BenchFrameWin = 0;			// Last Frame window
+XEvent			sc_BenchQueueArr[sc_BENCHQUEUECOUNT];
+Uns32			sc_BenchQueueHead = 0;
+Uns32			sc_BenchQueueCount = 0;
+char *			sc_BenchAtomArr[sc_BENCHATOMCOUNT];
+Int16			sc_BenchAtomCount = 0;
+Atom			sc_BenchSelAtomArr[sc_BENCHSELCOUNT];
+Window			sc_BenchSelOwnerArr[sc_BENCHSELCOUNT];
+Int16			sc_BenchSelCount = 0;
+char			sc_BenchStrArr[sc_BENCHSTRCOUNT][16];
+Int16			sc_BenchStrI = 0;
+char			sc_BenchPathS[64] = "";			// File of the run in progress, "" if none
+
+// ***********************************************************************
+
+void		sc_BenchQueueEvent(XEvent * EventP);
+Int16		sc_BenchIsOurs(Window W);
+Int16		sc_BenchKeyLookup(XKeyEvent * KeyP, char * BufP, int BufLen, KeySym * KSP);
+
+void		sc_BenchTraceAdd(sc_BenchTracePointer TraceP, KeySym KS, Uns32 Mods);
+void		sc_BenchTraceText(sc_BenchTracePointer TraceP, char * TextP);
+Int16		sc_BenchTraceParse(sc_BenchTracePointer TraceP, char * TextP);
+Int16		sc_BenchTraceLoad(sc_BenchTracePointer TraceP, char * PathP);
+void		sc_BenchTraceRepeat(sc_BenchTracePointer TraceP, Int32 Count, char * TextP);
+void		sc_BenchTraceGotoMiddle(sc_BenchTracePointer TraceP, Int64 FileLen);
+void		sc_BenchTraceTyping(sc_BenchTracePointer TraceP, Int32 Ops);
+
+void		sc_BenchMakeType(sc_BenchTracePointer TraceP, Int64 FileLen, Int32 Ops);
+void		sc_BenchMakeScroll(sc_BenchTracePointer TraceP, Int64 FileLen, Int32 Ops);
+void		sc_BenchMakeISearch(sc_BenchTracePointer TraceP, Int64 FileLen, Int32 Ops);
+void		sc_BenchMakeQReplace(sc_BenchTracePointer TraceP, Int64 FileLen, Int32 Ops);
+void		sc_BenchMakeKillYank(sc_BenchTracePointer TraceP, Int64 FileLen, Int32 Ops);
+void		sc_BenchMakeUndo(sc_BenchTracePointer TraceP, Int64 FileLen, Int32 Ops);
+
+Int64		sc_BenchNanoSecs(void);
+Int64		sc_BenchParseSize(char * StrP);
+Int16		sc_BenchMakeFile(char * PathP, Int64 Len);
+void		sc_BenchCleanup(void);
+void		sc_BenchSignal(int Sig);
+void		sc_BenchSettle(void);
+void		sc_BenchKey(sc_BenchKeyPointer KeyP);
+void		sc_BenchChild(char * PathP, sc_BenchTracePointer TraceP, Int32 OutFD);
+void		sc_BenchRun(char * NameP, Int64 FileLen, sc_BenchTracePointer TraceP);
+
+sc_BenchScenarioRecord	sc_BenchScenarioArr[] = {
+    {"open",		NULL},
+    {"type",		sc_BenchMakeType},
+    {"scroll",		sc_BenchMakeScroll},
+    {"isearch",		sc_BenchMakeISearch},
+    {"qreplace",	sc_BenchMakeQReplace},
+    {"killyank",	sc_BenchMakeKillYank},
+    {"undo",		sc_BenchMakeUndo},
+    {NULL,		NULL}
+};
+
+// ******************************************************************************
+// ******************************************************************************
+// STUB DISPLAY LAYER
+//
+// Just enough XLib/Xft/XRender for sc_Editor.c + sc_Main.c.  Windows, GCs,
+// Pixmaps and Cursors are only XIDs.  Mapping a window queues its Expose,
+// destroying it queues DestroyNotify, XSendEvent to our own windows is queued,
+// and XConvertSelection (no other client ever owns one) is refused.
+//
+// The editor only reads fields through the Display macros (DefaultScreen,
+// RootWindow, ConnectionNumber, ...), so sc_BenchDisplay has 1 Screen, and
+// fd -1, which poll ignores.
+
+void	sc_BenchQueueEvent(XEvent * EventP)
+{
+    if (sc_BenchQueueCount == sc_BENCHQUEUECOUNT) G_SETEXCEPTION("Bench event queue full", sc_BenchQueueCount);
+
+    sc_BenchQueueArr[(sc_BenchQueueHead + sc_BenchQueueCount) & sc_BENCHQUEUEMASK] = *EventP;
+    sc_BenchQueueCount += 1;
+}
+
+Int16	sc_BenchIsOurs(Window W)
+{
+    return (W >= sc_BENCHFIRSTXID) && (W < sc_BenchNextXID);
+}
+
+// Key events carry the KeySym in keycode, so this is all the "keymap" needed.
+// Ctrl turns chars into control codes, as XLib does.
+Int16	sc_BenchKeyLookup(XKeyEvent * KeyP, char * BufP, int BufLen, KeySym * KSP)
+{
+    KeySym	KS = KeyP->keycode;
+    char	C;
+
+    if (KSP) *KSP = KS;
+    if (BufLen < 1) return 0;
+
+    if (KS < 0x80) {
+	C = (char)KS;
+	if (KeyP->state & ControlMask) C &= 0x1F;
+    } else switch (KS) {
+	case XK_Return:		C = 0x0D; break;
+	case XK_Tab:		C = 0x09; break;
+	case XK_BackSpace:	C = 0x08; break;
+	case XK_Delete:		C = 0x7F; break;
+	case XK_Escape:		C = 0x1B; break;
+	default:		return 0;
+    }
+
+    BufP[0] = C;
+    return 1;
+}
+
+Display *	XOpenDisplay(_Xconst char * NameP)
+{
+    memset(&sc_BenchScreen, 0, sizeof(sc_BenchScreen));
+    sc_BenchScreen.display = &sc_BenchDisplay;
+    sc_BenchScreen.root = sc_BenchNextXID++;
+    sc_BenchScreen.width = sc_BENCHDISPWIDTH;
+    sc_BenchScreen.height = sc_BENCHDISPHEIGHT;
+    sc_BenchScreen.root_depth = 24;
+    sc_BenchScreen.root_visual = &sc_BenchVisual;
+    sc_BenchScreen.cmap = sc_BenchNextXID++;
+    sc_BenchScreen.white_pixel = 0xFFFFFF;
+    sc_BenchScreen.black_pixel = 0;
+
+    memset(&sc_BenchDisplay, 0, sizeof(sc_BenchDisplay));
+    sc_BenchDisplay.fd = -1;
+    sc_BenchDisplay.default_screen = 0;
+    sc_BenchDisplay.nscreens = 1;
+    sc_BenchDisplay.screens = &sc_BenchScreen;
+    sc_BenchDisplay.max_request_size = 65535;
+
+    memset(&sc_BenchFont, 0, sizeof(sc_BenchFont));
+    sc_BenchFont.ascent = 13;
+    sc_BenchFont.descent = 4;
+    sc_BenchFont.height = 17;
+    sc_BenchFont.max_advance_width = 8;
+
+    return &sc_BenchDisplay;
+}
+
+int	XFlush(Display * DP)				{ return 1; }
+int	XSync(Display * DP, Bool Discard)		{ return 1; }
+int	XPending(Display * DP)				{ return sc_BenchQueueCount; }
+int	XEventsQueued(Display * DP, int Mode)		{ return sc_BenchQueueCount; }
+Bool	XCheckMaskEvent(Display * DP, long Mask, XEvent * EventP)	{ return False; }
+Bool	XFilterEvent(XEvent * EventP, Window W)		{ return False; }
+int	XRefreshKeyboardMapping(XMappingEvent * EventP)	{ return 1; }
+
+int	XNextEvent(Display * DP, XEvent * EventP)
+{
+    if (sc_BenchQueueCount == 0) G_SETEXCEPTION("Bench XNextEvent would block", 0);
+
+    *EventP = sc_BenchQueueArr[sc_BenchQueueHead];
+    sc_BenchQueueHead = (sc_BenchQueueHead + 1) & sc_BENCHQUEUEMASK;
+    sc_BenchQueueCount -= 1;
+    return 0;
+}
+
+int	XPeekEvent(Display * DP, XEvent * EventP)
+{
+    if (sc_BenchQueueCount == 0) G_SETEXCEPTION("Bench XPeekEvent would block", 0);
+
+    *EventP = sc_BenchQueueArr[sc_BenchQueueHead];
+    return 0;
+}
+
+Status	XSendEvent(Display * DP, Window W, Bool Propagate, long Mask, XEvent * EventP)
+{
+    XEvent	Event = *EventP;
+
+    if (sc_BenchIsOurs(W)) {
+	Event.xany.send_event = True;
+	Event.xany.window = W;
+	sc_BenchQueueEvent(&Event);
+    }
+    return 1;
+}
+
+Window	XCreateSimpleWindow(Display * DP, Window Parent, int X, int Y, unsigned int W, unsigned int H,
+			    unsigned int Border, unsigned long BorderPix, unsigned long BackPix)
+{
+    return sc_BenchNextXID++;
+}
+
+Window	XCreateWindow(Display * DP, Window Parent, int X, int Y, unsigned int W, unsigned int H,
+		      unsigned int Border, int Depth, unsigned int Class, Visual * VisualP,
+		      unsigned long Mask, XSetWindowAttributes * AttrP)
+{
+    return sc_BenchNextXID++;
+}
+
+int	XMapWindow(Display * DP, Window W)
+{
+    XEvent	Event;
+
+    memset(&Event, 0, sizeof(Event));
+    Event.xexpose.type = Expose;
+    Event.xexpose.display = DP;
+    Event.xexpose.window = W;
+    Event.xexpose.count = 0;
+    sc_BenchQueueEvent(&Event);
+    return 1;
+}
+
+int	XDestroyWindow(Display * DP, Window W)
+{
+    XEvent	Event;
+
+    memset(&Event, 0, sizeof(Event));
+    Event.xdestroywindow.type = DestroyNotify;
+    Event.xdestroywindow.display = DP;
+    Event.xdestroywindow.event = W;
+    Event.xdestroywindow.window = W;
+    sc_BenchQueueEvent(&Event);
+    return 1;
+}
+
+int	XMoveWindow(Display * DP, Window W, int X, int Y)	{ return 1; }
+int	XMoveResizeWindow(Display * DP, Window W, int X, int Y, unsigned int Wide, unsigned int High)	{ return 1; }
+int	XSelectInput(Display * DP, Window W, long Mask)		{ return 1; }
+int	XDefineCursor(Display * DP, Window W, Cursor C)		{ return 1; }
+int	XSetInputFocus(Display * DP, Window W, int Revert, Time T)	{ return 1; }
+int	XUngrabPointer(Display * DP, Time T)			{ return 1; }
+Window	XDefaultRootWindow(Display * DP)			{ return sc_BenchScreen.root; }
+int	XDisplayWidth(Display * DP, int ScreenN)		{ return sc_BenchScreen.width; }
+int	XDisplayHeight(Display * DP, int ScreenN)		{ return sc_BenchScreen.height; }
+long	XMaxRequestSize(Display * DP)				{ return 65535; }
+long	XExtendedMaxRequestSize(Display * DP)			{ return (1 << 22) - 1; }
+
+Bool	XQueryPointer(Display * DP, Window W, Window * RootP, Window * ChildP, int * RootXP, int * RootYP,
+		      int * WinXP, int * WinYP, unsigned int * MaskP)
+{
+    *RootP = sc_BenchScreen.root, *ChildP = None;
+    *RootXP = *RootYP = *WinXP = *WinYP = 0;
+    *MaskP = 0;
+    return True;
+}
+
+Bool	XTranslateCoordinates(Display * DP, Window SrcW, Window DestW, int SrcX, int SrcY,
+			      int * DestXP, int * DestYP, Window * ChildP)
+{
+    *DestXP = SrcX, *DestYP = SrcY;
+    *ChildP = None;
+    return True;
+}
+
+// The Frame window is the one that gets WM_DELETE_WINDOW.
+Status	XSetWMProtocols(Display * DP, Window W, Atom * ProtoP, int Count)
+{
+    sc_BenchFrameWin = W;
+    return 1;
+}
+
+void	XSetWMProperties(Display * DP, Window W, XTextProperty * NameP, XTextProperty * IconP, char ** ArgV, int ArgC,
+			 XSizeHints * NormalP, XWMHints * WMP, XClassHint * ClassP)
+{
+}
+
+void	XSetWMNormalHints(Display * DP, Window W, XSizeHints * HintsP)	{ }
+Status	XGetWMNormalHints(Display * DP, Window W, XSizeHints * HintsP, long * SuppliedP)	{ return 0; }
+XSizeHints *	XAllocSizeHints(void)				{ return calloc(1, sizeof(XSizeHints)); }
+int	XFree(void * DataP)					{ free(DataP); return 1; }
+
+Status	XStringListToTextProperty(char ** ListP, int Count, XTextProperty * PropP)
+{
+    PropP->value = (unsigned char *)strdup((Count > 0) ? ListP[0] : "");
+    PropP->encoding = XA_STRING;
+    PropP->format = 8;
+    PropP->nitems = strlen((char *)PropP->value);
+    return (PropP->value != NULL);
+}
+
+Atom	XInternAtom(Display * DP, _Xconst char * NameP, Bool OnlyIfExists)
+{
+    Int16	I;
+
+    for (I = 0; I < sc_BenchAtomCount; I++)
+	if (strcmp(sc_BenchAtomArr[I], NameP) == 0) return sc_BENCHATOMBASE + I;
+
+    if (OnlyIfExists) return None;
+    if (sc_BenchAtomCount == sc_BENCHATOMCOUNT) G_SETEXCEPTION("Bench out of Atoms", I);
+    sc_BenchAtomArr[sc_BenchAtomCount] = strdup(NameP);
+    return sc_BENCHATOMBASE + sc_BenchAtomCount++;
+}
+
+int	XSetSelectionOwner(Display * DP, Atom Sel, Window Owner, Time T)
+{
+    Int16	I;
+
+    for (I = 0; I < sc_BenchSelCount; I++)
+	if (sc_BenchSelAtomArr[I] == Sel) break;
+    if (I == sc_BenchSelCount) {
+	if (I == sc_BENCHSELCOUNT) return 1;
+	sc_BenchSelAtomArr[sc_BenchSelCount++] = Sel;
+    }
+    sc_BenchSelOwnerArr[I] = Owner;
+    return 1;
+}
+
+Window	XGetSelectionOwner(Display * DP, Atom Sel)
+{
+    Int16	I;
+
+    for (I = 0; I < sc_BenchSelCount; I++)
+	if (sc_BenchSelAtomArr[I] == Sel) return sc_BenchSelOwnerArr[I];
+    return None;
+}
+
+int	XConvertSelection(Display * DP, Atom Sel, Atom Target, Atom Prop, Window Requestor, Time T)
+{
+    XEvent	Event;
+
+    memset(&Event, 0, sizeof(Event));
+    Event.xselection.type = SelectionNotify;
+    Event.xselection.display = DP;
+    Event.xselection.requestor = Requestor;
+    Event.xselection.selection = Sel;
+    Event.xselection.target = Target;
+    Event.xselection.property = None;			// Refused
+    Event.xselection.time = T;
+    sc_BenchQueueEvent(&Event);
+    return 1;
+}
+
+int	XChangeProperty(Display * DP, Window W, Atom Prop, Atom Type, int Format, int Mode,
+			_Xconst unsigned char * DataP, int Count)
+{
+    return 1;
+}
+
+int	XDeleteProperty(Display * DP, Window W, Atom Prop)	{ return 1; }
+
+int	XGetWindowProperty(Display * DP, Window W, Atom Prop, long Offset, long Len, Bool Delete, Atom ReqType,
+			   Atom * TypeP, int * FormatP, unsigned long * CountP, unsigned long * AfterP,
+			   unsigned char ** DataPP)
+{
+    *TypeP = None, *FormatP = 0;
+    *CountP = *AfterP = 0;
+    *DataPP = NULL;
+    return BadAtom;
+}
+
+GC	XCreateGC(Display * DP, Drawable D, unsigned long Mask, XGCValues * ValuesP)
+{
+    GC	NewGC = calloc(1, 64);				// Opaque, never looked into
+
+    if (NewGC == NULL) G_SETEXCEPTION("Bench GC alloc failed", 0);
+    return NewGC;
+}
+
+int	XFreeGC(Display * DP, GC G)				{ free(G); return 1; }
+int	XSetForeground(Display * DP, GC G, unsigned long Pixel)	{ return 1; }
+int	XSetFunction(Display * DP, GC G, int Func)		{ return 1; }
+int	XSetGraphicsExposures(Display * DP, GC G, Bool Exposures)	{ return 1; }
+
+Pixmap	XCreatePixmap(Display * DP, Drawable D, unsigned int W, unsigned int H, unsigned int Depth)
+{
+    return sc_BenchNextXID++;
+}
+
+int	XFreePixmap(Display * DP, Pixmap PM)			{ return 1; }
+Cursor	XCreateFontCursor(Display * DP, unsigned int Shape)	{ return sc_BenchNextXID++; }
+int	XFreeCursor(Display * DP, Cursor C)			{ return 1; }
+
+int	XCopyArea(Display * DP, Drawable Src, Drawable Dest, GC G, int SrcX, int SrcY,
+		  unsigned int W, unsigned int H, int DestX, int DestY)
+{
+    return 1;
+}
+
+int	XFillRectangle(Display * DP, Drawable D, GC G, int X, int Y, unsigned int W, unsigned int H)	{ return 1; }
+int	XDrawRectangle(Display * DP, Drawable D, GC G, int X, int Y, unsigned int W, unsigned int H)	{ return 1; }
+
+char **	XListFonts(Display * DP, _Xconst char * PatternP, int Max, int * CountP)
+{
+    *CountP = 0;
+    return NULL;
+}
+
+int	XFreeFontNames(char ** ListP)				{ return 1; }
+
+char *	XKeysymToString(KeySym KS)
+{
+    char *	StrP = sc_BenchStrArr[sc_BenchStrI];
+
+    sc_BenchStrI = (sc_BenchStrI + 1) % sc_BENCHSTRCOUNT;
+    if ((0x20 < KS) && (KS < 0x7F)) sprintf(StrP, "%c", (char)KS);
+    else sprintf(StrP, "0x%lx", (unsigned long)KS);
+    return StrP;
+}
+
+XIM	XOpenIM(Display * DP, struct _XrmHashBucketRec * DB, char * ResName, char * ResClass) { return (XIM)&sc_BenchXIM; }
+Status	XCloseIM(XIM IM)					{ return 1; }
+XIC	XCreateIC(XIM IM, ...)					{ return (XIC)&sc_BenchXIC; }
+void	XDestroyIC(XIC IC)					{ }
+void	XSetICFocus(XIC IC)					{ }
+void	XUnsetICFocus(XIC IC)					{ }
+
+int	XLookupString(XKeyEvent * KeyP, char * BufP, int BufLen, KeySym * KSP, XComposeStatus * StatusP)
+{
+    return sc_BenchKeyLookup(KeyP, BufP, BufLen, KSP);
+}
+
+int	Xutf8LookupString(XIC IC, XKeyPressedEvent * KeyP, char * BufP, int BufLen, KeySym * KSP, Status * StatusP)
+{
+    Int16	Count = sc_BenchKeyLookup(KeyP, BufP, BufLen, KSP);
+
+    if (StatusP) *StatusP = (Count) ? XLookupBoth : XLookupKeySym;
+    return Count;
+}
+
+FT_UInt	XftCharIndex(Display * DP, XftFont * FontP, FcChar32 Ucs)	{ return Ucs; }
+
+Bool	XftColorAllocValue(Display * DP, Visual * VisualP, Colormap CMap, _Xconst XRenderColor * ColorP, XftColor * ResultP)
+{
+    ResultP->color = *ColorP;
+    ResultP->pixel = ((ColorP->red >> 8) << 16) | ((ColorP->green >> 8) << 8) | (ColorP->blue >> 8);
+    return True;
+}
+
+void	XftColorFree(Display * DP, Visual * VisualP, Colormap CMap, XftColor * ColorP)	{ }
+
+XftDraw *	XftDrawCreate(Display * DP, Drawable D, Visual * VisualP, Colormap CMap)
+{
+    return (XftDraw *)&sc_BenchXftDraw;
+}
+
+void	XftDrawDestroy(XftDraw * XftDP)				{ }
+Picture	XftDrawPicture(XftDraw * XftDP)				{ return 0; }
+
+Bool	XftDrawSetClipRectangles(XftDraw * XftDP, int X, int Y, _Xconst XRectangle * RectsP, int N)	{ return True; }
+
+void	XftDrawRect(XftDraw * XftDP, _Xconst XftColor * ColorP, int X, int Y, unsigned int W, unsigned int H)	{ }
+
+void	XftDrawString8(XftDraw * XftDP, _Xconst XftColor * ColorP, XftFont * FontP, int X, int Y,
+		       _Xconst FcChar8 * StrP, int Len)
+{
+}
+
+void	XftDrawStringUtf8(XftDraw * XftDP, _Xconst XftColor * ColorP, XftFont * FontP, int X, int Y,
+			  _Xconst FcChar8 * StrP, int Len)
+{
+}
+
+void	XftDrawGlyphFontSpec(XftDraw * XftDP, _Xconst XftColor * ColorP, _Xconst XftGlyphFontSpec * GlyphsP, int Len)
+{
+}
+
+void	XRenderFillRectangles(Display * DP, int Op, Picture Dest, _Xconst XRenderColor * ColorP,
+			      _Xconst XRectangle * RectsP, int N)
+{
+}
+
+// ******************************************************************************
+// ******************************************************************************
+// TRACES
+//
+// A trace is just an array of keys.  Recorded traces are parsed from a file,
+// the synthetic ones are built with the same parser.
+
+void	sc_BenchTraceAdd(sc_BenchTracePointer TraceP, KeySym KS, Uns32 Mods)
+{
+    sc_BenchKeyPointer	NewArrP;
+
+    if (TraceP->KeyCount == TraceP->KeyMax) {
+	TraceP->KeyMax = (TraceP->KeyMax) ? 2 * TraceP->KeyMax : sc_BENCHTRACEINITLEN;
+	NewArrP = realloc(TraceP->KeyArrP, TraceP->KeyMax * sizeof(sc_BenchKeyRecord));
+	if (NewArrP == NULL) G_SETEXCEPTION("Realloc Bench trace failed", TraceP->KeyMax);
+	TraceP->KeyArrP = NewArrP;
+    }
+
+    TraceP->KeyArrP[TraceP->KeyCount].KS = KS;
+    TraceP->KeyArrP[TraceP->KeyCount].Mods = Mods;
+    TraceP->KeyCount += 1;
+}
+
+void	sc_BenchTraceText(sc_BenchTracePointer TraceP, char * TextP)
+{
+    while (*TextP) {
+	if (*TextP == '\n') sc_BenchTraceAdd(TraceP, XK_Return, 0);
+	else sc_BenchTraceAdd(TraceP, (Uns8)*TextP, 0);
+	TextP++;
+    }
+}
+
+// Parse keys (see top of file) into TraceP.  Returns 0 for a bad key.
+Int16	sc_BenchTraceParse(sc_BenchTracePointer TraceP, char * TextP)
+{
+    static struct {char * NameP; KeySym KS;} NameArr[] = {
+	{"RET", XK_Return},	{"TAB", XK_Tab},	{"BS", XK_BackSpace},	{"DEL", XK_Delete},
+	{"ESC", XK_Escape},	{"SPC", ' '},		{"UP", XK_Up},		{"DOWN", XK_Down},
+	{"LEFT", XK_Left},	{"RIGHT", XK_Right},	{"PGUP", XK_Page_Up},	{"PGDN", XK_Page_Down},
+	{"HOME", XK_Home},	{"END", XK_End},	{NULL, 0}};
+    char	TokS[32];
+    char *	EndP;
+    char *	CP;
+    Int16	I, Len;
+    Uns32	Mods;
+
+    while (*TextP) {
+	if ((*TextP == ' ') || (*TextP == '\t') || (*TextP == '\n') || (*TextP == '\r')) {
+	    TextP++;
+	    continue;
+	}
+	if (*TextP == '#') {
+	    while (*TextP && (*TextP != '\n')) TextP++;
+	    continue;
+	}
+	if (*TextP == '"') {
+	    EndP = strchr(++TextP, '"');
+	    if (EndP == NULL) return 0;
+	    while (TextP < EndP)
+		sc_BenchTraceAdd(TraceP, (*TextP == '\n') ? XK_Return : (Uns8)*TextP, 0), TextP++;
+	    TextP = EndP + 1;
+	    continue;
+	}
+
+	Len = 0;
+	while (*TextP && (*TextP != ' ') && (*TextP != '\t') && (*TextP != '\n') && (*TextP != '\r')) {
+	    if (Len == sizeof(TokS) - 1) return 0;
+	    TokS[Len++] = *TextP++;
+	}
+	TokS[Len] = 0;
+
+	CP = TokS;
+	Mods = 0;
+	while ((CP[0] == 'C' || CP[0] == 'M') && (CP[1] == '-') && CP[2]) {
+	    Mods |= (CP[0] == 'C') ? ControlMask : Mod1Mask;
+	    CP += 2;
+	}
+
+	if (CP[1] == 0)
+	    sc_BenchTraceAdd(TraceP, (Uns8)CP[0], Mods);
+	else {
+	    for (I = 0; NameArr[I].NameP; I++)
+		if (strcmp(NameArr[I].NameP, CP) == 0) break;
+	    if (NameArr[I].NameP == NULL) return 0;
+	    sc_BenchTraceAdd(TraceP, NameArr[I].KS, Mods);
+	}
+    }
+
+    return 1;
+}
+
+Int16	sc_BenchTraceLoad(sc_BenchTracePointer TraceP, char * PathP)
+{
+    struct stat		StatR;
+    char *		TextP;
+    Int32		FD;
+    Int16		Res = 0;
+
+    FD = open(PathP, O_RDONLY);
+    if (FD < 0) return 0;
+
+    if ((fstat(FD, &StatR) == 0) && (TextP = malloc(StatR.st_size + 1))) {
+	if (read(FD, TextP, StatR.st_size) == StatR.st_size) {
+	    TextP[StatR.st_size] = 0;
+	    Res = sc_BenchTraceParse(TraceP, TextP);
+	}
+	free(TextP);
+    }
+
+    close(FD);
+    return Res;
+}
+
+void	sc_BenchTraceRepeat(sc_BenchTracePointer TraceP, Int32 Count, char * TextP)
+{
+    while (Count-- > 0) sc_BenchTraceParse(TraceP, TextP);
+}
+
+// goto-char into the middle of the file.
+void	sc_BenchTraceGotoMiddle(sc_BenchTracePointer TraceP, Int64 FileLen)
+{
+    char	PosS[32];
+
+    sprintf(PosS, "%lld", (long long)(FileLen / 2));
+    sc_BenchTraceParse(TraceP, "M-g c");
+    sc_BenchTraceText(TraceP, PosS);
+    sc_BenchTraceParse(TraceP, "RET");
+}
+
+// Type Ops chars of words, with a new line every so often.
+void	sc_BenchTraceTyping(sc_BenchTracePointer TraceP, Int32 Ops)
+{
+    static char *	TextP = "the quick brown fox jumps over the lazy dog ";
+    Int32		I, Col = 0;
+
+    for (I = 0; I < Ops; I++) {
+	if (Col == 60) {
+	    sc_BenchTraceAdd(TraceP, XK_Return, 0);
+	    Col = 0;
+	} else
+	    sc_BenchTraceAdd(TraceP, TextP[Col++ % 44], 0);
+    }
+}
+
+// ******************************************************************************
+// The synthetic scenarios.  Each is sized to about Ops keys, and stays away
+// from failed commands (FlashError sleeps) and from the ends of the Buf.
+
+void	sc_BenchMakeType(sc_BenchTracePointer TraceP, Int64 FileLen, Int32 Ops)
+{
+    sc_BenchTraceGotoMiddle(TraceP, FileLen);
+    sc_BenchTraceTyping(TraceP, Ops);
+}
+
+// Page through the top and the bottom, jumping between them.
+void	sc_BenchMakeScroll(sc_BenchTracePointer TraceP, Int64 FileLen, Int32 Ops)
+{
+    sc_BenchTraceRepeat(TraceP, (Ops + 41) / 42, "C-v C-v C-v C-v C-v C-v C-v C-v C-v C-v C-v C-v C-v C-v C-v C-v C-v C-v C-v C-v M-> "
+						 "M-v M-v M-v M-v M-v M-v M-v M-v M-v M-v M-v M-v M-v M-v M-v M-v M-v M-v M-v M-v M-<");
+}
+
+// The generated file has a "needle" every few hundred bytes.
+void	sc_BenchMakeISearch(sc_BenchTracePointer TraceP, Int64 FileLen, Int32 Ops)
+{
+    sc_BenchTraceParse(TraceP, "M-< C-s \"needle\"");
+    sc_BenchTraceRepeat(TraceP, Ops, "C-s");
+    sc_BenchTraceParse(TraceP, "RET");
+}
+
+// One replace-all over the whole Buf, Ops does not matter.
+void	sc_BenchMakeQReplace(sc_BenchTracePointer TraceP, Int64 FileLen, Int32 Ops)
+{
+    sc_BenchTraceParse(TraceP, "M-< M-% \"needle\" RET \"thread\" RET !");
+}
+
+void	sc_BenchMakeKillYank(sc_BenchTracePointer TraceP, Int64 FileLen, Int32 Ops)
+{
+    sc_BenchTraceGotoMiddle(TraceP, FileLen);
+    sc_BenchTraceRepeat(TraceP, Ops / 6, "C-a C-k C-k C-n C-y M-y");
+}
+
+// C-n ends each Undo group, so every C-/ has exactly one edit to take back.
+// (Undo past the start of history flashes, and FlashError sleeps.)
+void	sc_BenchMakeUndo(sc_BenchTracePointer TraceP, Int64 FileLen, Int32 Ops)
+{
+    sc_BenchTraceGotoMiddle(TraceP, FileLen);
+    sc_BenchTraceRepeat(TraceP, Ops / 7, "\"edit \" C-n");
+    sc_BenchTraceRepeat(TraceP, Ops / 7, "C-/");
+}
+
+// ******************************************************************************
+// ******************************************************************************
+// DRIVER
+
+Int64	sc_BenchNanoSecs(void)
+{
+    struct timespec	TS;
+
+    clock_gettime(CLOCK_MONOTONIC, &TS);
+    return ((Int64)TS.tv_sec * 1000000000) + TS.tv_nsec;
+}
+
+// Bytes, with an optional K/M/G.  Returns 0 if bad.
+Int64	sc_BenchParseSize(char * StrP)
+{
+    char *	EndP;
+    Int64	Len = strtoll(StrP, &EndP, 10);
+
+    switch (*EndP) {
+	case 'k': case 'K':	Len <<= 10, EndP++; break;
+	case 'm': case 'M':	Len <<= 20, EndP++; break;
+	case 'g': case 'G':	Len <<= 30, EndP++; break;
+	default:		break;
+    }
+
+    return (*EndP || (Len < 0)) ? 0 : Len;
+}
+
+// Words in lines of 6-13, a Tab now and then (so Open runs the Filter), and
+// a "needle" for isearch/qreplace every 64 words.  Same seed, same file.
+Int16	sc_BenchMakeFile(char * PathP, Int64 Len)
+{
+    static char *	WordArr[] = {"the", "buffer", "gap", "pane", "frame", "undo", "kill", "yank",
+				     "scroll", "search", "replace", "struct", "int", "return", "while",
+				     "if", "else", "char", "void", "static"};
+    char		ChunkArr[sc_BENCHCHUNKLEN + 32];
+    Uns32		Seed = 12345;
+    Int64		Done = 0;
+    Int32		FD, N, Words = 0, LineWords = 0, LineMax = 8;
+    char *		WP;
+
+    FD = open(PathP, O_WRONLY | O_CREAT | O_TRUNC, 0600);
+    if (FD < 0) return 0;
+
+    while (Done < Len) {
+	N = 0;
+	while ((N < sc_BENCHCHUNKLEN) && (Done + N < Len)) {
+	    Seed = Seed * 1103515245 + 12345;
+	    if (LineWords == LineMax) {
+		ChunkArr[N++] = '\n';
+		LineWords = 0;
+		LineMax = 6 + ((Seed >> 16) & 7);
+		if (((Seed >> 20) & 15) == 0) ChunkArr[N++] = '\t';
+		continue;
+	    }
+
+	    WP = (++Words % 64) ? WordArr[(Seed >> 16) % 20] : "needle";
+	    if (LineWords++) ChunkArr[N++] = ' ';
+	    while (*WP) ChunkArr[N++] = *WP++;
+	}
+	if (Done + N > Len) N = Len - Done;
+	if (Done + N == Len) ChunkArr[N - 1] = '\n';
+
+	if (write(FD, ChunkArr, N) != N) {
+	    close(FD);
+	    return 0;
+	}
+	Done += N;
+    }
+
+    close(FD);
+    return 1;
+}
+
+// Removes sc_BenchPathS, and the temp files (".Name.XXXXXX") of a Save the
+// child did not finish.
+void	sc_BenchCleanup(void)
+{
+    char		TempS[sizeof(sc_BenchPathS) + 320];
+    char *		NameP;
+    DIR *		DirP;
+    struct dirent *	DEP;
+    Int32		NameLen;
+
+    if (sc_BenchPathS[0] == 0) return;
+    unlink(sc_BenchPathS);
+
+    NameP = strrchr(sc_BenchPathS, '/');
+    *NameP++ = 0;
+    NameLen = (Int32)strlen(NameP);
+    if ((DirP = opendir(sc_BenchPathS))) {
+	while ((DEP = readdir(DirP)))
+	    if ((DEP->d_name[0] == '.') && (strncmp(DEP->d_name + 1, NameP, NameLen) == 0) &&
+		(DEP->d_name[NameLen + 1] == '.')) {
+		snprintf(TempS, sizeof(TempS), "%s/%s", sc_BenchPathS, DEP->d_name);
+		unlink(TempS);
+	    }
+	closedir(DirP);
+    }
+
+    sc_BenchPathS[0] = 0;
+}
+
+// Parent only: an exception (SIGABRT) or ^C must not leave the file behind.
+void	sc_BenchSignal(int Sig)
+{
+    if (sc_BenchPathS[0]) unlink(sc_BenchPathS);
+    signal(Sig, SIG_DFL);
+    raise(Sig);
+}
+
+// Run the main loop the way main does, until there is nothing left to do:
+// no events, no idle work, no background Load/Save.
+void	sc_BenchSettle(void)
+{
+    while (sc_MainContinue) {
+	sc_MainEventLoop();
+	if (ED_IdleHandler()) {
+	    sc_SchedWait(0);
+	    continue;
+	}
+	if (sc_BenchQueueCount) continue;
+	if (! ED_WorkPending()) break;
+	sc_SchedWait(-1);				// Wait for the worker
+    }
+}
+
+void	sc_BenchKey(sc_BenchKeyPointer KeyP)
+{
+    XEvent	Event;
+
+    memset(&Event, 0, sizeof(Event));
+    Event.xkey.type = KeyPress;
+    Event.xkey.display = &sc_BenchDisplay;
+    Event.xkey.window = sc_BenchFrameWin;
+    Event.xkey.root = sc_BenchScreen.root;
+    Event.xkey.keycode = KeyP->KS;
+    Event.xkey.state = KeyP->Mods;
+    Event.xkey.same_screen = True;
+    sc_BenchQueueEvent(&Event);
+
+    sc_BenchSettle();
+}
+
+// In the forked child: bring up the editor on the stub display, open PathP,
+// then time the trace (or the Open itself, if no TraceP).
+void	sc_BenchChild(char * PathP, sc_BenchTracePointer TraceP, Int32 OutFD)
+{
+    sc_BenchResultRecord	ResR;
+    XEvent			Event;
+    Int64			StartNs;
+    Int32			I;
+
+    signal(SIGABRT, SIG_DFL);				// Not the parent's sc_BenchSignal
+    signal(SIGINT, SIG_DFL);
+    signal(SIGTERM, SIG_DFL);
+    signal(SIGHUP, SIG_DFL);
+
+    G_MAINFILEERROR_INIT;
+    sc_WERegInit();
+    sc_SchedInit();
+
+    XDispP = XOpenDisplay(NULL);
+    ED_EditorInit(XDispP, &sc_BenchFont, (XIM)&sc_BenchXIM, sc_BENCHDISPWIDTH / 3, sc_BENCHDISPHEIGHT / 2);
+    sc_MainContinue = 1;
+    sc_BlinkTimerInit();
+
+    memset(&Event, 0, sizeof(Event));			// WM gives the Frame focus
+    Event.xfocus.type = FocusIn;
+    Event.xfocus.display = XDispP;
+    Event.xfocus.window = sc_BenchFrameWin;
+    Event.xfocus.mode = NotifyNormal;
+    Event.xfocus.detail = NotifyAncestor;
+    sc_BenchQueueEvent(&Event);
+    sc_BenchSettle();
+
+    StartNs = sc_BenchNanoSecs();
+    ED_EditorOpenFile(PathP, 0);
+    sc_BenchSettle();
+    ResR.Ns = sc_BenchNanoSecs() - StartNs;
+    ResR.Ops = 1;
+
+    if (TraceP) {
+	StartNs = sc_BenchNanoSecs();
+	for (I = 0; (I < TraceP->KeyCount) && sc_MainContinue; I++)
+	    sc_BenchKey(&TraceP->KeyArrP[I]);
+	ResR.Ns = sc_BenchNanoSecs() - StartNs;
+	ResR.Ops = I;
+    }
+
+    if (write(OutFD, &ResR, sizeof(ResR)) != sizeof(ResR)) _exit(1);
+    _exit(0);						// Not ED_EditorKill, the Buf is modified
+}
+
+// Generate the file, fork, run, and print one JSON line for the scenario.
+void	sc_BenchRun(char * NameP, Int64 FileLen, sc_BenchTracePointer TraceP)
+{
+    sc_BenchResultRecord	ResR;
+    struct rusage		UsageR;
+    Int32			PipeArr[2];
+    Int32			WaitStat = 0;
+    Int16			Got;
+    pid_t			Pid;
+
+    sprintf(sc_BenchPathS, "/tmp/scBench-%d-%lld.txt", (int)getpid(), (long long)FileLen);
+    if (! sc_BenchMakeFile(sc_BenchPathS, FileLen)) {
+	fprintf(stderr, "scBench: cannot write %s\n", sc_BenchPathS);
+	sc_BenchCleanup();
+	exit(1);
+    }
+
+    if (pipe(PipeArr) < 0) G_SETEXCEPTION("Bench pipe failed", errno);
+
+    fflush(stdout);
+    Pid = fork();
+    if (Pid < 0) G_SETEXCEPTION("Bench fork failed", errno);
+    if (Pid == 0) {
+	close(PipeArr[0]);
+	sc_BenchChild(sc_BenchPathS, TraceP, PipeArr[1]);
+    }
+
+    close(PipeArr[1]);
+    Got = (read(PipeArr[0], &ResR, sizeof(ResR)) == sizeof(ResR));
+    close(PipeArr[0]);
+    memset(&UsageR, 0, sizeof(UsageR));
+    while ((wait4(Pid, &WaitStat, 0, &UsageR) < 0) && (errno == EINTR));
+
+    if (Got && WIFEXITED(WaitStat) && (WEXITSTATUS(WaitStat) == 0))
+	printf("{\"scenario\":\"%s\",\"bytes\":%lld,\"ops\":%d,\"ns\":%lld,\"ns_per_op\":%.1f,\"peak_rss_kb\":%ld,\"status\":\"ok\"}\n",
+	       NameP, (long long)FileLen, ResR.Ops, (long long)ResR.Ns,
+	       (ResR.Ops) ? (double)ResR.Ns / ResR.Ops : 0.0, UsageR.ru_maxrss);
+    else
+	printf("{\"scenario\":\"%s\",\"bytes\":%lld,\"status\":\"failed\",\"signal\":%d}\n",
+	       NameP, (long long)FileLen, WIFSIGNALED(WaitStat) ? WTERMSIG(WaitStat) : 0);
+
+    sc_BenchCleanup();
+}
+
+int	main(int ArgC, char * ArgV[])
+{
+    Int64			SizeArr[sc_BENCHMAXSIZES];
+    char *			TracePathArr[sc_BENCHMAXTRACES];
+    sc_BenchTraceRecord		TraceR;
+    sc_BenchScenarioPointer	SP;
+    Int16			SizeCount = 0, TraceCount = 0, PickCount = 0;
+    Int16			I, J, S;
+    Int32			Ops = sc_BENCHDEFOPS;
+    char *			NameP;
+    char *			CP;
+
+    G_MAINFILEERROR_INIT;
+
+    for (I = 1; I < ArgC; I++) {
+	if ((strcmp(ArgV[I], "-s") == 0) && (I + 1 < ArgC)) {
+	    if (SizeCount == sc_BENCHMAXSIZES) continue;
+	    if ((SizeArr[SizeCount] = sc_BenchParseSize(ArgV[++I])) <= 0) goto Usage;
+	    SizeCount += 1;
+	} else if ((strcmp(ArgV[I], "-n") == 0) && (I + 1 < ArgC)) {
+	    if ((Ops = atoi(ArgV[++I])) <= 0) goto Usage;
+	} else if ((strcmp(ArgV[I], "-t") == 0) && (I + 1 < ArgC)) {
+	    if (TraceCount < sc_BENCHMAXTRACES) TracePathArr[TraceCount++] = ArgV[I + 1];
+	    I += 1;
+	} else if (ArgV[I][0] == '-')
+	    goto Usage;
+	else
+	    PickCount += 1;
+    }
+    if (SizeCount == 0) SizeArr[SizeCount++] = sc_BENCHDEFSIZE;
+
+    signal(SIGABRT, sc_BenchSignal);
+    signal(SIGINT, sc_BenchSignal);
+    signal(SIGTERM, sc_BenchSignal);
+    signal(SIGHUP, sc_BenchSignal);
+
+    for (S = 0; S < SizeCount; S++) {
+	for (SP = sc_BenchScenarioArr; SP->NameP; SP++) {
+	    if (PickCount) {
+		for (J = 1; J < ArgC; J++)
+		    if (strcmp(ArgV[J], SP->NameP) == 0) break;
+		if (J == ArgC) continue;
+	    }
+
+	    memset(&TraceR, 0, sizeof(TraceR));
+	    if (SP->MakeFP) (*SP->MakeFP)(&TraceR, SizeArr[S], Ops);
+	    sc_BenchRun(SP->NameP, SizeArr[S], (SP->MakeFP) ? &TraceR : NULL);
+	    free(TraceR.KeyArrP);
+	}
+
+	for (I = 0; I < TraceCount; I++) {
+	    memset(&TraceR, 0, sizeof(TraceR));
+	    if (! sc_BenchTraceLoad(&TraceR, TracePathArr[I])) {
+		fprintf(stderr, "scBench: bad trace %s\n", TracePathArr[I]);
+		free(TraceR.KeyArrP);
+		continue;
+	    }
+	    NameP = TracePathArr[I];
+	    if ((CP = strrchr(NameP, '/'))) NameP = CP + 1;
+	    sc_BenchRun(NameP, SizeArr[S], &TraceR);
+	    free(TraceR.KeyArrP);
+	}
+    }
+
+    exit(0);
+
+Usage:
+    fprintf(stderr, "Usage: scBench [-s Size[K|M|G]]... [-n Ops] [-t TraceFile]... [Scenario]...\n");
+    exit(2);
+}
@@ -37,6 +37,12 @@
 #include	<dirent.h>
 #include	<sys/time.h>
 #include	<fcntl.h>
+#include	<sys/mman.h>
+#include	<sys/stat.h>
+#include	<sys/uio.h>
+#include	<sys/inotify.h>
+#include	<sys/xattr.h>
+#include	<pthread.h>
 
 #include	<X11/Xft/Xft.h>
 
@@ -316,9 +322,20 @@
 #define	ED_VERSIONMAJOR		0x0001
 #define ED_VERSIONMINOR		0x0001
 
-#define	ED_MAXMEMSIZE		0x7FFFFFFF
+#define	ED_MAXMEMSIZE		0x7FFFFFFFFFFFFFFFLL	// Positions are Int64
 #define ED_BUFINITLEN		8192L		// Set 256 for Testing
 #define ED_GAPEXTRAEXPAND	512		// Set 256 for Testing
+#define ED_GAPGROWDIV		16		// Gap also grows by LastPos / ED_GAPGROWDIV
+#define ED_GAPGROWMAX		(8 * 1024 * 1024)	// ...up to this much
+#define ED_MAPMINSIZE		(1024 * 1024)	// Files this big (or bigger) are mmapped
+#define ED_MAPRESERVE		(64 * 1024 * 1024)	// Extra (untouched) space reserved for Gap growth
+#define ED_MAPSLOTMAX		32		// Mapped Bufs at once, then read, see ED_MapSigBusHandler
+#define ED_LOADSTREAMSIZE	(16 * 1024 * 1024)	// Files this big (or bigger) load in the background
+#define ED_LOADFIRSTCHUNK	(256 * 1024)	// Loaded up front, for the first paint
+#define ED_LOADCHUNK		(8 * 1024 * 1024)	// Background load chunk
+#define ED_SESSVERSION		1		// Session snapshot format
+#define ED_SESSALIGN(Len)	(((Len) + 7) & ~7)	// Snapshot paths are padded
+#define ED_SESSMTIME(StatR)	((Int64)(StatR).st_mtim.tv_sec * 1000000000 + (StatR).st_mtim.tv_nsec)
 #define ED_NAMESTRING		"scEmacs"
 #define ED_UNDOINITLEN		8192		// Initial UndoSlab size
 #define ED_UNDOEXTRALEN		8192		// Extra UndoSlab size
@@ -326,6 +343,22 @@
 #define ED_UNDOGCL0SLABCOUNT	12		// Max number of UndoSlabs to trim to in L0 GC
 #define ED_UNDOGCL1SLABCOUNT	8		// Max number of UndoSlabs for L1 GC
 #define ED_UNDOGCL2MEMMAX	(120 * 1024)	// Max total UndoSlabsize for L2 GC
+#define ED_UNDORESIDENTMAX	(512 * 1024)	// Resident UndoSlab bytes per Buf, older ones are frozen
+#define ED_UNDOMAXSLABS		4096		// Max UndoSlabs per Buf, frozen or not
+#define ED_UNDOJOURNALMAX	(256LL * 1024 * 1024)	// Sparse journal file for frozen UndoSlabs
+#define ED_LIDXSTEP		1024		// Lines between LineIdx checkpoints
+#define ED_LIDXINITCOUNT	64		// Initial LineIdx array size (in entries)
+#define ED_RIDXSTEP		256		// Rows between RowIdx checkpoints
+#define ED_RIDXINITCOUNT	64		// Initial RowIdx array size (in entries)
+#define ED_RIDXWIDTHS		4		// RowIdx kept for this many RowChars values
+#define ED_PIDXSTEP		(64 * 1024)	// Bytes between ParenIdx checkpoints
+#define ED_PIDXNEAR		(64 * 1024)	// Scanned for a match before using the ParenIdx
+#define ED_PIDXINITCOUNT	64		// Initial ParenIdx array size (in entries)
+#define ED_PIDXKINDS		3		// ( [ {
+#define ED_REFLOWNEAR		(1024 * 1024)	// Reflowing, Rows this far past the last checkpoint are estimated
+#define ED_REFLOWCHUNK		(64 * 1024)	// Bytes re-wrapped per idle step
+#define ED_REFLOWSAMPLES	16		// Estimate from this many samples...
+#define ED_REFLOWSAMPLELEN	(8 * 1024)	// ...this long (rounded to whole lines)
 
 #define ED_EXTCOMMANDCODE	0x15		// Designates special keys
 #define	ED_CTLCOMMANDCODE	0x16		// Control
@@ -350,11 +383,25 @@
 
 #define	ED_FREGALLOCCOUNT	100		// Size of Store Rack (in entries)
 #define ED_FBINDALLOCCOUNT	100
+#define ED_TRIEMINSLOTS		256		// Power of 2, Trie edge table starts here
+#define ED_TRIEMINNODES		128
+#define ED_DIRCACHECOUNT	8		// Directory listings kept for path completion
+#define ED_DIRLISTINITLEN	(16 * 1024)	// Initial names memory, doubles as needed
 #define ED_FRAMEALLOCCOUNT	8
 #define ED_PANEALLOCCOUNT	16
 #define ED_BUFFERALLOCCOUNT	6
+#define ED_USTUBALLOCCOUNT	64		// Frozen UndoSlab headers
+#define ED_PAYLOADMINLEN	1024		// Smallest PayloadPool class
+#define ED_PAYLOADMAXLEN	(64 * 1024)	// Largest PayloadPool class, bigger is malloced
+#define ED_PAYLOADRACKLEN	(256 * 1024)	// About this much per PayloadPool Rack
 
 #define ED_BUFHELPIDENT		0xABC0		// Special code for special HELP Info buffers
+#define ED_BUFSTATSIDENT	0xABC1		// ...and for the STATS Info buffer
+
+#define ED_HISTSUBBITS		2		// Histogram buckets per power of 2 == 1 << SUBBITS
+#define ED_HISTSUBCOUNT		(1 << ED_HISTSUBBITS)
+#define ED_HISTBUCKETS		(40 * ED_HISTSUBCOUNT)	// Values up to 2^40, rest goes in the last
+#define ED_STATSDUMPPATH	"%s/scEmacs-stats.%d.XXXXXX"	// dump-stats target in $TMPDIR, %d is the pid
 
 #define	ED_FBINDKEYSTRLEN	(8 * 2)		// Multiple of 8
 #define ED_CMDKEYSTRLEN		(ED_FBINDKEYSTRLEN * 2)
@@ -364,15 +411,33 @@
 
 #define	ED_KILLRINGCOUNT	(1 << 4)	// Power of 2--16 is plenty
 #define	ED_KILLRINGMASK		(ED_KILLRINGCOUNT - 1)
-#define	ED_KRTOPINITLEN		128		// 1024		Testing
-#define	ED_KRTOPEXTRA		128		// 512		Testing
-#define	ED_KRRESTINITLEN	128		// 8 * 1024	Testing
-#define	ED_KRRESTEXTRA		128		// 1024		Testing
+#define	ED_XSELREQSLACK		64		// 4-byte units kept for the XChangeProperty request
+#define	ED_XSELTIMEOUT		2048		// mSec, max wait for each INCR step
+#define	ED_XSELTICK		512		// mSec, timeout checks while transferring
+#define	ED_KRINITLEN		1024		// Smallest chunk for a KillRing entry
+#define	ED_KRKEEPLEN		(64 * 1024)	// Recycled chunks bigger than this may be freed
 
 #define	ED_MSGSTRLEN		256
 #define ED_RESPSTRLEN		256
 #define	ED_ISSTRLEN		128
+#define	ED_ISSETINITCOUNT	256		// Initial slots in the IS match set
+#define	ED_ISCOUNTCHUNK		(1 << 20)	// Bytes per idle call when counting IS matches
 #define	ED_TABSTOP		8		// Every N spaces
+#define	ED_FILTERCHUNK		(1 << 20)	// Filter progress is updated per chunk
+#define	ED_PDTRECTINITCOUNT	32		// Initial slots for IS hilite rects in PaneDrawText
+#define	ED_PDTBATCHINITCOUNT	256		// Initial slots for batched glyphs/fills in PaneDrawText
+#define	ED_GLYPHDIRECTCOUNT	256		// ASCII/Latin-1 glyphs are looked up directly
+#define	ED_GLYPHHASHINITCOUNT	256		// Initial (power of 2) slots for other glyphs
+#define	ED_HASHSEED		0xCBF29CE484222325ULL	// FNV-1a 64 offset basis
+#define	ED_HASHPRIME		0x00000100000001B3ULL	// FNV-1a 64 prime
+#define	ED_LZHASHBITS		12		// LZ match finder table, 4K entries
+#define	ED_LZBOUND(N)		((N) + ((N) / 255) + 16)	// Worst case compressed size
+#define	ED_SAVEWORKERCOUNT	4		// Bufs saved in parallel
+#define	ED_POOLMAXWORKERS	31		// Scan pool threads (plus the UI thread), at most
+#define	ED_POOLMAXCHUNKS	256		// A scan is split into this many chunks, at most
+#define	ED_POOLCHUNK		(4 * 1024 * 1024)	// ...of at least this many bytes
+#define	ED_POOLMINLEN		(16 * 1024 * 1024)	// Shorter scans stay on the UI thread
+#define	ED_POOLMINLINES		(64 * 1024)	// LineToPos walks this far before going parallel
 
 #define ED_DOUBLECLICKINTERVAL	500		// mSec, standard value.
 #define ED_EXTRACLICKINTERVAL	100		// mSec, Extra time for triple (and more) clicks
@@ -405,19 +470,22 @@
     typedef struct _ED_USlabRecord {
 	Uns32			Tag;		// "UNDO"
 	Uns32			Flags;
-	Int32			SlabSize;	// Size of this USlab (May vary!)
-	Int32			LastUBlock;	// Offset to Last USED UBlock on this Slab
+	Int64			SlabSize;	// Size of this USlab (May vary!)
+	Int64			LastUBlock;	// Offset to Last USED UBlock on this Slab
 	_ED_USLABPOINTER	NextUSP;	// Next USlab
 	_ED_USLABPOINTER	PrevUSP;	// Prev USlab
+	Int64			JournalOff;	// Compressed copy in journal, if ED_US_JOURNALFLAG
+	Int32			JournalLen;	// Compressed length
+	Int64			UsedLen;	// Bytes used (header included) when frozen
 	// UBlock		Block[];
     } ED_USlabRecord, *ED_USlabPointer;
 
     typedef struct _ED_UBlockRecord {
-	Int32			PrevUBlock;	// Prev Offset, this Slab or Prev if First block
-	Int32			DataPos;	// Start Pos in Buffer
-	Int32			DataLen;	// DataLen in Buffer, Store here if Del
+	Int64			PrevUBlock;	// Prev Offset, this Slab or Prev if First block
+	Int64			DataPos;	// Start Pos in Buffer
+	Int64			DataLen;	// DataLen in Buffer, Store here if Del
 	Uns8			Flags;		// Add + Del (replace if both) + Chain/Free
-	char			Data[3];	// Only stored if Del/Replace
+	char			Data[7];	// Only stored if Del/Replace
     } ED_UBlockRecord, *ED_UBlockPointer;
 
     typedef enum {
@@ -428,6 +496,7 @@
 	ED_UB_CHUNK		= 0x10,		// Text was yanked, copied, etc... must stand alone
 	ED_UB_FIRSTMOD		= 0x20,		// First Modification of an UNMODIFIED buffer--new or after save!
 	ED_UB_SAVE		= 0x40,		// Buffer was saved... So ignore FirsMod *BEFORE* this!
+	ED_UB_NOIDX		= 0x80,		// Request only, caller did ED_BufferEditUpdate--never stored
     } ED_UB_Flags;
 
     
@@ -435,6 +504,88 @@
 #undef _ED_USLABPOINTER
 
 
+    typedef struct _ED_LIdxRecord {
+	Int64			Pos;		// Pos of first char on the Line
+	Int64			Line;		// 0-based Line number
+    } ED_LIdxRecord, *ED_LIdxPointer;
+
+    typedef struct _ED_RIdxRecord {
+	Int64			Pos;		// Pos of first char on a Line
+	Int64			Row;		// ABSOLUTE Row count for Pos
+    } ED_RIdxRecord, *ED_RIdxPointer;
+
+    typedef struct _ED_PIdxRecord {
+	Int64			Pos;		// Checkpoint, segment runs to the next one
+	Int64			DepthArr[ED_PIDXKINDS];	// Opens less Closes before Pos
+	Int64			MinArr[ED_PIDXKINDS];	// Lowest depth in the segment
+	Int32			Dirty;		// MinArr must be counted again
+	Int32			Pad;
+    } ED_PIdxRecord, *ED_PIdxPointer;
+
+    typedef struct _ED_RIdxWidthRecord {
+	Int32			RowChars;	// Frame width for this RowIdx, 0 if unused
+	Uns32			LastUse;	// For LRU recycling
+	Int64			DirtyStart;	// Dirty range, -1 if none
+	Int64			DirtyEnd;
+	ED_RIdxPointer		ArrP;		// Checkpoints, [0] is always (0, 0)
+	Int32			Count;		// Checkpoints in ArrP
+	Int32			Max;		// Allocated size of ArrP (in entries)
+	Int64			EstBytes;	// Reflowing: Rows past the last checkpoint
+	Int64			EstRows;	// are EstRows per EstBytes, 0 if not
+    } ED_RIdxWidthRecord, *ED_RIdxWidthPointer;
+
+    typedef struct _ED_RowCacheRecord {
+	Int64			Pos;		// First Pos on the Row, -1 if blank
+	Int32			Len;		// Bytes shown on the Row
+	Int16			Wrap;		// Row wraps into the next
+	Uns64			Hash;		// Everything drawn on the Row, 0 if invalid
+    } ED_RowCacheRecord, *ED_RowCachePointer;
+
+    typedef struct _ED_PDTRectRecord {
+	Int32			StartCol;	// IS hilite for one Row (or Row segment)
+	Int32			EndCol;
+	Int16			IsMain;		// Purple if Main, else Turquoise
+    } ED_PDTRectRecord, *ED_PDTRectPointer;
+
+    typedef struct _ED_PDTRowRecord {
+	char *			SegP[2];	// Row can be split by the Gap
+	Int32			SegCount[2];	// Bytes in each segment
+	Int32			SegCol[2];	// Starting Col of each segment
+	Int16			SegN;		// Segments in use
+	Int16			WrapIn;		// Row continues a wrapped line
+	Int16			WrapOut;	// Row wraps into the next
+	Int16			Blank;		// Row is past LastPos
+	Int16			DrawSel;	// Row has Sel hilite from SelStartCol to SelEndCol
+	Int32			SelStartCol;
+	Int32			SelEndCol;
+	Int32			RectFirst;	// IS hilite rects in ED_PDTRectArrP
+	Int32			RectCount;
+	ED_RowCacheRecord	RC;		// What goes into the Pane RowCache
+    } ED_PDTRowRecord, *ED_PDTRowPointer;
+
+    typedef struct _ED_GlyphRecord {
+	Uns32			Ucs;		// Codepoint, 0 if slot is empty
+	FT_UInt			Glyph;		// XftCharIndex for Ucs in ED_XFP
+    } ED_GlyphRecord, *ED_GlyphPointer;
+
+    typedef struct _ED_PDTFillRecord {
+	Int16			Color;		// Filled with this color
+	XRectangle *		ArrP;		// Batched for one XRenderFillRectangles
+	Int32			Count;
+	Int32			Max;
+    } ED_PDTFillRecord, *ED_PDTFillPointer;
+
+    typedef enum {				// PaneDrawText fills, in the order they are drawn
+	ED_PDTFILLTOUCH		= 0,		// Edge bands
+	ED_PDTFILLWHITE,			// Background
+	ED_PDTFILLSEL,				// Sel hilite
+	ED_PDTFILLMAIN,				// IS hilite--Main match
+	ED_PDTFILLALT,				// IS hilite--Alt match
+	ED_PDTFILLWRAP,				// Wrap bars, on top of Touch bands
+	ED_PDTFILLCOUNT
+    } ED_PDTFill;
+
+
 #define _ED_FRAMEPOINTER	struct _ED_FrameRecord *
 #define _ED_PANEPOINTER		struct _ED_PaneRecord *
 #define _ED_BUFFERPOINTER	struct _ED_BufferRecord *
@@ -452,6 +603,11 @@
 	GC			BlinkerGC;		// XWin GC for Blinker
 	GC			HiliteGC;		// For high-lighting Search
 	GC			HLBlinkerGC;		// GC for Blinker *ON* hilite color (Sel, Match, etc.)
+	GC			CopyGC;			// GC for XCopyArea, BackPM to itself or XWin
+	Pixmap			BackPM;			// PaneDrawText composes text rows here
+	XftDraw *		BackDP;			// Xft Draw for BackPM
+	Int32			BackWidth;		// Size of BackPM, same as XWin
+	Int32			BackHeight;
 	Uns32			Number;			// Frame number
 	Int32			PaneCount;		// Number of Panes
 	Int32			WinWidth;
@@ -477,18 +633,25 @@
 	Int64			ScrollScale;		// 32.32 scale for scrolling
 	Window			XModeWin;		// Window for modeline--not for bottom Pane
 	Window			XScrollWin;		// Window for VScroll--every Pane gets one
-	Int32			CursorPos;		// But MarkPos belongs in Buffer
-	Int32			PanePos;		// Start of displayed page, first visible Pos
+	Int64			CursorPos;		// But MarkPos belongs in Buffer
+	Int64			PanePos;		// Start of displayed page, first visible Pos
 
-	Int32			CursorRow;		// First row of Pane is 0
+	Int64			CursorRow;		// First row of Pane is 0
 	Int32			CursorCol;		// First col of Pane is 0
-	Int32			StartRowCount;		// Rows before PanePos
-	Int32			BufRowCount;		// Total rows of text
+	Int64			StartRowCount;		// Rows before PanePos
+	Int64			BufRowCount;		// Total rows of text
 	Int32			TopRow;			// First row of FRAME is 0
 	Int32			RowCount;		// Includes ModeLine at bot of Pane
 	Int32			ScrollTop;		// Height of area above bar
 	Int32			ScrollThumb;		// Height of Thumb area (visible bar)
 	Int32			ScrollHeight;		// Height of entire scrol bar
+	ED_RowCachePointer	RCArrP;			// RowCache, what is on screen for each text Row
+	Int32			RCMax;			// Allocated entries in RCArrP
+	Int32			RCRowCount;		// Text Rows cached, 0 if invalid
+	Int32			RCTopRow;		// TopRow when cached
+	Int32			RCRowChars;		// FrameP->RowChars when cached
+	Int32			XORFirstRow;		// Rows the cursor was drawn on (GXxor) since the
+	Int32			XORLastRow;		// last PaneDrawText, First > Last if none
     } ED_PaneRecord, *ED_PanePointer;
 
     typedef struct _ED_BufferRecord {
@@ -505,17 +668,32 @@
 	ED_USlabPointer		FirstUSP;		// First UndoSlab
 	ED_USlabPointer		LastUSP;		// Last UndoSlab
 	Int32			USCount;		// Number of UndoSlabs
-	Int32			USTotalSize;		// Total size of UndoSlabs in bytes
-
-	Int32			MarkPos;		// MarkPos is in buffer, CursorPos in Pane
-	Int32			CursorPos;		// Stashed here for new Pane getting this Buf
-	Int32			PanePos;		// Stashed here for new Pane getting this Buf
-	Int32			LastPos;		// 1 more than last valid Pos
+	Int64			USTotalSize;		// Total size of (resident) UndoSlabs in bytes
+	Int32			USFrozenCount;		// UndoSlabs frozen to the journal
+
+	ED_LIdxPointer		LIdxArrP;		// LineIdx checkpoints, NULL until first needed
+	Int32			LIdxCount;		// Checkpoints in LIdxArrP, [0] is always (0, 0)
+	Int32			LIdxMax;		// Allocated size of LIdxArrP (in entries)
+	ED_RIdxWidthRecord	RIdxWidthArr[ED_RIDXWIDTHS];	// RowIdx, one per recent RowChars
+	ED_PIdxPointer		PIdxArrP;		// ParenIdx checkpoints, NULL until first needed
+	Int32			PIdxCount;		// Checkpoints in PIdxArrP, [0] is at Pos 0
+	Int32			PIdxMax;		// Allocated size of PIdxArrP (in entries)
+	Int64			PIdxEndPos;		// Counted up to here
+
+	Int64			MapLen;			// Reserved length, if ED_BUFMAPPEDFLAG
+	Int64			MapDev;			// st_dev + st_ino of the mapped file
+	Int64			MapIno;
+
+	Int64			MarkPos;		// MarkPos is in buffer, CursorPos in Pane
+	Int64			CursorPos;		// Stashed here for new Pane getting this Buf
+	Int64			PanePos;		// Stashed here for new Pane getting this Buf
+	Int64			LastPos;		// 1 more than last valid Pos
 	Int32			PaneRefCount;		// How many are showing this Buffer
 
 	Int32			MarkRingIndex;		// Limit with ED_MARKRINGMASK
-	Int32			MarkRingArr[ED_MARKRINGCOUNT];
+	Int64			MarkRingArr[ED_MARKRINGCOUNT];
 
+	Uns32			EditSeq;		// Bumped on each edit, see ED_SaveFinish
 	Int32			Ident;			// Special Ident codes for special buffers
 	Int32			DirNameOffset;		// Offset to *LAST* DirName in PathName
 	char			FileName[NAME_MAX + 1];	// Posix constant (Waay too big!)
@@ -527,6 +705,135 @@
 #undef _ED_PANEPOINTER
 #undef _ED_FRAMEPOINTER
 
+#define _ED_SAVEJOBPOINTER	struct _ED_SaveJobRecord *
+    typedef struct _ED_SaveJobRecord {
+	_ED_SAVEJOBPOINTER	NextP;			// Chain from ED_SavePendingP (main thread)
+	_ED_SAVEJOBPOINTER	NextQueueP;		// Chain from ED_SaveQueueP (ED_SaveMutex)
+	ED_BufferPointer	BufP;			// NULL if the Buf was killed meanwhile
+	Uns32			EditSeq;		// BufP->EditSeq at snapshot
+	Int32			Err;			// 0 or errno, set by worker
+	Int16			InPlace;		// Write over the file, no temp + rename
+	Int16			MapFree;		// No Buf maps it, may fall back to InPlace
+	Uns32			Batch;			// ED_CmdSaveBatch if from save-some-files, else 0
+	char *			DataP;			// Snapshot, both halves
+	struct iovec		IOVArr[2];		// Halves within DataP
+	char			FullPath[ED_FULLPATHLEN + 1];
+    } ED_SaveJobRecord, *ED_SaveJobPointer;
+#undef _ED_SAVEJOBPOINTER
+
+#define _ED_LOADPOINTER	struct _ED_LoadRecord *
+    typedef struct _ED_LoadRecord {
+	_ED_LOADPOINTER		NextP;			// Chain from ED_LoadFirstP
+	ED_BufferPointer	BufP;
+	pthread_t		Thread;
+	char *			MemP;			// BufP->BufStartP, for the worker
+	Uns32			Id;			// Stale pipe messages are ignored
+	Int32			FD;			// Dup, closed when reaped
+	Int64			Size;			// File size
+	Int64			DoneLen;		// Exposed so far (main thread)
+	Int16			Mapped;			// Fault in, rather than read
+	Int16			Percent;		// Last drawn progress
+	volatile Int16		Cancel;			// Set by main, worker stops
+	// Session positions past the first chunk, -1 if none (ED_SessionApply)
+	Int64			SessCursorPos;
+	Int64			SessPanePos;
+	Int64			SessMarkPos;
+	// Set by the worker before it exits, read after join
+	Int64			EndLen;
+	Int32			EndErr;
+	Int16			EndFilter;		// Saw CR or Tab
+    } ED_LoadRecord, *ED_LoadPointer;
+#undef _ED_LOADPOINTER
+
+    typedef struct {
+	Int64			StartPos;		// [StartPos, EndPos), never straddles the Gap
+	Int64			EndPos;
+	// Set by the scan function
+	Int64			Count;			// Newlines, Rows, or match Pos (-1 if none)
+	Int64			FirstNL;		// First and last '\n' Pos, -1 if none
+	Int64			LastNL;
+    } ED_PoolChunkRecord, *ED_PoolChunkPointer;
+
+    typedef void (*ED_PoolFuncP)(ED_BufferPointer BufP, ED_PoolChunkPointer CP);
+
+    typedef enum {
+	ED_POOLALL		= 0,			// Scan every chunk
+	ED_POOLFIRST,					// Want the first hit, skip chunks after it
+	ED_POOLLAST,					// Want the last hit, skip chunks before it
+    } ED_PoolMode;
+
+#define _ED_DIRPOINTER	struct _ED_DirRecord *
+    typedef struct _ED_DirRecord {
+	_ED_DIRPOINTER		NextP;			// Chain from ED_DirFirstP, most recent first
+	char **			NameArrP;		// Sorted names, NULL if not listed (or stale)
+	char *			MemP;			// The names themselves
+	Int32			Count;
+	Int32			WD;			// inotify watch, -1 if none
+	Uns32			Seq;			// Bumped on every change
+	Int16			Loading;		// Prefetch job in flight
+	struct timespec		MTime;			// Dir mtime when listed
+	char			Path[ED_BUFFERPATHLEN + 1];
+    } ED_DirRecord, *ED_DirPointer;
+
+    typedef struct {
+	ED_DirPointer		DirP;
+	Uns32			Seq;			// DirP->Seq when started
+	pthread_t		Thread;
+	// Set by the worker
+	char **			NameArrP;
+	char *			MemP;
+	Int32			Count;			// -1 if it failed
+	struct timespec		MTime;
+	char			Path[ED_BUFFERPATHLEN + 1];
+    } ED_DirJobRecord, *ED_DirJobPointer;
+#undef _ED_DIRPOINTER
+
+#define _ED_XSENDPOINTER	struct _ED_XSendRecord *
+    typedef struct _ED_XSendRecord {
+	_ED_XSENDPOINTER	NextP;			// Chain from ED_XSendFirstP
+	Window			Requestor;
+	Atom			Property;
+	Atom			Type;
+	char *			DataP;			// Data being sent
+	char *			ChunkP;			// KillRing chunk DataP is in, or NULL
+	char *			OwnP;			// Free when done--copy, or adopted chunk
+	Int64			OwnLen;			// PayloadPool size of OwnP
+	Int64			DataLen;
+	Int64			SentLen;		// Written to the property so far
+	Int64			DueTime;		// sc_ClockMSecs, next step by then
+    } ED_XSendRecord, *ED_XSendPointer;
+#undef _ED_XSENDPOINTER
+
+    typedef struct {
+	ED_PanePointer		PaneP;			// Asked for the paste, may be gone
+	ED_BufferPointer	BufP;			// NULL when idle
+	Atom			SelAtom;		// Also the property on ED_XSelWin
+	Atom			TypeAtom;		// UTF8_STRING, then STRING
+	Int64			InsertPos;
+	Int64			SelZap;			// SelRange bytes deleted first
+	Int64			Len;			// Filtered bytes staged at GapStartP (or SpillP)
+	char *			SpillP;			// Staged bytes, if the Gap had to move
+	Int64			SpillLen;		// Size of SpillP
+	Int32			Col;			// ED_AuxFilterCopy state
+	Int16			CR;
+	Int16			Started;		// Owner answered, Gap is staged
+	Int16			Incr;			// INCR blocks coming
+	Int64			DueTime;		// sc_ClockMSecs, next step by then
+    } ED_XRecvRecord;
+
+    typedef struct {					// Goes down ED_LoadPipeArr
+	Uns32			Id;
+	Int64			DoneLen;
+	Int16			Done;			// Last one, EndXXX are set
+    } ED_LoadMsgRecord;
+
+    typedef struct {					// Read by ED_MapSigBusHandler, any thread
+	char * volatile		StartP;			// NULL if free, else mapped file pages
+	volatile Int64		Len;			// File size when mapped
+	ED_BufferPointer	BufP;			// Main thread only
+	volatile sig_atomic_t	Damaged;		// Handler put in a zero page
+    } ED_MapSlotRecord, *ED_MapSlotPointer;
+
 typedef enum {
     ED_Black = 0,
     ED_White, ED_Touch, ED_TouchPlus, ED_LightGray, ED_Gray, ED_TitleGray,
@@ -546,6 +853,7 @@ typedef enum {
 typedef enum {
     ED_FRAMENOFLAG		= 0x00000000,
     ED_FRAMEFOCUSFLAG		= 0x00000001,		// Frame has focus
+    ED_FRAMEDIRTYFLAG		= 0x00000002,		// Whole Frame must be drawn, see ED_RenderHandler
     ED_FRAMENOWINFLAG		= 0x80000000,		// Do NOT draw/write
     ED_FRAMEINITFILTERFLAG	= 0x40000000,
     ED_FRAMEQRSOLIDCURSORFLAG	= 0x08000000,
@@ -555,17 +863,31 @@ typedef enum {
     ED_PANESOLIDCURSORFLAG	= 0x80000000,
     ED_PANEBOXCURSORFLAG	= 0x40000000,
     ED_PANESCROLLINGFLAG	= 0x00000001,
+    ED_PANEWINSTALEFLAG		= 0x00000002,		// XWin must be refreshed from BackPM
+    ED_PANEDIRTYFLAG		= 0x00000004,		// Pane text must be drawn, see ED_RenderHandler
+    ED_PANEROWESTFLAG		= 0x00000008,		// StartRowCount is an estimate, see ED_PaneRowsFix
     
     ED_BUFNOFLAG		= 0x00000000,
     ED_BUFNOFILEFLAG		= 0x00000001,		// Has no associated disk file
     ED_BUFINFOONLYFLAG		= 0x00000010,		// InfoOnly buffer, will kill when PaneRefCount == 0
     ED_BUFREADONLYFLAG		= 0x00000020,		// ReadONly buffer, will not allow WRITE
+    ED_BUFMAPPEDFLAG		= 0x00000040,		// BufStartP is mmapped file, NOT malloc
+    ED_BUFSAVINGFLAG		= 0x00000080,		// Save in flight, see ED_SaveQueueJob
+    ED_BUFLOADINGFLAG		= 0x00000100,		// Still loading, see ED_BufferLoadFile
+    ED_BUFPASTINGFLAG		= 0x00000200,		// XSel paste coming in, see ED_XSelInsertData
+    ED_BUFDAMAGEDFLAG		= 0x00000400,		// Mapped file shrank under it, see ED_MapSigBusHandler
     ED_BUFMODFLAG		= 0x80000000,		// Buffer was modified
     ED_BUFCLEANUNDOFLAG		= 0x40000000,		// Buffer is Unmodified--reset by Undo system!
     ED_BUFFILTERFLAG		= 0x20000000,		// Buffer was filtered (Tab+CR removed)
     ED_BUFNAMECOLFLAG		= 0x10000000,		// Buffer Filename collides with other buffers
 
     ED_US_NOFLAG		= 0x00000000,		// UndoSlab (US)
+    ED_US_FROZENFLAG		= 0x00000001,		// Header only, UBlocks are in the journal
+    ED_US_JOURNALFLAG		= 0x00000002,		// Has a (still valid) copy in the journal
+
+    ED_SESSNOFLAG		= 0x00000000,		// Session snapshot Entry
+    ED_SESSEXACTFLAG		= 0x00000001,		// Buf was the file, indexes are saved
+    ED_SESSCLEANFLAG		= 0x00000002,		// ...and it needed no filtering
 
 } ED_Flag;
 
@@ -581,6 +903,60 @@ typedef enum _ED_QRespType {
 } ED_QRespType;
 
 
+    // Log2 histogram, each power of 2 split into ED_HISTSUBCOUNT buckets, so
+    // a percentile read back off it is within 25%.  See ED_StatsHistAdd.
+    typedef struct _ED_HistRecord {
+	Uns64			Count;
+	Uns64			Sum;
+	Uns64			Max;
+	Uns32			BucketArr[ED_HISTBUCKETS];
+    } ED_HistRecord, *ED_HistPointer;
+
+    typedef enum {
+	ED_DrawHistId		= 0,			// NSecs, first input event to drawn
+	ED_RenderHistId,				// NSecs, per ED_PaneRender
+	ED_XReqHistId,					// X requests, per input event to drawn
+	ED_GapHistId,					// Bytes moved, per ED_BufferPlaceGap
+	ED_PoolHistId,					// NSecs, per ED_PoolRun
+	ED_HistCount
+    } ED_HistId;
+
+    // Session snapshot file: a Head, then Count Entries.  Each Entry is followed by
+    // its PathLen (8-aligned) path, LIdxCount ED_LIdxRecords, then RIdxCount times
+    // an ED_SessRIdxRecord with its Count ED_RIdxRecords.  See ED_SessionSave.
+    typedef struct {
+	Uns32			Tag;			// "SESS"
+	Uns32			Version;		// ED_SESSVERSION
+	Int32			Count;			// Entries
+	Int32			Pad;
+    } ED_SessHeadRecord, *ED_SessHeadPointer;
+
+    typedef struct {
+	Int64			Size;			// The file, when the snapshot was taken
+	Int64			MTime;			// nSecs
+	Int64			Dev;
+	Int64			Ino;
+	Int64			CursorPos;
+	Int64			PanePos;
+	Int64			MarkPos;
+	Int32			PathLen;		// With its 0, before padding
+	Int32			LIdxCount;		// 0 unless ED_SESSEXACTFLAG
+	Int32			RIdxCount;
+	Uns32			Flags;
+    } ED_SessEntryRecord, *ED_SessEntryPointer;
+
+    typedef struct {
+	Int32			RowChars;
+	Int32			Count;
+    } ED_SessRIdxRecord, *ED_SessRIdxPointer;
+
+#define _ED_STARTFILEPOINTER	struct _ED_StartFileRecord *
+    typedef struct _ED_StartFileRecord {
+	_ED_STARTFILEPOINTER	NextP;			// Chain from ED_StartFileFirstP
+	char			PathName[ED_FULLPATHLEN + 1];
+    } ED_StartFileRecord, *ED_StartFilePointer;
+#undef _ED_STARTFILEPOINTER
+
 #define _ED_FREGPOINTER struct _ED_FRegRecord *
 #define _ED_FBINDPOINTER struct _ED_FBindRecord *
 
@@ -606,6 +982,9 @@ typedef enum _ED_QRespType {
 	char *			NameP;				// Name string
 	ED_FRegFuncP		FuncP;				// Actual function
 	_ED_FBINDPOINTER	FirstBindP;			// Bindings (to KeyStr) if any
+	Uns32			CallCount;			// Stats, see ED_FRegExec
+	Int64			TotalNs;
+	Int64			MaxNs;
     } ED_FRegRecord, *ED_FRegPointer;
 
     typedef struct _ED_FBindRecord {
@@ -617,6 +996,28 @@ typedef enum _ED_QRespType {
 	char			KeyStr[ED_FBINDKEYSTRLEN];	// Actual key binding--Null delimited
     } ED_FBindRecord, *ED_FBindPointer;
 
+    // Trie over the FBind KeyStrs (and FReg Names), see ED_FRegCompile.  Edges
+    // live in a hash table keyed on (Parent Node, Byte), Nodes in an array.
+    typedef struct _ED_TrieEdgeRecord {
+	Uns32			Key;				// (Parent << 8) | Byte, 0 == Empty slot
+	Uns32			Node;				// Child Node (Root is 0)
+    } ED_TrieEdgeRecord, *ED_TrieEdgePointer;
+
+    typedef struct _ED_TrieNodeRecord {
+	void *			DataP;				// Entry ending exactly here, or NULL
+	void *			FirstP;				// First entry (sort order) under here
+	void *			LastP;				// Last entry under here
+    } ED_TrieNodeRecord, *ED_TrieNodePointer;
+
+    typedef struct _ED_TrieRecord {
+	ED_TrieEdgePointer	EdgeArrP;
+	Uns32			Slots;				// Power of 2, at most half full
+	Uns32			Shift;				// 64 - log2(Slots)
+	ED_TrieNodePointer	NodeArrP;
+	Uns32			NodeCount;			// == Edges + 1
+	Uns32			NodeMax;
+    } ED_TrieRecord, *ED_TriePointer;
+
 #undef _ED_FBINDPOINTER
 #undef _ED_FREGPOINTER
 
@@ -636,18 +1037,15 @@ typedef void (*ED_QRExitFuncP)(void);				// QR Exit (cleanup) function
 
     typedef struct _ED_KERecord {
 	Int32			Flags;
-	Int32			Pos;				// Offset in buffer
-	Int32			Len;				// Length of data
+	Int64			Pos;				// Offset in MemP
+	Int64			Len;				// Length of data
+	char *			MemP;				// Chunk owned by this entry (or NULL)
+	Int64			MemLen;				// Size of MemP
     } ED_KERecord, *ED_KEPointer;
 
 
     typedef struct _ED_KRRecord {
 	Uns32			Flags;
-	char *			TopP;				// Data for CUR kill
-	char *			RestP;				// Data for prev kills
-	Int32			TopLen;				// Len for TopP
-	Int32			RestLen;			// Len for RestP
-	Int32			RestDataLen;			// How much Data in RestP
 
 	Int16			TopI;				// Top--Index into Elts
 	Int16			YankI;				// Doodle dandy, Index to Yank (can be TopI)
@@ -714,7 +1112,8 @@ typedef void (*ED_QRExitFuncP)(void);				// QR Exit (cleanup) function
 // ******************************************************************************
 XftFont *			ED_XFP;				// Xft Font
 Display *			ED_XDP;				// X11 Display
-XIM				ED_XIMP;			// Input method
+XIM				ED_XIMP;			// Input method, NULL until needed
+Int16				ED_XIMOwned = 0;		// Opened here, close it too
 Atom				ED_XWMDelAtom;			// Client window Delete
 Atom				ED_PUExecAtom;			// Exec a cmd--from PU
 Atom				ED_ClipAtom;			// CLIPBOARD
@@ -759,10 +1158,10 @@ char				ED_ISStr[ED_ISSTRLEN] = "";	// Current search string--may get aborted
 Int32				ED_ISStrLen = 0;		// Length of ISStr
 Int16				ED_ISCaseSen = 0;		// 1 if CaseSensitive (ISStr includes Uppercase)
 char				ED_ISPrevStr[ED_ISSTRLEN] = "";	// Previous successful search
-Int32				ED_ISMatchPos = -1;		// Current Match Pos
-Int32				ED_ISSearchPos = -1;		// Where to start searching NEXT
-Int32				ED_ISAltPos = -1;		// Only if Alternate comes RIGHT AFTER MatchPos!
-Int32				ED_ISOriginPos = 0;		// Origin of the search
+Int64				ED_ISMatchPos = -1;		// Current Match Pos
+Int64				ED_ISSearchPos = -1;		// Where to start searching NEXT
+Int64				ED_ISAltPos = -1;		// Only if Alternate comes RIGHT AFTER MatchPos!
+Int64				ED_ISOriginPos = 0;		// Origin of the search
 Int16				ED_ISDoWrap = 0;		// Wrap around again
 
 ED_PanePointer			ED_QREPPaneP = NULL;			// QREP mode (QueryReplace) if not NULL
@@ -782,6 +1181,50 @@ char				ED_FullPath[ED_FULLPATHLEN + 1]; // Temp global, during file operations
 Int32				ED_FullPathLen;			// Temp global, during file operations
 Int32				ED_FD;				// Temp global, during file operations
 
+pthread_t			ED_SaveWorkerArr[ED_SAVEWORKERCOUNT];
+Int16				ED_SaveWorkerCount = 0;		// 0 until first save
+Int32				ED_SavePipeArr[2];		// Workers write done JobPs
+ED_SaveJobPointer		ED_SavePendingP = NULL;		// All Jobs in flight
+ED_SaveJobPointer		ED_SaveQueueP = NULL;		// Jobs not yet picked up
+pthread_mutex_t			ED_SaveMutex = PTHREAD_MUTEX_INITIALIZER;	// Guards Queue + Quit
+pthread_cond_t			ED_SaveCond = PTHREAD_COND_INITIALIZER;
+Int16				ED_SaveQuit = 0;
+Uns32				ED_SaveBatchTag = 0;		// Jobs get it as Batch
+Uns32				ED_CmdSaveBatch = 0;		// Bumped for each save-some-files
+Int16				ED_CmdSaveAsking = 0;		// Still asking about Bufs
+Int32				ED_CmdSaveFileCount;		// Written, counted by ED_SaveFinish
+Int32				ED_CmdSaveFileLeft;		// Queued, not finished yet
+
+pthread_t			ED_PoolWorkerArr[ED_POOLMAXWORKERS];
+Int16				ED_PoolWorkerCount = -1;	// -1 until first scan
+pthread_mutex_t			ED_PoolMutex = PTHREAD_MUTEX_INITIALIZER;	// Guards all ED_Pool below
+pthread_cond_t			ED_PoolCond = PTHREAD_COND_INITIALIZER;		// Workers wait for a new Gen
+pthread_cond_t			ED_PoolDoneCond = PTHREAD_COND_INITIALIZER;	// UI thread waits for Left == 0
+Uns32				ED_PoolGen = 0;			// Bumped for each scan
+Int16				ED_PoolQuit = 0;
+ED_PoolChunkRecord		ED_PoolArr[ED_POOLMAXCHUNKS + 1];	// +1 for the split at the Gap
+Int32				ED_PoolCount = 0;		// Chunks in ED_PoolArr
+Int32				ED_PoolNext;			// Next one to hand out
+Int32				ED_PoolLeft;			// Not yet done
+Int32				ED_PoolLow, ED_PoolHigh;	// Chunks outside are skipped
+ED_PoolMode			ED_PoolModeNow;
+ED_PoolFuncP			ED_PoolFunc;
+ED_BufferPointer		ED_PoolBufP;
+Int32				ED_PoolColLimit;		// For EDCB_PoolRows
+
+ED_DirPointer			ED_DirFirstP = NULL;		// Cached listings, see DIR CACHE
+Int32				ED_DirNotifyFD = -1;		// inotify, all the watches
+Int32				ED_DirPipeArr[2] = {-1, -1};	// Prefetch workers write done JobPs
+Int16				ED_DirJobCount = 0;		// Prefetches in flight
+
+ED_LoadPointer			ED_LoadFirstP = NULL;		// Loads in flight
+Int32				ED_LoadPipeArr[2] = {-1, -1};	// Workers write ED_LoadMsgRecords
+Uns32				ED_LoadIdCount = 0;
+
+ED_MapSlotRecord		ED_MapSlotArr[ED_MAPSLOTMAX];	// One per mapped Buf
+Int32				ED_MapPipeArr[2] = {-1, -1};	// ED_MapSigBusHandler writes a byte
+Int64				ED_MapPageSize = 0;
+
 ED_PanePointer			ED_QRPaneP = NULL;		// PaneP or NULL--THIS IS HOW WE KNOW QR MODE!!
 ED_QRRespFuncP			ED_QRRespFP = NULL;		// Callback to process response
 ED_QRAutoCompFuncP		ED_QRAutoCompFP = NULL;		// Callback for auto-complete!
@@ -814,22 +1257,37 @@ char				ED_TabStr[ED_TABSTOP + 1];	// String of spaces to replace Tab
 sc_SAStore			ED_PaneStore;			// Store to allocate Panes
 
 ED_PanePointer			ED_SelPaneP = NULL;		// Pane with Sel range, or NULL
-Int32				ED_SelMarkPos;			// SelRange is between Mark and Cursor
+Int64				ED_SelMarkPos;			// SelRange is between Mark and Cursor
 Int32				ED_SelMarkCol;			// Mark (Col, Row) can be OFF screen!
-Int32				ED_SelMarkRow;
-Int32				ED_SelLastRow;			// Used for drag-selecting region
+Int64				ED_SelMarkRow;
+Int64				ED_SelLastRow;			// Used for drag-selecting region
 Int32				ED_SelLastCol;
 
 ED_PanePointer			ED_LastSelPaneP	= NULL;		// Stash ED_SelPaneP when Frame loses focus
 
 sc_SAStore			ED_BufferStore;			// Store to allocate Buffer records
 ED_BufferPointer		ED_FirstBufP = NULL;		// Head of linked list
+Uns32				ED_RIdxUseCount = 0;		// LRU clock for RowIdx widths
 
 ED_KRRecord			ED_KillRing;			// One KillRing for everything!
+sc_SAPool			ED_PayloadPool;			// KillRing chunks and UndoSlabs
+sc_SAStore			ED_UStubStore;			// Frozen UndoSlab headers
+
+ED_HistRecord			ED_StatsHistArr[ED_HistCount];	// See STATS
+Int64				ED_StatsStartNs;		// When the editor came up
+Int64				ED_StartupNsArr[ED_StartCount];	// Startup phases, 0 until reached
+ED_StartFilePointer		ED_StartFileFirstP = NULL;	// Opened after the first paint
+ED_StartFilePointer		ED_StartFileLastP = NULL;
+char *				ED_SessMemP = NULL;		// Snapshot read at startup
+Int64				ED_SessLen = 0;
+char				ED_SessPath[ED_FULLPATHLEN + 1];	// Written back here at exit, "" if none
+Int64				ED_StatsInputNs = 0;		// First input not yet drawn, 0 if none
+Uns64				ED_StatsInputReq;		// NextRequest at that input
 
 char				ED_FrameTag[] = "FRAM";
 char				ED_PaneTag[] = "PANE";
 char				ED_BufTag[] = "BUFF";
+char				ED_SessTag[] = "SESS";
 char				ED_UndoTag[] = "UNDO";
 char				ED_TempBufName[32];		// Stash temp name here
 Int32				ED_TempBufCount = 1;		// Increment each time!
@@ -840,6 +1298,10 @@ ED_FRegPointer			ED_FirstFRegP = NULL;
 sc_SAStore			ED_FBindStore;
 ED_FBindPointer			ED_FirstBindP = NULL;
 
+ED_TrieRecord			ED_KeyTrie;			// FBind KeyStrs, compiled
+ED_TrieRecord			ED_NameTrie;			// FReg Names, compiled
+Int16				ED_FRegStale = 1;		// Tries need a re-compile
+
 ED_PURecord			ED_PUR;				// Just one for now
 
 
@@ -862,6 +1324,7 @@ char *				ED_STR_QueryReplaceNoDef	= "Query replace: ";
 char *				ED_STR_QueryReplaceWith		= "Query replace %.*s with: ";
 
 char *				ED_STR_TempBufName		= "*Temp_%d*";
+char *				ED_STR_StatsBufName		= "*Stats*";
 char *				ED_STR_Filtered			= "<Filtered>";
 char *				ED_STR_All			= "All";
 char *				ED_STR_Top			= "Top";
@@ -883,7 +1346,7 @@ char *				ED_STR_KillBuffer		= "Kill buffer (default %.*s): ";
 char *				ED_STR_ISearch			= " ISearch";
 char *				ED_STR_QReplace			= " QReplace";
 char *				ED_STR_BufInfoPath		= "Temp read-only info buffer!";
-char *				ED_STR_BufMemDisp		= "-:%c%c %d Data (%ld Memory) %d Undo Memory (%d Bytes)";
+char *				ED_STR_BufMemDisp		= "-:%c%c %ld Data (%ld Memory) %d Undo Memory (%ld Bytes)";
 
 
 char *				ED_STR_EchoErrorTemplate	= "%s  (Errno:%d)";
@@ -892,8 +1355,8 @@ char *				ED_STR_EchoMarkSet		= "Mark set";
 char *				ED_STR_EchoMarkPop		= "Mark popped";
 char *				ED_STR_EchoQuit			= "Quit";
 char *				ED_STR_EchoAbort		= "Aborted";
-char *				ED_STR_EchoCursorInfo		= "Char: %s %s Pos=%d of %d (%%%d) Loc:(%d,%d)";
-char *				ED_STR_EchoEOBCursorInfo	= "E-O-B Pos=%d of %d Loc:(%d,%d)";
+char *				ED_STR_EchoCursorInfo		= "Char: %s %s Pos=%ld of %ld (%%%ld) Loc:(%d,%ld) Line=%ld";
+char *				ED_STR_EchoEOBCursorInfo	= "E-O-B Pos=%ld of %ld Loc:(%d,%ld) Line=%ld";
 char *				ED_STR_EchoCmdUndef		= "%s%s is not a command!";
 char *				ED_STR_EchoCmdMatchFail		= "%sis undefined!";
 char *				ED_STR_EchoCmdBadNum		= "%sis too much!";
@@ -901,9 +1364,13 @@ char *				ED_STR_EchoBegBuf		= "Beginning of buffer";
 char *				ED_STR_EchoEndBuf		= "End of buffer";
 char *				ED_STR_EchoWrotePath		= "Wrote: %.*s";
 char *				ED_STR_EchoWroteName		= "Wrote: .../%.*s";
+char *				ED_STR_EchoWroteEdited		= "Wrote: .../%.*s (edited since, still modified)";
+char *				ED_STR_EchoSaving		= "Saving %.*s...";
+char *				ED_STR_EchoSaveInFlight		= "(Already saving this buffer.)";
 char *				ED_STR_EchoOpenFailed		= "Could not open file.";
 char *				ED_STR_EchoWriteFailed		= "Could not write file.";
 char *				ED_STR_EchoReadFailed		= "Could not read file.";
+char *				ED_STR_EchoMapDamaged		= "%.*s shrank on disk, read only (lost text is NULs)";
 char *				ED_STR_EchoNoChangeSave		= "(No changes need to be saved.)";
 char *				ED_STR_EchoModFlagSet		= "Modification-flag set";
 char *				ED_STR_EchoModFlagClear		= "Modification-flag cleared";
@@ -919,6 +1386,7 @@ char *				ED_STR_EchoIS			= "Search: %.*s";
 char *				ED_STR_EchoISFail		= "Failing search: %.*s";
 char *				ED_STR_EchoISBack		= "Search backward: %.*s";
 char *				ED_STR_EchoISBackFail		= "Failing search backward: %.*s";
+char *				ED_STR_EchoISCount		= "   [%ld matches]";
 char *				ED_STR_EchoQueryReplace		= "Query replacing %.*s with %.*s: [y n ! . <Ret>]";
 char *				ED_STR_EchoQueryReplaceDone	= "Replaced %d occurrences";
 char *				ED_STR_EchoUndoMemFreed		= "Cleared out some old Undo memory";
@@ -927,6 +1395,10 @@ char *				ED_STR_EchoBufNoUndo		= "Undo has been disabled, 'M-x reset-undo' to t
 char *				ED_STR_EchoUndoNoMore		= "Reached limit of Undo history";
 char *				ED_STR_EchoUndoReset		= "Undo memory has been reset, will record from here";
 char *				ED_STR_EchoReadOnly		= "Buffer is read only!";
+char *				ED_STR_EchoLoading		= "Buffer is still loading!";
+char *				ED_STR_EchoPasting		= "Paste still coming in!";
+char *				ED_STR_EchoLoaded		= "Loaded: %.*s";
+char *				ED_STR_Loading			= "Loading";
 char *				ED_STR_QueryLineNumber		= "Line number: ";
 char *				ED_STR_QueryCharNumber		= "Char number: ";
 char *				ED_STR_EchoSavedNFiles		= "Buffers saved: %d";
@@ -936,6 +1408,9 @@ char *				ED_STR_EchoSearchOriginMark	= "Mark saved where search started";
 // ******************************************************************************
 
 #define		ED_BUFFERISMIDUTF8(C)		(((Uns8)C & 0xC0) == 0x80)
+#define		ED_SCANONES			0x0101010101010101ULL
+#define		ED_SCANHIGHS			0x8080808080808080ULL
+#define		ED_SCANHASZERO(W)		(((W) - ED_SCANONES) & ~(W) & ED_SCANHIGHS)
 #define		ED_RANGELIMIT(X, Low, Hi)	do {if (X < (Low)) X = (Low);		   \
 						    else if (X > (Hi)) X = (Hi); } while (0);
 						    
@@ -945,8 +1420,14 @@ void		ED_FRegInit(void);
 void		ED_FRegKill(void);
 ED_FRegPointer	ED_FRegNewFunction(ED_FRegFuncP FuncP, char * NameP);
 ED_FBindPointer	ED_FRegNewBinding(ED_FRegPointer FRegP, char * KeyStrP);
-Int16		ED_FRegFindBinding(ED_FBindPointer *StartBPP, char * KeyStrP);
-Int16		ED_FRegBindCompare(register char * EntryP, register char * KeyStrP);
+void		ED_FRegExec(ED_FRegPointer FRegP, ED_PanePointer PaneP);
+ED_FRegPointer	ED_FRegFindFunc(ED_FRegFuncP FuncP);
+Int16		ED_FRegFindBinding(ED_FBindPointer *BindPP, char * KeyStrP);
+void		ED_FRegCompile(void);
+void		ED_TrieReset(ED_TriePointer TP);
+void		ED_TrieKill(ED_TriePointer TP);
+void		ED_TrieAdd(ED_TriePointer TP, char * StrP, void * DataP);
+ED_TrieNodePointer	ED_TrieFind(ED_TriePointer TP, char * StrP, Int32 Len);
 
 Int16		ED_KeyStrPrintExtKey(char * DestP, char Key);
 Int16		ED_KeyStrPrint(char * KeyStrP, char * DestP);
@@ -955,17 +1436,24 @@ void		ED_XSelInit(void);
 void		ED_XSelKill(void);
 Int16		ED_XSelInsertData(ED_PanePointer PaneP, Atom SelAtom);
 void		ED_XSelHandleEvent(XEvent * EventP, void * DataP);
+void		ED_XSelTimerFunc(void * DataP);
+Int16		ED_XSendChunkBusy(char * ChunkP);
+Int16		ED_XSendAdoptChunk(char * ChunkP, Int64 MemLen);
+void		ED_XSendFinish(ED_XSendPointer SendP);
+void		ED_XSendHandleEvent(XEvent * EventP, void * DataP);
+void		ED_XRecvAbort(void);
+void		ED_XRecvSpill(void);
 void		ED_XSelSetPrimary(ED_PanePointer PaneP);
 void		ED_XSelReleasePrimary(ED_BufferPointer BufP);
-void		ED_XSelAlterPrimary(ED_BufferPointer BufP, Int32 Pos, Int32 Len);
+void		ED_XSelAlterPrimary(ED_BufferPointer BufP, Int64 Pos, Int64 Len);
 void		ED_XSelSetClip(void);
 void		ED_XSelLostPrimary(void);
 void		ED_XSelLostClip(void);
 
 void		ED_KillRingInit(void);
 void		ED_KillRingFree(void);
-void		ED_KillRingAdd(char * DataP, Int32 DataLen, Int16 OpForward);
-void		ED_KillRingYank(Int32 PopCount, char **PP, Int32 *LenP, Int16 LoopForData);
+void		ED_KillRingAdd(char * DataP, Int64 DataLen, Int16 OpForward);
+void		ED_KillRingYank(Int32 PopCount, char **PP, Int64 *LenP, Int16 LoopForData);
 
 void		ED_FrameHandleEvent(XEvent * EventP, ED_FramePointer FP);
 void		ED_FrameHandleClick(ED_FramePointer FrameP, XEvent * EventP);
@@ -984,11 +1472,15 @@ void		ED_FrameGetWinSize(ED_FramePointer FrameP, Int32 * WidthP, Int32 * HeightP
 void		ED_FrameResetWinMinSize(ED_FramePointer FrameP);
 void		ED_FrameSetSize(ED_FramePointer FrameP, Int16 DoPanes);
 void		ED_FrameUpdateTextRows(ED_FramePointer FrameP, Int32 OldRowChars);
+Int16		ED_FrameReflowStep(void);
+void		ED_AuxFrameReflowPanes(ED_BufferPointer BufP, Int32 RowChars, Int16 Done);
 void		ED_FrameNew(Int32 WinWidth, Int32 WinHeight, ED_BufferPointer BufP);
 void		ED_FrameWinDestroyed(ED_FramePointer FrameP);
 void		ED_FrameKill(ED_FramePointer FrameP);
 void		ED_FrameKillAsk(ED_FramePointer FrameP);
 void		ED_FrameDrawAll(ED_FramePointer FrameP);
+void		ED_FrameRenderAll(ED_FramePointer FrameP);
+void		ED_FrameRender(ED_FramePointer FrameP);
 void		ED_FrameDrawEchoProgressBar(ED_FramePointer FrameP, char * LabelP, Int16 Percent);
 void		ED_FrameDrawEchoLine(ED_FramePointer FrameP);
 void		ED_FrameSetEchoS(Int16 Mode, char * SourceP);
@@ -1004,12 +1496,33 @@ void		ED_PaneKill(ED_PanePointer PaneP);
 Int16		ED_PaneResize(ED_PanePointer PaneP, Int32 Delta);
 void		ED_PaneUpdateStartPos(ED_PanePointer PaneP, Int32 OldRowChars);
 void		ED_PaneUpdateAllPos(ED_PanePointer PaneP, Int32 MoveCursor);
+void		ED_PaneRowsFix(ED_PanePointer PaneP);
 void		ED_PaneDrawBlinker(ED_PanePointer PaneP);
 void		ED_PaneEraseCursor(ED_PanePointer FrameP);
 void		ED_PaneDrawCursor(ED_PanePointer PaneP, Int16 Box);
-char *		ED_PaneGetDrawRow(ED_PanePointer PaneP, Int32 *PosP, Int32 *ColP, Int32 *CountP, Int16 * WrapP, Int16 * PartialP);
+char *		ED_PaneGetDrawRow(ED_PanePointer PaneP, Int64 *PosP, Int32 *ColP, Int32 *CountP, Int16 * WrapP, Int16 * PartialP);
 void		ED_PaneDrawText(ED_PanePointer PaneP);
-void		ED_PaneDrawBackground(ED_PanePointer PaneP, Int32 Row, Int32 LineY);
+void		ED_PaneRender(ED_PanePointer PaneP);
+void		ED_PaneDrawBackground(ED_PanePointer PaneP, ED_PDTRowPointer RP, Int32 LineY);
+Int16		ED_PaneGetSelCols(ED_PanePointer PaneP, Int32 Row, Int32 * StartColP, Int32 * EndColP);
+void		ED_PaneRowCacheCheck(ED_PanePointer PaneP, Int32 Rows);
+Int16		ED_PaneRowCacheScroll(ED_PanePointer PaneP, Int32 Rows);
+void		ED_PaneRowCacheFree(ED_PanePointer PaneP);
+void		ED_FrameRowCacheReset(ED_FramePointer FrameP);
+void		ED_FrameSetWinStale(ED_FramePointer FrameP);
+void		ED_FrameCheckBackPM(ED_FramePointer FrameP);
+void		ED_PDTAddFill(Int16 Fill, Int32 X, Int32 Y, Int32 Width, Int32 Height);
+void		ED_PDTAddGlyphs(char * CharP, Int32 Len, Int32 X, Int32 Y);
+void		ED_PDTFlushBatch(ED_FramePointer FrameP);
+Uns64		ED_UtilHash(Uns64 Hash, void * DataP, Int32 Len);
+Uns32		ED_UtilUTF8ToUcs4(char * CharP, Int16 Len);
+Int32		ED_UtilLZCompress(char * SrcP, Int32 Len, char * DstP);
+Int32		ED_UtilLZExpand(char * SrcP, Int32 SrcLen, char * DstP, Int32 DstLen);
+void		ED_GlyphCacheInit(XftFont * XFP);
+void		ED_GlyphCacheFree(void);
+ED_GlyphPointer	ED_GlyphFindSlot(ED_GlyphPointer ArrP, Int32 Max, Uns32 Ucs);
+FT_UInt		ED_GlyphIndex(Uns32 Ucs);
+void		ED_GlyphDrawRun(XftDraw * XftDP, Int16 Color, Int32 X, Int32 Y, char * CharP, Int32 Len);
 void		ED_PaneDrawModeLine(ED_PanePointer PaneP);
 void		ED_PaneMakeModeWin(ED_PanePointer PaneP);
 void		ED_PaneKillModeWin(ED_PanePointer PaneP);
@@ -1018,60 +1531,145 @@ void		ED_PaneModeWinHandleEvent(XEvent * EventP, ED_PanePointer PaneP);
 void		ED_PaneMakeScrollWin(ED_PanePointer PaneP);
 void		ED_PaneKillScrollWin(ED_PanePointer PaneP);
 void		ED_PanePositionScrollBar(ED_PanePointer PaneP);
+Int64		ED_AuxFixDiv(Int64 Num, Int64 Den);
+Int64		ED_AuxFixMul(Int64 Fix, Int64 N);
 void		ED_PaneSetScrollBar(ED_PanePointer PaneP);
 void		ED_PaneDrawScrollBar(ED_PanePointer PaneP, Int16 Grabbed);
 void		ED_PaneScrollWinHandleEvent(XEvent * EventP, ED_PanePointer PaneP);
 Int32		ED_PaneScrollByThumb(ED_PanePointer PaneP, Int32 Delta);
-void		ED_PaneScrollByRow(ED_PanePointer PaneP, XEvent * EventP, Int32 DeltaRow);
-void		ED_PaneMoveCursorAfterScroll(ED_PanePointer PaneP, Int32 DeltaRow);
-void		ED_PaneMoveAfterCursorMove(ED_PanePointer PaneP, Int32 CursorRowStartPos, Int32 DeltaRow, Int16 ForceSetScroll);
-void		ED_PaneMoveForCursor(ED_PanePointer PaneP, Int32 CursorRowStartPos, Int32 NewCursorRow);
+void		ED_PaneScrollByRow(ED_PanePointer PaneP, XEvent * EventP, Int64 DeltaRow);
+void		ED_PaneMoveCursorAfterScroll(ED_PanePointer PaneP, Int64 DeltaRow);
+void		ED_PaneMoveAfterCursorMove(ED_PanePointer PaneP, Int64 CursorRowStartPos, Int64 DeltaRow, Int16 ForceSetScroll);
+void		ED_PaneMoveForCursor(ED_PanePointer PaneP, Int64 CursorRowStartPos, Int64 NewCursorRow);
 
-void		ED_PaneHandleClick(ED_PanePointer PaneP, Int32 Row, Int32 Col, Int16 Shift, Int16 Count);
+void		ED_PaneHandleClick(ED_PanePointer PaneP, Int64 Row, Int32 Col, Int16 Shift, Int16 Count);
 void		ED_PaneHandleDrag(ED_PanePointer PaneP);
 void		ED_PaneHandleRelease(ED_PanePointer PaneP);
 void		ED_PaneInsertPrimary(ED_PanePointer PaneP);
-void		ED_PaneHandleDragMotion(ED_PanePointer PaneP, Int32 Row, Int32 Col);
-Int32	ED_PaneFindLoc(ED_PanePointer PaneP, Int32 Pos, Int32 *RowP, Int32 *ColP, Int16 FromZero, Int16 PaneLimit);
-Int32	ED_PaneFindPos(ED_PanePointer PaneP, Int32 *PosP, Int32 *RowP, Int32 *ColP, Int16 FromPane, Int16 FixOffBottom);
-Int32		ED_PaneDelSelRange(ED_PanePointer PaneP, Int16 DoUpdate);
-void		ED_PaneShowOpenParen(ED_PanePointer PaneP, char CloseC, Int32 ParenPos);
-void		ED_PaneInsertChars(ED_PanePointer PaneP, Int32 Count, char * StrP, Int16 Typed);
+void		ED_PaneHandleDragMotion(ED_PanePointer PaneP, Int64 Row, Int32 Col);
+Int64	ED_PaneFindLoc(ED_PanePointer PaneP, Int64 Pos, Int64 *RowP, Int32 *ColP, Int16 FromZero, Int16 PaneLimit);
+Int64	ED_PaneFindPos(ED_PanePointer PaneP, Int64 *PosP, Int64 *RowP, Int32 *ColP, Int16 FromPane, Int16 FixOffBottom);
+Int64		ED_PaneDelSelRange(ED_PanePointer PaneP, Int16 DoUpdate);
+void		ED_PaneShowOpenParen(ED_PanePointer PaneP, char CloseC, Int64 ParenPos);
+void		ED_PaneInsertChars(ED_PanePointer PaneP, Int64 Count, char * StrP, Int16 Typed);
+void		ED_PaneInsertGapChars(ED_PanePointer PaneP, Int64 Size, Int64 SelZap, Int16 IsPaste);
 void		ED_PaneInsertBufferChars(ED_PanePointer PaneP, ED_BufferPointer TempBufP, Int16 IsPaste);
-void		ED_PaneUpdateOtherPanes(ED_PanePointer PaneP, Int32 InsertPos, Int32 InsertCount);
-void			ED_PaneUpdateOtherPanesIncrBasic(ED_PanePointer PaneP, Int32 InsertPos, Int32 InsertCount);
+void		ED_PaneUpdateOtherPanes(ED_PanePointer PaneP, Int64 InsertPos, Int64 InsertCount);
+void			ED_PaneUpdateOtherPanesIncrBasic(ED_PanePointer PaneP, Int64 InsertPos, Int64 InsertCount);
 void			ED_PaneUpdateOtherPanesIncrRest(ED_PanePointer PaneP);
 
-void		ED_BufferPushMark(ED_BufferPointer BufP, Int32 Pos);
-Int32		ED_BufferGetMark(ED_BufferPointer BufP, Int16 DoPop);
-Int32		ED_BufferGetDiffMark(ED_BufferPointer BufP, Int32 NotPos);
-Int32		ED_BufferSwapMark(ED_BufferPointer BufP, Int32 NewPos);
-void		ED_BufferUpdateMark(ED_BufferPointer BufP, Int32 Pos, Int32 Delta);
-ED_BufferPointer	ED_BufferNew(Int32 InitSize, char * FileNameP, char * PathNameP, Int16 InfoOnly);
+void		ED_BufferPushMark(ED_BufferPointer BufP, Int64 Pos);
+Int64		ED_BufferGetMark(ED_BufferPointer BufP, Int16 DoPop);
+Int64		ED_BufferGetDiffMark(ED_BufferPointer BufP, Int64 NotPos);
+Int64		ED_BufferSwapMark(ED_BufferPointer BufP, Int64 NewPos);
+void		ED_BufferUpdateMark(ED_BufferPointer BufP, Int64 Pos, Int64 Delta);
+ED_BufferPointer	ED_BufferNew(Int64 InitSize, char * FileNameP, char * PathNameP, Int16 InfoOnly);
 ED_BufferPointer	ED_BufferReadFile(Int32 FD, char * NameP, char * PathP);
+Int16			ED_BufferMapFile(ED_BufferPointer BufP, Int32 FD, Int64 Size);
+ED_BufferPointer	ED_BufferLoadFile(Int32 FD, char * NameP, char * PathP);
+void *			ED_LoadWorkerFunc(void * ArgP);
+void			ED_LoadDoneHandler(Int32 FD, Int16 REvents, void * DataP);
+void			ED_LoadExpose(ED_LoadPointer LoadP, Int64 DoneLen);
+void			ED_LoadEnd(ED_LoadPointer LoadP);
+Int16			ED_AuxLoadSessPos(ED_LoadPointer LoadP);
+void			ED_LoadReap(ED_LoadPointer LoadP);
+ED_LoadPointer		ED_LoadFind(ED_BufferPointer BufP);
+void			ED_LoadWait(ED_BufferPointer BufP);
+void			ED_LoadStop(ED_BufferPointer BufP);
+Int16			ED_BufferLoading(ED_BufferPointer BufP);
+void			ED_BufferUnmap(ED_BufferPointer BufP);
+void			ED_BufferUnmapPath(char * PathP);
+Int16			ED_BufferPathMapped(char * PathP);
+void			ED_MapInit(void);
+Int16			ED_MapSlotAdd(ED_BufferPointer BufP, char * StartP, Int64 Len);
+void			ED_MapSlotDrop(ED_BufferPointer BufP);
+void			ED_MapSigBusHandler(int Sig, siginfo_t * InfoP, void * CtxP);
+void			ED_MapDamageHandler(Int32 FD, Int16 REvents, void * DataP);
+void			ED_MapCheck(void);
+void			ED_AuxMapDamaged(ED_BufferPointer BufP);
+void			ED_BufferFreeMem(ED_BufferPointer BufP);
 void		ED_BufferKill(ED_BufferPointer BufP);
+void		ED_BufferUpdateModeLines(ED_BufferPointer TheBufP);
 
 void		ED_BufferDidSave(ED_BufferPointer BufP, ED_FramePointer ThisFrameP);
 void		ED_BufferDidWrite(ED_BufferPointer BufP, ED_FramePointer ThisFrameP);
-void		ED_BufferPlaceGap(ED_BufferPointer BufP, Int32 Offset, Int32 Len);
+void		ED_BufferPlaceGap(ED_BufferPointer BufP, Int64 Offset, Int64 Len);
 Int16		ED_BufferGetUTF8Len(char C);
 Int16		ED_BufferCIsAlpha(register char C);
-char *		ED_BufferPosToPtr(ED_BufferPointer BufP, Int32 Pos);
-Int32	ED_BufferGetPosPlusRows(ED_BufferPointer BufP, Int32 Pos, Int32 *RowsP, Int32 ColLimit);	
-Int32	ED_BufferGetPosMinusRows(ED_BufferPointer BufP, Int32 Pos, Int32 *RowsP, Int32 ColLimit);
-Int32		ED_BufferFillStr(ED_BufferPointer BufP, char * StrP, Int32 StartPos, Int32 MaxLen, Int16 NoNL);
-Int32		ED_BufferGetRowStartPos(ED_BufferPointer BufP, Int32 OldPos, Int32 Col);
-Int32		ED_BufferGetLineStartPos(ED_BufferPointer BufP, Int32 OldPos);
-Int32		ED_BufferGetLineEndPos(ED_BufferPointer BufP, Int32 OldPos);
-Int32		ED_BufferGetLineLen(ED_BufferPointer BufP, Int32 Pos, Int16 BeforeToo);
-void		ED_BufferGetLineCount(ED_BufferPointer BufP, Int32 *PosP, Int32 *CountP);
+char *		ED_BufferPosToPtr(ED_BufferPointer BufP, Int64 Pos);
+Int64	ED_BufferGetPosPlusRows(ED_BufferPointer BufP, Int64 Pos, Int64 *RowsP, Int32 ColLimit);	
+Int64	ED_BufferGetPosMinusRows(ED_BufferPointer BufP, Int64 Pos, Int64 *RowsP, Int32 ColLimit);
+Int32		ED_BufferFillStr(ED_BufferPointer BufP, char * StrP, Int64 StartPos, Int32 MaxLen, Int16 NoNL);
+Int64		ED_BufferGetRowStartPos(ED_BufferPointer BufP, Int64 OldPos, Int32 Col);
+Int64		ED_BufferGetLineStartPos(ED_BufferPointer BufP, Int64 OldPos);
+Int64		ED_BufferGetLineEndPos(ED_BufferPointer BufP, Int64 OldPos);
+Int64		ED_BufferGetLineLen(ED_BufferPointer BufP, Int64 Pos, Int16 BeforeToo);
+void		ED_BufferGetLineCount(ED_BufferPointer BufP, Int64 *PosP, Int64 *CountP);
+void		ED_BufferLIdxKill(ED_BufferPointer BufP);
+void		ED_BufferLIdxReset(ED_BufferPointer BufP);
+void		ED_BufferLIdxUpdate(ED_BufferPointer BufP, Int64 Pos, Int64 Delta, char * DataP);
+Int64		ED_BufferPosToLine(ED_BufferPointer BufP, Int64 Pos);
+Int64		ED_BufferLineToPos(ED_BufferPointer BufP, Int64 Line);
+Int64		ED_AuxCountNL(char * DataP, Int64 Len);
+Int64		ED_BufferFindNextNL(ED_BufferPointer BufP, Int64 Pos, Int64 EndPos);
+void		ED_BufferLIdxInit(ED_BufferPointer BufP);
+void		ED_BufferLIdxInsert(ED_BufferPointer BufP, Int32 Index, Int64 Pos, Int64 Line);
+Int32		ED_BufferLIdxFind(ED_BufferPointer BufP, Int64 Value, Int16 ByLine);
+Int64		ED_AuxRIdxCountRows(ED_BufferPointer BufP, Int32 ColLimit, Int64 StartPos, Int64 EndPos);
+Int32		ED_AuxRIdxFind(ED_RIdxWidthPointer WP, Int64 Pos);
+void		ED_AuxRIdxInsert(ED_RIdxWidthPointer WP, Int32 Index, Int64 Pos, Int64 Row);
+void		ED_AuxRIdxResolve(ED_BufferPointer BufP, ED_RIdxWidthPointer WP);
+ED_RIdxWidthPointer	ED_BufferRIdxGet(ED_BufferPointer BufP, Int32 RowChars);
+void		ED_BufferRIdxUpdate(ED_BufferPointer BufP, Int64 Pos, Int64 Delta);
+void		ED_BufferRIdxReflow(ED_BufferPointer BufP, ED_RIdxWidthPointer WP);
+Int16		ED_BufferRIdxReflowStep(ED_BufferPointer BufP, ED_RIdxWidthPointer WP);
+Int64		ED_AuxRIdxEstRows(ED_RIdxWidthPointer WP, Int64 Len);
+void		ED_BufferRIdxReset(ED_BufferPointer BufP);
+void		ED_BufferRIdxKill(ED_BufferPointer BufP);
+void		ED_AuxPIdxCount(char * CurP, char * EndP, Int64 * DepthArr, Int64 * MinArr);
+void		ED_AuxPIdxCountRange(ED_BufferPointer BufP, Int64 Pos, Int64 EndPos, Int64 * DepthArr, Int64 * MinArr);
+Int64		ED_AuxPIdxScanBack(ED_BufferPointer BufP, Int64 Pos, Int64 EndPos, char OpenC, char CloseC, Int64 * PCountP);
+void		ED_BufferPIdxInit(ED_BufferPointer BufP);
+void		ED_BufferPIdxKill(ED_BufferPointer BufP);
+void		ED_BufferPIdxReset(ED_BufferPointer BufP);
+Int32		ED_AuxPIdxFind(ED_BufferPointer BufP, Int64 Pos);
+Int32		ED_AuxPIdxCountSeg(ED_BufferPointer BufP, Int32 Index, Int64 EndPos);
+Int32		ED_AuxPIdxClean(ED_BufferPointer BufP, Int32 Index);
+void		ED_BufferPIdxUpdate(ED_BufferPointer BufP, Int64 Pos, Int64 Delta, char * DataP);
+Int64		ED_BufferPIdxFindOpen(ED_BufferPointer BufP, char CloseC, Int64 ParenPos);
 void		ED_BufferCheckNameCol(ED_BufferPointer BufP);
 ED_BufferPointer	ED_BufferFindByName(char * NameP, char * PathP);
 Int16		ED_BufferWriteFile(ED_BufferPointer BufP, Int32 FD);
+Int16		ED_UtilWriteV(Int32 FD, struct iovec * IOVArr, Int32 Count);
+void *			ED_SaveWorkerFunc(void * ArgP);
+Int32			ED_SaveWriteJob(ED_SaveJobPointer JobP);
+void			ED_SaveInit(void);
+void			ED_SaveKill(void);
+Int32			ED_SaveQueueJob(ED_BufferPointer BufP);
+void			ED_SaveDoneHandler(Int32 FD, Int16 REvents, void * DataP);
+void			ED_SaveFinish(ED_SaveJobPointer JobP);
+void			ED_SaveDetach(ED_BufferPointer BufP);
+Int16			ED_AuxSaveInPlace(char * PathP);
+void			ED_AuxSaveSomeReport(void);
+void *			ED_PoolWorkerFunc(void * ArgP);
+void			ED_PoolInit(void);
+void			ED_PoolKill(void);
+Int16			ED_PoolWanted(Int64 Len);
+void			ED_AuxPoolSplit(ED_BufferPointer BufP, Int64 StartPos, Int64 EndPos);
+void			ED_PoolRun(ED_BufferPointer BufP, Int64 StartPos, Int64 EndPos, ED_PoolFuncP FuncP, ED_PoolMode Mode);
+void			ED_AuxPoolTake(Uns32 Gen);
+void			EDCB_PoolCountNL(ED_BufferPointer BufP, ED_PoolChunkPointer CP);
+void			EDCB_PoolRows(ED_BufferPointer BufP, ED_PoolChunkPointer CP);
+void			EDCB_PoolFilter(ED_BufferPointer BufP, ED_PoolChunkPointer CP);
+void			EDCB_PoolISForward(ED_BufferPointer BufP, ED_PoolChunkPointer CP);
+void			EDCB_PoolISBackward(ED_BufferPointer BufP, ED_PoolChunkPointer CP);
+Int64			ED_AuxPoolRows(ED_BufferPointer BufP, ED_RIdxWidthPointer WP, Int32 *IndexP, Int64 Pos, Int64 EndPos, Int64 *RowP);
 Int16		ED_BufferNeedsFilter(ED_BufferPointer BufP);
 void		ED_BufferDoFilter(ED_BufferPointer BufP, void (*UpdateFuncP)(Int16, void *), void * DataP);
+Int64		ED_AuxFilterSize(char * SrcP, Int64 Len);
+Int64		ED_AuxFilterCopy(char * DestP, char * SrcP, Int64 Len, Int32 * ColP, Int16 * CRP);
 void			EDCB_FilterEchoUpdate(Int16 Percent, void * DataP);
-Int32		ED_BufferInsertLine(ED_BufferPointer BufP, Int32 Pos, char * StrP);
+Int64		ED_BufferInsertLine(ED_BufferPointer BufP, Int64 Pos, char * StrP);
 Int16		ED_BufferReadOnly(ED_BufferPointer BufP);
 
 void		ED_CmdSplitPane(ED_PanePointer PaneP);
@@ -1139,19 +1737,47 @@ void		ED_CmdDeleteOtherFrames(ED_PanePointer PaneP);
 void		ED_CmdISearch(ED_PanePointer PaneP);
 void		ED_CmdISearchBack(ED_PanePointer PaneP);
 Int16			ED_ISHandleChars(ED_FramePointer FrameP, Uns16 SymChar, Int16 Mods, Int32 StrLen, char *StrP);
-Int16			ED_ISCheckMatch(ED_BufferPointer BufP, Int32 Pos);
+Int16			ED_ISCheckMatch(ED_BufferPointer BufP, Int64 Pos);
+void			ED_ISPrepare(void);
+Int16			ED_ISEngCompare(Uns8 * TextP);
+Int64			ED_ISEngForward(char * TextP, Int64 First, Int64 Last);
+Int64			ED_ISEngBackward(char * TextP, Int64 First, Int64 Last);
+Int64			ED_ISFindRange(ED_BufferPointer BufP, Int64 FirstPos, Int64 LastStart);
+Int64			ED_ISFindRangeBack(ED_BufferPointer BufP, Int64 FirstPos, Int64 LastStart);
+Int64			ED_AuxISFindRange(ED_BufferPointer BufP, Int64 FirstPos, Int64 LastStart);
+Int64			ED_AuxISFindRangeBack(ED_BufferPointer BufP, Int64 FirstPos, Int64 LastStart);
+void			ED_ISSetUpdate(ED_PanePointer PaneP);
+void			ED_ISSetInvalidate(ED_BufferPointer BufP);
+Int16			ED_ISSetIsMatch(ED_BufferPointer BufP, Int64 Pos);
+Int16			ED_ISCountStep(void);
+void			ED_ISEcho(void);
 void			ED_ISAbortOut(char * MsgP);
 void		ED_CmdQueryReplace(ED_PanePointer PaneP);
 Int16			ED_QREPHandleChars(ED_FramePointer FrameP, Uns16 SymChar, Int16 Mods);
 void			ED_QREPAbortOut(char * MsgP);
+void			ED_QREPReplaceAll(void);
 void		ED_CmdUndo(ED_PanePointer PaneP);
 void		ED_CmdResetUndo(ED_PanePointer PaneP);
 void		ED_CmdDisableUndo(ED_PanePointer PaneP);
 void			ED_BufferInitUndo(ED_BufferPointer BufP);
 void			ED_BufferKillUndo(ED_BufferPointer BufP);
-void			ED_BufferAddUndoBlock(ED_BufferPointer BufP, Int32 Pos, Int32 Len, Uns8 Mode, char * DataP);
+void			ED_UndoJournalKill(void);
+void			ED_BufferEditUpdate(ED_BufferPointer BufP, Int64 Pos, Int64 Delta, char * DataP);
+void			ED_BufferAddUndoBlock(ED_BufferPointer BufP, Int64 Pos, Int64 Len, Uns8 Mode, char * DataP);
+
+void		ED_StatsHistAdd(ED_HistId Id, Uns64 Value);
+void		ED_StatsMarkInput(void);
+void		ED_StatsReport(void (*LineFP)(char *, void *), void * DataP);
+Int16		ED_StartupStep(void);
+void		ED_SessionSave(void);
+Int16		ED_SessionApply(ED_BufferPointer BufP, Int32 FD, char * FullPathP);
+ED_SessEntryPointer	ED_AuxSessNext(Int64 * OffP);
+Int16		ED_AuxSessIdxCheck(Int64 * ArrP, Int32 Count, Int64 LastPos);
+void		ED_CmdShowStats(ED_PanePointer PaneP);
+void		ED_CmdDumpStats(ED_PanePointer PaneP);
 
 void		ED_XWinCreate(ED_FramePointer FP);
+XIC		ED_AuxFrameXIC(ED_FramePointer FP);
 void		ED_ColorArrCreate(void);
 void		ED_ColorArrDestroy(void);
 
@@ -1164,6 +1790,8 @@ void		ED_FrameQRDrawCursor(ED_FramePointer FrameP, Int16 Box);
 void		ED_FrameQRAbortOut(char * MsgP);
 void		ED_FrameQRHandleChars(ED_FramePointer FrameP, Uns16 SymChar, Int16 Mods, Int32 StrLen, char * StrP);
 Int16		EDCB_QRAutoCompPathFunc(void);
+void		ED_DirPrefetchResp(void);
+void		ED_DirCacheKill(void);
 
 void		ED_PUListConfigure(ED_PUPointer PUP, char * TitleP, Int32 TitleLen,
 				   Int32 EntryTotal, Int32 EntryRows, Int32 LeftColChars);
@@ -1201,6 +1829,160 @@ char *		ED_UtilGetLastStrSlash(char * Str)
     return LastP;
 }
 
+// FNV-1a hash of Len bytes at DataP, continuing from Hash (start with ED_HASHSEED).
+Uns64		ED_UtilHash(Uns64 Hash, void * DataP, Int32 Len)
+{
+    Uns8 *	P = (Uns8 *)DataP;
+    Uns8 *	EndP = P + Len;
+
+    while (P < EndP) {
+	Hash ^= *P++;
+	Hash *= ED_HASHPRIME;
+    }
+
+    return Hash;
+}
+
+// LZ compression, in the LZ4 block format (no frame).  Fast and simple, meant
+// for Undo slabs, which are mostly text.  DstP must have room for
+// ED_LZBOUND(Len) bytes, returns the compressed length.
+//
+// Same rules as LZ4: the last match starts at least 12 bytes before the end,
+// and the last 5 bytes are always literals.
+
+Int32		ED_UtilLZCompress(char * SrcP, Int32 Len, char * DstP)
+{
+    Int32	HashArr[1 << ED_LZHASHBITS];
+    Uns8 *	SrcStartP = (Uns8 *)SrcP;
+    Uns8 *	IP = SrcStartP;
+    Uns8 *	AnchorP = IP;
+    Uns8 *	EndP = IP + Len;
+    Uns8 *	OP = (Uns8 *)DstP;
+    Uns8 *	RefP;
+    Uns8 *	TokenP;
+    Uns32	Seq, H;
+    Int32	LitLen, MatchLen, Off, I;
+
+    for (I = 0; I < (1 << ED_LZHASHBITS); I++) HashArr[I] = -1;
+
+    while (EndP - IP > 12) {
+	memcpy(&Seq, IP, 4);
+	H = (Seq * 2654435761U) >> (32 - ED_LZHASHBITS);
+	RefP = (HashArr[H] >= 0) ? SrcStartP + HashArr[H] : NULL;
+	HashArr[H] = IP - SrcStartP;
+	if ((RefP == NULL) || (IP - RefP > 0xFFFF) || memcmp(RefP, IP, 4)) {
+	    IP++;
+	    continue;
+	}
+
+	MatchLen = 4;
+	while ((EndP - (IP + MatchLen) > 5) && (IP[MatchLen] == RefP[MatchLen])) MatchLen++;
+
+	// Token, literals, offset, then the extra match len.
+	LitLen = IP - AnchorP;
+	TokenP = OP++;
+	*TokenP = ((LitLen >= 15) ? 15 : LitLen) << 4;
+	if (LitLen >= 15) {
+	    for (I = LitLen - 15; I >= 255; I -= 255) *OP++ = 255;
+	    *OP++ = I;
+	}
+	memcpy(OP, AnchorP, LitLen);
+	OP += LitLen;
+
+	Off = IP - RefP;
+	*OP++ = Off & 0xFF;
+	*OP++ = Off >> 8;
+
+	I = MatchLen - 4;
+	*TokenP |= (I >= 15) ? 15 : I;
+	if (I >= 15) {
+	    for (I -= 15; I >= 255; I -= 255) *OP++ = 255;
+	    *OP++ = I;
+	}
+
+	IP += MatchLen;
+	AnchorP = IP;
+    }
+
+    // Last literals
+    LitLen = EndP - AnchorP;
+    TokenP = OP++;
+    *TokenP = ((LitLen >= 15) ? 15 : LitLen) << 4;
+    if (LitLen >= 15) {
+	for (I = LitLen - 15; I >= 255; I -= 255) *OP++ = 255;
+	*OP++ = I;
+    }
+    memcpy(OP, AnchorP, LitLen);
+    OP += LitLen;
+
+    return OP - (Uns8 *)DstP;
+}
+
+// ED_UtilLZExpand returns the expanded length, or -1 if SrcP is corrupt or
+// would overrun DstLen.
+
+Int32		ED_UtilLZExpand(char * SrcP, Int32 SrcLen, char * DstP, Int32 DstLen)
+{
+    Uns8 *	IP = (Uns8 *)SrcP;
+    Uns8 *	IEndP = IP + SrcLen;
+    Uns8 *	OP = (Uns8 *)DstP;
+    Uns8 *	OEndP = OP + DstLen;
+    Uns8 *	RefP;
+    Int32	Len, Off;
+    Uns8	Token;
+
+    while (IP < IEndP) {
+	Token = *IP++;
+
+	Len = Token >> 4;
+	if (Len == 15) {
+	    do {
+		if (IP >= IEndP) return -1;
+		Len += *IP;
+	    } while (*IP++ == 255);
+	}
+	if ((IEndP - IP < Len) || (OEndP - OP < Len)) return -1;
+	memcpy(OP, IP, Len);
+	IP += Len, OP += Len;
+	if (IP == IEndP) break;				// Last literals
+
+	if (IEndP - IP < 2) return -1;
+	Off = IP[0] | (IP[1] << 8);
+	IP += 2;
+	if ((Off == 0) || (Off > OP - (Uns8 *)DstP)) return -1;
+	RefP = OP - Off;
+
+	Len = Token & 15;
+	if (Len == 15) {
+	    do {
+		if (IP >= IEndP) return -1;
+		Len += *IP;
+	    } while (*IP++ == 255);
+	}
+	Len += 4;
+	if (OEndP - OP < Len) return -1;
+	while (Len--) *OP++ = *RefP++;			// May overlap, byte by byte
+    }
+
+    return OP - (Uns8 *)DstP;
+}
+
+// Decode one UTF8 char of Len bytes (from ED_BufferGetUTF8Len).
+Uns32		ED_UtilUTF8ToUcs4(char * CharP, Int16 Len)
+{
+    Uns8 *	P = (Uns8 *)CharP;
+    Uns32	Ucs;
+    Int16	I;
+
+    if (Len == 1) return *P;
+
+    Ucs = *P & (0x7F >> Len);
+    for (I = 1; I < Len; I++)
+	Ucs = (Ucs << 6) | (P[I] & 0x3F);
+
+    return Ucs;
+}
+
 // returns byte count to end of line--in KillRing NOT Buffer!
 Int32	ED_UtilGetLineEnd(char * TextP, Int32 TextLen, Int32 * CharCountP) {
     char *	CurP = TextP;
@@ -1219,6 +2001,183 @@ Int32	ED_UtilGetLineEnd(char * TextP, Int32 TextLen, Int32 * CharCountP) {
     return (CurP - TextP);
 }
 
+// ******************************************************************************
+// GLYPH CACHE
+//
+// The font is monospaced and opened once, so the glyph index for each codepoint
+// never changes.  ASCII/Latin-1 are filled in up front, everything else is
+// looked up (XftCharIndex) on first use and kept in an open-addressed table.
+// Text is then drawn as glyph runs on the ED_Advance grid.
+
+FT_UInt			ED_GlyphDirectArr[ED_GLYPHDIRECTCOUNT];
+ED_GlyphPointer		ED_GlyphHashArrP = NULL;
+Int32			ED_GlyphHashCount = 0;
+Int32			ED_GlyphHashMax = 0;
+XftGlyphFontSpec *	ED_GlyphRunArrP = NULL;		// Scratch for ED_GlyphDrawRun
+Int32			ED_GlyphRunMax = 0;
+
+void	ED_GlyphCacheInit(XftFont * XFP)
+{
+    Uns32	Ucs;
+
+    for (Ucs = 0; Ucs < ED_GLYPHDIRECTCOUNT; Ucs++)
+	ED_GlyphDirectArr[Ucs] = XftCharIndex(ED_XDP, XFP, Ucs);
+
+    ED_GlyphHashMax = ED_GLYPHHASHINITCOUNT;
+    ED_GlyphHashCount = 0;
+    ED_GlyphHashArrP = calloc(ED_GlyphHashMax, sizeof(ED_GlyphRecord));
+    if (ED_GlyphHashArrP == NULL) G_SETEXCEPTION("Malloc GlyphHash Failed", ED_GlyphHashMax);
+}
+
+void	ED_GlyphCacheFree(void)
+{
+    free(ED_GlyphHashArrP);
+    ED_GlyphHashArrP = NULL;
+    ED_GlyphHashCount = ED_GlyphHashMax = 0;
+    if (ED_GlyphRunArrP) free(ED_GlyphRunArrP);
+    ED_GlyphRunArrP = NULL;
+    ED_GlyphRunMax = 0;
+}
+
+// Linear probe for Ucs, returns its slot--or the empty slot where it belongs.
+ED_GlyphPointer	ED_GlyphFindSlot(ED_GlyphPointer ArrP, Int32 Max, Uns32 Ucs)
+{
+    Uns32	Mask = Max - 1;
+    Uns32	I = (Ucs * 2654435761U) & Mask;
+
+    while (ArrP[I].Ucs && (ArrP[I].Ucs != Ucs))
+	I = (I + 1) & Mask;
+
+    return ArrP + I;
+}
+
+FT_UInt	ED_GlyphIndex(Uns32 Ucs)
+{
+    ED_GlyphPointer	GP, OldArrP, NewArrP;
+    Int32		I, NewMax;
+
+    if (Ucs < ED_GLYPHDIRECTCOUNT) return ED_GlyphDirectArr[Ucs];
+
+    GP = ED_GlyphFindSlot(ED_GlyphHashArrP, ED_GlyphHashMax, Ucs);
+    if (GP->Ucs) return GP->Glyph;
+
+    // Miss... keep table at most half full.
+    if ((ED_GlyphHashCount + 1) * 2 > ED_GlyphHashMax) {
+	OldArrP = ED_GlyphHashArrP;
+	NewMax = ED_GlyphHashMax * 2;
+	NewArrP = calloc(NewMax, sizeof(ED_GlyphRecord));
+	if (NewArrP == NULL) G_SETEXCEPTION("Malloc GlyphHash Failed", NewMax);
+	for (I = 0; I < ED_GlyphHashMax; I++)
+	    if (OldArrP[I].Ucs)
+		*ED_GlyphFindSlot(NewArrP, NewMax, OldArrP[I].Ucs) = OldArrP[I];
+	free(OldArrP);
+	ED_GlyphHashArrP = NewArrP;
+	ED_GlyphHashMax = NewMax;
+	GP = ED_GlyphFindSlot(ED_GlyphHashArrP, ED_GlyphHashMax, Ucs);
+    }
+
+    GP->Ucs = Ucs;
+    GP->Glyph = XftCharIndex(ED_XDP, ED_XFP, Ucs);
+    ED_GlyphHashCount += 1;
+    return GP->Glyph;
+}
+
+// Draw Len bytes of UTF8 as one glyph run, one glyph per Col starting at X.  Y is the baseline.
+void	ED_GlyphDrawRun(XftDraw * XftDP, Int16 Color, Int32 X, Int32 Y, char * CharP, Int32 Len)
+{
+    char *	EndP = CharP + Len;
+    Int32	N = 0;
+    Int16	L;
+
+    if (Len > ED_GlyphRunMax) {
+	ED_GlyphRunMax = Len;
+	ED_GlyphRunArrP = realloc(ED_GlyphRunArrP, ED_GlyphRunMax * sizeof(XftGlyphFontSpec));
+	if (ED_GlyphRunArrP == NULL) G_SETEXCEPTION("Realloc GlyphRun Failed", ED_GlyphRunMax);
+    }
+
+    while (CharP < EndP) {
+	L = ED_BufferGetUTF8Len(*CharP);
+	if (CharP + L > EndP) L = EndP - CharP;
+
+	ED_GlyphRunArrP[N].font = ED_XFP;
+	ED_GlyphRunArrP[N].glyph = ED_GlyphIndex(ED_UtilUTF8ToUcs4(CharP, L));
+	ED_GlyphRunArrP[N].x = X;
+	ED_GlyphRunArrP[N].y = Y;
+	N += 1;
+
+	X += ED_Advance;
+	CharP += L;
+    }
+
+    if (N) XftDrawGlyphFontSpec(XftDP, &ED_XCArr[Color], ED_GlyphRunArrP, N);
+}
+
+// ******************************************************************************
+// SCAN KERNELS
+//
+// Shared by the Buffer walkers (ED_PaneFindLoc, ED_BufferGetPosPlusRows, etc.)
+// that used to go 1 byte at a time, calling ED_BufferGetUTF8Len for every char.
+// Each works on ONE contiguous run--caller deals with the Gap.  They look at 8
+// bytes at a time: a word has a zero byte iff ED_SCANHASZERO is non-zero, and
+// XOR with a repeated char turns that char into zero.  Plain single-char
+// searches just use memchr, libc already picks the best SIMD version for the
+// CPU at runtime.
+
+// Returns ptr to the first '\n' or non-ASCII (UTF8) byte in [CurP, EndP), or
+// EndP if none.  Everything before it is 1 byte == 1 char == 1 Col.
+char *	ED_UtilScanPlain(char * CurP, char * EndP)
+{
+    Uns64	W;
+
+    while (EndP - CurP >= 8) {
+	memcpy(&W, CurP, 8);
+	if ((W | ED_SCANHASZERO(W ^ (ED_SCANONES * '\n'))) & ED_SCANHIGHS) break;
+	CurP += 8;
+    }
+
+    // Finish up, will find it within 8 bytes if the loop broke out.
+    while ((CurP < EndP) && (*CurP != '\n') && !(*CurP & 0x80)) CurP++;
+    return CurP;
+}
+
+// Returns ptr to the first C1 or C2 in [CurP, EndP), or NULL if none.
+char *	ED_UtilScanByte2(char * CurP, char * EndP, char C1, char C2)
+{
+    Uns64	W;
+    Uns64	M1 = ED_SCANONES * (Uns8)C1;
+    Uns64	M2 = ED_SCANONES * (Uns8)C2;
+
+    while (EndP - CurP >= 8) {
+	memcpy(&W, CurP, 8);
+	if (ED_SCANHASZERO(W ^ M1) | ED_SCANHASZERO(W ^ M2)) break;
+	CurP += 8;
+    }
+
+    while (CurP < EndP) {
+	if ((*CurP == C1) || (*CurP == C2)) return CurP;
+	CurP++;
+    }
+    return NULL;
+}
+
+// Mirror image of ED_UtilScanByte2 (for one byte), returns the LAST C in
+// [StartP, EndP), or NULL.
+char *	ED_UtilScanBackByte(char * StartP, char * EndP, char C)
+{
+    Uns64	W;
+    Uns64	M = ED_SCANONES * (Uns8)C;
+
+    while (EndP - StartP >= 8) {
+	memcpy(&W, EndP - 8, 8);
+	if (ED_SCANHASZERO(W ^ M)) break;
+	EndP -= 8;
+    }
+
+    while (EndP > StartP)
+	if (*--EndP == C) return EndP;
+    return NULL;
+}
+
 // NewSP will be intersected with MainSP.  Result accumulates in MainSP.
 // (So result can NEVER be longer than MainSP already is!  But MainSP
 // can become shorter!)
@@ -1344,6 +2303,51 @@ void	ED_BlinkHandler(void)
     }
 }
 
+// ******************************************************************************
+// ED_IdleHandler is called from MAIN event loop each time XLib runs out of window
+// events, before it waits on the Blinker.  Does one small chunk of background work
+// and returns 1 if there is more to do--so MAIN comes right back instead of waiting.
+
+Int16	ED_IdleHandler(void)
+{
+    if (ED_StartupStep()) return 1;			// Deferred past the first paint
+    if (ED_ISPaneP && ED_ISCountStep()) return 1;	// Counting IS matches
+    if (ED_FrameReflowStep()) return 1;			// Re-wrapping after a resize
+
+    return 0;
+}
+
+// ******************************************************************************
+// ED_WorkPending is 1 while worker threads still owe the main loop a result
+// (background Loads, Saves and directory prefetches).  Nothing to do but wait for their pipes.
+
+Int16	ED_WorkPending(void)
+{
+    return (ED_LoadFirstP != NULL) || (ED_SavePendingP != NULL) || ED_DirJobCount;
+}
+
+// ******************************************************************************
+// ED_RenderHandler is called from MAIN event loop once all pending window events
+// have been handled.  Event handlers only mark Frames/Panes dirty, so a burst of
+// KeyPress or MotionNotify events gets drawn just once.
+
+void	ED_RenderHandler(void)
+{
+    ED_FramePointer	FrameP = ED_FirstFrameP;
+
+    while (FrameP) {
+	ED_FrameRender(FrameP);
+	FrameP = FrameP->NextFrameP;
+    }
+
+    // All input so far is on screen now (well, queued for the XServer).
+    if (ED_StatsInputNs) {
+	ED_StatsHistAdd(ED_DrawHistId, sc_ClockNSecs() - ED_StatsInputNs);
+	ED_StatsHistAdd(ED_XReqHistId, NextRequest(ED_XDP) - ED_StatsInputReq);
+	ED_StatsInputNs = 0;
+    }
+}
+
 // ******************************************************************************
 // FReg and FBind:  Command functions in the editor are registered, so they can
 // be invoked by name or bound to a control (or meta) key sequence.  Each new
@@ -1363,6 +2367,10 @@ void	ED_FRegInit(void)
 
     sc_SAStoreOpen(&ED_FBindStore, sizeof(ED_FBindRecord), ED_FBINDALLOCCOUNT);
     ED_FirstBindP = NULL;
+
+    memset(&ED_KeyTrie, 0, sizeof(ED_TrieRecord));
+    memset(&ED_NameTrie, 0, sizeof(ED_TrieRecord));
+    ED_FRegStale = 1;
 }
 
 // ******************************************************************************
@@ -1376,6 +2384,10 @@ void	ED_FRegKill(void)
 
     ED_FirstBindP = NULL;
     sc_SAStoreClose(&ED_FBindStore);
+
+    ED_TrieKill(&ED_KeyTrie);
+    ED_TrieKill(&ED_NameTrie);
+    ED_FRegStale = 1;
 }
 
 // ******************************************************************************
@@ -1390,6 +2402,9 @@ ED_FRegPointer		ED_FRegNewFunction(ED_FRegFuncP FuncP, char * NameP)
     NewFRP->NameP = NameP;
     NewFRP->FuncP = FuncP;
     NewFRP->FirstBindP = NULL;
+    NewFRP->CallCount = 0;
+    NewFRP->TotalNs = NewFRP->MaxNs = 0;
+    ED_FRegStale = 1;
 
     PrevFRP = NULL;
     NextFRP = ED_FirstFRegP;
@@ -1410,6 +2425,39 @@ ED_FRegPointer		ED_FRegNewFunction(ED_FRegFuncP FuncP, char * NameP)
     return NewFRP;
 }
 
+// ******************************************************************************
+// ED_FRegExec runs the registered command on PaneP, and times it for the STATS
+// report.  Everybody who dispatches a command (keys, M-x, PU) comes through here.
+//
+// NOTE:	A command can kill its Pane/Frame, so do not touch PaneP after.
+
+void	ED_FRegExec(ED_FRegPointer FRegP, ED_PanePointer PaneP)
+{
+    Int64	StartNs, Ns;
+
+    StartNs = sc_ClockNSecs();
+    (*FRegP->FuncP)(PaneP);
+    Ns = sc_ClockNSecs() - StartNs;
+
+    FRegP->CallCount += 1;
+    FRegP->TotalNs += Ns;
+    if (Ns > FRegP->MaxNs) FRegP->MaxNs = Ns;
+}
+
+// ******************************************************************************
+// ED_FRegFindFunc returns the registered FRegP for FuncP, NULL if there is none.
+// A simple walk, only used when the caller has just the FuncP (PU commands).
+
+ED_FRegPointer	ED_FRegFindFunc(ED_FRegFuncP FuncP)
+{
+    ED_FRegPointer	FRP = ED_FirstFRegP;
+
+    while (FRP && (FRP->FuncP != FuncP))
+	FRP = FRP->SortNextP;
+
+    return FRP;
+}
+
 // ******************************************************************************
 // ED_FregNewBinding will record a new Binding for the registered function.  The
 // FRegP can have many different bindings, but a given KeyStr can only be bound
@@ -1422,6 +2470,7 @@ ED_FBindPointer	ED_FRegNewBinding(ED_FRegPointer FRegP, char * KeyStrP)
 
     if (strlen(KeyStrP) >= ED_FBINDKEYSTRLEN)
 	G_SETEXCEPTION("FRegNewBinding too long", 0);
+    ED_FRegStale = 1;
 
     Res = 1;			// Not 0 if FirstBindP is NULL!!
     PrevFBP = NULL;
@@ -1471,63 +2520,175 @@ ED_FBindPointer	ED_FRegNewBinding(ED_FRegPointer FRegP, char * KeyStrP)
 // ED_FRegFindBinding is called to get a binding for a given KeyStr (key sequence).
 // This KeyStr will be matched incrementally, as the user is typing it, so it
 // is important to recognize partial matches, as opposed to obvious mismatches.
-// In the case of a partial match, the *StartBPP value will refer to the
-// ED_FBindPointer that should be used to re-start the match once another
-// char in the KeyStr has been entered.  In the case of a perfect match, this
-// field will indicate the matching FBindPointer... otherwise, throw away value.
+// The whole KeyStr is walked down the KeyTrie each time, one probe per key, so
+// the cost is the length of the KeyStr--not the number of bindings.  In the
+// case of a perfect match, *BindPP gets the matching FBindPointer.
 //
 // Return Values:
 // -1	There are no matching bindings, adding more Chars will not help.
 // 1	Partial match, keep typing
-// 99	Found perfect match, get the function from *StartBPP
+// 99	Found perfect match, get the function from *BindPP
 
-Int16	ED_FRegFindBinding(ED_FBindPointer *StartBPP, char * KeyStrP)
+Int16	ED_FRegFindBinding(ED_FBindPointer *BindPP, char * KeyStrP)
 {
-    Int16		Res;
-    
-    while (*StartBPP) {
-	Res = ED_FRegBindCompare(KeyStrP, (*StartBPP)->KeyStr);
-	if (Res) return Res;
+    ED_TrieNodePointer	NP;
 
-        *StartBPP = (*StartBPP)->SortNextP;
-    }
+    if (ED_FRegStale) ED_FRegCompile();
 
-    return -1;
+    NP = ED_TrieFind(&ED_KeyTrie, KeyStrP, strlen(KeyStrP));
+    if (NP == NULL) return -1;			// MISMATCH
+    if (NP->DataP == NULL) return 1;		// PARTIAL, only longer KeyStrs here
+
+    *BindPP = (ED_FBindPointer)NP->DataP;	// FULL MATCH
+    return 99;
+}
+
+// ******************************************************************************
+// ED_FRegCompile (re)builds the KeyTrie from the FBind list and the NameTrie
+// from the FReg list.  Both lists are sorted, so every Trie Node knows the
+// first and last entry under it--a Name prefix is a range of commands.  New
+// functions or bindings just set ED_FRegStale, the next lookup compiles.
+
+void	ED_FRegCompile(void)
+{
+    ED_FBindPointer	FBP;
+    ED_FRegPointer	FRP;
+
+    ED_TrieReset(&ED_KeyTrie);
+    for (FBP = ED_FirstBindP; FBP; FBP = FBP->SortNextP)
+	ED_TrieAdd(&ED_KeyTrie, FBP->KeyStr, FBP);
+
+    ED_TrieReset(&ED_NameTrie);
+    for (FRP = ED_FirstFRegP; FRP; FRP = FRP->SortNextP)
+	ED_TrieAdd(&ED_NameTrie, FRP->NameP, FRP);
+
+    ED_FRegStale = 0;
 }
 
 // ******************************************************************************
-// ED_FRegBindCompare is a special incremental match comparing the entered
-// key-sequence (EntryP) and binding KeyStr.  It is assumed that
-// FBindRecords will be fed to it in strict ascending alphabetic order.
+// TRIE:  Each Node hangs its children off the one edge table, an open addressed
+// (linear probing) hash keyed on (Parent Node << 8) | Byte.  So finding a child
+// is a probe or two, whatever the fan-out--the Root under C- or M- has dozens.
+// Key bytes are never 0 (strings are Null delimited), so Key 0 marks an empty
+// slot.  The table is kept at most half full, spread like sc_WEReg.
 //
-// Return values:
-// -1	Mismatch: give up, no match will be found.
-// 0	Get next BindP: Look in the next FBindRecord.
-// 1	Partial match: Looks promising, type more chars
-// 99	Full match: Bingo!
+// Entries must be added in sort order, that is what makes FirstP and LastP
+// the range of entries sharing a Node's prefix.
 
-Int16	ED_FRegBindCompare(register char * EntryP, register char * KeyStrP)
+Uns32	ED_TrieFindSlot(ED_TriePointer TP, Uns32 Key)
 {
-#ifdef DEBUG
-    if (0) {
-	char	EStr[64], KStr[64];
+    Uns32		Mask = TP->Slots - 1;
+    Uns32		I = (Uns32)((Key * 0x9E3779B97F4A7C15ULL) >> TP->Shift);
+
+    while (TP->EdgeArrP[I].Key && TP->EdgeArrP[I].Key != Key)
+	I = (I + 1) & Mask;
+    return I;
+}
+
+// (Re)allocates the edge table with Slots entries (power of 2), re-inserting
+// any existing edges.
+void	ED_TrieAlloc(ED_TriePointer TP, Uns32 Slots)
+{
+    ED_TrieEdgePointer	OldP = TP->EdgeArrP;
+    Uns32		OldSlots = TP->Slots;
+    Uns32		I;
+    Uns16		Bits = 0;
+
+    TP->EdgeArrP = (ED_TrieEdgePointer)calloc(Slots, sizeof(ED_TrieEdgeRecord));
+    if (TP->EdgeArrP == NULL) G_SETEXCEPTION("Trie Alloc failed", Slots);
+
+    while ((1UL << Bits) < Slots) Bits++;
+    TP->Slots = Slots;
+    TP->Shift = 64 - Bits;
+
+    if (OldP == NULL) return;
+
+    for (I = 0; I < OldSlots; I++)
+	if (OldP[I].Key)
+	    TP->EdgeArrP[ED_TrieFindSlot(TP, OldP[I].Key)] = OldP[I];
+    free(OldP);
+}
 
-	ED_KeyStrPrint(EntryP, EStr);
-	ED_KeyStrPrint(KeyStrP, KStr);
-	printf("BindCompare Entry:[%s] <%x %x %x> --> Binding:[%s]\n", EStr, EntryP[0], EntryP[1], EntryP[2], KStr);
+// Empties the Trie, down to the Root, keeps the memory.
+void	ED_TrieReset(ED_TriePointer TP)
+{
+    if (TP->EdgeArrP == NULL) ED_TrieAlloc(TP, ED_TRIEMINSLOTS);
+    else memset(TP->EdgeArrP, 0, TP->Slots * sizeof(ED_TrieEdgeRecord));
+
+    if (TP->NodeArrP == NULL) {
+	TP->NodeMax = ED_TRIEMINNODES;
+	TP->NodeArrP = (ED_TrieNodePointer)malloc(TP->NodeMax * sizeof(ED_TrieNodeRecord));
+	if (TP->NodeArrP == NULL) G_SETEXCEPTION("Trie Alloc failed", TP->NodeMax);
     }
-#endif
+    TP->NodeArrP[0].DataP = TP->NodeArrP[0].FirstP = TP->NodeArrP[0].LastP = NULL;
+    TP->NodeCount = 1;
+}
+
+void	ED_TrieKill(ED_TriePointer TP)
+{
+    free(TP->EdgeArrP);
+    free(TP->NodeArrP);
+    memset(TP, 0, sizeof(ED_TrieRecord));
+}
+
+// Adds StrP (Null delimited) for DataP, creating any missing Nodes on the way.
+void	ED_TrieAdd(ED_TriePointer TP, char * StrP, void * DataP)
+{
+    ED_TrieEdgePointer	EP;
+    ED_TrieNodePointer	NP;
+    Uns32		Node = 0;
+    Uns32		Key;
+
+    NP = TP->NodeArrP;
+    if (NP->FirstP == NULL) NP->FirstP = DataP;
+    NP->LastP = DataP;
+
+    while (*StrP) {
+	Key = (Node << 8) | *(Uns8 *)StrP++;
+
+	EP = &TP->EdgeArrP[ED_TrieFindSlot(TP, Key)];
+	if (EP->Key == 0) {
+	    // New Node.  Grow first (if need be), then find the slot again.
+	    if (TP->NodeCount * 2 > TP->Slots) {
+		ED_TrieAlloc(TP, TP->Slots * 2);
+		EP = &TP->EdgeArrP[ED_TrieFindSlot(TP, Key)];
+	    }
+	    if (TP->NodeCount == TP->NodeMax) {
+		TP->NodeMax *= 2;
+		TP->NodeArrP = (ED_TrieNodePointer)realloc(TP->NodeArrP, TP->NodeMax * sizeof(ED_TrieNodeRecord));
+		if (TP->NodeArrP == NULL) G_SETEXCEPTION("Trie Alloc failed", TP->NodeMax);
+	    }
+	    EP->Key = Key;
+	    EP->Node = TP->NodeCount++;
+	    NP = &TP->NodeArrP[EP->Node];
+	    NP->DataP = NULL;
+	    NP->FirstP = DataP;
+	}
+
+	Node = EP->Node;
+	NP = &TP->NodeArrP[Node];
+	NP->LastP = DataP;
+    }
+
+    NP->DataP = DataP;
+}
+
+// Returns the Node for the first Len bytes of StrP (Root if Len is 0), or NULL
+// if nothing was added with that prefix.
+ED_TrieNodePointer	ED_TrieFind(ED_TriePointer TP, char * StrP, Int32 Len)
+{
+    ED_TrieEdgePointer	EP;
+    Uns32		Node = 0;
+    Uns32		Key;
 
-    // Must cast to (Uns8 *) otherwise <DELETE> which is 0xFF would NOT match!!
-    while (*EntryP && *KeyStrP) {
-	if (*(Uns8 *)EntryP < *(Uns8 *)KeyStrP) return -1;	// Already too late! MISMATCH
-	if (*(Uns8 *)EntryP > *(Uns8 *)KeyStrP) return 0;	// Get next binding
-	EntryP++, KeyStrP++;			// Obviously ==, get next
+    while (Len-- > 0) {
+	Key = (Node << 8) | *(Uns8 *)StrP++;
+	EP = &TP->EdgeArrP[ED_TrieFindSlot(TP, Key)];
+	if (EP->Key == 0) return NULL;
+	Node = EP->Node;
     }
 
-    if (*EntryP) return -1;			// BindP ran out, so MISMATCH
-    if (*KeyStrP) return 1;			// EntryP ran out, so PARTIAL
-    return 99;					// Both ran out, FULL MATCH			
+    return &TP->NodeArrP[Node];
 }
 
 // ******************************************************************************
@@ -1628,166 +2789,231 @@ Int16	ED_KeyStrPrint(char * KeyStrP, char * DestP)
 // A new selection range sets Primary XSel (only).
 //
 // A special unmapped ED_XSelWin is used for INCR data import.
+//
+// INCR transfers (both ways) are state machines driven by events in the main
+// loop, so the editor keeps running while another app pastes a big selection
+// from us--or we paste from it.  Any number of requestors can be served at
+// once (ED_XSendFirstP), but only one paste (ED_XRecv) comes in at a time.
+// A single timer (ED_XSelTimerId) times out stalled transfers.
 
 Int32			ED_XSelSizeLimit;		// Max size of each INCR data block
 Window			ED_XSelWin = 0;			// Hidden XWin for XSelection
+Int16			ED_XSelTimerId;			// Times out INCR transfers
 
 Int16			ED_ClipOwn;			// We OWN the CLIPBOARD selection
 
 Int16			ED_PrimaryOwn;			// We OWN the PRIMARY selection
 ED_BufferPointer	ED_PrimaryBufP;
-Int32			ED_PrimaryPos;
-Int32			ED_PrimaryLen;
+Int64			ED_PrimaryPos;
+Int64			ED_PrimaryLen;
 
-struct	pollfd		ED_XSelPollR;			// So can limit to N mSec searching for an event
-struct	timeval		ED_XSelSetTimeR;		// To see how much time is left.
+ED_XSendPointer		ED_XSendFirstP = NULL;		// INCR sends in progress
+ED_XRecvRecord		ED_XRecv;			// Paste in progress, if BufP != NULL
 
 
 // Create XSelWin.  It is never mapped, just used for XSelection handling.
 // MUST XSelectInput, otherwise NO events, EVER!!
+//
+// Blocks can be as big as a request (BIG-REQUESTS if the server has it), less
+// some room for the XChangeProperty request itself.  Sizes are in 4-byte units.
 void    ED_XSelInit(void)
 {
     Int16	XScreenN = DefaultScreen(ED_XDP);
+    long	Units;
+
+    Units = XExtendedMaxRequestSize(ED_XDP);
+    if (Units == 0) Units = XMaxRequestSize(ED_XDP);
+    ED_XSelSizeLimit = (Units - ED_XSELREQSLACK) * 4;
 
-    ED_XSelSizeLimit = XMaxRequestSize(ED_XDP);			// Value is for N longs, we go 1/4 for Bytes!
     ED_XSelWin = XCreateSimpleWindow(ED_XDP, RootWindow(ED_XDP, XScreenN), 0, 0, 10, 10, 0, 0, 0);
     XSelectInput(ED_XDP, ED_XSelWin, PropertyChangeMask);
-    
+
     sc_WERegAdd(ED_XSelWin, &ED_XSelHandleEvent, NULL);		// Register with main loop
+    ED_XSelTimerId = sc_TimerNew(ED_XSelTimerFunc, NULL);
+    ED_XRecv.BufP = NULL;
 }
 
 void	ED_XSelKill(void)
 {
+    while (ED_XSendFirstP) ED_XSendFinish(ED_XSendFirstP);
+    if (ED_XRecv.BufP) ED_XRecvAbort();
+    sc_TimerFree(ED_XSelTimerId);
+
     XDestroyWindow(ED_XDP, ED_XSelWin);
     ED_XSelWin = 0;
 }
 
-// Initialize the timeout-timer for XSel.
-void	ED_AuxInitXSelTimer(void)
-{
-    ED_XSelPollR.fd = ConnectionNumber(ED_XDP);
-    ED_XSelPollR.events = POLLIN;
-}
-
-// Set the timeout-timer to measure from NOW!
-void	ED_AuxResetXSelTimer(void)
+// (Re)start the clock for the next step of a transfer.
+Int64	ED_AuxXSelDueTime(void)
 {
-    gettimeofday(&ED_XSelSetTimeR, NULL);
+    sc_TimerSet(ED_XSelTimerId, ED_XSELTICK);
+    return sc_ClockMSecs() + ED_XSELTIMEOUT;
 }
 
-// Can *ONLY* use in a do{}while loop, since poll will **NOT** kick out
-// if the Event has already been queued.  Be sure to process multiple
-// events in the loop... as there could be extraneous PropertyNotify
-// events that could gum-up the works!
-Int16	ED_AuxWaitXSelTimer(Int32 MSecs)
+// Ticks while transfers are in progress, drops the ones that stalled.
+void	ED_XSelTimerFunc(void * DataP)
 {
-    struct timeval	CurTime;
-    Int32		DeltaT;
+    ED_XSendPointer	SendP, NextP;
+    Int64		Now = sc_ClockMSecs();
 
-    gettimeofday(&CurTime, NULL);
-    DeltaT = (1024 * (CurTime.tv_sec - ED_XSelSetTimeR.tv_sec)) +
-	     ((CurTime.tv_usec - ED_XSelSetTimeR.tv_usec) / 1024);
+    SendP = ED_XSendFirstP;
+    while (SendP) {
+	NextP = SendP->NextP;
+	if (SendP->DueTime <= Now) ED_XSendFinish(SendP);
+	SendP = NextP;
+    }
 
-    if (DeltaT >= MSecs || 0 == poll(&ED_XSelPollR, 1, MSecs - DeltaT))
-	return 0;
+    if (ED_XRecv.BufP && (ED_XRecv.DueTime <= Now)) {
+	ED_XRecvAbort();
+	ED_FrameFlashError(ED_CurFrameP);
+    }
 
-    return 1;
+    if (ED_XSendFirstP || ED_XRecv.BufP)
+	sc_TimerSet(ED_XSelTimerId, ED_XSELTICK);
 }
 
-// Send requested Data... whether PRIMARY or CLIPBOARD, whether from BufP or KillRing.
-// Will process (involves complex hand-shaking + wait) locally rather than asynch to
-// eliminate possibility of buffer closing, gap moving, KillRing changing, another Sel....
-// Return 1 == Success
-// Return 0 == Fail
+// ******************************************************************************
+// Sending.  Small data goes out in one XChangeProperty.  Bigger data announces
+// INCR, then each time the requestor deletes the property, the next block is
+// written--from ED_XSendHandleEvent, on PropertyNotify for the requestor window.
+// A zero-len block ends it.
 //
-// NOTE:	Had ProgressBar display originally... but works toooo fast, even
-//		for multi-meg sized files, so no need.  Sigh.
-Int16	ED_XSelSendINCRData(XSelectionEvent * SEP, Atom Type, char * DataP, Int32 DataLen)
+// Data from the KillRing is sent straight out of its chunk (ChunkP).  If the
+// KillRing must let go of the chunk meanwhile, the transfer adopts it (OwnP).
+// Data from a Buffer is copied first, as the Buffer can change under it.
+
+// Is ChunkP being sent?
+Int16	ED_XSendChunkBusy(char * ChunkP)
 {
-    XEvent		XE;
-    Int16		StepDone;
-    Int32		CurStep, Len, LenLeft;
+    ED_XSendPointer	SendP;
 
-    // Get the number of Steps + add one for the INCR step.
-    // StepCount = 1 + ((ED_PrimaryLen + ED_XSelSizeLimit - 1) / ED_XSelSizeLimit);
-    CurStep = 0;
+    if (ChunkP == NULL) return 0;
+    for (SendP = ED_XSendFirstP; SendP; SendP = SendP->NextP)
+	if (SendP->ChunkP == ChunkP) return 1;
+    return 0;
+}
 
-    // Announce INCR protocol
-    XChangeProperty(ED_XDP, SEP->requestor, SEP->property, ED_IncrAtom, 32, PropModeReplace,
-		    (unsigned char *)&DataLen, 1);
-    XSendEvent(ED_XDP, SEP->requestor, 0, 0, (XEvent *)SEP);
+// KillRing drops ChunkP (of MemLen)... a transfer using it takes it over.  Returns 1 if so.
+Int16	ED_XSendAdoptChunk(char * ChunkP, Int64 MemLen)
+{
+    ED_XSendPointer	SendP;
 
-    // Look at requestor Win, ready for PropertyChange events.
-    // Stop looking at requestor Win when done... don't want events FOREVER.
-    // **MUST** Flush here... otherwise will NOT get events while we wait!
-    XSelectInput(ED_XDP, SEP->requestor, PropertyChangeMask);
-    XFlush(ED_XDP);
+    if (ChunkP == NULL) return 0;
+    for (SendP = ED_XSendFirstP; SendP; SendP = SendP->NextP)
+	if (SendP->ChunkP == ChunkP) {
+	    SendP->OwnP = ChunkP;
+	    SendP->OwnLen = MemLen;
+	    return 1;
+	}
+    return 0;
+}
 
-    // Initialize timer mechanism... so can timeout if no Event!
-    ED_AuxInitXSelTimer();
+// Done (or failed), unchain and let go of everything.  Another transfer of the
+// same (adopted) chunk inherits it, and the requestor window is only released
+// when no other transfer is going to it.
+void	ED_XSendFinish(ED_XSendPointer SendP)
+{
+    ED_XSendPointer	*SendPP, OtherP;
+    Int16		WinBusy = 0;
 
-    // Allow 2 Full seconds for accept/delete of INCR prop
-    StepDone = 0;
-    ED_AuxResetXSelTimer();
-    do {
-	// May have spurious PropertyNewValue before the PropertyDelete... so loop here.
-	while (XCheckWindowEvent(ED_XDP, SEP->requestor, PropertyChangeMask, &XE)) {
-	    if ((XE.xproperty.state == PropertyDelete) &&
-	        (XE.xproperty.atom == SEP->property)) {
+    for (SendPP = &ED_XSendFirstP; *SendPP != SendP; SendPP = &(*SendPP)->NextP);
+    *SendPP = SendP->NextP;
 
-		StepDone = 1;
-		CurStep += 1;
-		break;
-	    }
+    for (OtherP = ED_XSendFirstP; OtherP; OtherP = OtherP->NextP) {
+	if (OtherP->Requestor == SendP->Requestor) WinBusy = 1;
+	if (SendP->OwnP && (OtherP->ChunkP == SendP->ChunkP) && SendP->ChunkP) {
+	    OtherP->OwnP = SendP->OwnP;
+	    OtherP->OwnLen = SendP->OwnLen;
+	    SendP->OwnP = NULL;
 	}
+    }
 
-	if (StepDone) break;
-    } while (ED_AuxWaitXSelTimer(2048));
-    
-    if (! StepDone) goto Failed;
-    
-    // Now transmit all N parts, 1 chunk at a time... allow 2 sec timeout
-    LenLeft = DataLen;
-    while (LenLeft) {
-	Len = ED_XSelSizeLimit;
-	if (Len > LenLeft) Len = LenLeft;
+    if (! WinBusy) {
+	XSelectInput(ED_XDP, SendP->Requestor, NoEventMask);
+	sc_WERegDel(SendP->Requestor);
+    }
+    XFlush(ED_XDP);
 
-	// printf("Sending %d/%d  Len:%d LenLeft:%d\n ", CurStep, StepCount - 1, Len, LenLeft);
-	XChangeProperty(ED_XDP, SEP->requestor, SEP->property, Type, 8, PropModeReplace,
-			(unsigned char *)DataP + (DataLen - LenLeft), Len);
-	XFlush(ED_XDP);
+    sc_SAPoolFree(&ED_PayloadPool, SendP->OwnP, SendP->OwnLen);
+    free(SendP);
+}
 
-	// Wait until PropertyDelete, then repeat with next chunk
-	StepDone = 0;
-	ED_AuxResetXSelTimer();
-	do {
-	    // May have >1 PropertyNotify events... one Delete and one NewValue!
-	    while (XCheckWindowEvent(ED_XDP, SEP->requestor, PropertyChangeMask, &XE)) {
-		if ((XE.xproperty.state == PropertyDelete) &&
-		    (XE.xproperty.atom == SEP->property)) {
+// Announce INCR.  Must look at the requestor Win *BEFORE* it learns of the INCR,
+// or its first PropertyDelete may come and go unseen.
+// Return 1 == Success
+// Return 0 == Fail (OwnP is freed)
+// OwnP, if any, is a PayloadPool copy of the DataLen bytes.
+Int16	ED_XSendStart(XSelectionEvent * SEP, Atom Type, char * DataP, Int64 DataLen, char * ChunkP, char * OwnP)
+{
+    ED_XSendPointer	SendP, OtherP;
+    long		Announce = DataLen;
 
-		    StepDone = 1;
-		    CurStep += 1;
-		    break;
-		}
-	    }
+    SendP = malloc(sizeof(ED_XSendRecord));
+    if (! SendP) {
+	sc_SAPoolFree(&ED_PayloadPool, OwnP, DataLen);
+	return 0;
+    }
 
-	    if (StepDone) break;
-	} while (ED_AuxWaitXSelTimer(2014));
+    SendP->Requestor = SEP->requestor;
+    SendP->Property = SEP->property;
+    SendP->Type = Type;
+    SendP->DataP = DataP;
+    SendP->ChunkP = ChunkP;
+    SendP->OwnP = OwnP;
+    SendP->OwnLen = DataLen;
+    SendP->DataLen = DataLen;
+    SendP->SentLen = 0;
+    SendP->DueTime = ED_AuxXSelDueTime();
 
-	if (! StepDone) goto Failed;
-	LenLeft -= Len;
+    for (OtherP = ED_XSendFirstP; OtherP; OtherP = OtherP->NextP)
+	if (OtherP->Requestor == SendP->Requestor) break;
+    if (OtherP == NULL) {
+	XSelectInput(ED_XDP, SendP->Requestor, PropertyChangeMask);
+	sc_WERegAdd(SendP->Requestor, &ED_XSendHandleEvent, NULL);
     }
+    SendP->NextP = ED_XSendFirstP;
+    ED_XSendFirstP = SendP;
 
-    // Finally, write a zero-len data to end it all--and stop looking at requestor win events.
-    XChangeProperty(ED_XDP, SEP->requestor, SEP->property, Type, 8, PropModeReplace, 0, 0);
-    XSelectInput(ED_XDP, SEP->requestor, NoEventMask);
-    XFlush(ED_XDP);    
+    XChangeProperty(ED_XDP, SEP->requestor, SEP->property, ED_IncrAtom, 32, PropModeReplace,
+		    (unsigned char *)&Announce, 1);
+    XSendEvent(ED_XDP, SEP->requestor, 0, 0, (XEvent *)SEP);
+    XFlush(ED_XDP);
     return 1;
+}
 
-Failed:
-    XSelectInput(ED_XDP, SEP->requestor, None);
-    return 0;
+// Requestor deleted the property, it is ready for the next block.
+void	ED_XSendStep(ED_XSendPointer SendP)
+{
+    Int64	Len = SendP->DataLen - SendP->SentLen;
+
+    if (Len > ED_XSelSizeLimit) Len = ED_XSelSizeLimit;
+    XChangeProperty(ED_XDP, SendP->Requestor, SendP->Property, SendP->Type, 8, PropModeReplace,
+		    (unsigned char *)SendP->DataP + SendP->SentLen, Len);
+
+    if (Len == 0)
+	ED_XSendFinish(SendP);		// That was the zero-len end block
+    else {
+	SendP->SentLen += Len;
+	SendP->DueTime = ED_AuxXSelDueTime();
+	XFlush(ED_XDP);
+    }
+}
+
+// Event handler for requestor windows, registered while sending to them.
+// Spurious PropertyNewValue (our own writes) come too, only Delete counts.
+void	ED_XSendHandleEvent(XEvent * EventP, void * DataP)
+{
+    ED_XSendPointer	SendP;
+
+    if ((EventP->type != PropertyNotify) ||
+	(EventP->xproperty.state != PropertyDelete)) return;
+
+    for (SendP = ED_XSendFirstP; SendP; SendP = SendP->NextP)
+	if ((SendP->Requestor == EventP->xproperty.window) &&
+	    (SendP->Property == EventP->xproperty.atom)) {
+	    ED_XSendStep(SendP);
+	    return;
+	}
 }
 
 // Send the data to the requestor window.  SEP is the SelectionNotify event
@@ -1796,27 +3022,33 @@ Failed:
 void	ED_XSelSendData(XSelectionEvent * SEP, Atom Type)
 {
     char	* DataP = NULL;
-    Int32	DataLen = 0;
+    char	* ChunkP = NULL;
+    char	* OwnP = NULL;
+    Int64	DataLen = 0;
 
     if (SEP->property == None) SEP->property = Type;	// Ancient clients?
 
     // PRIMARY can come from Buffer or KillRing... but check that we own it.
     // CLIPBOARD can only come from KillRing... but check that we own it.
-    
+
     if (SEP->selection == XA_PRIMARY) {
 	if (ED_PrimaryOwn == 0) goto RejectRequest;
 
 	if (ED_PrimaryBufP) {			// Source == Buffer
+	    if (ED_PrimaryBufP->Flags & ED_BUFLOADINGFLAG) goto RejectRequest;	// Gap is the loader's
 	    ED_BufferPlaceGap(ED_PrimaryBufP, ED_PrimaryPos, 0);
 	    DataP = ED_PrimaryBufP->GapEndP;
 	    DataLen = ED_PrimaryLen;
-	} else					// Source == KillRing
+	} else {				// Source == KillRing
 	    ED_KillRingYank(0, &DataP, &DataLen, 1);
-	
+	    ChunkP = ED_KillRing.EltArr[ED_KillRing.YankI].MemP;
+	}
+
     } else if (SEP->selection == ED_ClipAtom) {
 	if (ED_ClipOwn == 0) goto RejectRequest;
 
 	ED_KillRingYank(0, &DataP, &DataLen, 1);
+	ChunkP = ED_KillRing.EltArr[ED_KillRing.YankI].MemP;
     }
 
     // Wrong SEP->selection or other problems...
@@ -1829,186 +3061,283 @@ void	ED_XSelSendData(XSelectionEvent * SEP, Atom Type)
 	XSendEvent(ED_XDP, SEP->requestor, 0, 0, (XEvent *)SEP);
 
     } else {
-	if (! ED_XSelSendINCRData(SEP, Type, DataP, DataLen));
+	if (ChunkP == NULL) {			// Buffer data, take a copy
+	    OwnP = sc_SAPoolAlloc(&ED_PayloadPool, DataLen);
+	    if (! OwnP) goto RejectRequest;
+	    memcpy(OwnP, DataP, DataLen);
+	    DataP = OwnP;
+	}
+	if (! ED_XSendStart(SEP, Type, DataP, DataLen, ChunkP, OwnP))
 	    goto RejectRequest;
     }
     return;
-    
+
 RejectRequest:
     SEP->property = None;
     XSendEvent(ED_XDP, SEP->requestor, 0, 0, (XEvent *)SEP);
 }
 
-// Get incoming XSel data using the (ICCCM) INCR protocol.  Accumulate the data in
-// TempBufP, as it comes in.  When all is done, filter the data if ncessary, and
-// insert into PaneP.
+// ******************************************************************************
+// Receiving.  Insert XSel data (paste it) on PaneP.  Asks for UTF8_STRING first,
+// then simply STRING if that fails.  Whatever SelAtom is (PRIMARY or CLIPBOARD),
+// uses it as the transfer property on ED_XSelWin!  The answer comes later, as
+// SelectionNotify (ED_XRecvNotify), then PropertyNotify for each INCR block
+// (ED_XRecvBlock).
+//
+// The data is filtered (Tab/CRLF) straight into the Gap of the Buf, at the
+// insertion point, but is not part of the Buf until it has all come in.  Then
+// it is added in one go, with one Undo block (ED_PaneInsertGapChars).  The Buf
+// is locked meanwhile (ED_BUFPASTINGFLAG), so no edits.  Should something else
+// move the Gap (copying a region out of the Buf, say), ED_BufferPlaceGap first
+// spills the staged bytes into a malloc block (ED_XRecvSpill), and the rest of
+// the data goes there.
 //
-// NOTE:	Beware of spurious PropNotify events... must get rid of PropertyDelete
-//		ones if looking for PropertyNewValue ones.  Must call XCheckWindowEvent
-//		in a loop.
+// NOTE:	A Mark is pushed at the beginning of the insertion point... just
+//		as when Yanking locally!
 //
 // NOTE:	Protocol asks for initiating INCR property to have DataLen (actually
-//		a lower bound on DataLen) as value.  But code defensively ignores DataLen,
+//		a lower bound on DataLen) as value.  It is only used to presize the Gap,
 //		in case the XSel owner does not send it (or sends a strange value).
-//		Instead, simply takes all the blocks and stops when the NULL one shows up.
-Int16	ED_XSelInsertINCRData(ED_PanePointer PaneP, Atom SelAtom)
+//		Simply takes all the blocks and stops when the NULL one shows up.
+//
+// Return 1 == Request is on its way
+// Return 0 == Fail
+Int16	ED_XSelInsertData(ED_PanePointer PaneP, Atom SelAtom)
 {
-    ED_BufferPointer	TempBufP;
-    XEvent		XE;
-    Int16		Done, GotBlock;
-    Atom		ResType;
-    char		*DataP;
-    Uns64		DataLen, LenLeft;
-    Int32		ResFormat;
-    
-    TempBufP = ED_BufferNew(ED_BUFINITLEN, NULL, NULL, 0);
-    
-    Done = 0;
-    while (! Done) {
-	GotBlock = 0;
-	ED_AuxResetXSelTimer();
-	do {
-	    // PropertyChange events will come in pairs, one NewValue and one Delete!
-	    while (XCheckWindowEvent(ED_XDP, ED_XSelWin, PropertyChangeMask, &XE)) {
-		if ((XE.xproperty.state == PropertyNewValue) &&
-		    (XE.xproperty.atom == SelAtom)) {
-		    GotBlock = 1;
-		    break;
-		}
+    if (ED_XRecv.BufP) {				// One at a time
+	ED_FrameSetEchoS(ED_ECHOMSGMODE, ED_STR_EchoPasting);
+	ED_FrameFlashError(PaneP->FrameP);
+	return 0;
+    }
+
+    ED_XRecv.PaneP = PaneP;
+    ED_XRecv.BufP = PaneP->BufP;
+    ED_XRecv.SelAtom = SelAtom;
+    ED_XRecv.TypeAtom = ED_UTF8Atom;
+    ED_XRecv.Started = 0;
+    ED_XRecv.Incr = 0;
+    ED_XRecv.SpillP = NULL;
+    ED_XRecv.DueTime = ED_AuxXSelDueTime();
+    PaneP->BufP->Flags |= ED_BUFPASTINGFLAG;
+
+    XConvertSelection(ED_XDP, SelAtom, ED_UTF8Atom, SelAtom, ED_XSelWin, CurrentTime);
+    XFlush(ED_XDP);
+    return 1;
+}
+
+// The Pane that asked may be gone (or on another Buf) by now... any Pane on the
+// Buf will do.  Returns NULL if none.
+ED_PanePointer	ED_XRecvFindPane(void)
+{
+    ED_FramePointer	FP;
+    ED_PanePointer	PP, AnyPP = NULL;
+
+    for (FP = ED_FirstFrameP; FP; FP = FP->NextFrameP)
+	for (PP = FP->FirstPaneP; PP; PP = PP->NextPaneP)
+	    if (PP->BufP == ED_XRecv.BufP) {
+		if (PP == ED_XRecv.PaneP) return PP;
+		if (AnyPP == NULL) AnyPP = PP;
 	    }
 
-	    if (GotBlock) break;
-	} while (ED_AuxWaitXSelTimer(2048));
-
-	if (! GotBlock) goto Fail;
-	if (Success == XGetWindowProperty(ED_XDP, ED_XSelWin, SelAtom, 0L, LONG_MAX, True, AnyPropertyType,
-					  &ResType, &ResFormat, &DataLen, &LenLeft, (unsigned char **)&DataP)) {
-	    if (DataLen) {
-		ED_BufferPlaceGap(TempBufP, TempBufP->LastPos, DataLen);	// May expand it!
-		memcpy(TempBufP->GapStartP, DataP, DataLen);
-		TempBufP->GapStartP += DataLen;
-		TempBufP->LastPos += DataLen;
-	    } else
-		Done = 1;
-	    XFree(DataP);
-	} else
-	    goto Fail;
+    return AnyPP;
+}
+
+// The owner said yes, so zap the SelRange (same as any insertion) and presize
+// the Gap at the insertion point for SizeHint bytes.
+void	ED_XRecvBegin(Int64 SizeHint)
+{
+    ED_BufferPointer	BufP = ED_XRecv.BufP;
+    ED_PanePointer	PaneP = ED_XRecvFindPane();
+
+    ED_XRecv.SelZap = 0;
+    if (PaneP) {
+	ED_XRecv.SelZap = ED_PaneDelSelRange(PaneP, 0);
+	if (ED_XRecv.SelZap) ED_PaneMoveAfterCursorMove(PaneP, -1, 2, 0);
+	ED_XRecv.InsertPos = PaneP->CursorPos;
+    } else
+	ED_XRecv.InsertPos = BufP->GapStartP - BufP->BufStartP;
+
+    if (SizeHint < 0) SizeHint = 0;
+    ED_BufferPlaceGap(BufP, ED_XRecv.InsertPos, SizeHint + 1);
+    ED_XRecv.Len = 0;
+    ED_XRecv.Col = 0;
+    ED_XRecv.CR = 0;
+    ED_XRecv.Started = 1;
+}
+
+// Something is about to move the Gap, keep the staged bytes in a malloc block.
+void	ED_XRecvSpill(void)
+{
+    if (ED_XRecv.SpillP) return;
+
+    ED_XRecv.SpillLen = 2 * ED_XRecv.Len + ED_GAPEXTRAEXPAND;
+    ED_XRecv.SpillP = malloc(ED_XRecv.SpillLen);
+    if (ED_XRecv.SpillP == NULL) G_SETEXCEPTION_L("Malloc XSel data Failed", ED_XRecv.SpillLen);
+    memcpy(ED_XRecv.SpillP, ED_XRecv.BufP->GapStartP, ED_XRecv.Len);
+}
+
+// Filter DataLen more bytes into the Gap (or SpillP), after what is already
+// there.  If there is no room, it is grown (doubled).  The staged bytes are
+// not part of the Buf, so they are saved aside while the Gap grows.
+void	ED_XRecvAdd(char * DataP, Int64 DataLen)
+{
+    ED_BufferPointer	BufP = ED_XRecv.BufP;
+    Int64		Need = ED_AuxFilterSize(DataP, DataLen);
+    char *		DestP;
+
+    if (ED_XRecv.SpillP) {
+	if (ED_XRecv.SpillLen - ED_XRecv.Len < Need) {
+	    ED_XRecv.SpillLen = 2 * (ED_XRecv.Len + Need);
+	    DestP = realloc(ED_XRecv.SpillP, ED_XRecv.SpillLen);
+	    if (DestP == NULL) G_SETEXCEPTION_L("Realloc XSel data Failed", ED_XRecv.SpillLen);
+	    ED_XRecv.SpillP = DestP;
+	}
+	DestP = ED_XRecv.SpillP;
+
+    } else {
+	if ((BufP->GapEndP - BufP->GapStartP) - ED_XRecv.Len < Need) {
+	    DestP = malloc(ED_XRecv.Len + 1);
+	    if (DestP == NULL) G_SETEXCEPTION_L("Malloc XSel data Failed", ED_XRecv.Len);
+	    memcpy(DestP, BufP->GapStartP, ED_XRecv.Len);
+	    BufP->Flags &= ~ED_BUFPASTINGFLAG;		// Not a spill, the Gap stays
+	    ED_BufferPlaceGap(BufP, ED_XRecv.InsertPos, 2 * (ED_XRecv.Len + Need));
+	    BufP->Flags |= ED_BUFPASTINGFLAG;
+	    memcpy(BufP->GapStartP, DestP, ED_XRecv.Len);
+	    free(DestP);
+	}
+	DestP = BufP->GapStartP;
     }
 
-    if (TempBufP->LastPos) {
-	if (ED_BufferNeedsFilter(TempBufP))
-	    ED_BufferDoFilter(TempBufP, NULL, NULL);
-	ED_BufferPushMark(PaneP->BufP, PaneP->CursorPos);
-	ED_PaneInsertBufferChars(PaneP, TempBufP, 1);
+    ED_XRecv.Len += ED_AuxFilterCopy(DestP + ED_XRecv.Len, DataP, DataLen, &ED_XRecv.Col, &ED_XRecv.CR);
+    ED_XRecv.DueTime = ED_AuxXSelDueTime();
+}
+
+// All in, make it part of the Buf.
+void	ED_XRecvEnd(void)
+{
+    ED_BufferPointer	BufP = ED_XRecv.BufP;
+    ED_PanePointer	PaneP = ED_XRecvFindPane();
+    char *		StageP = (ED_XRecv.SpillP) ? ED_XRecv.SpillP : BufP->GapStartP;
+    Int64		Len;
+
+    if (ED_XRecv.CR) StageP[ED_XRecv.Len++] = '\n';	// Last block ended in CR
+    Len = ED_XRecv.Len;
+    BufP->Flags &= ~ED_BUFPASTINGFLAG;
+    ED_XRecv.BufP = NULL;
+
+    if (ED_XRecv.SpillP) {
+	if (Len) {
+	    ED_BufferPlaceGap(BufP, ED_XRecv.InsertPos, Len);
+	    memcpy(BufP->GapStartP, ED_XRecv.SpillP, Len);
+	}
+	free(ED_XRecv.SpillP);
+	ED_XRecv.SpillP = NULL;
+    }
+    if (Len == 0) return;
+
+    if (PaneP) {
+	PaneP->CursorPos = ED_XRecv.InsertPos;
+	ED_PaneInsertGapChars(PaneP, Len, ED_XRecv.SelZap, 1);
+	ED_BufferPushMark(BufP, ED_XRecv.InsertPos);
 	ED_FrameDrawAll(PaneP->FrameP);
+    } else {
+	BufP->Flags |= ED_BUFMODFLAG;
+	ED_BufferAddUndoBlock(BufP, ED_XRecv.InsertPos, Len, ED_UB_ADD | ED_UB_CHUNK, BufP->GapStartP);
+	BufP->GapStartP += Len;
+	BufP->LastPos += Len;
+	ED_BufferUpdateMark(BufP, ED_XRecv.InsertPos, Len);
+	ED_BufferPushMark(BufP, ED_XRecv.InsertPos);
     }
-    ED_BufferKill(TempBufP);
-    return 1;
+}
 
-Fail:
-    ED_BufferKill(TempBufP);
-    return 0;
+// Give up, whatever is in the Gap is simply dropped.
+void	ED_XRecvAbort(void)
+{
+    ED_XRecv.BufP->Flags &= ~ED_BUFPASTINGFLAG;
+    ED_XRecv.BufP = NULL;
+    free(ED_XRecv.SpillP);
+    ED_XRecv.SpillP = NULL;
+    XDeleteProperty(ED_XDP, ED_XSelWin, ED_XRecv.SelAtom);
 }
 
-// Insert XSel data (paste it) on PaneP.  Asks for UTF8_STRING first, then simply
-// STRING if that fails.  Whatever SelAtom is (PRIMARY or CLIPBOARD), uses it as
-// the transfer property on ED_XSelWin!  Calls ED_XSelInsetINCRData if the owner
-// (of the XSel) responds with an INCR protocol.
-//
-// NOTE:	A Mark is pushed at the beginning of the insertion point... just
-//		as when Yanking locally!
-//
-// NOTE:	INCR protocol relies on PropNotify events.  *MUST* process/dispose
-//		of 2 such events for every block that is transmitted--one DELETE
-//		and one NEWVALUE!!  Otherwise, it will gum-up the transmission.
-//
-// NOTE:	Incoming data may have Tabs/CRLF... so need filtering.
-//		Best to read it into a TempBufP, then filter if necessary, and
-//		finally insert into PaneP!
-Int16	ED_XSelInsertData(ED_PanePointer PaneP, Atom SelAtom)
+// SelectionNotify on ED_XSelWin... the owner's answer to XConvertSelection.
+void	ED_XRecvNotify(XSelectionEvent * SEP)
 {
-    ED_BufferPointer	TempBufP;
-    XEvent		XE;
-    Atom		TypeAtom, ResType;
+    Atom		ResType;
     char		*DataP;
-    Uns64		DataLen, LenLeft;
+    unsigned long	DataLen, LenLeft;
     Int32		ResFormat;
 
-    ED_AuxInitXSelTimer();
-    TypeAtom = ED_UTF8Atom;
-    
-TryAgain:
+    if ((ED_XRecv.BufP == NULL) || ED_XRecv.Started || (SEP->selection != ED_XRecv.SelAtom)) return;
 
-    XConvertSelection(ED_XDP, SelAtom, TypeAtom, SelAtom, ED_XSelWin, CurrentTime);
-    ED_AuxResetXSelTimer();
-    XFlush(ED_XDP);
-    do {
-	if (XCheckTypedWindowEvent(ED_XDP, ED_XSelWin, SelectionNotify, &XE)) {
-	    
-	    if (XE.xselection.property == None) {
-		if (TypeAtom == ED_UTF8Atom) {
-		    TypeAtom = XA_STRING;
-		    goto TryAgain;
-		} else
-		    goto FailReturn;
+    if (SEP->property == None) {
+	if (ED_XRecv.TypeAtom == ED_UTF8Atom) {
+	    ED_XRecv.TypeAtom = XA_STRING;
+	    ED_XRecv.DueTime = ED_AuxXSelDueTime();
+	    XConvertSelection(ED_XDP, ED_XRecv.SelAtom, XA_STRING, ED_XRecv.SelAtom, ED_XSelWin, CurrentTime);
+	    XFlush(ED_XDP);
+	    return;
+	}
+	goto Fail;
+    }
 
-	    } else if ((XE.xselection.target == ED_UTF8Atom) ||
-		       (XE.xselection.target == ED_TextAtom) ||
-		       (XE.xselection.target == XA_STRING)) {
-		XEvent		IgnoreE;
+    if ((SEP->target != ED_UTF8Atom) && (SEP->target != ED_TextAtom) && (SEP->target != XA_STRING))
+	goto Fail;
 
-		// XSel Owner responded with a Target type we know and like.
-		// Get rid of previous PropertyChange events... may have a few!
-		while (XCheckWindowEvent(ED_XDP, ED_XSelWin, PropertyChangeMask, &IgnoreE));
-		
-		if (Success == XGetWindowProperty(ED_XDP, ED_XSelWin, SelAtom, 0L, LONG_MAX, True, AnyPropertyType,
-						  &ResType, &ResFormat, &DataLen, &LenLeft, (unsigned char **)&DataP)) {
-		    // If ResType is INCR, switch to INCRemental transfer protocol.
-		    // Otherwise, we got the data...!!
-		    if (ResType == ED_IncrAtom) {
-			//printf("INCR -> Length %d\n", *(Uns32 *)DataP);
-			XFree(DataP);
-			if (ED_XSelInsertINCRData(PaneP, SelAtom))
-			    return 1;
-			else
-			    goto FailReturn;
-		    } else {
+    if (Success != XGetWindowProperty(ED_XDP, ED_XSelWin, ED_XRecv.SelAtom, 0L, LONG_MAX, True, AnyPropertyType,
+				      &ResType, &ResFormat, &DataLen, &LenLeft, (unsigned char **)&DataP))
+	goto Fail;
 
-			if (DataLen) {
-			    TempBufP = ED_BufferNew(DataLen + ED_GAPEXTRAEXPAND, NULL, NULL, 0);
-			    memcpy(TempBufP->GapStartP, DataP, DataLen);
-			    TempBufP->GapStartP += DataLen;
-			    TempBufP->LastPos = DataLen;
-
-			    if (ED_BufferNeedsFilter(TempBufP))
-				ED_BufferDoFilter(TempBufP, NULL, NULL);
-
-			    ED_BufferPushMark(PaneP->BufP, PaneP->CursorPos);
-			    ED_PaneInsertBufferChars(PaneP, TempBufP, 1);
-			    ED_BufferKill(TempBufP);
-			    ED_FrameDrawAll(PaneP->FrameP);
-			}
-			XFree(DataP);			
-			return 1;
-		    }
-		} else
-		    goto FailReturn;
+    // If ResType is INCR, switch to INCRemental transfer protocol.
+    // Deleting the property (above) tells the owner to send the first block.
+    if (ResType == ED_IncrAtom) {
+	ED_XRecv.Incr = 1;
+	ED_XRecvBegin((DataLen && (ResFormat == 32)) ? *(long *)DataP : 0);
+	XFree(DataP);
+	return;
+    }
 
-	    }
-	}
-    } while (ED_AuxWaitXSelTimer(2048));
+    ED_XRecvBegin(DataLen);
+    if (DataLen) ED_XRecvAdd(DataP, DataLen);
+    XFree(DataP);
+    ED_XRecvEnd();
+    return;
 
-FailReturn:
-    ED_FrameFlashError(PaneP->FrameP);
-    return 0;
+Fail:
+    ED_XRecvAbort();
+    ED_FrameFlashError(ED_CurFrameP);
+}
+
+// PropertyNotify (NewValue) on ED_XSelWin during INCR, the next block is in.
+// Reading it deletes it, which asks for the next one.
+void	ED_XRecvBlock(void)
+{
+    Atom		ResType;
+    char		*DataP;
+    unsigned long	DataLen, LenLeft;
+    Int32		ResFormat;
+
+    if (Success != XGetWindowProperty(ED_XDP, ED_XSelWin, ED_XRecv.SelAtom, 0L, LONG_MAX, True, AnyPropertyType,
+				      &ResType, &ResFormat, &DataLen, &LenLeft, (unsigned char **)&DataP)) {
+	ED_XRecvAbort();
+	ED_FrameFlashError(ED_CurFrameP);
+	return;
+    }
+
+    if (DataLen) {
+	ED_XRecvAdd(DataP, DataLen);
+	XFree(DataP);
+    } else {
+	XFree(DataP);
+	ED_XRecvEnd();
+    }
 }
 
 // Event handler (for ED_XSelWin) registered with the main event loop.
 // Incoming SelectionRequest will trigger XSelSendData.  Will also get
 // incoming SelectionClear requests--as other apps claim the XSel (PRIMARY
-// or CLIPBOARD).  SelectionNotify is generally ignored here as XSelInsertData
-// will look for it locally.  INCR protocol is handled locally, rather than
-// through main event loop.
+// or CLIPBOARD).  SelectionNotify and PropertyNotify drive a paste
+// in progress (ED_XRecv).
 void	ED_XSelHandleEvent(XEvent * EventP, void * DataP)
 {
     switch (EventP->type) {
@@ -2035,7 +3364,7 @@ void	ED_XSelHandleEvent(XEvent * EventP, void * DataP)
 
 	    // printf("XSel Request Req:%ld, Sel: %ld  Target:%ld  Property:%ld\n",
 	    // 	    SREP->requestor, SREP->selection, SREP->target, SREP->property);
-	    
+
 	    if (SREP->target == ED_TargetsAtom) {
 		// Always reply with UTF8_STRING... without checking if we are still the owner
 		XChangeProperty(ED_XDP, SE.requestor, SE.property, XA_ATOM, 32,
@@ -2044,21 +3373,30 @@ void	ED_XSelHandleEvent(XEvent * EventP, void * DataP)
 
 	    } else if ((SREP->target == XA_STRING) || (SREP->target == ED_TextAtom)) {
 		ED_XSelSendData(&SE, XA_STRING);
-		
+
 	    } else if (SREP->target == ED_UTF8Atom) {
 		ED_XSelSendData(&SE, ED_UTF8Atom);
-		
+
 	    } else {
 		// Unkown target
 		SE.property = None;
 		XSendEvent(ED_XDP, SE.requestor, 0, 0, (XEvent *)&SE);
 	    }
-	    
+
 	    break;
 	}
-	
+
 	case SelectionNotify:
-	    // printf("XSel Notify\n");
+	    ED_XRecvNotify(&EventP->xselection);
+	    break;
+
+	case PropertyNotify:
+	    if (ED_XRecv.BufP && ED_XRecv.Incr &&
+		(EventP->xproperty.state == PropertyNewValue) &&
+		(EventP->xproperty.atom == ED_XRecv.SelAtom))
+		ED_XRecvBlock();
+	    break;
+
 	default:
 	    break;
     }
@@ -2114,7 +3452,7 @@ void	ED_XSelReleasePrimary(ED_BufferPointer BufP)
 // or deleted BEFORE the specified Pos.  If data in the Pos-Len range is
 // altered, then it is best to relinquish the PRIMARY XSel--user can
 // re-select later...
-void	ED_XSelAlterPrimary(ED_BufferPointer BufP, Int32 Pos, Int32 Len)
+void	ED_XSelAlterPrimary(ED_BufferPointer BufP, Int64 Pos, Int64 Len)
 {
     if ((BufP != ED_PrimaryBufP) || (Len == 0))
 	return;
@@ -2162,34 +3500,28 @@ void	ED_XSelLostClip(void)
 
 // ******************************************************************************
 // ******************************************************************************
-// ED_KillRing is a single statically allocated structure that manages two memory
-// buffers, one for the current (Top) kill, and one for the accumulated previous
-// (Rest) kills.  If the user kills a number of words/lines in sequences, they are
-// all added and combined in the Top buffer.  But if another command is executed,
-// the Top buffer is frozen.  If the user kills another line, the frozen Top will
-// be transfered to the Rest buffer, and the new kill data will be placed in Top.
-//
-// The Elts array in ED_KillRing points to the buffers and implements a circular
-// stack... Indices wrap around using ED_KILLRINGMASK.  
+// ED_KillRing is a single statically allocated structure.  Each entry in its
+// EltArr owns a malloc chunk for its data.  If the user kills a number of
+// words/lines in sequences, they are all added and combined in the Top entry.
+// But if another command is executed, the Top is frozen.  If the user kills
+// another line, a new Top entry is pushed--the old one keeps its chunk, nothing
+// is copied.  Chunks grow geometrically, so a long run of kills costs O(size).
+//
+// The Elts array implements a circular stack... Indices wrap around using
+// ED_KILLRINGMASK.  The oldest entry is recycled for the new Top, chunk and all.
+//
+// NOTE:	ED_KillRingYank hands out pointers INTO these chunks (no copy).
+//		They stay valid until the entry is appended/prepended to or
+//		recycled--i.e. until the next kill.  INCR XSel transfers read
+//		a chunk for longer, so a chunk they use is never moved or
+//		overwritten, it is handed over to them (ED_KillRingDropChunk).
 
 void	ED_KillRingInit(void)
 {
-    char		*TP, *RP;
     Int16		I;
     ED_KEPointer	KEP;
 
-    TP = malloc(ED_KRTOPINITLEN);
-    if (! TP) G_SETEXCEPTION("Malloc KillRing Top Failed", 0);
-
-    RP = malloc(ED_KRRESTINITLEN);
-    if (! RP) G_SETEXCEPTION("Malloc KillRing Rest Failed", 0);
-
     ED_KillRing.Flags = ED_KRNOFLAG;
-    ED_KillRing.TopP = TP;
-    ED_KillRing.TopLen = ED_KRTOPINITLEN;
-    ED_KillRing.RestP = RP;
-    ED_KillRing.RestLen = ED_KRRESTINITLEN;
-    ED_KillRing.RestDataLen = 0;
     ED_KillRing.TopI = 0;
     ED_KillRing.YankI = (ED_KillRing.TopI - 1) & ED_KILLRINGMASK;
 
@@ -2198,53 +3530,88 @@ void	ED_KillRingInit(void)
 	KEP->Flags = ED_KENOFLAG;
 	KEP->Pos = 0;
 	KEP->Len = 0;
+	KEP->MemP = NULL;
+	KEP->MemLen = 0;
     }
     ED_KillRing.EltArr[0].Flags |= ED_KETOPFLAG;
 }
 
 void	ED_KillRingFree(void)
 {
-    free(ED_KillRing.TopP);
-    free(ED_KillRing.RestP);
-    ED_KillRing.TopP = NULL;
-    ED_KillRing.RestP = NULL;
+    Int16		I;
+
+    for (I = 0; I < ED_KILLRINGCOUNT; I++) {
+	sc_SAPoolFree(&ED_PayloadPool, ED_KillRing.EltArr[I].MemP, ED_KillRing.EltArr[I].MemLen);
+	ED_KillRing.EltArr[I].MemP = NULL;
+	ED_KillRing.EltArr[I].MemLen = 0;
+    }
     // Assume everything is being zapped, no reason to cleanup.
 }
 
+// ******************************************************************************
+// ED_KillRingDropChunk lets go of the chunk of KEP.  Freed, unless an XSel
+// transfer is still sending it (ED_XSendAdoptChunk), then it is theirs.
+
+void	ED_KillRingDropChunk(ED_KEPointer KEP)
+{
+    if (! ED_XSendAdoptChunk(KEP->MemP, KEP->MemLen))
+	sc_SAPoolFree(&ED_PayloadPool, KEP->MemP, KEP->MemLen);
+    KEP->MemP = NULL;
+    KEP->MemLen = 0;
+}
+
+// ******************************************************************************
+// ED_KillRingMakeRoom ensures KEP has room for DataLen more bytes, in front of
+// its data (Front) or after it.  If the chunk is at least twice what is needed,
+// it just slides the data so all the free space is on the wanted side.
+// Otherwise, it moves to a new chunk, doubled until it is twice the need.
+// Either way, the next slide/grow is at least Len bytes away--so O(1) amortized.
+
+void	ED_KillRingMakeRoom(ED_KEPointer KEP, Int64 DataLen, Int16 Front)
+{
+    Int64		Need = KEP->Len + DataLen;
+    Int64		NewLen, NewPos;
+    char *		MemP;
+
+    if (Front) {
+	if (KEP->Pos >= DataLen) return;
+    } else if (KEP->Pos + Need <= KEP->MemLen)
+	return;
+
+    if ((2 * Need <= KEP->MemLen) && ! ED_XSendChunkBusy(KEP->MemP)) {
+	NewPos = (Front) ? KEP->MemLen - KEP->Len : 0;
+	memmove(KEP->MemP + NewPos, KEP->MemP + KEP->Pos, KEP->Len);
+	KEP->Pos = NewPos;
+	return;
+    }
+
+    NewLen = (KEP->MemLen) ? KEP->MemLen : ED_KRINITLEN;
+    while (NewLen < 2 * Need) NewLen *= 2;
+
+
+    MemP = sc_SAPoolAlloc(&ED_PayloadPool, NewLen);
+    if (! MemP) G_SETEXCEPTION("Malloc KillRing Chunk Failed", 0);
+
+    NewPos = (Front) ? NewLen - KEP->Len : 0;
+    if (KEP->Len) memcpy(MemP + NewPos, KEP->MemP + KEP->Pos, KEP->Len);
+    ED_KillRingDropChunk(KEP);
+    KEP->MemP = MemP;
+    KEP->MemLen = NewLen;
+    KEP->Pos = NewPos;
+}
+
 // ******************************************************************************
 // ED_KillRingAppendTop is called to append new data to the TOP element of the
 // KillRing.  This happens only if the user KILLS again, with a routine that goes
 // in the forward direction.  The idea is to combine multiple kills into a single
 // one that can be yanked back.
-//
-// NOTE:	The whole reason to have a separate TopP buffer (instead of RestP)
-//		is to allow for these appends as the user makes multiple kills
-//		in sequence.
 
-void	ED_KillRingAppendTop(char * DataP, Int32 DataLen)
+void	ED_KillRingAppendTop(char * DataP, Int64 DataLen)
 {
     ED_KEPointer	KEP = ED_KillRing.EltArr + ED_KillRing.TopI;
-    char *		MemP = ED_KillRing.TopP;
-    Int32		Len;
-
-    // Enough room?  Slide contents Up first, then expand!
-    while (KEP->Pos + KEP->Len + DataLen > ED_KillRing.TopLen) {
-	if (KEP->Pos) {
-	    memmove(MemP, MemP + KEP->Pos, KEP->Len);
-	    KEP->Pos = 0;
-	    continue;
-	}
-
-	// Pos is already 0 if we get here.
-	Len = KEP->Len + DataLen + ED_KRTOPEXTRA;
-	MemP = realloc(MemP, Len);
-	if (! MemP) G_SETEXCEPTION("Append: Realloc KillRing Top Failed", 0);
-	ED_KillRing.TopP = MemP;
-	ED_KillRing.TopLen = Len;
-	break;
-    }
 
-    memcpy(MemP + KEP->Pos + KEP->Len, DataP, DataLen);
+    ED_KillRingMakeRoom(KEP, DataLen, 0);
+    memcpy(KEP->MemP + KEP->Pos + KEP->Len, DataP, DataLen);
     KEP->Len += DataLen;
 }
 
@@ -2253,42 +3620,24 @@ void	ED_KillRingAppendTop(char * DataP, Int32 DataLen)
 // that was used deletes in the reverse/backward direction.  Therefore, the killed
 // data should go BEFORE the existing data in Top.
 
-void	ED_KillRingPrependTop(char * DataP, Int32 DataLen)
+void	ED_KillRingPrependTop(char * DataP, Int64 DataLen)
 {
     ED_KEPointer	KEP = ED_KillRing.EltArr + ED_KillRing.TopI;
-    char *		MemP = ED_KillRing.TopP;
-    Int32		Len;
-
-    // Enough room?  Expand first, then slide contents down
-    if (KEP->Pos < DataLen) {
-	if (DataLen + KEP->Len > ED_KillRing.TopLen) {
-	    Len = DataLen + KEP->Len + ED_KRTOPEXTRA;
-	    MemP = realloc(MemP, Len);
-	    if (! MemP) G_SETEXCEPTION("Prepend: Realloc KillRing Top Failed", 0);
-	    ED_KillRing.TopP = MemP;
-	    ED_KillRing.TopLen = Len;
-	}
-
-	// Slide data all the way to bottom... likely to do another Prepend later!
-	Len = ED_KillRing.TopLen;
-	memmove(MemP + Len - KEP->Len, MemP + KEP->Pos, KEP->Len);
-	KEP->Pos = Len - KEP->Len;
-    }
 
+    ED_KillRingMakeRoom(KEP, DataLen, 1);
     KEP->Pos -= DataLen;
-    memcpy(MemP + KEP->Pos, DataP, DataLen);
+    memcpy(KEP->MemP + KEP->Pos, DataP, DataLen);
     KEP->Len += DataLen;
 }
 
 // ******************************************************************************
-// ED_KillRingAdvanceTop is called prior to pushing new data onto Top.
+// ED_KillRingAdvanceTop is called prior to pushing new data onto Top.  The
+// oldest entry becomes the new (empty) Top, its data is dropped.
 
 void	ED_KillRingAdvanceTop(void)
 {
     ED_KEPointer	TopKEP, LastKEP;
-    Int32		Len;
     Int16		LastI;
-    char		*MemP;
 
     TopKEP = ED_KillRing.EltArr + ED_KillRing.TopI;
     
@@ -2297,64 +3646,31 @@ void	ED_KillRingAdvanceTop(void)
 
     LastI = (ED_KillRing.TopI + 1) & ED_KILLRINGMASK;
     LastKEP = ED_KillRing.EltArr + LastI;		// Get the last KEP, 
-    if (LastKEP->Len) {					// Zap its data, if any!
-	ED_KillRing.RestDataLen -= LastKEP->Len;	// Will be at BOTTOM of RestP
-	LastKEP->Pos = LastKEP->Len = 0;		// Clean out KEP record
-    }
-
-    MemP = ED_KillRing.RestP;
-    Len = ED_KillRing.RestDataLen + TopKEP->Len;	// Total data len for RestP
-    
-    // Now there is a gap at the end of RestP.  Enough for TopP or Expand!
-    if (ED_KillRing.RestLen < Len) {
-	Len += ED_KRRESTEXTRA;
-	MemP = realloc(MemP, Len);
-	if (! MemP) G_SETEXCEPTION("Realloc KillRing Rest Failed", 0);
-	ED_KillRing.RestP = MemP;
-	ED_KillRing.RestLen = Len;
-    }
-
-    memmove(MemP + TopKEP->Len, MemP, ED_KillRing.RestDataLen);	// Slide RestP down just enough
-    memcpy(MemP, ED_KillRing.TopP + TopKEP->Pos, TopKEP->Len);	// Copy TopP to the top of RestP
-    ED_KillRing.RestDataLen += TopKEP->Len;		// RestP gets the former Top data
-    TopKEP->Pos = 0;					// At very top of RestP
     TopKEP->Flags &= ~ ED_KETOPFLAG;			// First of the Rest, no longer Top.
 
     ED_KillRing.TopI = LastI;				// New Top!
     LastKEP->Flags = ED_KETOPFLAG;
-    LastKEP->Pos = LastKEP->Len = 0;			// Top is Empty!
-
-    // Since we wrote the top of RestP, all other Pos offsets are displaced
-    // down... skip the new TopKEP and the old LastKEP.
-
-    LastKEP = ED_KillRing.EltArr;			// Recycle LastI/TopKEP vars
-    for (LastI = 0; LastI < ED_KILLRINGCOUNT; LastI++, LastKEP++)
-	if (LastKEP->Len && (LastKEP != TopKEP))	// Old TopKEP is current TOP of RestP
-	    LastKEP->Pos += TopKEP->Len;
+    LastKEP->Pos = LastKEP->Len = 0;			// Top is Empty, chunk is recycled!
 }
 
 // ******************************************************************************
 // ED_KillRingWriteTop is called to store recently killed chars in the KillRing.
+// A recycled chunk that is far too big for DataLen (or still being sent) is let go.
 //
-// NOTE:	*MUST* call StashTop before calling this function.
+// NOTE:	*MUST* call AdvanceTop before calling this function.
 
-void	ED_KillRingWriteTop(char * DataP, Int32 DataLen)
+void	ED_KillRingWriteTop(char * DataP, Int64 DataLen)
 {
     ED_KEPointer	KEP = ED_KillRing.EltArr + ED_KillRing.TopI;
-    char *		MemP = ED_KillRing.TopP;
-    Int32		Len = ED_KillRing.TopLen;
 
     ED_KillRing.YankI = ED_KillRing.TopI;
-    if (Len < DataLen) {				// Enough room?
-	Len = DataLen + ED_KRTOPEXTRA;			// Expand!
-	MemP = realloc(MemP, Len);			
-	if (! MemP) G_SETEXCEPTION("NewTop: Realloc KillRing Top Failed", 0);
-	ED_KillRing.TopP = MemP;
-	ED_KillRing.TopLen = Len;
-    }
+    if (((KEP->MemLen > ED_KRKEEPLEN) && (KEP->MemLen / 4 > DataLen)) ||
+	ED_XSendChunkBusy(KEP->MemP))
+	ED_KillRingDropChunk(KEP);
 
-    memcpy(MemP, DataP, DataLen);
-    KEP->Pos = 0;
+    KEP->Pos = KEP->Len = 0;
+    ED_KillRingMakeRoom(KEP, DataLen, 0);
+    memcpy(KEP->MemP, DataP, DataLen);
     KEP->Len = DataLen;
 }
 
@@ -2364,7 +3680,7 @@ void	ED_KillRingWriteTop(char * DataP, Int32 DataLen)
 // existing TopP, depending on Forward/Reverse direction.  In this way multiple
 // sequential kills will be grouped as 1 big mass homicide--emacs lingo!!
 
-void	ED_KillRingAdd(char * DataP, Int32 DataLen, Int16 OpForward)
+void	ED_KillRingAdd(char * DataP, Int64 DataLen, Int16 OpForward)
 {
     if ((ED_QRPaneP && ED_QRLastCmd == ED_QRKillCmd) ||
 	(ED_CmdLastId == ED_KillId)) {
@@ -2387,7 +3703,7 @@ void	ED_KillRingAdd(char * DataP, Int32 DataLen, Int16 OpForward)
 // around until it finds a nonzero entry--really only an issue when first starting
 // up, as the KR soon fills up with entries.
 
-void	ED_KillRingYank(Int32 PopCount, char **PP, Int32 *LenP, Int16 LoopForData)
+void	ED_KillRingYank(Int32 PopCount, char **PP, Int64 *LenP, Int16 LoopForData)
 {
     ED_KEPointer	KEP;
     Int16		Count, Inc;
@@ -2407,12 +3723,8 @@ void	ED_KillRingYank(Int32 PopCount, char **PP, Int32 *LenP, Int16 LoopForData)
 	}
     }
 
-    // Get from TopP or RestP, depending on KEP.
-    if (ED_KillRing.YankI == ED_KillRing.TopI)
-	*PP = ED_KillRing.TopP + KEP->Pos;
-    else
-	*PP = ED_KillRing.RestP + KEP->Pos;
-
+    // Straight from the chunk, no copy.
+    *PP = (KEP->MemP) ? KEP->MemP + KEP->Pos : NULL;
     *LenP = KEP->Len;
 }
 
@@ -2457,7 +3769,9 @@ void	ED_FrameHandleEvent(XEvent * EventP, ED_FramePointer FP)
 		ED_BufferDoFilter(FP->FirstPaneP->BufP, EDCB_FilterEchoUpdate, FP->FirstPaneP);
 	    }
 
+	    ED_FrameSetWinStale(FP);			// BackPM is still good, just copy it
 	    ED_FrameDrawAll(FP);			// Resets blinker
+	    ED_StartupMark(ED_StartPaint);
 	    break;
 
         case ConfigureNotify:
@@ -2473,6 +3787,7 @@ void	ED_FrameHandleEvent(XEvent * EventP, ED_FramePointer FP)
         case ButtonPress:
 	    if (FP->Flags & ED_FRAMENOWINFLAG) break;
 	    if (! FP->Flags & ED_FRAMEFOCUSFLAG) break;
+	    ED_StatsMarkInput();
 	    ED_FrameHandleClick(FP, EventP);
 	    break;
 
@@ -2485,13 +3800,14 @@ void	ED_FrameHandleEvent(XEvent * EventP, ED_FramePointer FP)
 
 	case KeyPress:
 	    if (FP->Flags & ED_FRAMENOWINFLAG) break;
+	    ED_StatsMarkInput();
 	    {
 		Int16		Count;
 		char		KeyBuf[32];
 		KeySym		KS;
 		Status		XStat = 0;
 		
-		Count = Xutf8LookupString(FP->XICP, &EventP->xkey, KeyBuf, 31, &KS, &XStat);
+		Count = Xutf8LookupString(ED_AuxFrameXIC(FP), &EventP->xkey, KeyBuf, 31, &KS, &XStat);
 		if (XStat == XBufferOverflow) G_SETEXCEPTION("Utf8 LookupSring Buffer Overflow", Count);
 		// Count reflects bytes in buffer, not multi-byte chars.
 		if (Count > -1) {
@@ -2526,7 +3842,7 @@ void	ED_FrameHandleEvent(XEvent * EventP, ED_FramePointer FP)
 	    ED_FrameDrawBlinker(FP);
 	    ED_FrameDrawScrollBar(FP);
 	    sc_BlinkTimerReset();
-	    XSetICFocus(FP->XICP);
+	    if (FP->XICP) XSetICFocus(FP->XICP);	// Else set when created
 	    XSync(ED_XDP, False);			// Necessary if PU creates another PU window!
 	    break;
 
@@ -2563,7 +3879,7 @@ void	ED_FrameHandleEvent(XEvent * EventP, ED_FramePointer FP)
 	    ED_FrameDrawBlinker(FP);
 	    ED_FrameDrawScrollBar(FP);
 	    sc_BlinkTimerReset();
-	    XUnsetICFocus(FP->XICP);
+	    if (FP->XICP) XUnsetICFocus(FP->XICP);
 	    XSync(ED_XDP, False);
 	    break;
 
@@ -2924,9 +4240,8 @@ Int16	ED_FrameCommandMatchAbort(ED_FramePointer FrameP, Uns16 SymChar)
 // ED_FrameCommandMatch is called to initiate a new command match or *CONTINUE*
 // an on-going partial match--as new command chars are typed in.
 //
-// When initiating, ED_CmdBindP is set to the first binding record.
-// In a partial match, ED_CmdBindP limits the number of bindings to be
-// searched.
+// Each call walks the (whole) command KeyStr down the KeyTrie, see
+// ED_FRegFindBinding.  On a perfect match, ED_CmdBindP is the binding.
 //
 // Return 1 means SymChar should be inserted... check on ED_CmdMult !
 // Return 0 means did my thing, success or fail
@@ -2944,7 +4259,7 @@ Int16	ED_FrameCommandMatch(ED_FramePointer FrameP, Uns16 SymChar, Uns32 Mods)
     Int16	NewI;
 
     if (ED_CmdLen == 0) {
-	ED_CmdBindP = ED_FirstBindP;
+	ED_CmdBindP = NULL;
 	ED_CmdEchoDelay = 2;				// 2 blinker cycles
 	ED_FrameEchoLen = 0;				// Clear out Echo line
 	ED_CmdMult = 1;					// Default
@@ -3072,7 +4387,7 @@ Int16	ED_FrameCommandMatch(ED_FramePointer FrameP, Uns16 SymChar, Uns32 Mods)
     ED_CmdLen = 0;
     ED_CmdShift = (Mods & (ShiftMask | LockMask));
     ED_CmdThisId = (Uns64)ED_CmdBindP->FRegP->FuncP;
-	(*ED_CmdBindP->FRegP->FuncP)(FrameP->CurPaneP);
+	ED_FRegExec(ED_CmdBindP->FRegP, FrameP->CurPaneP);
     ED_CmdLastId = ED_CmdThisId;
 
     // Reset the count for everyone EXCEPT M-X... it has not
@@ -3278,7 +4593,7 @@ void	ED_FrameSetSize(ED_FramePointer FrameP, Int16 DoPanes)
 
     if (DoPanes) {
 	ED_PanePointer	PaneP = FrameP->FirstPaneP;
-	Int32		RowStartPos;
+	Int64		RowStartPos;
 
 	if (HChanged) ED_FrameUpdateTextRows(FrameP, OldRowChars);
 	
@@ -3315,6 +4630,10 @@ void	ED_FrameSetSize(ED_FramePointer FrameP, Int16 DoPanes)
 //		wrapped line.  If so, as the Pane width changes, the StartPos
 //		for the Pane has to change, since the long line will wrap
 //		differently!!  (Initial Wrap-FLow problem.)
+//
+// NOTE:	On a big Buffer, the new width is only reflowed around PanePos
+//		here, both counts are estimates (see RowIdx) until the idle
+//		handler catches up with ED_FrameReflowStep.
 
 void	ED_FrameUpdateTextRows(ED_FramePointer FrameP, Int32 OldRowChars)
 {
@@ -3325,6 +4644,7 @@ void	ED_FrameUpdateTextRows(ED_FramePointer FrameP, Int32 OldRowChars)
     PaneP = FrameP->FirstPaneP;
     while (PaneP) {
 	ED_PaneUpdateStartPos(PaneP, OldRowChars);
+	ED_BufferRIdxReflow(PaneP->BufP, ED_BufferRIdxGet(PaneP->BufP, FrameP->RowChars));
 	PaneP->BufRowCount = -1;
 	ED_PaneFindLoc(PaneP, PaneP->PanePos, &PaneP->StartRowCount, &Col, 1, 0);
 	PaneP = PaneP->NextPaneP;
@@ -3350,6 +4670,65 @@ void	ED_FrameUpdateTextRows(ED_FramePointer FrameP, Int32 OldRowChars)
     }
 }
 
+// ******************************************************************************
+// ED_FrameReflowStep is the idle work after a resize.  It reflows one more
+// ED_REFLOWCHUNK for the first Pane whose RowIdx is still estimated, and
+// returns 1 if it did any work.
+
+Int16	ED_FrameReflowStep(void)
+{
+    ED_FramePointer	FP = ED_FirstFrameP;
+    ED_PanePointer	PP;
+    ED_RIdxWidthPointer	WP;
+    Int16		Done;
+
+    while (FP) {
+	PP = FP->FirstPaneP;
+	while (PP) {
+	    WP = ED_BufferRIdxGet(PP->BufP, FP->RowChars);
+	    if (WP->EstBytes) {
+		Done = ED_BufferRIdxReflowStep(PP->BufP, WP);
+		ED_AuxFrameReflowPanes(PP->BufP, FP->RowChars, Done);
+		return 1;
+	    }
+	    PP = PP->NextPaneP;
+	}
+	FP = FP->NextFrameP;
+    }
+
+    return 0;
+}
+
+// ED_AuxFrameReflowPanes gives the Panes showing BufP at RowChars their real
+// StartRowCount once the reflow is near, and (if Done) their real BufRowCount.
+
+void	ED_AuxFrameReflowPanes(ED_BufferPointer BufP, Int32 RowChars, Int16 Done)
+{
+    ED_FramePointer	FP = ED_FirstFrameP;
+    ED_PanePointer	PP;
+    ED_RIdxWidthPointer	WP = ED_BufferRIdxGet(BufP, RowChars);
+    Int32		Col;
+
+    while (FP) {
+	PP = (FP->RowChars == RowChars) ? FP->FirstPaneP : NULL;
+	while (PP) {
+	    if ((PP->BufP == BufP) &&
+		(Done || ((PP->Flags & ED_PANEROWESTFLAG) &&
+			  (PP->PanePos <= WP->ArrP[WP->Count - 1].Pos + ED_REFLOWNEAR)))) {
+		ED_PaneRowsFix(PP);
+		if (Done) {
+		    ED_PaneFindLoc(PP, BufP->LastPos, &PP->BufRowCount, &Col, 1, 0);
+		    ED_PaneSetScrollBar(PP);
+		}
+		ED_PaneDrawScrollBar(PP, 0);
+		ED_PaneDrawModeLine(PP);
+	    }
+	    PP = PP->NextPaneP;
+	}
+	FP = FP->NextFrameP;
+    }
+}
+
 // ******************************************************************************
 // ED_FrameNew will allocate and init a new FrameRecord, will stash in ED_FirstFrameP.
 //
@@ -3371,6 +4750,11 @@ void	ED_FrameNew(Int32 WinWidth, Int32 WinHeight, ED_BufferPointer BufP)
     FrameP->BlinkerGC = 0;
     FrameP->HiliteGC = 0;
     FrameP->HLBlinkerGC = 0;
+    FrameP->CopyGC = 0;
+    FrameP->BackPM = 0;				// Created on first PaneDrawText
+    FrameP->BackDP = NULL;
+    FrameP->BackWidth = 0;
+    FrameP->BackHeight = 0;
     FrameP->Number = ED_FrameN;
     FrameP->PaneCount = 0;
     FrameP->WinWidth = WinWidth;
@@ -3406,6 +4790,7 @@ void	ED_FrameWinDestroyed(ED_FramePointer FrameP)
     while (ThisPP) {
 	NextPP = ThisPP->NextPaneP;
 	// Do NOT kill Info Buffers here, FrameKill has already done that!
+	ED_PaneRowCacheFree(ThisPP);
 	sc_SAStoreFreeBlock(&ED_PaneStore, ThisPP);
 	ThisPP = NextPP;
     }
@@ -3462,8 +4847,14 @@ void	ED_FrameKill(ED_FramePointer FrameP)
     FrameP->HiliteGC = 0;
     XFreeGC(ED_XDP, FrameP->HLBlinkerGC);	// Free the GC
     FrameP->HLBlinkerGC = 0;
+    XFreeGC(ED_XDP, FrameP->CopyGC);
+    FrameP->CopyGC = 0;
+    if (FrameP->BackDP) XftDrawDestroy(FrameP->BackDP);
+    FrameP->BackDP = NULL;
+    if (FrameP->BackPM) XFreePixmap(ED_XDP, FrameP->BackPM);
+    FrameP->BackPM = 0;
     
-    XDestroyIC(FrameP->XICP);
+    if (FrameP->XICP) XDestroyIC(FrameP->XICP);
     FrameP->XICP = NULL;
     
     XDestroyWindow(ED_XDP, FrameP->XWin);
@@ -3529,24 +4920,59 @@ void	ED_FrameKillAsk(ED_FramePointer FrameP)
 //
 // Drawing the whole frame is usually the last thing and takes time...
 // So reset BlinkTimer too!
+//
+// NOTE:	Like ED_PaneDrawText, this only marks the Frame dirty.  MAIN drains
+//		all pending events, then calls ED_RenderHandler to draw it just once.
+//		Call ED_FrameRender if the screen must be up to date right now.
 
 void    ED_FrameDrawAll(ED_FramePointer FrameP)
 {
-    ED_PanePointer	PaneP;
+    FrameP->Flags |= ED_FRAMEDIRTYFLAG;
+    sc_BlinkTimerReset();
+}
 
-    // Draw left and right margins first
+void	ED_FrameRenderAll(ED_FramePointer FrameP)
+{
+    ED_PanePointer	PaneP;
+    Int64		StartNs;
 
     PaneP = FrameP->FirstPaneP;			// Draw all the panes first
     while (PaneP) {
-	ED_PaneDrawText(PaneP);
+	StartNs = sc_ClockNSecs();
+	ED_PaneRender(PaneP);
+	ED_StatsHistAdd(ED_RenderHistId, sc_ClockNSecs() - StartNs);
 	ED_PaneDrawScrollBar(PaneP, 0);
 	PaneP = PaneP->NextPaneP;
     }
 
     ED_FrameDrawEchoLine(FrameP);
     ED_FrameDrawBlinker(FrameP);
+}
 
-    sc_BlinkTimerReset();
+// Draw whatever was marked dirty on the Frame.  A dirty Pane gets its Blinker back too.
+void	ED_FrameRender(ED_FramePointer FrameP)
+{
+    ED_PanePointer	PaneP;
+    Int64		StartNs;
+
+    if (FrameP->Flags & ED_FRAMENOWINFLAG) return;
+
+    if (FrameP->Flags & ED_FRAMEDIRTYFLAG) {
+	FrameP->Flags &= ~ED_FRAMEDIRTYFLAG;
+	ED_FrameRenderAll(FrameP);
+	return;
+    }
+
+    PaneP = FrameP->FirstPaneP;
+    while (PaneP) {
+	if (PaneP->Flags & ED_PANEDIRTYFLAG) {
+	    StartNs = sc_ClockNSecs();
+	    ED_PaneRender(PaneP);
+	    ED_StatsHistAdd(ED_RenderHistId, sc_ClockNSecs() - StartNs);
+	    ED_PaneDrawBlinker(PaneP);
+	}
+	PaneP = PaneP->NextPaneP;
+    }
 }
 
 // ******************************************************************************
@@ -3695,6 +5121,13 @@ void	ED_PaneNew(ED_FramePointer FrameP, ED_BufferPointer NewBufP)
     PaneP->FracRowCount = (Int64)PaneP->RowCount << 32;	// 32.32
     PaneP->BufRowCount = 0;
     PaneP->StartRowCount = 0;
+    PaneP->RCArrP = NULL;			// RowCache is allocated on first draw
+    PaneP->RCMax = 0;
+    PaneP->RCRowCount = 0;
+    PaneP->RCTopRow = 0;
+    PaneP->RCRowChars = 0;
+    PaneP->XORFirstRow = 0x7FFFFFFF;
+    PaneP->XORLastRow = -1;
     FrameP->FirstPaneP = PaneP;
     FrameP->CurPaneP = PaneP;
     
@@ -3740,6 +5173,13 @@ void	ED_PaneSplit(ED_PanePointer PaneP)
     NewPaneP->PanePos = PaneP->PanePos;
     NewPaneP->CursorRow = PaneP->CursorRow;
     NewPaneP->CursorCol = PaneP->CursorCol;
+    NewPaneP->RCArrP = NULL;
+    NewPaneP->RCMax = 0;
+    NewPaneP->RCRowCount = 0;
+    NewPaneP->RCTopRow = 0;
+    NewPaneP->RCRowChars = 0;
+    NewPaneP->XORFirstRow = 0x7FFFFFFF;
+    NewPaneP->XORLastRow = -1;
 
     // Divide the pane, but account properly for fractional size.
     // If the pane is really 27.3 lines, then top gets 14 (13.65)
@@ -3758,6 +5198,7 @@ void	ED_PaneSplit(ED_PanePointer PaneP)
     NewPaneP->FracRowCount = TotalFracRows - PaneP->FracRowCount;
     NewPaneP->BufRowCount = PaneP->BufRowCount;			// Same Buf, same Frame
     NewPaneP->StartRowCount = PaneP->StartRowCount;		// Same PanePos
+    NewPaneP->Flags |= PaneP->Flags & ED_PANEROWESTFLAG;	// Same estimate too
 
     // Create a ModeWin for new Pane.  But this gets tricky.
     // First time around, upper Pane gets XModeWin.  But if split again,
@@ -3852,7 +5293,7 @@ void	ED_PaneKill(ED_PanePointer PaneP)
 	
     } else if (PaneP->NextPaneP) {	// PaneP has no Prev if we get here
 	ED_PanePointer		NP = PaneP->NextPaneP;
-	Int32			Rows = PaneP->RowCount;
+	Int64			Rows = PaneP->RowCount;
     
 	// Give space to next Pane, Prev is NULL--so this was first
 	PaneP->FrameP->FirstPaneP = NP;
@@ -3883,6 +5324,7 @@ void	ED_PaneKill(ED_PanePointer PaneP)
     PaneP->BufP->CursorPos = PaneP->CursorPos;	// Stash in Buffer, for next visit to Buffer
     PaneP->BufP->PanePos = PaneP->PanePos;
     ED_FrameResetWinMinSize(PaneP->FrameP);	// Lost a pane, so WinMinSize is less
+    ED_PaneRowCacheFree(PaneP);
     sc_SAStoreFreeBlock(&ED_PaneStore, PaneP);
     
 }
@@ -3901,7 +5343,8 @@ void	ED_PaneKill(ED_PanePointer PaneP)
 Int16	ED_PaneResize(ED_PanePointer PaneP, Int32 Delta)
 {
     ED_PanePointer	NextP;
-    Int32		NewRowCount, RowStart;
+    Int32		NewRowCount;
+    Int64		RowStart;
 
     if (!PaneP || !PaneP->NextPaneP) return 0;
 
@@ -3971,7 +5414,8 @@ Int16	ED_PaneResize(ED_PanePointer PaneP, Int32 Delta)
 void	ED_PaneUpdateStartPos(ED_PanePointer PaneP, Int32 OldRowChars)
 {
     ED_BufferPointer	BufP = PaneP->BufP;
-    Int32		Pos, Count, PrevRowPos, RowCount, SubCount, NewRowChars;
+    Int32		Count, RowCount, SubCount, NewRowChars;
+    Int64		Pos, PrevRowPos;
     char		*CurP;
 
     NewRowChars = PaneP->FrameP->RowChars;
@@ -4035,7 +5479,8 @@ void	ED_PaneUpdateStartPos(ED_PanePointer PaneP, Int32 OldRowChars)
 void	ED_PaneUpdateAllPos(ED_PanePointer PaneP, Int32 MoveCursor)
 {
     ED_BufferPointer	BufP = PaneP->BufP;
-    Int32		RowStartPos, Col;
+    Int32		Col;
+    Int64		RowStartPos;
     
     // Set PanePos and StartRowCount first
     if (PaneP->PanePos >= BufP->LastPos) PaneP->PanePos = 0;
@@ -4057,12 +5502,29 @@ void	ED_PaneUpdateAllPos(ED_PanePointer PaneP, Int32 MoveCursor)
     ED_PaneSetScrollBar(PaneP);
 }
 
-
 // ******************************************************************************
-// ED_PaneDrawBlinker draws the blinker for the given Pane.
-// The concept of a Blinker gets implemented as a Solid or Box Cursor.
-//
-// The Blinker in a pane that has keyboard Focus is a solid rect, blinks on and
+// ED_PaneRowsFix replaces an estimated StartRowCount (ED_PANEROWESTFLAG) with
+// the real one, once the RowIdx reflow is near PanePos.  Rows relative to
+// PanePos were counted all along, BufRowCount moves by the same amount.
+
+void	ED_PaneRowsFix(ED_PanePointer PaneP)
+{
+    Int64	Row;
+    Int32	Col;
+
+    PaneP->Flags &= ~ED_PANEROWESTFLAG;
+    ED_PaneFindLoc(PaneP, PaneP->PanePos, &Row, &Col, 1, 0);
+    PaneP->BufRowCount += Row - PaneP->StartRowCount;
+    PaneP->StartRowCount = Row;
+    ED_PaneSetScrollBar(PaneP);
+}
+
+
+// ******************************************************************************
+// ED_PaneDrawBlinker draws the blinker for the given Pane.
+// The concept of a Blinker gets implemented as a Solid or Box Cursor.
+//
+// The Blinker in a pane that has keyboard Focus is a solid rect, blinks on and
 // off.  The Blinker in a pane WITHOUT focus is a hollow box, does not blink.
 
 void	ED_PaneDrawBlinker(ED_PanePointer PaneP)
@@ -4120,6 +5582,11 @@ void	ED_PaneDrawCursor(ED_PanePointer PaneP, Int16 Box)
     
     X = FP->FrameX + (PaneP->CursorCol * ED_Advance);
     Y = FP->FrameY + ((PaneP->TopRow + PaneP->CursorRow) * ED_Row);
+
+    // PaneDrawText must copy these Rows again--on or off, Cursor may have moved in between.
+    if (PaneP->CursorRow < PaneP->XORFirstRow) PaneP->XORFirstRow = PaneP->CursorRow;
+    if (PaneP->CursorRow > PaneP->XORLastRow) PaneP->XORLastRow = PaneP->CursorRow;
+
     if (Box) {
 	XDrawRectangle(ED_XDP, FP->XWin, FP->BlinkerGC, X, Y, ED_Advance-1, ED_Height-1);
 	PaneP->Flags ^= ED_PANEBOXCURSORFLAG;
@@ -4171,7 +5638,7 @@ DrawSolid:
 //
 // NOTE:	DO NOT CALL with *PosP greater than BufP->LastPos.
 
-char *	ED_PaneGetDrawRow(ED_PanePointer PaneP, Int32 *PosP, Int32 *ColP, Int32 *CountP, Int16 * WrapP, Int16 * PartialP)
+char *	ED_PaneGetDrawRow(ED_PanePointer PaneP, Int64 *PosP, Int32 *ColP, Int32 *CountP, Int16 * WrapP, Int16 * PartialP)
 {
     ED_BufferPointer	BufP = PaneP->BufP;
     char		*StartP, *EndP, *CurP;
@@ -4232,7 +5699,7 @@ char *	ED_PaneGetDrawRow(ED_PanePointer PaneP, Int32 *PosP, Int32 *ColP, Int32 *
 // Variables used for PaneDrawText (PDT) showing Incremental Search (IS) matches.
 Int16	ED_PDT_InMatch = 0;		// PaneDrawText: IN a match to ISStr (may be Alt)
 Int16	ED_PDT_IsMain = 0;		// PaneDrawText: This match is the MAIN one (not Alt)
-Int32	ED_PDT_StartPos = 0;		// PaneDrawText: StartPos for last match (Main or Alt)
+Int64	ED_PDT_StartPos = 0;		// PaneDrawText: StartPos for last match (Main or Alt)
 
 // Find any matches that start *BEFORE* top of pane, but may extend INTO pane.
 // (If in QueryReplace (QREP), not interested in alternative BEFORE the main match,
@@ -4240,7 +5707,7 @@ Int32	ED_PDT_StartPos = 0;		// PaneDrawText: StartPos for last match (Main or Al
 void	ED_PDTFindHangingMatch(ED_PanePointer PaneP)
 {
     ED_BufferPointer	BufP = PaneP->BufP;
-    Int32		CurPos;
+    Int64		CurPos;
 
     ED_PDT_InMatch = 0;
     ED_PDT_StartPos = 0;
@@ -4250,7 +5717,7 @@ void	ED_PDTFindHangingMatch(ED_PanePointer PaneP)
 	CurPos = PaneP->PanePos - ED_ISStrLen;
 	if (CurPos < 0) CurPos = 0;
 	while (CurPos < PaneP->PanePos) {
-	    if (ED_ISCheckMatch(BufP, CurPos)) {
+	    if (ED_ISSetIsMatch(BufP, CurPos)) {
 		ED_PDT_InMatch = 1;
 		ED_PDT_StartPos = CurPos;
 		ED_PDT_IsMain = (CurPos == ED_ISMatchPos);
@@ -4262,26 +5729,39 @@ void	ED_PDTFindHangingMatch(ED_PanePointer PaneP)
 }
 
 // Hilite IS match--Purple for Main, Turquoise for Alt.
+// Only records the rect for the current Row, PaneDrawText draws it once it knows the Row changed.
+ED_PDTRectPointer	ED_PDTRectArrP = NULL;		// IS hilite rects for all Rows of the Pane
+Int32			ED_PDTRectCount = 0;
+Int32			ED_PDTRectMax = 0;
+
 void	ED_PDTHiliteMatch(ED_PanePointer PaneP, Int16 IsMain, Int32 StartCol, Int32 EndCol, Int32 Row)
 {
-    ED_FramePointer	FP = PaneP->FrameP;
-    Int32		StartX = ED_FRAMELMARGIN + (StartCol * ED_Advance);
-    Int32		Width = (EndCol - StartCol) * ED_Advance;
-    Int32		LineY = (PaneP->TopRow + Row) * ED_Row;
-    Int16		Color = (IsMain) ? ED_Purple : ED_Turquoise;
+    ED_PDTRectPointer	RP;
 
-    XftDrawRect(FP->XftDP, &ED_XCArr[Color], StartX, LineY, Width, ED_Row);
+    if (EndCol <= StartCol) return;
+
+    if (ED_PDTRectCount == ED_PDTRectMax) {
+	ED_PDTRectMax = (ED_PDTRectMax) ? ED_PDTRectMax * 2 : ED_PDTRECTINITCOUNT;
+	ED_PDTRectArrP = realloc(ED_PDTRectArrP, ED_PDTRectMax * sizeof(ED_PDTRectRecord));
+	if (ED_PDTRectArrP == NULL) G_SETEXCEPTION("Realloc PDTRectArr Failed", ED_PDTRectMax);
+    }
+
+    RP = ED_PDTRectArrP + ED_PDTRectCount++;
+    RP->StartCol = StartCol;
+    RP->EndCol = EndCol;
+    RP->IsMain = IsMain;
 }
 
-// Finds and draws IS matches (Main or Alt) *AS* PaneDrawText gets text one row at a time.
+// Finds IS matches (Main or Alt) *AS* PaneDrawText lays out text one row at a time.
 // On occasion, PDT will hit the gap in mid-row... so a match may be interruped and span two of these
 // calls.  In that case, it will be hilited with two rects!
 //
 // If in QREP (QuerySearch) mode, only draw alternatives AFTER the current main match.
-void	ED_PDTDrawMatch(ED_PanePointer PaneP, Int32 StartPos, char *CurP, Int32 Count, Int32 Row, Int32 Col)
+void	ED_PDTDrawMatch(ED_PanePointer PaneP, Int64 StartPos, char *CurP, Int32 Count, Int32 Row, Int32 Col)
 {
     ED_BufferPointer	BufP = PaneP->BufP;
-    Int32		L, CurPos, StartCol;
+    Int32		L, StartCol;
+    Int64		CurPos;
     char		*EndP;
 
     StartCol = Col;
@@ -4314,7 +5794,7 @@ void	ED_PDTDrawMatch(ED_PanePointer PaneP, Int32 StartPos, char *CurP, Int32 Cou
 	}
 
 	// Logic must allow for back-to-back matches! (An Alt following Main leads to ED_ISAltPos)
-	if ((! ED_PDT_InMatch) && (ED_ISCheckMatch(BufP, CurPos))) {
+	if ((! ED_PDT_InMatch) && (ED_ISSetIsMatch(BufP, CurPos))) {
 	    ED_PDT_InMatch = 1;
 	    ED_PDT_StartPos = CurPos;
 	    ED_PDT_IsMain = (CurPos == ED_ISMatchPos);
@@ -4335,12 +5815,279 @@ void	ED_PDTDrawMatch(ED_PanePointer PaneP, Int32 StartPos, char *CurP, Int32 Cou
     }
 }
 
+// ******************************************************************************
+// PaneDrawText keeps a RowCache for each Pane, one entry per text Row, holding
+// a hash of everything that was drawn on that Row--chars, wrap bars, Sel and IS
+// hilites.  The first pass lays out all Rows without drawing; only Rows whose
+// hash changed are repainted.  If the Pane scrolled by N Rows, the Rows still
+// shown are moved with XCopyArea and the cache is shifted to match.
+//
+// Rows are composed off-screen in the Frame BackPM.  All fills for the Pane go
+// out as one XRenderFillRectangles per color, all glyphs as one
+// XftDrawGlyphFontSpec, then the changed Rows are copied to XWin in one go.
+//
+// NOTE:	The Blinker is drawn with GXxor on XWin only, so any Row it is
+//		showing on is simply copied again from BackPM.  (PaneDrawText resets
+//		the flags.)
+//
+// NOTE:	If XWin gets damaged (Expose) call ED_FrameSetWinStale.  If BackPM
+//		is lost, call ED_FrameRowCacheReset.
+
+ED_PDTRowPointer	ED_PDTRowArrP = NULL;		// Layout of each Row for PaneDrawText
+Int32			ED_PDTRowMax = 0;
+
+XftGlyphFontSpec *	ED_PDTGlyphArrP = NULL;		// Batched glyphs, for all changed Rows
+Int32			ED_PDTGlyphCount = 0;
+Int32			ED_PDTGlyphMax = 0;
+
+ED_PDTFillRecord	ED_PDTFillArr[ED_PDTFILLCOUNT] = {	// Batched fills, drawn in this order
+    {ED_Touch, NULL, 0, 0},
+    {ED_White, NULL, 0, 0},
+    {ED_SelOrange, NULL, 0, 0},
+    {ED_Purple, NULL, 0, 0},
+    {ED_Turquoise, NULL, 0, 0},
+    {ED_Gray, NULL, 0, 0}
+};
+
+void	ED_PDTAddFill(Int16 Fill, Int32 X, Int32 Y, Int32 Width, Int32 Height)
+{
+    ED_PDTFillPointer	FillP = ED_PDTFillArr + Fill;
+    XRectangle *	RP;
+
+    if (Width <= 0) return;
+    
+    if (FillP->Count == FillP->Max) {
+	FillP->Max = (FillP->Max) ? FillP->Max * 2 : ED_PDTBATCHINITCOUNT;
+	FillP->ArrP = realloc(FillP->ArrP, FillP->Max * sizeof(XRectangle));
+	if (FillP->ArrP == NULL) G_SETEXCEPTION("Realloc PDTFill Failed", FillP->Max);
+    }
+
+    RP = FillP->ArrP + FillP->Count++;
+    RP->x = X;
+    RP->y = Y;
+    RP->width = Width;
+    RP->height = Height;
+}
+
+// Len bytes of UTF8 at CharP, one glyph per Col starting at X.  Y is the baseline.
+void	ED_PDTAddGlyphs(char * CharP, Int32 Len, Int32 X, Int32 Y)
+{
+    char *		EndP = CharP + Len;
+    XftGlyphFontSpec *	GP;
+    Int16		L;
+
+    while (CharP < EndP) {
+	if (ED_PDTGlyphCount == ED_PDTGlyphMax) {
+	    ED_PDTGlyphMax = (ED_PDTGlyphMax) ? ED_PDTGlyphMax * 2 : ED_PDTBATCHINITCOUNT;
+	    ED_PDTGlyphArrP = realloc(ED_PDTGlyphArrP, ED_PDTGlyphMax * sizeof(XftGlyphFontSpec));
+	    if (ED_PDTGlyphArrP == NULL) G_SETEXCEPTION("Realloc PDTGlyph Failed", ED_PDTGlyphMax);
+	}
+
+	L = ED_BufferGetUTF8Len(*CharP);
+	if (CharP + L > EndP) L = EndP - CharP;
+	
+	GP = ED_PDTGlyphArrP + ED_PDTGlyphCount++;
+	GP->font = ED_XFP;
+	GP->glyph = ED_GlyphIndex(ED_UtilUTF8ToUcs4(CharP, L));
+	GP->x = X;
+	GP->y = Y;
+
+	X += ED_Advance;
+	CharP += L;
+    }
+}
+
+// Send the batch to BackPM: fills first, then glyphs on top.
+void	ED_PDTFlushBatch(ED_FramePointer FrameP)
+{
+    ED_PDTFillPointer	FillP;
+    Picture		Pict = XftDrawPicture(FrameP->BackDP);
+    Int32		I;
+    Int16		Fill;
+
+    for (Fill = 0; Fill < ED_PDTFILLCOUNT; Fill++) {
+	FillP = ED_PDTFillArr + Fill;
+	if (FillP->Count == 0) continue;
+
+	if (Pict)
+	    XRenderFillRectangles(ED_XDP, PictOpSrc, Pict, &ED_XCArr[FillP->Color].color, FillP->ArrP, FillP->Count);
+	else for (I = 0; I < FillP->Count; I++)
+	    XftDrawRect(FrameP->BackDP, &ED_XCArr[FillP->Color], FillP->ArrP[I].x, FillP->ArrP[I].y,
+			FillP->ArrP[I].width, FillP->ArrP[I].height);
+	FillP->Count = 0;
+    }
+
+    if (ED_PDTGlyphCount)
+	XftDrawGlyphFontSpec(FrameP->BackDP, &ED_XCArr[ED_Black], ED_PDTGlyphArrP, ED_PDTGlyphCount);
+    ED_PDTGlyphCount = 0;
+}
+
+// BackPM is the size of XWin, so it is replaced when XWin changes size.
+void	ED_FrameCheckBackPM(ED_FramePointer FrameP)
+{
+    Int16	XScreenN = DefaultScreen(ED_XDP);
+
+    if (FrameP->BackPM && (FrameP->BackWidth == FrameP->WinWidth) && (FrameP->BackHeight == FrameP->WinHeight))
+	return;
+
+    if (FrameP->BackDP) XftDrawDestroy(FrameP->BackDP);
+    if (FrameP->BackPM) XFreePixmap(ED_XDP, FrameP->BackPM);
+
+    FrameP->BackWidth = FrameP->WinWidth;
+    FrameP->BackHeight = FrameP->WinHeight;
+    FrameP->BackPM = XCreatePixmap(ED_XDP, FrameP->XWin, FrameP->BackWidth, FrameP->BackHeight,
+				   DefaultDepth(ED_XDP, XScreenN));
+    FrameP->BackDP = XftDrawCreate(ED_XDP, FrameP->BackPM, DefaultVisual(ED_XDP, XScreenN), DefaultColormap(ED_XDP, XScreenN));
+    if (! FrameP->BackDP) G_SETEXCEPTION("Frame BackPM XftDrawCreate failed", FrameP->Number);
+
+    ED_FrameRowCacheReset(FrameP);		// Nothing drawn in BackPM yet
+}
+
+// Make sure RowCache fits the Pane geometry--if anything changed, nothing on screen can be trusted.
+void	ED_PaneRowCacheCheck(ED_PanePointer PaneP, Int32 Rows)
+{
+    Int32	I;
+
+    if (Rows > PaneP->RCMax) {
+	PaneP->RCArrP = realloc(PaneP->RCArrP, Rows * sizeof(ED_RowCacheRecord));
+	if (PaneP->RCArrP == NULL) G_SETEXCEPTION("Realloc RowCache Failed", Rows);
+	PaneP->RCMax = Rows;
+	PaneP->RCRowCount = 0;
+    }
+
+    if ((Rows != PaneP->RCRowCount) ||
+	(PaneP->TopRow != PaneP->RCTopRow) ||
+	(PaneP->FrameP->RowChars != PaneP->RCRowChars)) {
+	for (I = 0; I < Rows; I++)
+	    PaneP->RCArrP[I].Hash = 0;
+	PaneP->RCRowCount = Rows;
+	PaneP->RCTopRow = PaneP->TopRow;
+	PaneP->RCRowChars = PaneP->FrameP->RowChars;
+    }
+
+    if (Rows > ED_PDTRowMax) {
+	ED_PDTRowArrP = realloc(ED_PDTRowArrP, Rows * sizeof(ED_PDTRowRecord));
+	if (ED_PDTRowArrP == NULL) G_SETEXCEPTION("Realloc PDTRowArr Failed", Rows);
+	ED_PDTRowMax = Rows;
+    }
+}
+
+void	ED_PaneRowCacheFree(ED_PanePointer PaneP)
+{
+    if (PaneP->RCArrP) free(PaneP->RCArrP);
+    PaneP->RCArrP = NULL;
+    PaneP->RCMax = 0;
+    PaneP->RCRowCount = 0;
+}
+
+// Every Pane in the Frame must repaint every Row.
+void	ED_FrameRowCacheReset(ED_FramePointer FrameP)
+{
+    ED_PanePointer	PaneP = FrameP->FirstPaneP;
+
+    while (PaneP) {
+	PaneP->RCRowCount = 0;
+	PaneP = PaneP->NextPaneP;
+    }
+}
+
+// XWin lost its contents, but BackPM did not... every Pane must copy all its Rows.
+void	ED_FrameSetWinStale(ED_FramePointer FrameP)
+{
+    ED_PanePointer	PaneP = FrameP->FirstPaneP;
+
+    while (PaneP) {
+	PaneP->Flags |= ED_PANEWINSTALEFLAG;
+	PaneP = PaneP->NextPaneP;
+    }
+}
+
+// Look for the new first Row in the old cache (scrolled up), or the old first Row in the
+// new layout (scrolled down).  If found, and at least one Row would not need repainting,
+// XCopyArea the Rows still shown (within BackPM) and shift the cache.  Returns 1 if so.
+Int16	ED_PaneRowCacheScroll(ED_PanePointer PaneP, Int32 Rows)
+{
+    ED_FramePointer	FP = PaneP->FrameP;
+    ED_RowCachePointer	RCP = PaneP->RCArrP;
+    ED_PDTRowPointer	RP = ED_PDTRowArrP;
+    Int32		K, I, Shift, Keep, Width, SrcY, DestY;
+
+    if (RP[0].RC.Pos < 0) return 0;
+    if ((RCP[0].Hash == RP[0].RC.Hash) && (RCP[0].Pos == RP[0].RC.Pos)) return 0;
+
+    Shift = 0;
+    for (K = 1; K < Rows; K++) {
+	if (RCP[K].Hash && (RCP[K].Pos == RP[0].RC.Pos)) {		// Scrolled up by K
+	    Shift = K;
+	    break;
+	}
+	if (RCP[0].Hash && (RCP[0].Pos == RP[K].RC.Pos)) {		// Scrolled down by K
+	    Shift = -K;
+	    break;
+	}
+    }
+    if (Shift == 0) return 0;
+
+    K = (Shift > 0) ? Shift : -Shift;
+    Keep = Rows - K;
+    for (I = 0; I < Keep; I++) {
+	if ((Shift > 0) && (RCP[I + K].Hash == RP[I].RC.Hash)) break;
+	if ((Shift < 0) && (RCP[I].Hash == RP[I + K].RC.Hash)) break;
+    }
+    if (I == Keep) return 0;						// Would repaint it all anyway
+
+    // Copy includes the (Touch) edge bands and wrap bars.
+    Width = ED_FRAMELMARGIN + ((FP->RowChars + 1) * ED_Advance);
+    SrcY = (PaneP->TopRow + ((Shift > 0) ? K : 0)) * ED_Row;
+    DestY = (PaneP->TopRow + ((Shift > 0) ? 0 : K)) * ED_Row;
+    XCopyArea(ED_XDP, FP->BackPM, FP->BackPM, FP->CopyGC, 0, SrcY, Width, Keep * ED_Row, 0, DestY);
+
+    if (Shift > 0) {
+	memmove(RCP, RCP + K, Keep * sizeof(ED_RowCacheRecord));
+	for (I = Keep; I < Rows; I++) RCP[I].Hash = 0;
+    } else {
+	memmove(RCP + K, RCP, Keep * sizeof(ED_RowCacheRecord));
+	for (I = 0; I < K; I++) RCP[I].Hash = 0;
+    }
+
+    return 1;
+}
+
+// Hash everything that will be drawn for the Row.  Never 0, that means invalid.
+Uns64	ED_PDTRowHash(ED_PDTRowPointer RP)
+{
+    Uns64	H = ED_HASHSEED;
+    Int16	I;
+
+    if (RP->Blank) return ED_HASHSEED;
+
+    for (I = 0; I < RP->SegN; I++) {
+	H = ED_UtilHash(H, &RP->SegCol[I], sizeof(Int32));
+	H = ED_UtilHash(H, &RP->SegCount[I], sizeof(Int32));
+	H = ED_UtilHash(H, RP->SegP[I], RP->SegCount[I]);
+    }
+    H = ED_UtilHash(H, &RP->WrapIn, sizeof(Int16));
+    H = ED_UtilHash(H, &RP->WrapOut, sizeof(Int16));
+    if (RP->DrawSel) {
+	H = ED_UtilHash(H, &RP->SelStartCol, sizeof(Int32));
+	H = ED_UtilHash(H, &RP->SelEndCol, sizeof(Int32));
+    }
+    for (I = 0; I < RP->RectCount; I++) {
+	ED_PDTRectPointer	RectP = ED_PDTRectArrP + RP->RectFirst + I;
+
+	H = ED_UtilHash(H, &RectP->StartCol, sizeof(Int32));
+	H = ED_UtilHash(H, &RectP->EndCol, sizeof(Int32));
+	H = ED_UtilHash(H, &RectP->IsMain, sizeof(Int16));
+    }
+
+    return (H == 0) ? 1 : H;
+}
+
+// ED_PaneDrawText only marks the Pane dirty, ED_RenderHandler calls ED_PaneRender
+// once the current batch of events is done.
 void	ED_PaneDrawText(ED_PanePointer PaneP)
 {
     ED_FramePointer	FP = PaneP->FrameP;
-    Int32		StartPos, Pos, LineCount, LineX, LineY, StartCol, Col, Count;
-    Int16		LineWrap, Partial;
-    char *		CharP;
 
     // If this is *the* CurPane, stash Pane state into its Buf... 
     if ((PaneP == FP->CurPaneP) && (FP->Flags & ED_FRAMEFOCUSFLAG)) {
@@ -4348,9 +6095,49 @@ void	ED_PaneDrawText(ED_PanePointer PaneP)
 	PaneP->BufP->CursorPos = PaneP->CursorPos;
     }
 
+    PaneP->Flags |= ED_PANEDIRTYFLAG;
+}
+
+void	ED_PaneRender(ED_PanePointer PaneP)
+{
+    ED_FramePointer	FP = PaneP->FrameP;
+    ED_PDTRowPointer	RP;
+    ED_RowCachePointer	RCP;
+    Int32		Row, Rows, LineY, RightX, StartCol, Col, Count, I;
+    Int64		StartPos, Pos;
+    Int32		FirstRow, LastRow;
+    Int16		LineWrap, Partial, Done;
+    char *		CharP;
+
+    if (FP->Flags & ED_FRAMENOWINFLAG) return;
+
+    Rows = PaneP->RowCount - 1;				// Last Row is the ModeLine
+    if (Rows < 1) {
+	ED_PaneDrawModeLine(PaneP);
+	PaneP->Flags &= ~(ED_PANESOLIDCURSORFLAG | ED_PANEBOXCURSORFLAG | ED_PANEWINSTALEFLAG | ED_PANEDIRTYFLAG);
+	return;
+    }
+
+    ED_FrameCheckBackPM(FP);
+    ED_PaneRowCacheCheck(PaneP, Rows);
+
+    // Rows [FirstRow, LastRow] get copied from BackPM to XWin.
+    FirstRow = Rows;
+    LastRow = -1;
+    if (PaneP->Flags & ED_PANEWINSTALEFLAG) {
+	FirstRow = 0;
+	LastRow = Rows - 1;
+    }
+    if (PaneP->XORFirstRow <= PaneP->XORLastRow) {
+	if (PaneP->XORFirstRow < FirstRow) FirstRow = PaneP->XORFirstRow;
+	if (PaneP->XORLastRow > LastRow) LastRow = PaneP->XORLastRow;
+	ED_RANGELIMIT(FirstRow, 0, Rows - 1);
+	ED_RANGELIMIT(LastRow, 0, Rows - 1);
+    }
+    PaneP->XORFirstRow = 0x7FFFFFFF;
+    PaneP->XORLastRow = -1;
+
     Pos = PaneP->PanePos;
-    LineCount = 0;
-    LineY = PaneP->TopRow * ED_Row;
 
     // Decide whether very first line was wrapped!
     LineWrap = 0;
@@ -4359,66 +6146,119 @@ void	ED_PaneDrawText(ED_PanePointer PaneP)
 	LineWrap = ! (*CharP == '\n');
     }
 
-    // Draw left and right edge band
-    XftDrawRect(FP->XftDP, &ED_XCArr[ED_Touch], 0, (PaneP->TopRow * ED_Row),
-		ED_FRAMELMARGIN, (PaneP->RowCount - 1) * ED_Row);
-    XftDrawRect(FP->XftDP, &ED_XCArr[ED_Touch],
-		ED_FRAMELMARGIN + (FP->RowChars * ED_Advance), (PaneP->TopRow * ED_Row),
-		ED_Advance, (PaneP->RowCount - 1) * ED_Row);
-
     // Catch matches that start *above* the pane, but end in the pane!
-    if (PaneP == ED_ISPaneP)
+    // Match set is (re)built only if the window, Buf or ISStr changed.
+    if (PaneP == ED_ISPaneP) {
+	ED_ISSetUpdate(PaneP);
 	ED_PDTFindHangingMatch(PaneP);
+    }
 
-    while (++LineCount < PaneP->RowCount) {
-	// Draw background for row... normally just white, unless hilited for selection, search, etc.
-	ED_PaneDrawBackground(PaneP, LineCount - 1, LineY);
-
-	// Draw left bar if line was wrapped
-	if (LineWrap) XftDrawRect(FP->XftDP, &ED_XCArr[ED_Gray], 1, LineY, ED_FRAMELMARGIN - 1, ED_Height);
+    // First pass, lay out every Row--no drawing.
+    ED_PDTRectCount = 0;
+    Done = 0;
+    for (Row = 0; Row < Rows; Row++) {
+	RP = ED_PDTRowArrP + Row;
+	RP->SegN = 0;
+	RP->Blank = Done;
+	RP->RectFirst = ED_PDTRectCount;
+	RP->WrapIn = RP->WrapOut = 0;
+	RP->RC.Pos = -1;
+	RP->RC.Len = 0;
+
+	if (! Done) {
+	    RP->RC.Pos = Pos;
+	    RP->WrapIn = LineWrap;
+	    RP->DrawSel = ED_PaneGetSelCols(PaneP, Row, &RP->SelStartCol, &RP->SelEndCol);
+
+	    // The row may intersect the Gap, so may get TWO segments for 1 row.
+	    Col = 0;
+	    do {
+		StartPos = Pos;
+		StartCol = Col;
+		CharP = ED_PaneGetDrawRow(PaneP, &Pos, &Col, &Count, &LineWrap, &Partial);
+		if ((PaneP == ED_ISPaneP) && (ED_ISMatchPos >= 0))
+		    ED_PDTDrawMatch(PaneP, StartPos, CharP, Count, Row, StartCol);
+
+		if (Count) {
+		    RP->SegP[RP->SegN] = CharP;
+		    RP->SegCount[RP->SegN] = Count;
+		    RP->SegCol[RP->SegN] = StartCol;
+		    RP->SegN += 1;
+		    if (LineWrap) break;
+		}
+	    } while (Partial);
 
-	// Draw the row, but it may intersect the Gap, so need to draw TWO segments of 1 row.
-	LineX = ED_FRAMELMARGIN;
-	Col = 0;
-	do {
-	    StartPos = Pos;
-	    StartCol = Col;
-	    CharP = ED_PaneGetDrawRow(PaneP, &Pos, &Col, &Count, &LineWrap, &Partial);
-	    if ((PaneP == ED_ISPaneP) && (ED_ISMatchPos >= 0))
-		ED_PDTDrawMatch(PaneP, StartPos, CharP, Count, LineCount - 1, StartCol);
-	    
-	    if (Count) {
-		XftDrawStringUtf8(FP->XftDP, &ED_XCArr[ED_Black], ED_XFP, LineX, LineY + ED_Ascent, (XftChar8 *)CharP, Count);
-		LineX = ED_FRAMELMARGIN + (Col * ED_Advance);
-		if (LineWrap) break;
-	    }
-	} while (Partial);
+	    RP->WrapOut = LineWrap;
+	    RP->RC.Len = Pos - RP->RC.Pos;
+	    if (Pos >= PaneP->BufP->LastPos) Done = 1;		// Termination!
+	}
 
-	// Draw right bar if line was wrapped
-	if (LineWrap) XftDrawRect(FP->XftDP, &ED_XCArr[ED_Gray],
-				  ED_FRAMELMARGIN + (FP->RowChars * ED_Advance) + 1, LineY,
-				  ED_FRAMELMARGIN - 1, ED_Height);
+	RP->RectCount = ED_PDTRectCount - RP->RectFirst;
+	RP->RC.Wrap = RP->WrapOut;
+	RP->RC.Hash = ED_PDTRowHash(RP);
+    }
 
-	LineY += ED_Row;
-	if (Pos >= PaneP->BufP->LastPos) break;		// Termination!
+    if (ED_PaneRowCacheScroll(PaneP, Rows)) {
+	FirstRow = 0;
+	LastRow = Rows - 1;
     }
 
-    // Draw blanks in case any rows remain on the Pane
+    // Second pass, batch up only the Rows that changed.
+    RightX = ED_FRAMELMARGIN + (FP->RowChars * ED_Advance);
+    RCP = PaneP->RCArrP;
+    for (Row = 0; Row < Rows; Row++) {
+	RP = ED_PDTRowArrP + Row;
+	if (RCP[Row].Hash == RP->RC.Hash) continue;
+	RCP[Row] = RP->RC;
+	if (Row < FirstRow) FirstRow = Row;
+	if (Row > LastRow) LastRow = Row;
 
-    while (++LineCount < PaneP->RowCount) {
-	XftDrawRect(FP->XftDP, &ED_XCArr[ED_White], ED_FRAMELMARGIN, LineY, FP->RowChars * ED_Advance, ED_Height + 1);
-	LineY += ED_Row;
+	LineY = (PaneP->TopRow + Row) * ED_Row;
+
+	// Left and right edge band
+	ED_PDTAddFill(ED_PDTFILLTOUCH, 0, LineY, ED_FRAMELMARGIN, ED_Row);
+	ED_PDTAddFill(ED_PDTFILLTOUCH, RightX, LineY, ED_Advance, ED_Row);
+
+	if (RP->Blank) {
+	    ED_PDTAddFill(ED_PDTFILLWHITE, ED_FRAMELMARGIN, LineY, FP->RowChars * ED_Advance, ED_Height + 1);
+	    continue;
+	}
+
+	// Background for row... normally just white, unless hilited for selection, search, etc.
+	ED_PaneDrawBackground(PaneP, RP, LineY);
+	for (I = 0; I < RP->RectCount; I++) {
+	    ED_PDTRectPointer	RectP = ED_PDTRectArrP + RP->RectFirst + I;
+
+	    ED_PDTAddFill((RectP->IsMain) ? ED_PDTFILLMAIN : ED_PDTFILLALT,
+			  ED_FRAMELMARGIN + (RectP->StartCol * ED_Advance), LineY,
+			  (RectP->EndCol - RectP->StartCol) * ED_Advance, ED_Row);
+	}
+
+	// Left/right bar if line was wrapped
+	if (RP->WrapIn) ED_PDTAddFill(ED_PDTFILLWRAP, 1, LineY, ED_FRAMELMARGIN - 1, ED_Height);
+	if (RP->WrapOut) ED_PDTAddFill(ED_PDTFILLWRAP, RightX + 1, LineY, ED_FRAMELMARGIN - 1, ED_Height);
+
+	for (I = 0; I < RP->SegN; I++)
+	    ED_PDTAddGlyphs(RP->SegP[I], RP->SegCount[I], ED_FRAMELMARGIN + (RP->SegCol[I] * ED_Advance), LineY + ED_Ascent);
     }
 
+    // Everything goes to BackPM, then one copy to XWin.
+    ED_PDTFlushBatch(FP);
+    if (FirstRow <= LastRow)
+	XCopyArea(ED_XDP, FP->BackPM, FP->XWin, FP->CopyGC,
+		  0, (PaneP->TopRow + FirstRow) * ED_Row,
+		  ED_FRAMELMARGIN + ((FP->RowChars + 1) * ED_Advance), (LastRow - FirstRow + 1) * ED_Row,
+		  0, (PaneP->TopRow + FirstRow) * ED_Row);
+
     ED_PaneDrawModeLine(PaneP);
 
     // Drawing erases blinkers, so reset the flags.
-    PaneP->Flags &= ~(ED_PANESOLIDCURSORFLAG | ED_PANEBOXCURSORFLAG);
+    PaneP->Flags &= ~(ED_PANESOLIDCURSORFLAG | ED_PANEBOXCURSORFLAG | ED_PANEWINSTALEFLAG | ED_PANEDIRTYFLAG);
 }
 
 // ******************************************************************************
 // ED_PaneDrawBackground is called from within ED_PaneDrawText to "erase" the
-// background before text is drawn on top of it.  This function also provides
+// background before text is drawn on top of it.  (Fills are batched, see ED_PDTAddFill.)  This function also provides
 // the highlighting for Selection--Xft draws text glyphs in grayscale
 // so the hilite must be drawn *UNDER* the text, not over it!
 //
@@ -4431,44 +6271,51 @@ void	ED_PaneDrawText(ED_PanePointer PaneP)
 // come directly after the range when Sel is from SelMark to Cursor.)
 // (Likewise must use ISBlinkerGC if drawn on top of IS highlights.)
 
-void	ED_PaneDrawBackground(ED_PanePointer PaneP, Int32 Row, Int32 LineY)
+// Returns 1 if Row has Sel hilite, from *StartColP to *EndColP.
+Int16	ED_PaneGetSelCols(ED_PanePointer PaneP, Int32 Row, Int32 * StartColP, Int32 * EndColP)
 {
-    ED_FramePointer	FP = PaneP->FrameP;
-    Int32		StartCol, EndCol;
-    Int16		DrawSel = 0;
-
-    if (ED_SelPaneP == PaneP) {						// Can have Sel !
-	if (ED_SelMarkPos < PaneP->CursorPos) {				// From SelPos to CursorPos
-	    if ((ED_SelMarkRow <= Row) && (Row <= PaneP->CursorRow)) {	// This row has Sel!
-		StartCol = (ED_SelMarkRow == Row) ? ED_SelMarkCol : 0;
-		EndCol = (PaneP->CursorRow == Row) ? PaneP->CursorCol : FP->RowChars;
-		DrawSel = 1;
-	    }
+    Int32	RowChars = PaneP->FrameP->RowChars;
+
+    if (ED_SelPaneP != PaneP) return 0;					// Cannot have Sel
+
+    if (ED_SelMarkPos < PaneP->CursorPos) {				// From SelPos to CursorPos
+	if ((ED_SelMarkRow <= Row) && (Row <= PaneP->CursorRow)) {	// This row has Sel!
+	    *StartColP = (ED_SelMarkRow == Row) ? ED_SelMarkCol : 0;
+	    *EndColP = (PaneP->CursorRow == Row) ? PaneP->CursorCol : RowChars;
+	    return 1;
+	}
 	    
-	} else if (PaneP->CursorPos < ED_SelMarkPos) {			// From CursorPos to SelPos
-	    if ((PaneP->CursorRow <= Row) && (Row <= ED_SelMarkRow)) {	// This row has Sel!
-		StartCol = (PaneP->CursorRow == Row) ? PaneP->CursorCol : 0;
-		EndCol = (ED_SelMarkRow == Row) ? ED_SelMarkCol : FP->RowChars;
-		DrawSel = 1;
-	    }
+    } else if (PaneP->CursorPos < ED_SelMarkPos) {			// From CursorPos to SelPos
+	if ((PaneP->CursorRow <= Row) && (Row <= ED_SelMarkRow)) {	// This row has Sel!
+	    *StartColP = (PaneP->CursorRow == Row) ? PaneP->CursorCol : 0;
+	    *EndColP = (ED_SelMarkRow == Row) ? ED_SelMarkCol : RowChars;
+	    return 1;
 	}
     }
 
+    return 0;
+}
+
+void	ED_PaneDrawBackground(ED_PanePointer PaneP, ED_PDTRowPointer RP, Int32 LineY)
+{
+    ED_FramePointer	FP = PaneP->FrameP;
+    Int32		StartCol = RP->SelStartCol;
+    Int32		EndCol = RP->SelEndCol;
+
     // If the row has Sel, it can have 3 sections:  Before (in white), Sel (orange), After (in white again).
-    if (DrawSel) {	
+    if (RP->DrawSel) {	
 	if (StartCol)
-	    XftDrawRect(FP->XftDP, &ED_XCArr[ED_White], ED_FRAMELMARGIN, LineY, StartCol * ED_Advance, ED_Height + 1);
+	    ED_PDTAddFill(ED_PDTFILLWHITE, ED_FRAMELMARGIN, LineY, StartCol * ED_Advance, ED_Height + 1);
 
-	XftDrawRect(FP->XftDP, &ED_XCArr[ED_SelOrange],
-		    ED_FRAMELMARGIN + (StartCol * ED_Advance), LineY,
-		    (EndCol - StartCol) * ED_Advance, ED_Height + 1);
+	ED_PDTAddFill(ED_PDTFILLSEL, ED_FRAMELMARGIN + (StartCol * ED_Advance), LineY,
+		      (EndCol - StartCol) * ED_Advance, ED_Height + 1);
 
 	if (EndCol < FP->RowChars)
-	    XftDrawRect(FP->XftDP, &ED_XCArr[ED_White], ED_FRAMELMARGIN + (EndCol * ED_Advance), LineY,
-			(FP->RowChars - EndCol) * ED_Advance, ED_Height + 1);
+	    ED_PDTAddFill(ED_PDTFILLWHITE, ED_FRAMELMARGIN + (EndCol * ED_Advance), LineY,
+			  (FP->RowChars - EndCol) * ED_Advance, ED_Height + 1);
     } else
 	// No selection on this row, just paint it white!
-	XftDrawRect(FP->XftDP, &ED_XCArr[ED_White], ED_FRAMELMARGIN, LineY, FP->RowChars * ED_Advance, ED_Height + 1);
+	ED_PDTAddFill(ED_PDTFILLWHITE, ED_FRAMELMARGIN, LineY, FP->RowChars * ED_Advance, ED_Height + 1);
 }
 
 // ******************************************************************************
@@ -4497,7 +6344,7 @@ void	ED_PaneDrawModeLine(ED_PanePointer PaneP)
     else if ((PaneP->StartRowCount + PaneP->RowCount) > PaneP->BufRowCount)
 	PStringP = ED_STR_Bot;
     else {
-	Int32  	PerCent = ((Int32)PaneP->StartRowCount * 100) / PaneP->BufRowCount;
+	Int32  	PerCent = (PaneP->StartRowCount * 100) / PaneP->BufRowCount;
 
 	snprintf(PercentString, 8, "%d%%", PerCent);
 	PStringP = PercentString;
@@ -4517,7 +6364,7 @@ void	ED_PaneDrawModeLine(ED_PanePointer PaneP)
     else if (PaneP == ED_ISPaneP) ModeP = ED_STR_ISearch;
 
 #ifdef DEBUG
-    snprintf(ModeString, ED_MSGSTRLEN - 1, "U:%c%c %.*s %.*s %s  %s R%d (Text%s) (R %d-%d) (P %d-%d) (S %d-%d-%d) (C %d,%d:%d)",
+    snprintf(ModeString, ED_MSGSTRLEN - 1, "U:%c%c %.*s %.*s %s  %s R%ld (Text%s) (R %ld-%ld) (P %ld-%ld) (S %d-%d-%d) (C %d,%ld:%ld)",
 	     ModMark, ModMark, 64, BufP->FileName, 64, DirName, FilterP, PStringP,
 	     PaneP->CursorRow + PaneP->StartRowCount + 1, ModeP,
 	     PaneP->StartRowCount, PaneP->BufRowCount,
@@ -4525,7 +6372,7 @@ void	ED_PaneDrawModeLine(ED_PanePointer PaneP)
 	     PaneP->ScrollTop, PaneP->ScrollThumb, PaneP->ScrollHeight,
 	     PaneP->CursorCol, PaneP->CursorRow, PaneP->CursorPos);
 #else
-    snprintf(ModeString, ED_MSGSTRLEN - 1, "U:%c%c %.*s %.*s %s  %s R%d (Text%s)",
+    snprintf(ModeString, ED_MSGSTRLEN - 1, "U:%c%c %.*s %.*s %s  %s R%ld (Text%s)",
 	     ModMark, ModMark, 64, BufP->FileName, 64, DirName, FilterP, PStringP,
 	     PaneP->CursorRow + PaneP->StartRowCount + 1, ModeP);
 #endif
@@ -4539,9 +6386,7 @@ void	ED_PaneDrawModeLine(ED_PanePointer PaneP)
     XftDrawRect(FrameP->XftDP, &ED_XCArr[Color], 0, LineY - ED_Ascent,
 		((FrameP->RowChars + 1) * ED_Advance) + ED_FRAMELMARGIN + ED_FRAMERMARGIN, ED_Height + 1);
 		
-    XftDrawStringUtf8(FrameP->XftDP, &ED_XCArr[ED_Black], ED_XFP,
-		      ED_FRAMELMARGIN, LineY,
-		      (XftChar8 *)ModeString, ModeStringLen);
+    ED_GlyphDrawRun(FrameP->XftDP, ED_Black, ED_FRAMELMARGIN, LineY, ModeString, ModeStringLen);
 }
 
 // ******************************************************************************
@@ -4710,11 +6555,29 @@ void	ED_PanePositionScrollBar(ED_PanePointer PaneP)
 // than ED_SCROLLTHUMBMINLEN.
 //
 // No thumb is drawn for an empty Pane.
+//
+// NOTE:	Span (in Rows) can pass 2^32 on a huge Buffer, so (Span << 32)
+//		and (IScale * Pixels) would overflow.  Both go through
+//		ED_AuxFixDiv and ED_AuxFixMul, which split the 32.32 value in
+//		its integer and fraction parts.  (Scale * Rows) is always less
+//		than (Height << 32), so it is safe as is.
+
+// Num / Den as a 32.32 number, Num can be much bigger than 2^32.
+Int64	ED_AuxFixDiv(Int64 Num, Int64 Den)
+{
+    return ((Num / Den) << 32) + (((Num % Den) << 32) / Den);
+}
+
+// Fix (32.32) * N, the result is an integer.  Fine as long as N is a Pixel count.
+Int64	ED_AuxFixMul(Int64 Fix, Int64 N)
+{
+    return ((Fix >> 32) * N) + (((Fix & 0xFFFFFFFFLL) * N) >> 32);
+}
 
 void	ED_PaneSetScrollBar(ED_PanePointer PaneP)
 {
-    Int32	Height, Span;
-    Int64	Scale, IScale;
+    Int32	Height;
+    Int64	Span, Scale, IScale;
 
     Height = ED_Row * (PaneP->RowCount - 1);
     Span = PaneP->BufRowCount + PaneP->RowCount;
@@ -4727,14 +6590,14 @@ void	ED_PaneSetScrollBar(ED_PanePointer PaneP)
     }
     
     Scale = ((Uns64)Height << 32) / Span;
-    IScale = ((Uns64)Span << 32) / Height;
+    IScale = ED_AuxFixDiv(Span, Height);
 
     // If ScrollThumb is too small, floor its size, re-scale Top + Bot space
     PaneP->ScrollThumb = (Scale * PaneP->RowCount) >> 32;
     if (PaneP->ScrollThumb < ED_SCROLLTHUMBMINLEN) {
 	PaneP->ScrollThumb = ED_SCROLLTHUMBMINLEN;
 	Scale = ((Uns64)(Height - ED_SCROLLTHUMBMINLEN) << 32) / (Span - PaneP->RowCount);
-	IScale = ((Uns64)(Span - PaneP->RowCount) << 32) / (Height - ED_SCROLLTHUMBMINLEN);
+	IScale = ED_AuxFixDiv(Span - PaneP->RowCount, Height - ED_SCROLLTHUMBMINLEN);
     }
 
     PaneP->ScrollScale = IScale;
@@ -4800,6 +6663,7 @@ void	ED_PaneScrollWinHandleEvent(XEvent * EventP, ED_PanePointer PaneP)
 	    // Flush extra ButtonMotion events, just look at last.
 	    while (XCheckMaskEvent(ED_XDP, ButtonMotionMask, EventP));
 	    if (PaneP->Flags & ED_PANESCROLLINGFLAG) {
+		ED_StatsMarkInput();
 		if (EventP->xmotion.y != GrabY)
 		    GrabY += ED_PaneScrollByThumb(PaneP, EventP->xmotion.y - GrabY);
 	    }
@@ -4816,6 +6680,7 @@ void	ED_PaneScrollWinHandleEvent(XEvent * EventP, ED_PanePointer PaneP)
 	    break;
 
 	case ButtonPress:
+	    ED_StatsMarkInput();
 
 	    // Turn off QREP/ISearch if active... but NOT QR!
 	    {	Int16		ClearML = 1;
@@ -4877,7 +6742,8 @@ void	ED_PaneScrollWinHandleEvent(XEvent * EventP, ED_PanePointer PaneP)
 
 Int32	ED_PaneScrollByThumb(ED_PanePointer PaneP, Int32 Delta)
 {
-    Int32	MaxLen, StartRow, DeltaRow;
+    Int32	MaxLen;
+    Int64	StartRow, DeltaRow;
 
     if (Delta < 0) {
 	if ((PaneP->ScrollTop + Delta) < 0)
@@ -4892,7 +6758,7 @@ Int32	ED_PaneScrollByThumb(ED_PanePointer PaneP, Int32 Delta)
     
     // When ScrollTop is 0, StartRow will always be 0.  But 32.32 multiplication
     // can miss the max value by 1... so adjust.
-    StartRow = (PaneP->ScrollScale * PaneP->ScrollTop) >> 32;
+    StartRow = ED_AuxFixMul(PaneP->ScrollScale, PaneP->ScrollTop);
     if (PaneP->ScrollTop + PaneP->ScrollThumb == PaneP->ScrollHeight)
 	StartRow = PaneP->BufRowCount;
 
@@ -4927,7 +6793,7 @@ Int32	ED_PaneScrollByThumb(ED_PanePointer PaneP, Int32 Delta)
 // the X,Y coords of xbutton could be relative to FrameP->XWin or PaneP->XScrollWin.
 // Must differentiate the origin (OnScrollBar) so can draw full or thin scroll thumb.
 
-void	ED_PaneScrollByRow(ED_PanePointer PaneP, XEvent * EventP, Int32 DeltaRow)
+void	ED_PaneScrollByRow(ED_PanePointer PaneP, XEvent * EventP, Int64 DeltaRow)
 {
     Int32	MaxLen;
     Int16	OnScrollBar;
@@ -4981,10 +6847,10 @@ void	ED_PaneScrollByRow(ED_PanePointer PaneP, XEvent * EventP, Int32 DeltaRow)
 //		range, so better to remove the range than change it without the
 //		user being explicitly aware.
 
-void	ED_PaneMoveCursorAfterScroll(ED_PanePointer PaneP, Int32 DeltaRow)
+void	ED_PaneMoveCursorAfterScroll(ED_PanePointer PaneP, Int64 DeltaRow)
 {
     Int16	CancelSel = 0;
-    Int32	LastPos;
+    Int64	LastPos;
 
     if (ED_SelPaneP == PaneP)
 	ED_SelMarkRow -= DeltaRow;	// Adjust, ok if off pane now!
@@ -5031,7 +6897,7 @@ void	ED_PaneMoveCursorAfterScroll(ED_PanePointer PaneP, Int32 DeltaRow)
 //		otherwise, the ScrollBars will get updated IFF PaneMoveForCursor
 //		is called.
 
-void	ED_PaneMoveAfterCursorMove(ED_PanePointer PaneP, Int32 CursorRowStartPos, Int32 DeltaRow, Int16 ForceSetScroll)
+void	ED_PaneMoveAfterCursorMove(ED_PanePointer PaneP, Int64 CursorRowStartPos, Int64 DeltaRow, Int16 ForceSetScroll)
 {
     if (PaneP->CursorRow > (PaneP->RowCount - 2))
 	DeltaRow = (PaneP->RowCount - 2) - DeltaRow;
@@ -5050,7 +6916,7 @@ void	ED_PaneMoveAfterCursorMove(ED_PanePointer PaneP, Int32 CursorRowStartPos, I
 //
 // This function definitely MOVES the Pane--unless PaneP->CursorRow was == NewCursorRow.
 
-void	ED_PaneMoveForCursor(ED_PanePointer PaneP, Int32 CursorRowStartPos, Int32 NewCursorRow)
+void	ED_PaneMoveForCursor(ED_PanePointer PaneP, Int64 CursorRowStartPos, Int64 NewCursorRow)
 {
     ED_BufferPointer	BufP = PaneP->BufP;
     Int32		MaxLen = PaneP->FrameP->RowChars;
@@ -5084,7 +6950,7 @@ void	ED_PaneMoveForCursor(ED_PanePointer PaneP, Int32 CursorRowStartPos, Int32 N
 //		will know...  If there *IS* a real Sel, then SelMark is recorded
 //		on the MarkRing.
 
-void	ED_PaneHandleClick(ED_PanePointer PaneP, Int32 Row, Int32 Col, Int16 Shift, Int16 Count)
+void	ED_PaneHandleClick(ED_PanePointer PaneP, Int64 Row, Int32 Col, Int16 Shift, Int16 Count)
 {
     ED_FramePointer	FP = PaneP->FrameP;
 
@@ -5210,7 +7076,7 @@ void	ED_PaneHandleRelease(ED_PanePointer PaneP)
 void	ED_PaneInsertPrimary(ED_PanePointer PaneP)
 {
     char	*MemP;
-    Int32	Len;
+    Int64	Len;
 
     if (ED_BufferReadOnly(PaneP->BufP)) return;
 
@@ -5254,9 +7120,9 @@ void	ED_PaneInsertPrimary(ED_PanePointer PaneP)
 //	stationary and ii) take a pause before returning to slow down the scrolling.
 
 
-void	ED_PaneHandleDragMotion(ED_PanePointer PaneP, Int32 Row, Int32 Col)
+void	ED_PaneHandleDragMotion(ED_PanePointer PaneP, Int64 Row, Int32 Col)
 {
-    Int32		R;
+    Int64		R;
     struct pollfd	PollR;
     Int16		OffPane = 0;
     
@@ -5308,6 +7174,7 @@ void	ED_PaneHandleDragMotion(ED_PanePointer PaneP, Int32 Row, Int32 Col)
 	// Set ED_SelLastRow/Col to impossible values, so we process the
 	// next call, even if mouse is stationary OFF PANE.
 	if (OffPane) {
+	    ED_FrameRender(PaneP->FrameP);		// Show this step first
 	    PollR.fd = ConnectionNumber(ED_XDP);
 	    PollR.events = POLLIN;
 	    poll(&PollR, 1, 50);
@@ -5341,24 +7208,68 @@ void	ED_PaneHandleDragMotion(ED_PanePointer PaneP, Int32 Row, Int32 Col)
 //
 // NOTE:	Extra "CorCol += 1" will handle case where target is not found and
 //		there is no /n at the end of buffer.
+//
+// NOTE:	"Pos 0" really means the nearest RowIdx checkpoint before Pos,
+//		which is also used instead of PanePos if it is closer (and not
+//		PaneLimit, which needs FinalPos from the Pane rows).  New
+//		checkpoints are left behind only if the walk started on one.
+//		A long walk from a checkpoint goes to ED_AuxPoolRows, up to the
+//		last line start before Pos, then continues here.
+//
+// NOTE:	While the RowIdx is reflowing (after a resize), a walk of more
+//		than ED_REFLOWNEAR past the last checkpoint jumps to the line
+//		of Pos with estimated Rows instead, and makes no checkpoints.
+//		StartRowCount keeps the ED_PANEROWESTFLAG if it got one of
+//		those, and is fixed first thing once the checkpoints get near.
 
-Int32	ED_PaneFindLoc(ED_PanePointer PaneP, Int32 Pos, Int32 *RowP, Int32 *ColP, Int16 FromZero, Int16 PaneLimit)
+Int64	ED_PaneFindLoc(ED_PanePointer PaneP, Int64 Pos, Int64 *RowP, Int32 *ColP, Int16 FromZero, Int16 PaneLimit)
 {
     ED_BufferPointer	BufP = PaneP->BufP;
-    char		*CurP, *EndP;
-    Int32		CurRow, CurCol, ColLimit, CurPos, RowStartPos, FinalPos, LastRow;
-    Int16		L;
+    ED_RIdxWidthPointer	WP;
+    char		*CurP, *EndP, *StopP;
+    Int32		CurCol, ColLimit, CPIndex;
+    Int64		CurPos, RowStartPos, FinalPos, CurRow, LastRow, LinePos;
+    Int64		CPRow = 0;				// Only used if DoCP
+    Int16		L, DoCP, Estimated;
+
+    ColLimit = PaneP->FrameP->RowChars;
+    WP = ED_BufferRIdxGet(BufP, ColLimit);
+    if ((PaneP->Flags & ED_PANEROWESTFLAG) &&
+	(! WP->EstBytes || (PaneP->PanePos <= WP->ArrP[WP->Count - 1].Pos + ED_REFLOWNEAR)))
+	ED_PaneRowsFix(PaneP);
+    CPIndex = ED_AuxRIdxFind(WP, Pos);
 
     // Internally, CurRow is *ABSOLUTE*, start from Pos 0 or PaneP->PanePos?
     CurPos = PaneP->PanePos;
     CurRow = PaneP->StartRowCount;
     CurCol = 0;
-    if (FromZero || (Pos < PaneP->PanePos)) {
-	CurPos = 0;
-	CurRow = 0;
+    DoCP = 0;
+    if (FromZero || (Pos < PaneP->PanePos) ||
+	(! PaneLimit && (WP->ArrP[CPIndex].Pos > PaneP->PanePos))) {
+	CurPos = WP->ArrP[CPIndex].Pos;
+	CurRow = CPRow = WP->ArrP[CPIndex].Row;
+	DoCP = 1;
     } 
 
-    ColLimit = PaneP->FrameP->RowChars;
+    // Reflowing and far past the checkpoints, estimate up to the line of Pos.
+    Estimated = 0;
+    if (WP->EstBytes && ! PaneLimit && (Pos - CurPos > ED_REFLOWNEAR) &&
+	(Pos > WP->ArrP[WP->Count - 1].Pos + ED_REFLOWNEAR)) {
+	LinePos = ED_BufferGetLineStartPos(BufP, Pos);
+	if (LinePos > CurPos) {
+	    CurRow += ED_AuxRIdxEstRows(WP, LinePos - CurPos);
+	    CurPos = LinePos;
+	    DoCP = 0;
+	    Estimated = 1;
+	}
+    }
+
+    // Far from the checkpoint, the scan pool counts the bulk of the Rows.
+    if (DoCP && ! PaneLimit && ED_PoolWanted(Pos - CurPos)) {
+	CurPos = ED_AuxPoolRows(BufP, WP, &CPIndex, CurPos, Pos, &CurRow);
+	CPRow = CurRow;
+    }
+
     RowStartPos = CurPos;					// 0 or PaneStart, either way, new Row!
     LastRow = PaneP->StartRowCount + PaneP->RowCount  - 2;	// ABSOLUTE value for it
     
@@ -5371,6 +7282,16 @@ Int32	ED_PaneFindLoc(ED_PanePointer PaneP, Int32 Pos, Int32 *RowP, Int32 *ColP,
 
 DoRest:
     while (CurP < EndP) {
+
+	if (CurCol < ColLimit) {			// Skip plain ASCII, up to the wrap or Pos
+	    StopP = (EndP - CurP > ColLimit - CurCol) ? CurP + (ColLimit - CurCol) : EndP;
+	    if ((Pos >= CurPos) && (Pos - CurPos < StopP - CurP)) StopP = CurP + (Pos - CurPos);
+	    StopP = ED_UtilScanPlain(CurP, StopP);
+	    CurCol += StopP - CurP;
+	    CurPos += StopP - CurP;
+	    CurP = StopP;
+	    if (CurP == EndP) continue;
+	}
     
 	CurCol++;					// CurCol is **1-Based**
 	if (*CurP == '\n') {				// Hard end of line, *CAN* be in OverFlow col
@@ -5378,6 +7299,11 @@ DoRest:
 	    CurRow++, CurCol = 0;			// (**) May exit loop with 0 CurCol !!
 	    FinalPos = RowStartPos;			// Lags 1 line behind.
 	    RowStartPos = CurPos + 1;			// Next char will be beginning of line
+
+	    if (DoCP && (CurRow - CPRow >= ED_RIDXSTEP) && (CurPos < Pos)) {
+		ED_AuxRIdxInsert(WP, ++CPIndex, RowStartPos, CurRow);
+		CPRow = CurRow;
+	    }
 	}
 	
         if (CurCol > ColLimit) {			// Wrap around, will be 1 on next row
@@ -5409,6 +7335,11 @@ FoundIt:
      if (! FromZero) CurRow -= PaneP->StartRowCount;	// Make it Pane-relative
      *RowP = CurRow;
      *ColP = CurCol;
+
+     if (RowP == &PaneP->StartRowCount) {		// Remember if it is an estimate
+	if (Estimated) PaneP->Flags |= ED_PANEROWESTFLAG;
+	else PaneP->Flags &= ~ED_PANEROWESTFLAG;
+     }
      return RowStartPos;				// Returns matching Row start!
 }
 
@@ -5444,13 +7375,19 @@ FoundIt:
 // NOTE:	ED_PaneSetCusorLoc and ED_PaneGetCursorLoc (as well as other drawing
 //		and scrolling functions) ***MUST*** be in logical synchrony.  Do
 //		not alter one without the others.
+//
+// NOTE:	A Row above the Pane is found by backing up from PanePos with
+//		ED_BufferGetPosMinusRows, not by walking down from Pos 0.  So it
+//		only counts Rows relative to PanePos, and works the same when
+//		StartRowCount is an estimate (see ED_PaneRowsFix).
 
 
-Int32	ED_PaneFindPos(ED_PanePointer PaneP, Int32 *PosP, Int32 *RowP, Int32 *ColP, Int16 FromPane, Int16 FixOffBottom)
+Int64	ED_PaneFindPos(ED_PanePointer PaneP, Int64 *PosP, Int64 *RowP, Int32 *ColP, Int16 FromPane, Int16 FixOffBottom)
 {
     ED_BufferPointer	BufP = PaneP->BufP;
     char		*CurP, *EndP;
-    Int32		CurRow, CurCol, ColLimit, CurPos, RowStartPos;
+    Int32		CurCol, ColLimit;
+    Int64		CurRow, CurPos, RowStartPos, Rows;
     Int16		L;
 
     *RowP += PaneP->StartRowCount;			// Internally in ABSOLUTE count
@@ -5460,6 +7397,10 @@ Int32	ED_PaneFindPos(ED_PanePointer PaneP, Int32 *PosP, Int32 *RowP, Int32 *ColP
     if (FromPane || (*RowP >= PaneP->StartRowCount)) {
 	CurRow = PaneP->StartRowCount;
 	CurPos = PaneP->PanePos;
+    } else {
+	Rows = PaneP->StartRowCount - *RowP;
+	CurPos = ED_BufferGetPosMinusRows(BufP, PaneP->PanePos, &Rows, ColLimit);
+	CurRow = PaneP->StartRowCount - Rows;
     }
     RowStartPos = CurPos;
 
@@ -5541,10 +7482,12 @@ FoundIt:
 //		usually called by routines that simply delete + discard text,
 //		instead	of "kill" routines that save to the KillRing.
 
-Int32	ED_PaneDelSelRange(ED_PanePointer PaneP, Int16 DoUpdate)
+Int64	ED_PaneDelSelRange(ED_PanePointer PaneP, Int16 DoUpdate)
 {
     ED_BufferPointer	BufP = PaneP->BufP;
-    Int32		StartPos, EndPos, Total, Col;
+    Int32		Col;
+    Int64		Total;
+    Int64		StartPos, EndPos;
 
     if ((ED_SelPaneP != PaneP) || (ED_SelMarkPos == PaneP->CursorPos))
 	return 0;
@@ -5609,6 +7552,8 @@ void	ED_AuxOpenParenHilite(ED_PanePointer PaneP, char C, Int32 Row, Int32 Col)
     X = FP->FrameX + (Col * ED_Advance);
     Y = FP->FrameY + ((PaneP->TopRow + Row) * ED_Row);
 
+    ED_FrameRender(FP);				// Show the Close paren before flashing
+
     PollR.fd = ConnectionNumber(ED_XDP);	// Negate to ignore all events
     PollR.events = POLLIN;
     XftDrawRect(FP->XftDP, &ED_XCArr[ED_Turquoise], X, Y, ED_Advance, ED_Height + 1);
@@ -5617,37 +7562,33 @@ void	ED_AuxOpenParenHilite(ED_PanePointer PaneP, char C, Int32 Row, Int32 Col)
     poll(&PollR, 1, 1000);			// 1000 mSec !!
 
     // ED_PaneDrawText will erase the hiliting, but easier to just do it in place.
-    XftDrawRect(FP->XftDP, &ED_XCArr[ED_White], X, Y, ED_Advance, ED_Height + 1);
-    XftDrawString8(FP->XftDP, &ED_XCArr[ED_Black], ED_XFP, X, Y + ED_Ascent, (XftChar8 *)&C, 1);
+    // BackPM still has the char as it was, Sel or IS hilite included.
+    if (FP->BackPM)
+	XCopyArea(ED_XDP, FP->BackPM, FP->XWin, FP->CopyGC, X, Y, ED_Advance, ED_Row, X, Y);
+    else {
+	XftDrawRect(FP->XftDP, &ED_XCArr[ED_White], X, Y, ED_Advance, ED_Height + 1);
+	XftDrawString8(FP->XftDP, &ED_XCArr[ED_Black], ED_XFP, X, Y + ED_Ascent, (XftChar8 *)&C, 1);
+    }
 }
 
-void	ED_PaneShowOpenParen(ED_PanePointer PaneP, char CloseC, Int32 ParenPos)
+void	ED_PaneShowOpenParen(ED_PanePointer PaneP, char CloseC, Int64 ParenPos)
 {
     ED_BufferPointer	BufP = PaneP->BufP;
-    char		OpenC, *CurP;
+    char		OpenC;
     char		Msg[ED_MSGSTRLEN];
-    Int32		CurPos, PCount, Row, Col, MsgLen;
+    Int32		Col, MsgLen;
+    Int64		Row, CurPos;
 
     if (CloseC == ')')
 	OpenC = CloseC - 1;	// '(' + 1 == ')'
     else
 	OpenC = CloseC - 2;	// '[' + 2 == ']' and '{' + 2 == '}'
 
-    CurPos = ParenPos;
-    PCount = 1;
-
-    while (CurPos) {
-	CurP = ED_BufferPosToPtr(BufP, --CurPos);
-	while (ED_BUFFERISMIDUTF8(*CurP)) CurP--, CurPos--;
-
-	if (*CurP == CloseC) PCount++;
-	else if (*CurP == OpenC) PCount--;
-
-	if (PCount == 0) break;
-    }
+    // Near ones are a short scan back, far ones use the ParenIdx
+    CurPos = ED_BufferPIdxFindOpen(BufP, CloseC, ParenPos);
 
     // Fount the matching Paren at Pos?  Row is Pane-relative!
-    if (PCount == 0) {
+    if (CurPos >= 0) {
 	ED_PaneFindLoc(PaneP, CurPos, &Row, &Col, 0, 0);
 
 	if (Row < 0) {
@@ -5702,16 +7643,16 @@ void	ED_PaneShowOpenParen(ED_PanePointer PaneP, char CloseC, Int32 ParenPos)
 //		PaneInsertChars will use SelZap boolean to CHAIN the ADD block
 //		that it creates.
 
-void    ED_PaneInsertChars(ED_PanePointer PaneP, Int32 StrLen, char * StrP, Int16 Typed)
+void    ED_PaneInsertChars(ED_PanePointer PaneP, Int64 StrLen, char * StrP, Int16 Typed)
 {
     ED_BufferPointer	BufP = PaneP->BufP;
     char		*SP, *DP, ParenC;
     Uns8		UndoMode;
     Int16		L;
-    Int32		I, InsertPos, CurPos, ParenPos;
-    Int32		LenPushing, LenBefore;
-    Int32		OldRowCount, NewRowCount;
-    Int32		TotalCount, SelZap;
+    Int64		I, InsertPos, CurPos, ParenPos;
+    Int64		LenPushing, LenBefore;
+    Int64		OldRowCount, NewRowCount;
+    Int64		TotalCount, SelZap;
 
     if (ED_BufferReadOnly(BufP)) return;
 
@@ -5779,7 +7720,7 @@ void    ED_PaneInsertChars(ED_PanePointer PaneP, Int32 StrLen, char * StrP, Int1
 	    UndoMode = (SelZap) ? ED_UB_ADD | ED_UB_CHAIN : ED_UB_ADD;
 	    if (Typed == 0) UndoMode |= ED_UB_CHUNK;
 
-	    ED_BufferAddUndoBlock(BufP, InsertPos, TotalCount, UndoMode, NULL);
+	    ED_BufferAddUndoBlock(BufP, InsertPos, TotalCount, UndoMode, BufP->GapStartP);
 	    BufP->GapStartP += TotalCount;
 	    BufP->LastPos += TotalCount;
 
@@ -5809,15 +7750,14 @@ void    ED_PaneInsertChars(ED_PanePointer PaneP, Int32 StrLen, char * StrP, Int1
 // to optimize for speed--as opposed to PaneInsertChars that is called for every
 // key click!
 //
-// This function is called by XSelInsert (Sets IsPaste == 1).
+// IsPaste == 1 moves the Cursor past the inserted text.
 //
 // Caller should kill the TempBufP after calling this function.
 
 void	ED_PaneInsertBufferChars(ED_PanePointer PaneP, ED_BufferPointer TempBufP, Int16 IsPaste)
 {
     ED_BufferPointer		BufP = PaneP->BufP;
-    Int32			Size, SelZap, Count;
-    Uns8			UndoMode;
+    Int64			Size, SelZap, Count;
     
     // Zap the sel-range, if there was one!  (Don't update, more work ahead)
     SelZap = ED_PaneDelSelRange(PaneP, 0);
@@ -5839,16 +7779,33 @@ void	ED_PaneInsertBufferChars(ED_PanePointer PaneP, ED_BufferPointer TempBufP, I
     if (Count < Size)
 	memcpy(BufP->GapStartP + Count, TempBufP->GapEndP, Size - Count);
 
-    // Create an Undo block for all this--no Data for ADD--Chain to SelZap DEL if any!
+    ED_PaneInsertGapChars(PaneP, Size, SelZap, IsPaste);
+}
+
+// ******************************************************************************
+// ED_PaneInsertGapChars makes Size chars, already written at the start of the Gap
+// (at the Cursor), part of the Buf.  SelZap is what ED_PaneDelSelRange removed.
+// Used by ED_PaneInsertBufferChars and by XSel paste, which fills the Gap as
+// the data comes in.
+
+void	ED_PaneInsertGapChars(ED_PanePointer PaneP, Int64 Size, Int64 SelZap, Int16 IsPaste)
+{
+    ED_BufferPointer		BufP = PaneP->BufP;
+    Uns8			UndoMode;
+
+    BufP->Flags |= ED_BUFMODFLAG;
+
+    // Create an Undo block for all this--no Data stored for ADD, DataP is only
+    // for the LineIdx--Chain to SelZap DEL if any!
     UndoMode = (SelZap) ? ED_UB_ADD | ED_UB_CHAIN : ED_UB_ADD;
     UndoMode |= ED_UB_CHUNK;
-    ED_BufferAddUndoBlock(BufP, PaneP->CursorPos, Size, UndoMode, NULL);
+    ED_BufferAddUndoBlock(BufP, PaneP->CursorPos, Size, UndoMode, BufP->GapStartP);
 	
     BufP->GapStartP += Size;
     BufP->LastPos += Size;
 
     // Normal insertion does NOT move the Cursor, but Paste will!
-    if (IsPaste) PaneP->CursorPos += TempBufP->LastPos;
+    if (IsPaste) PaneP->CursorPos += Size;
 
     ED_PaneUpdateAllPos(PaneP, 0);
     ED_PaneUpdateOtherPanes(PaneP, PaneP->CursorPos, Size - SelZap);
@@ -5894,14 +7851,15 @@ void	ED_PaneInsertBufferChars(ED_PanePointer PaneP, ED_BufferPointer TempBufP, I
 // NOTE:	Cannot rely on Original Pane to have BufRowCount updated!
 //
 
-void	ED_PaneUpdateOtherPanes(ED_PanePointer PaneP, Int32 InsertPos, Int32 InsertCount)
+void	ED_PaneUpdateOtherPanes(ED_PanePointer PaneP, Int64 InsertPos, Int64 InsertCount)
 {
     ED_FramePointer	FrameP;
     ED_PanePointer	FPaneP;
     ED_BufferPointer	BufP = PaneP->BufP;
     Int32		LastRowChar = 0;		// Cache of one
-    Int32		LastRowCount = 0;
-    Int32		RowStart, Ignore;
+    Int64		LastRowCount = 0;
+    Int32		Ignore;
+    Int64		RowStart;
     Int16		DoScrollBar;
 
     FrameP = ED_FirstFrameP;
@@ -5965,7 +7923,7 @@ void	ED_PaneUpdateOtherPanes(ED_PanePointer PaneP, Int32 InsertPos, Int32 Insert
 //
 // NOTE:	For a one-off change, calling the main PaneUpdateOtherPanes is more efficient.
 
-void	ED_PaneUpdateOtherPanesIncrBasic(ED_PanePointer PaneP, Int32 InsertPos, Int32 InsertCount)
+void	ED_PaneUpdateOtherPanesIncrBasic(ED_PanePointer PaneP, Int64 InsertPos, Int64 InsertCount)
 {
     ED_FramePointer	FrameP;
     ED_PanePointer	FPaneP;
@@ -6000,8 +7958,9 @@ void	ED_PaneUpdateOtherPanesIncrRest(ED_PanePointer PaneP)
     ED_FramePointer	FrameP;
     ED_PanePointer	FPaneP;
     Int32		LastRowChar = 0;	// Cache of 1
-    Int32		LastRowCount = 0;
-    Int32		RowStart, Ignore;
+    Int64		LastRowCount = 0;
+    Int32		Ignore;
+    Int64		RowStart;
 
     FrameP = ED_FirstFrameP;
     while (FrameP) {
@@ -6056,7 +8015,7 @@ void	ED_PaneUpdateOtherPanesIncrRest(ED_PanePointer PaneP)
 // ******************************************************************************
 // ED_PanePushmark simply creates a new Mark on the Ring, with the given Pos.
 
-void	ED_BufferPushMark(ED_BufferPointer BufP, Int32 Pos)
+void	ED_BufferPushMark(ED_BufferPointer BufP, Int64 Pos)
 {
     if (BufP->MarkRingArr[BufP->MarkRingIndex] != Pos) {			// Already there?
 	BufP->MarkRingIndex = (BufP->MarkRingIndex + 1) & ED_MARKRINGMASK;	// Inc and wrap
@@ -6070,9 +8029,9 @@ void	ED_BufferPushMark(ED_BufferPointer BufP, Int32 Pos)
 // ED_PaneGetMark returns the current (top) Mark.  It will advance the Index to
 // the next Mark if DoPop is 1.
 
-Int32	ED_BufferGetMark(ED_BufferPointer BufP, Int16 DoPop)
+Int64	ED_BufferGetMark(ED_BufferPointer BufP, Int16 DoPop)
 {
-    Int32	MarkPos;
+    Int64	MarkPos;
 
     MarkPos = BufP->MarkRingArr[BufP->MarkRingIndex];
     if (DoPop) {
@@ -6091,9 +8050,9 @@ Int32	ED_BufferGetMark(ED_BufferPointer BufP, Int16 DoPop)
 // would be impossible without this function.  (Otherwise, cursor will be directly
 // on last Mark, so no rgn to Kill.)
 
-Int32	ED_BufferGetDiffMark(ED_BufferPointer BufP, Int32 NotPos)
+Int64	ED_BufferGetDiffMark(ED_BufferPointer BufP, Int64 NotPos)
 {
-    Int32	MarkPos;
+    Int64	MarkPos;
     Int16	I;
 
     // Pop 0..MarkRingCount times, as necessary.
@@ -6114,9 +8073,9 @@ Int32	ED_BufferGetDiffMark(ED_BufferPointer BufP, Int32 NotPos)
 //		This is done ONLY once to make PaneExchMarkCmd work well when
 //		going to start + end of a buffer.
 
-Int32	ED_BufferSwapMark(ED_BufferPointer BufP, Int32 NewPos)
+Int64	ED_BufferSwapMark(ED_BufferPointer BufP, Int64 NewPos)
 {
-    Int32			MarkPos;
+    Int64			MarkPos;
     
     MarkPos = BufP->MarkRingArr[BufP->MarkRingIndex];		// Read
     if (MarkPos == NewPos) {
@@ -6137,10 +8096,10 @@ Int32	ED_BufferSwapMark(ED_BufferPointer BufP, Int32 NewPos)
 // NOTE:	For deletion: Delta is negative, Pos is the *LEFT* edge of
 //		range being deleted... i.e. assume DELETE FORWARD.
 
-void	ED_BufferUpdateMark(ED_BufferPointer BufP, Int32 Pos, Int32 Delta)
+void	ED_BufferUpdateMark(ED_BufferPointer BufP, Int64 Pos, Int64 Delta)
 {
     Int16		I;
-    Int32		*RAP;
+    Int64		*RAP;
 
     RAP = BufP->MarkRingArr;
     for (I = 0; I < ED_MARKRINGCOUNT; RAP++, I++) {
@@ -6176,7 +8135,7 @@ void	ED_BufferUpdateMark(ED_BufferPointer BufP, Int32 Pos, Int32 Delta)
 //
 // NOTE:	InitSize of 0 means allocate the default size!
 
-ED_BufferPointer	ED_BufferNew(Int32 InitSize, char * FileNameP, char * PathNameP, Int16 InfoOnly)
+ED_BufferPointer	ED_BufferNew(Int64 InitSize, char * FileNameP, char * PathNameP, Int16 InfoOnly)
 {
     ED_BufferPointer	BufP;
     char *		MemP;
@@ -6191,6 +8150,7 @@ ED_BufferPointer	ED_BufferNew(Int32 InitSize, char * FileNameP, char * PathNameP
     BufP->LastPos = 0;
     BufP->PaneRefCount = 0;		// No Panes yet.
     BufP->Ident = 0;			// No Ident for now
+    BufP->EditSeq = 0;
 
     if (FileNameP == NULL) {
 	sprintf(ED_TempBufName, ED_STR_TempBufName, ED_TempBufCount++);
@@ -6230,9 +8190,23 @@ ED_BufferPointer	ED_BufferNew(Int32 InitSize, char * FileNameP, char * PathNameP
 	BufP->FirstUSP = BufP->LastUSP = NULL;
 	BufP->USCount = 0;
 	BufP->USTotalSize = 0;
+	BufP->USFrozenCount = 0;
     } else
 	ED_BufferInitUndo(BufP);		// Initialize undo buffer
 
+    BufP->LIdxArrP = NULL;			// LineIdx is created lazily
+    BufP->LIdxCount = BufP->LIdxMax = 0;
+    for (I = 0; I < ED_RIDXWIDTHS; I++) {	// So is RowIdx
+	BufP->RIdxWidthArr[I].ArrP = NULL;
+	BufP->RIdxWidthArr[I].RowChars = BufP->RIdxWidthArr[I].LastUse = 0;
+	BufP->RIdxWidthArr[I].Count = BufP->RIdxWidthArr[I].Max = 0;
+	BufP->RIdxWidthArr[I].DirtyStart = BufP->RIdxWidthArr[I].DirtyEnd = -1;
+	BufP->RIdxWidthArr[I].EstBytes = BufP->RIdxWidthArr[I].EstRows = 0;
+    }
+    BufP->PIdxArrP = NULL;			// And ParenIdx
+    BufP->PIdxCount = BufP->PIdxMax = 0;
+    BufP->PIdxEndPos = 0;
+
     // New buffer is one big Gap!
     BufP->BufStartP = MemP;
     BufP->BufEndP = MemP + InitSize;		// Same as GapEnd, for now
@@ -6262,29 +8236,40 @@ ED_BufferPointer	ED_BufferNew(Int32 InitSize, char * FileNameP, char * PathNameP
 
 ED_BufferPointer	ED_BufferReadFile(Int32 FD, char * NameP, char * PathP)
 {
-    Int32		Size;
+    Int64		Size, Count, Done;
     ED_BufferPointer	BufP;
-    Int32		Count, SysError;
+    Int32		SysError;
 
     // Find the length of the file by seeking the end.
     Size = lseek(FD, 0, SEEK_END);
     if (Size == -1) return NULL;
     lseek(FD, 0, SEEK_SET);
 
+    // Big file, try to just map it in.  Fall back to read if that fails.
+    if (Size >= ED_MAPMINSIZE) {
+	BufP = ED_BufferNew(ED_GAPEXTRAEXPAND, NameP, PathP, 0);
+	if (ED_BufferMapFile(BufP, FD, Size) == 0) goto DoneRead;
+	ED_BufferKill(BufP);
+    }
+
     // Create a new buffer!  Add a little Gap space to file size.
     BufP = ED_BufferNew(Size + ED_GAPEXTRAEXPAND, NameP, PathP, 0);
 
-    // Read it all in!
-    Count = read(FD, BufP->GapStartP, Size);
-    if (Count != Size) {
-	SysError = errno;		// Save
-	    ED_BufferKill(BufP);
-	errno = SysError;		// Restore for caller!
-	return NULL;
+    // Read it all in!  A single read returns at most ~2GB, so loop.
+    for (Done = 0; Done < Size; Done += Count) {
+	Count = read(FD, BufP->GapStartP + Done, Size - Done);
+	if ((Count == -1) && (errno == EINTR)) { Count = 0; continue; }
+	if (Count <= 0) {
+	    SysError = (Count == 0) ? EIO : errno;	// Save
+		ED_BufferKill(BufP);
+	    errno = SysError;		// Restore for caller!
+	    return NULL;
+	}
     }
     BufP->GapStartP += Size;
     BufP->LastPos = Size;
 
+DoneRead:
     // Check that Filename has no collisions with other buffers!
     if (NameP) ED_BufferCheckNameCol(BufP);
 
@@ -6292,26 +8277,642 @@ ED_BufferPointer	ED_BufferReadFile(Int32 FD, char * NameP, char * PathP)
 }
 
 // ******************************************************************************
-// ED_BufferKill gets rid of BufP *IF AND ONLY IF* PaneRefCount is 0 !!
+// ED_BufferMapFile maps a (big) file into BufP, instead of reading it in.  This
+// is instant, and until the Buf is edited, the pages are shared with the page
+// cache--RSS does not double.  Returns 0 for success, 1 for failure.
+//
+// The file is mapped MAP_PRIVATE (Copy-On-Write) over a bigger anonymous
+// MAP_NORESERVE block, so the Gap starts out at the end, and can even grow
+// there (up to ED_MAPRESERVE) without copying.  Moving the Gap only copies
+// (COWs) the pages between the old and new Gap positions, the rest remain
+// untouched file pages.  An edit far from the Gap still copies everything in
+// between--text is *NOT* brought in lazily just around the edits, that would
+// need a piece table, and this is a gap buffer.  Left out on purpose.
+//
+// NOTE:	Overwriting the same file (O_TRUNC) would yank the pages from under
+//		the mapping, so ED_BufferUnmapPath must be called before that.
+//		Saves rename a new file over it, the old inode lives on.
+//
+// NOTE:	Another program can still truncate or rewrite the file in place.
+//		Pages past a new (shorter) end then fault with SIGBUS, on the UI
+//		thread or the load worker, and ED_MapSigBusHandler puts a zero page
+//		in each one so the editor lives on.  The Buf goes read only and
+//		DAMAGED, and will not be saved.  A rewrite that keeps the length
+//		is *NOT* caught--it shows through in the pages not yet copied
+//		(COW only shields the ones already copied).  A read Buf has
+//		neither problem.
+
+Int16	ED_BufferMapFile(ED_BufferPointer BufP, Int32 FD, Int64 Size)
+{
+    struct stat		StatR;
+    Int64		MapLen;
+    char *		MemP;
 
-void		ED_BufferKill(ED_BufferPointer BufP)
-{
-    if (BufP->PaneRefCount != 0) return;
+    if (fstat(FD, &StatR)) return 1;
 
-    ED_XSelReleasePrimary(BufP);	// In case this BufP held the Primary!
+    MapLen = (Int64)Size + ED_MAPRESERVE;
+    MemP = mmap(NULL, MapLen, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (MemP == MAP_FAILED) return 1;
 
-    // Unchain it first
-    if (BufP->PrevBufP) BufP->PrevBufP->NextBufP = BufP->NextBufP;
-    if (BufP->NextBufP) BufP->NextBufP->PrevBufP = BufP->PrevBufP;
-    if (ED_FirstBufP == BufP) ED_FirstBufP = BufP->NextBufP;
+    if (MAP_FAILED == mmap(MemP, Size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_FIXED, FD, 0)) {
+	munmap(MemP, MapLen);
+	return 1;
+    }
+    if (ED_MapSlotAdd(BufP, MemP, Size)) {			// No slot, no SIGBUS cover... read it
+	munmap(MemP, MapLen);
+	return 1;
+    }
 
-    ED_BufferKillUndo(BufP);
-    free(BufP->BufStartP);
-    sc_SAStoreFreeBlock(&ED_BufferStore, BufP);
-}
+    free(BufP->BufStartP);		// Small malloc from ED_BufferNew
+    BufP->Flags |= ED_BUFMAPPEDFLAG;
+    BufP->MapLen = MapLen;
+    BufP->MapDev = StatR.st_dev;
+    BufP->MapIno = StatR.st_ino;
 
-// ******************************************************************************
-void	ED_BufferUpdateModeLines(ED_BufferPointer TheBufP)
+    // Gap at the end, same as after a read... but not (yet) all of it.
+    BufP->BufStartP = MemP;
+    BufP->GapStartP = MemP + Size;
+    BufP->GapEndP = BufP->BufEndP = MemP + Size + ED_GAPEXTRAEXPAND;
+    BufP->LastPos = Size;
+
+    return 0;
+}
+
+// ******************************************************************************
+// ED_BufferUnmap copies a mapped Buf out into regular malloc memory, and
+// drops the mapping.
+
+void	ED_BufferUnmap(ED_BufferPointer BufP)
+{
+    Int64	MemLen = BufP->BufEndP - BufP->BufStartP;
+    char *	MemP;
+
+    if (! (BufP->Flags & ED_BUFMAPPEDFLAG)) return;
+    if (BufP->Flags & ED_BUFLOADINGFLAG) ED_LoadWait(BufP);	// Worker reads the mapping
+
+    MemP = malloc(MemLen);
+    if (! MemP) G_SETEXCEPTION("Malloc Unmap Buffer Failed", 0);
+    memcpy(MemP, BufP->BufStartP, MemLen);
+    ED_MapSlotDrop(BufP);
+    munmap(BufP->BufStartP, BufP->MapLen);
+
+    BufP->GapStartP = MemP + (BufP->GapStartP - BufP->BufStartP);
+    BufP->GapEndP = MemP + (BufP->GapEndP - BufP->BufStartP);
+    BufP->BufEndP = MemP + MemLen;
+    BufP->BufStartP = MemP;
+    BufP->Flags &= ~ED_BUFMAPPEDFLAG;
+}
+
+// ******************************************************************************
+// ED_BufferUnmapPath unmaps any Buf that has PathP mapped--called just before
+// it is opened with O_TRUNC.  (Could be a different Buf from the one being saved.)
+
+void	ED_BufferUnmapPath(char * PathP)
+{
+    ED_BufferPointer	BufP = ED_FirstBufP;
+    struct stat		StatR;
+
+    if (stat(PathP, &StatR)) return;
+
+    while (BufP) {
+	if ((BufP->Flags & ED_BUFMAPPEDFLAG) &&
+	    (BufP->MapDev == StatR.st_dev) && (BufP->MapIno == StatR.st_ino))
+	    ED_BufferUnmap(BufP);
+
+	BufP = BufP->NextBufP;
+    }
+}
+
+// ED_BufferPathMapped returns 1 if any Buf has PathP mapped.
+Int16	ED_BufferPathMapped(char * PathP)
+{
+    ED_BufferPointer	BufP = ED_FirstBufP;
+    struct stat		StatR;
+
+    if (stat(PathP, &StatR)) return 0;
+
+    while (BufP) {
+	if ((BufP->Flags & ED_BUFMAPPEDFLAG) &&
+	    (BufP->MapDev == StatR.st_dev) && (BufP->MapIno == StatR.st_ino))
+	    return 1;
+
+	BufP = BufP->NextBufP;
+    }
+
+    return 0;
+}
+
+// ******************************************************************************
+// ED_MapInit installs ED_MapSigBusHandler and its pipe, on the first map.
+//
+// A mapped file that shrinks (another program truncates it) makes the pages
+// past its new end fault with SIGBUS, and the default action kills the editor.
+// Every mapped Buf has an ED_MapSlotRecord, so the handler can tell one of our
+// file pages from a real bug without walking the Buf list (not signal safe).
+// For ours, it maps one zero page over the faulting one--*ONLY* that page, the
+// pages around it may be COW copies with edits in them--and the access simply
+// restarts.  Then it writes a byte down ED_MapPipeArr, and ED_MapDamageHandler
+// (main loop) makes the Buf read only and DAMAGED, so the NULs are never saved.
+
+void	ED_MapInit(void)
+{
+    struct sigaction	SigR;
+
+    if (ED_MapPipeArr[0] != -1) return;
+
+    if (pipe(ED_MapPipeArr)) G_SETEXCEPTION("Map pipe failed", errno);
+    fcntl(ED_MapPipeArr[0], F_SETFL, O_NONBLOCK);
+    fcntl(ED_MapPipeArr[1], F_SETFL, O_NONBLOCK);	// Never block in the handler
+    sc_FDAdd(ED_MapPipeArr[0], POLLIN, ED_MapDamageHandler, NULL);
+    ED_MapPageSize = sysconf(_SC_PAGESIZE);
+
+    memset(&SigR, 0, sizeof(SigR));
+    SigR.sa_sigaction = ED_MapSigBusHandler;
+    SigR.sa_flags = SA_SIGINFO | SA_RESTART;
+    sigemptyset(&SigR.sa_mask);
+    sigaction(SIGBUS, &SigR, NULL);
+}
+
+// ED_MapSlotAdd registers the file pages of BufP.  Return 0 for success, 1 if
+// all ED_MAPSLOTMAX are taken.  StartP goes in last, the handler looks at it first.
+Int16	ED_MapSlotAdd(ED_BufferPointer BufP, char * StartP, Int64 Len)
+{
+    ED_MapSlotPointer	SP;
+
+    ED_MapInit();
+    for (SP = ED_MapSlotArr; SP < ED_MapSlotArr + ED_MAPSLOTMAX; SP++)
+	if (SP->StartP == NULL) {
+	    SP->Len = Len;
+	    SP->BufP = BufP;
+	    SP->Damaged = 0;
+	    SP->StartP = StartP;
+	    return 0;
+	}
+
+    return 1;
+}
+
+// ED_MapSlotDrop is called just before the mapping of BufP goes away.  Damage
+// seen while copying it out still counts, the copy has the NULs.
+void	ED_MapSlotDrop(ED_BufferPointer BufP)
+{
+    ED_MapSlotPointer	SP;
+
+    for (SP = ED_MapSlotArr; SP < ED_MapSlotArr + ED_MAPSLOTMAX; SP++)
+	if (SP->StartP && (SP->BufP == BufP)) {
+	    SP->StartP = NULL;
+	    if (SP->Damaged) ED_AuxMapDamaged(BufP);
+	    SP->Damaged = 0;
+	    return;
+	}
+}
+
+// ED_MapSigBusHandler runs on whichever thread faulted, see ED_MapInit.  If
+// the fault is not in a mapped Buf, it puts back the default action and
+// returns, the access faults again and the editor dies as it always did.
+void	ED_MapSigBusHandler(int Sig, siginfo_t * InfoP, void * CtxP)
+{
+    ED_MapSlotPointer	SP;
+    char *		AddrP = InfoP->si_addr;
+    char *		StartP;
+    Int32		SaveErrno = errno;
+
+    for (SP = ED_MapSlotArr; SP < ED_MapSlotArr + ED_MAPSLOTMAX; SP++) {
+	StartP = SP->StartP;
+	if (StartP && (AddrP >= StartP) && (AddrP < StartP + SP->Len)) {
+	    AddrP -= (Int64)AddrP & (ED_MapPageSize - 1);
+	    if (MAP_FAILED == mmap(AddrP, ED_MapPageSize, PROT_READ | PROT_WRITE,
+				   MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED, -1, 0)) break;
+	    SP->Damaged = 1;
+	    while ((write(ED_MapPipeArr[1], &Sig, 1) < 0) && (errno == EINTR));
+	    errno = SaveErrno;
+	    return;
+	}
+    }
+
+    signal(SIGBUS, SIG_DFL);
+    errno = SaveErrno;
+}
+
+// ******************************************************************************
+// ED_MapDamageHandler is the sc_FDAdd callback on the map pipe.
+
+void	ED_MapDamageHandler(Int32 FD, Int16 REvents, void * DataP)
+{
+    char	ByteArr[64];
+
+    while (read(FD, ByteArr, sizeof(ByteArr)) > 0);
+    ED_MapCheck();
+}
+
+// ED_MapCheck handles the Bufs damaged since last time.  Called from the main
+// loop, and before a mapped Buf is saved--the snapshot may have hit a hole.
+void	ED_MapCheck(void)
+{
+    ED_MapSlotPointer	SP;
+
+    for (SP = ED_MapSlotArr; SP < ED_MapSlotArr + ED_MAPSLOTMAX; SP++)
+	if (SP->StartP && SP->Damaged) {
+	    SP->Damaged = 0;
+	    ED_AuxMapDamaged(SP->BufP);
+	}
+}
+
+// ED_AuxMapDamaged makes BufP read only, once, and says so.
+void	ED_AuxMapDamaged(ED_BufferPointer BufP)
+{
+    if (BufP->Flags & ED_BUFDAMAGEDFLAG) return;
+
+    BufP->Flags |= ED_BUFDAMAGEDFLAG | ED_BUFREADONLYFLAG;
+    ED_FrameSPrintEchoS(ED_ECHOMSGMODE, ED_STR_EchoMapDamaged, NAME_MAX, BufP->FileName);
+    ED_BufferUpdateModeLines(BufP);
+    if (ED_CurFrameP) ED_FrameDrawEchoLine(ED_CurFrameP);
+}
+
+// ******************************************************************************
+// ******************************************************************************
+// BACKGROUND LOAD
+//
+// Mapping a big file is instant, but the first pass over it (NeedsFilter, then
+// BufRowCount) still faults in every page on the UI thread--and read() is no
+// better when mapping fails.  So ED_BufferLoadFile exposes just the first
+// ED_LOADFIRSTCHUNK, and a worker thread brings in the rest in ED_LOADCHUNK
+// pieces: pread into the Buf memory, or fault in the mapped pages.  It also
+// scans each piece for CR/Tab, so NeedsFilter is free at the end.
+//
+// The not-yet-exposed bytes sit in the Gap, which the UI never reads or writes
+// while ED_BUFLOADINGFLAG is set (ED_BufferReadOnly refuses edits).  After each
+// piece, the worker sends an ED_LoadMsgRecord down a pipe, ED_LoadDoneHandler
+// (main loop) moves GapStartP and LastPos up--as if the text was appended, so
+// the LineIdx and RowIdx are extended incrementally--and refines BufRowCount,
+// the ScrollBar and ModeLine, with a progress bar in the Echo line.
+//
+// At the end, a Buf that needs it is filtered without a query (as for command
+// line files), the FILTER flag still guards the original at Save time.  A read
+// error leaves the partial Buf read-only.  Killing the Buf cancels the worker.
+
+ED_BufferPointer	ED_BufferLoadFile(Int32 FD, char * NameP, char * PathP)
+{
+    ED_BufferPointer	BufP;
+    ED_LoadPointer	LoadP;
+    Int64		Size, First;
+    Int32		LoadFD, SysError;
+    Int16		Mapped;
+
+    Size = lseek(FD, 0, SEEK_END);
+    if (Size == -1) return NULL;
+    if (Size < ED_LOADSTREAMSIZE) return ED_BufferReadFile(FD, NameP, PathP);
+
+    LoadFD = dup(FD);
+    if (LoadFD == -1) return ED_BufferReadFile(FD, NameP, PathP);
+
+    if (ED_LoadPipeArr[0] == -1) {
+	if (pipe(ED_LoadPipeArr)) G_SETEXCEPTION("Load pipe failed", errno);
+	fcntl(ED_LoadPipeArr[0], F_SETFL, O_NONBLOCK);
+	sc_FDAdd(ED_LoadPipeArr[0], POLLIN, ED_LoadDoneHandler, NULL);
+    }
+
+    // Map it if possible (instant), else read the first chunk right now.
+    First = ED_LOADFIRSTCHUNK;
+    Mapped = 1;
+    BufP = ED_BufferNew(ED_GAPEXTRAEXPAND, NameP, PathP, 0);
+    if (ED_BufferMapFile(BufP, FD, Size)) {
+	ED_BufferKill(BufP);
+	Mapped = 0;
+	BufP = ED_BufferNew(Size + ED_GAPEXTRAEXPAND, NameP, PathP, 0);
+	First = pread(FD, BufP->BufStartP, First, 0);
+	if (First == -1) {
+	    SysError = errno;
+	    ED_BufferKill(BufP);
+	    close(LoadFD);
+	    errno = SysError;
+	    return NULL;
+	}
+    }
+    BufP->GapStartP = BufP->BufStartP + First;
+    BufP->LastPos = First;
+    BufP->Flags |= ED_BUFLOADINGFLAG;
+
+    LoadP = malloc(sizeof(ED_LoadRecord));
+    if (LoadP == NULL) G_SETEXCEPTION("Malloc Load failed", 0);
+    LoadP->BufP = BufP;
+    LoadP->MemP = BufP->BufStartP;
+    LoadP->Id = ++ED_LoadIdCount;
+    LoadP->FD = LoadFD;
+    LoadP->Size = Size;
+    LoadP->DoneLen = First;
+    LoadP->Mapped = Mapped;
+    LoadP->Percent = -1;
+    LoadP->Cancel = 0;
+    LoadP->SessCursorPos = LoadP->SessPanePos = LoadP->SessMarkPos = -1;
+    LoadP->EndLen = First;
+    LoadP->EndErr = 0;
+    LoadP->EndFilter = (ED_UtilScanByte2(BufP->BufStartP, BufP->GapStartP, 0x09, 0x0d) != NULL);
+
+    if (pthread_create(&LoadP->Thread, NULL, ED_LoadWorkerFunc, LoadP))
+	G_SETEXCEPTION("Load worker failed", 0);
+    LoadP->NextP = ED_LoadFirstP;
+    ED_LoadFirstP = LoadP;
+
+    if (NameP) ED_BufferCheckNameCol(BufP);
+    return BufP;
+}
+
+// ******************************************************************************
+// ED_LoadWorkerFunc runs on its own thread, touches *ONLY* LoadP and the
+// not-yet-exposed Buf memory.
+
+void *	ED_LoadWorkerFunc(void * ArgP)
+{
+    ED_LoadPointer	LoadP = ArgP;
+    ED_LoadMsgRecord	Msg = {0};
+    volatile char *	TouchP;
+    char *		P;
+    Int64		Done = LoadP->EndLen;
+    Int64		Len;
+    Int32		Err = 0;
+    Int16		Filter = LoadP->EndFilter;
+
+    Msg.Id = LoadP->Id;
+    while ((Done < LoadP->Size) && ! LoadP->Cancel) {
+	P = LoadP->MemP + Done;
+	Len = LoadP->Size - Done;
+	if (Len > ED_LOADCHUNK) Len = ED_LOADCHUNK;
+
+	if (LoadP->Mapped)
+	    madvise(P - ((Int64)P & (sysconf(_SC_PAGESIZE) - 1)), Len, MADV_WILLNEED);
+	else {
+	    Len = pread(LoadP->FD, P, Len, Done);
+	    if (Len == -1) {
+		if (errno == EINTR) continue;
+		Err = errno;
+		break;
+	    }
+	    if (Len == 0) break;		// File shrank, take what is there
+	}
+
+	// The scan faults in the pages, once a CR/Tab is seen just touch them.
+	if (! Filter)
+	    Filter = (ED_UtilScanByte2(P, P + Len, 0x09, 0x0d) != NULL);
+	else if (LoadP->Mapped)
+	    for (TouchP = P; TouchP < P + Len; TouchP += 4096) (void)*TouchP;
+
+	Done += Len;
+	Msg.DoneLen = Done;
+	while ((write(ED_LoadPipeArr[1], &Msg, sizeof(Msg)) < 0) && (errno == EINTR));
+    }
+
+    LoadP->EndLen = Done;
+    LoadP->EndErr = Err;
+    LoadP->EndFilter = Filter;
+
+    Msg.Done = 1;
+    Msg.DoneLen = Done;
+    while ((write(ED_LoadPipeArr[1], &Msg, sizeof(Msg)) < 0) && (errno == EINTR));
+    return NULL;
+}
+
+// ******************************************************************************
+// ED_LoadDoneHandler is the sc_FDAdd callback on the load pipe.
+
+void	ED_LoadDoneHandler(Int32 FD, Int16 REvents, void * DataP)
+{
+    ED_LoadMsgRecord	Msg;
+    ED_LoadPointer	LoadP;
+    ED_FramePointer	FP = ED_CurFrameP;
+    Int16		Percent;
+
+    while (read(FD, &Msg, sizeof(Msg)) == sizeof(Msg)) {
+	LoadP = ED_LoadFirstP;
+	while (LoadP && (LoadP->Id != Msg.Id)) LoadP = LoadP->NextP;
+	if ((LoadP == NULL) || LoadP->Cancel) continue;		// Stale
+
+	if (Msg.Done) {
+	    ED_LoadEnd(LoadP);
+	    continue;
+	}
+
+	ED_LoadExpose(LoadP, Msg.DoneLen);
+
+	// Progress bar, unless a QR is using the Echo line.
+	Percent = ((Int64)Msg.DoneLen * 100) / LoadP->Size;
+	if (FP && (Percent != LoadP->Percent) && ! (ED_QRPaneP && (ED_QRPaneP->FrameP == FP))) {
+	    ED_FrameDrawEchoProgressBar(FP, ED_STR_Loading, -1);
+	    ED_FrameDrawEchoProgressBar(FP, ED_STR_Loading, Percent);
+	    LoadP->Percent = Percent;
+	}
+    }
+}
+
+// ******************************************************************************
+// ED_LoadExpose moves the end of the Buf up to DoneLen, as if appended, and
+// updates the Panes showing it.
+
+void	ED_LoadExpose(ED_LoadPointer LoadP, Int64 DoneLen)
+{
+    ED_BufferPointer	BufP = LoadP->BufP;
+    Int64		OldLen = BufP->LastPos;
+    ED_FramePointer	FP;
+    ED_PanePointer	PP;
+
+    if (DoneLen <= OldLen) return;
+
+    BufP->GapStartP = BufP->BufStartP + DoneLen;
+    BufP->LastPos = DoneLen;
+    LoadP->DoneLen = DoneLen;
+    ED_BufferLIdxUpdate(BufP, OldLen, DoneLen - OldLen, BufP->BufStartP + OldLen);
+    ED_BufferRIdxUpdate(BufP, OldLen, DoneLen - OldLen);
+    ED_BufferPIdxUpdate(BufP, OldLen, DoneLen - OldLen, BufP->BufStartP + OldLen);
+    ED_ISSetInvalidate(BufP);
+
+    FP = ED_FirstFrameP;
+    while (FP) {
+	PP = FP->FirstPaneP;
+	while (PP) {
+	    if (PP->BufP == BufP) {
+		ED_PaneUpdateAllPos(PP, 0);		// Refines BufRowCount + ScrollBar
+		ED_PaneDrawText(PP);
+		ED_PaneDrawScrollBar(PP, 0);
+		ED_PaneDrawModeLine(PP);
+	    }
+	    PP = PP->NextPaneP;
+	}
+	FP = FP->NextFrameP;
+    }
+}
+
+// ******************************************************************************
+// ED_LoadEnd joins the worker, exposes the rest and does the housekeeping
+// ED_BufferReadFile callers would have done.
+
+void	ED_LoadEnd(ED_LoadPointer LoadP)
+{
+    ED_BufferPointer	BufP = LoadP->BufP;
+    ED_FramePointer	FP;
+    ED_PanePointer	PP;
+    Int16		SessPos = 0;
+
+    pthread_join(LoadP->Thread, NULL);
+    ED_LoadExpose(LoadP, LoadP->EndLen);
+    BufP->Flags &= ~ED_BUFLOADINGFLAG;
+
+    if (LoadP->EndErr) {
+	BufP->Flags |= ED_BUFREADONLYFLAG;		// Partial, must not be saved over
+	ED_FrameSetEchoError(ED_STR_EchoReadFailed, LoadP->EndErr);
+    } else {
+	if (LoadP->EndFilter) {
+	    PP = (ED_CurFrameP) ? ED_CurFrameP->CurPaneP : NULL;
+	    ED_BufferDoFilter(BufP, (PP) ? EDCB_FilterEchoUpdate : NULL, PP);
+	    BufP->MarkPos = -1;
+	    BufP->CursorPos = BufP->PanePos = 0;
+	} else
+	    SessPos = ED_AuxLoadSessPos(LoadP);
+	ED_FrameSPrintEchoS(ED_ECHOMSGMODE, ED_STR_EchoLoaded, NAME_MAX, BufP->FileName);
+    }
+
+    FP = ED_FirstFrameP;
+    while (FP) {
+	PP = FP->FirstPaneP;
+	while (PP) {
+	    if ((PP->BufP == BufP) && LoadP->EndFilter) {
+		PP->CursorPos = PP->PanePos = 0;	// Filter moved everything
+		ED_PaneUpdateAllPos(PP, 1);
+	    } else if ((PP->BufP == BufP) && SessPos && (PP->CursorPos == 0)) {
+		PP->CursorPos = BufP->CursorPos;	// Still where the first chunk left it
+		PP->PanePos = BufP->PanePos;
+		ED_PaneUpdateAllPos(PP, 1);
+	    }
+	    PP = PP->NextPaneP;
+	}
+	ED_FrameDrawAll(FP);
+	FP = FP->NextFrameP;
+    }
+
+    ED_LoadReap(LoadP);
+}
+
+// ED_AuxLoadSessPos gives BufP the session positions that were past the first
+// chunk.  Returns 1 if the Cursor or Pane one went in.
+Int16	ED_AuxLoadSessPos(ED_LoadPointer LoadP)
+{
+    ED_BufferPointer	BufP = LoadP->BufP;
+    Int16		Moved = 0;
+
+    if ((LoadP->SessCursorPos >= 0) && (LoadP->SessCursorPos <= BufP->LastPos)) {
+	BufP->CursorPos = LoadP->SessCursorPos;
+	Moved = 1;
+    }
+    if ((LoadP->SessPanePos >= 0) && (LoadP->SessPanePos <= BufP->LastPos)) {
+	BufP->PanePos = LoadP->SessPanePos;
+	Moved = 1;
+    }
+    if ((LoadP->SessMarkPos >= 0) && (LoadP->SessMarkPos <= BufP->LastPos))
+	BufP->MarkPos = LoadP->SessMarkPos;
+
+    return Moved;
+}
+
+// ******************************************************************************
+// ED_LoadReap unchains and frees a (joined) LoadP.
+
+void	ED_LoadReap(ED_LoadPointer LoadP)
+{
+    ED_LoadPointer *	LPP = &ED_LoadFirstP;
+
+    while (*LPP != LoadP) LPP = &(*LPP)->NextP;
+    *LPP = LoadP->NextP;
+
+    close(LoadP->FD);
+    free(LoadP);
+}
+
+ED_LoadPointer	ED_LoadFind(ED_BufferPointer BufP)
+{
+    ED_LoadPointer	LoadP = ED_LoadFirstP;
+
+    while (LoadP && (LoadP->BufP != BufP)) LoadP = LoadP->NextP;
+    return LoadP;
+}
+
+// ******************************************************************************
+// ED_LoadWait blocks until BufP is fully loaded--called before Unmap.
+
+void	ED_LoadWait(ED_BufferPointer BufP)
+{
+    ED_LoadPointer	LoadP = ED_LoadFind(BufP);
+
+    if (LoadP) ED_LoadEnd(LoadP);
+}
+
+// ED_LoadStop cancels the load of BufP, it is about to be killed.
+
+void	ED_LoadStop(ED_BufferPointer BufP)
+{
+    ED_LoadPointer	LoadP = ED_LoadFind(BufP);
+
+    if (LoadP == NULL) return;
+    LoadP->Cancel = 1;
+    pthread_join(LoadP->Thread, NULL);
+    BufP->Flags &= ~ED_BUFLOADINGFLAG;
+    ED_LoadReap(LoadP);
+}
+
+// ******************************************************************************
+// ED_BufferLoading returns 1 (and complains) if BufP is still loading--from
+// its file, or an XSel paste.
+
+Int16	ED_BufferLoading(ED_BufferPointer BufP)
+{
+    if (BufP->Flags & (ED_BUFLOADINGFLAG | ED_BUFPASTINGFLAG)) {
+	ED_FrameSetEchoS(ED_ECHOMSGMODE, (BufP->Flags & ED_BUFLOADINGFLAG) ? ED_STR_EchoLoading : ED_STR_EchoPasting);
+	ED_FrameDrawEchoLine(ED_CurFrameP);
+	ED_FrameFlashError(ED_CurFrameP);
+	return 1;
+    }
+
+    return 0;
+}
+
+// ******************************************************************************
+// ED_BufferFreeMem releases the Buf memory, mapped or malloced.
+
+void	ED_BufferFreeMem(ED_BufferPointer BufP)
+{
+    if (BufP->Flags & ED_BUFMAPPEDFLAG) {
+	ED_MapSlotDrop(BufP);
+	munmap(BufP->BufStartP, BufP->MapLen);
+    } else
+	free(BufP->BufStartP);
+}
+
+// ******************************************************************************
+// ED_BufferKill gets rid of BufP *IF AND ONLY IF* PaneRefCount is 0 !!
+
+void		ED_BufferKill(ED_BufferPointer BufP)
+{
+    if (BufP->PaneRefCount != 0) return;
+
+    ED_XSelReleasePrimary(BufP);	// In case this BufP held the Primary!
+
+    // Unchain it first
+    if (BufP->PrevBufP) BufP->PrevBufP->NextBufP = BufP->NextBufP;
+    if (BufP->NextBufP) BufP->NextBufP->PrevBufP = BufP->PrevBufP;
+    if (ED_FirstBufP == BufP) ED_FirstBufP = BufP->NextBufP;
+
+    if (BufP->Flags & ED_BUFSAVINGFLAG) ED_SaveDetach(BufP);
+    if (BufP->Flags & ED_BUFLOADINGFLAG) ED_LoadStop(BufP);
+    if (BufP->Flags & ED_BUFPASTINGFLAG) ED_XRecvAbort();
+    ED_BufferKillUndo(BufP);
+    ED_BufferLIdxKill(BufP);
+    ED_BufferRIdxKill(BufP);
+    ED_BufferPIdxKill(BufP);
+    ED_ISSetInvalidate(BufP);				// Block may be reused!
+    ED_BufferFreeMem(BufP);
+    sc_SAStoreFreeBlock(&ED_BufferStore, BufP);
+}
+
+// ******************************************************************************
+void	ED_BufferUpdateModeLines(ED_BufferPointer TheBufP)
 {
     ED_FramePointer	FP;
     ED_PanePointer	PP;
@@ -6381,7 +8982,7 @@ void	ED_BufferDidWrite(ED_BufferPointer BufP, ED_FramePointer ThisFrameP)
 	ED_BufferInitUndo(BufP);		// Create 1 new USlab.
     }
     
-    BufP->Flags &= ~ (ED_BUFNOFILEFLAG | ED_BUFINFOONLYFLAG | ED_BUFREADONLYFLAG);
+    BufP->Flags &= ~ (ED_BUFNOFILEFLAG | ED_BUFINFOONLYFLAG | ED_BUFREADONLYFLAG | ED_BUFDAMAGEDFLAG);
     BufP->Ident = 0;		// Reset IDENT... maybe TOO AGRESSIVE for future
 
     // Check if buffer's new "name" collides with any other buffers!
@@ -6399,8 +9000,18 @@ void	ED_BufferDidWrite(ED_BufferPointer BufP, ED_FramePointer ThisFrameP)
 // less than Len, then the entire BufMem is grown, so the gap is Len plus an
 // extra ED_GAPEXTRAEXPAND bytes--to minimize calls to realloc.
 //
+// The extra also includes a fraction of the Buf size (LastPos / ED_GAPGROWDIV,
+// up to ED_GAPGROWMAX).  With a fixed extra, repeated big pastes into a big
+// Buf would realloc AND slide the whole bottom block every time.  Growing
+// geometrically makes that amortized O(1) per byte.
+//
 // NOTE:	BufP->GapEndP is first byte AFTER Gap.
 //
+// NOTE:	While ED_BUFLOADINGFLAG is set, the Gap holds the not-yet-exposed
+//		file bytes the loader is filling in.  Moving (or using) it would
+//		corrupt the Buf, so the load is finished first (ED_LoadWait).
+//		Callers should not get here--edits are refused, copies check.
+//
 // BufMem is grown by "realloc" which (a) tries to grow in place or failing that
 // (b) creates a new memory block and copies the old to the new.  So if realloc
 // fails, an explicit alloc and copy will also fail.
@@ -6420,24 +9031,37 @@ void	ED_BufferDidWrite(ED_BufferPointer BufP, ED_FramePointer ThisFrameP)
 // Before: [TTTTTTT---MMBBBB]		[TTTTT---MMBBBBeeeee]
 // After:  [TTTTTTTMM---BBBB]		[TTTTTMM------BBBBBB]
 
-#define		ED_SLIDEDOWN(P, Len, Delta)	memmove(P + Delta, P, Len)
+#define		ED_SLIDEDOWN(P, Len, Delta)	(memmove(P + Delta, P, Len), Moved += (Len))
 
-void	ED_BufferPlaceGap(ED_BufferPointer BufP, Int32 Offset, Int32 Len)
+void	ED_BufferPlaceGap(ED_BufferPointer BufP, Int64 Offset, Int64 Len)
 {
-    Int32	OldGapLen, GapMove;
-    Int32	NewGapLen, NewMemLen;
+    Int64	OldGapLen, GapMove;
+    Int64	NewGapLen, NewMemLen;
     char *	NewMemP;
     char *	NewGapStartP;
+    Int64	Moved = 0;			// For STATS, ED_SLIDEDOWN adds to it
 
     if (Len < 0) Len = 0;
+    if ((BufP->Flags & ED_BUFLOADINGFLAG) && (Len || (BufP->BufStartP + Offset != BufP->GapStartP)))
+	ED_LoadWait(BufP);
+    if ((BufP->Flags & ED_BUFPASTINGFLAG) && ED_XRecv.Started) ED_XRecvSpill();	// Paste staged in Gap
 
     OldGapLen = BufP->GapEndP - BufP->GapStartP;    
     if (OldGapLen < Len) { // Expand Gap
-	NewGapLen = Len + ED_GAPEXTRAEXPAND;
+	NewGapLen = BufP->LastPos / ED_GAPGROWDIV;
+	if (NewGapLen > ED_GAPGROWMAX) NewGapLen = ED_GAPGROWMAX;
+	NewGapLen += Len + ED_GAPEXTRAEXPAND;
 	NewMemLen = (BufP->BufEndP - BufP->BufStartP) + (NewGapLen - OldGapLen);
 
-	NewMemP = realloc(BufP->BufStartP, NewMemLen);
-	if (NewMemP == NULL) G_SETEXCEPTION("Could not realloc Buf", NewMemLen);
+	// Mapped Buf can grow in place, into the reserved space.  Otherwise, copy
+	// it all out into malloc memory first, so it can be realloced.
+	if ((BufP->Flags & ED_BUFMAPPEDFLAG) && (NewMemLen <= BufP->MapLen))
+	    NewMemP = BufP->BufStartP;
+	else {
+	    if (BufP->Flags & ED_BUFMAPPEDFLAG) ED_BufferUnmap(BufP);
+	    NewMemP = realloc(BufP->BufStartP, NewMemLen);
+	}
+	if (NewMemP == NULL) G_SETEXCEPTION_L("Could not realloc Buf", NewMemLen);
 	
 	// If the block moved, transpose pointers to new locations--adjust BufEndP later.
 	if (NewMemP != BufP->BufStartP) {
@@ -6485,6 +9109,7 @@ void	ED_BufferPlaceGap(ED_BufferPointer BufP, Int32 Offset, Int32 Len)
 	    BufP->GapEndP = NewGapStartP + OldGapLen;
 	}
     }
+    if (Moved) ED_StatsHistAdd(ED_GapHistId, Moved);
 	    
 #ifdef DEBUG    
     // TEST_FillGap(BufP);
@@ -6537,7 +9162,7 @@ Int16	ED_BufferCIsAlpha(register char C)
 //
 // NOTE:	The Gap will *NEVER* straddle a UTF8 multi-byte sequence.
 
-char *	ED_BufferPosToPtr(ED_BufferPointer BufP, Int32 Pos)
+char *	ED_BufferPosToPtr(ED_BufferPointer BufP, Int64 Pos)
 {
     char	*P;
 
@@ -6563,10 +9188,11 @@ char *	ED_BufferPosToPtr(ED_BufferPointer BufP, Int32 Pos)
 // NOTE:	Legacy function, can be replaced by call tp ED_PaneFindPos.
 //		More runtime processing, but less code.
 
-Int32	ED_BufferGetPosPlusRows(ED_BufferPointer BufP, Int32 Pos, Int32 *RowsP, Int32 ColLimit)
+Int64	ED_BufferGetPosPlusRows(ED_BufferPointer BufP, Int64 Pos, Int64 *RowsP, Int32 ColLimit)
 {
-    char		*EndP, *CurP;
-    Int32		CurRow, CurCol;
+    char		*EndP, *CurP, *StopP;
+    Int64		CurRow;
+    Int32		CurCol;
     Int16		L;
 
     CurP = ED_BufferPosToPtr(BufP, Pos);
@@ -6581,6 +9207,15 @@ DoRest:
 	    return Pos;
 	}
 
+	if (CurCol < ColLimit) {		// Skip plain ASCII, up to the wrap
+	    StopP = (EndP - CurP > ColLimit - CurCol) ? CurP + (ColLimit - CurCol) : EndP;
+	    StopP = ED_UtilScanPlain(CurP, StopP);
+	    CurCol += StopP - CurP;
+	    Pos += StopP - CurP;
+	    CurP = StopP;
+	    if (CurP == EndP) continue;
+	}
+
 	CurCol++;
 	if (*CurP == '\n')			// Hit \n, New row AFTER it
 	    CurRow++, CurCol = 0;
@@ -6627,10 +9262,10 @@ DoRest:
 // NOTE:	Legacy function, can be replaced by call to ED_PaneFindPos for less code
 //		but more runtime processing.
 
-Int32	ED_BufferGetPosMinusRows(ED_BufferPointer BufP, Int32 Pos, Int32 *RowsP, Int32 ColLimit)
+Int64	ED_BufferGetPosMinusRows(ED_BufferPointer BufP, Int64 Pos, Int64 *RowsP, Int32 ColLimit)
 {
     char	*EndP, *CurP;
-    Int32	RowCount, ColCount;
+    Int64	RowCount, ColCount;
     Int16	Loop;
 
     if (*RowsP == 0) return Pos;			// Will do nothing
@@ -6690,7 +9325,7 @@ DoRest:
     }
 
     if (RowCount > *RowsP) {				// Gone too far, so move forward!
-	Int32	Count = (RowCount - *RowsP) * ColLimit; // Get the extra rows back
+	Int64	Count = (RowCount - *RowsP) * ColLimit; // Get the extra rows back
 							// DOES NOT work for *RowsP == 0 !!
 	RowCount = *RowsP;
 	while (Count--) {
@@ -6710,10 +9345,11 @@ DoRest:
 //
 // Return value is strlen of StrP.
 
-Int32	ED_BufferFillStr(ED_BufferPointer BufP, char * StrP, Int32 StartPos, Int32 MaxLen, Int16 NoNL)
+Int32	ED_BufferFillStr(ED_BufferPointer BufP, char * StrP, Int64 StartPos, Int32 MaxLen, Int16 NoNL)
 {
     char	*CurP, *DP;
-    Int32	CurPos, Len, L;
+    Int32	Len, L;
+    Int64	CurPos;
 
     CurPos = StartPos;
     DP = StrP;
@@ -6746,9 +9382,10 @@ Int32	ED_BufferFillStr(ED_BufferPointer BufP, char * StrP, Int32 StartPos, Int32
 // a Pos (Marks, etc.) that we locate on a given (Col,Row).  *BUT* BufferGetPos+/-Row
 // functions really only work when the Pos begins a Row--NOT mid-span.
 
-Int32	ED_BufferGetRowStartPos(ED_BufferPointer BufP, Int32 OldPos, Int32 Col)
+Int64	ED_BufferGetRowStartPos(ED_BufferPointer BufP, Int64 OldPos, Int32 Col)
 {
-    Int32	I, CurPos;
+    Int32	I;
+    Int64	CurPos;
     char	*CurP;
 
     I = Col;
@@ -6765,9 +9402,9 @@ Int32	ED_BufferGetRowStartPos(ED_BufferPointer BufP, Int32 OldPos, Int32 Col)
 // ED_BufferGetLineStartPos returns the Pos for the hard start of the line,
 // regardless of how many times (if any) it wraps around.
 
-Int32	ED_BufferGetLineStartPos(ED_BufferPointer BufP, Int32 OldPos)
+Int64	ED_BufferGetLineStartPos(ED_BufferPointer BufP, Int64 OldPos)
 {
-    Int32	CurPos;
+    Int64	CurPos;
     char	*CurP;
 
     if (OldPos == 0) return 0;
@@ -6786,9 +9423,9 @@ Int32	ED_BufferGetLineStartPos(ED_BufferPointer BufP, Int32 OldPos)
 // ED_BufferGetLineEndPos finds the Pos for the \n at the end of the Line,
 // regardless of any wrap-arounds for long lines.
 
-Int32	ED_BufferGetLineEndPos(ED_BufferPointer BufP, Int32 OldPos)
+Int64	ED_BufferGetLineEndPos(ED_BufferPointer BufP, Int64 OldPos)
 {
-    Int32	CurPos;
+    Int64	CurPos;
     char	*CurP;
 
     if (OldPos == BufP->LastPos) return BufP->LastPos;
@@ -6810,10 +9447,11 @@ Int32	ED_BufferGetLineEndPos(ED_BufferPointer BufP, Int32 OldPos)
 //
 // NOTE:	DOES NOT count final \n.
 
-Int32	ED_BufferGetLineLen(ED_BufferPointer BufP, Int32 Pos, Int16 BeforeToo)
+Int64	ED_BufferGetLineLen(ED_BufferPointer BufP, Int64 Pos, Int16 BeforeToo)
 {
     char	*CurP;
-    Int32	CurPos, Count;
+    Int32	Count;
+    Int64	CurPos;
 
     Count = 0;
 
@@ -6859,11 +9497,12 @@ Int32	ED_BufferGetLineLen(ED_BufferPointer BufP, Int32 Pos, Int16 BeforeToo)
 //		to check against BufP->LastPos, as it would fall on BufEndP or
 //		GapStartP (if the Gap was at the end).
 
-void		ED_BufferGetLineCount(ED_BufferPointer BufP, Int32 *PosP, Int32 *CountP)
+void		ED_BufferGetLineCount(ED_BufferPointer BufP, Int64 *PosP, Int64 *CountP)
 {
-    char	*CurP, *EndP;
+    char	*CurP, *EndP, *NLP;
     Int16	LoopAgain;
-    Int32	CurPos, LineCount;
+    Int32	LineCount;
+    Int64	CurPos;
 
     if (*CountP <= 0) *CountP = 0x7FFFFFFF;
 
@@ -6880,16 +9519,16 @@ void		ED_BufferGetLineCount(ED_BufferPointer BufP, Int32 *PosP, Int32 *CountP)
 
 DoRest:
 
-    while (CurP < EndP) {
-	if (*CurP == '\n') {
-	    LineCount += 1;
-	    if (LineCount == *CountP) {
-		*PosP = CurPos;
-		return;
-	    }
-        }
-	CurP++, CurPos++;
+    while ((CurP < EndP) && (NLP = memchr(CurP, '\n', EndP - CurP))) {
+	CurPos += NLP - CurP;
+	LineCount += 1;
+	if (LineCount == *CountP) {
+	    *PosP = CurPos;
+	    return;
+	}
+	CurP = NLP + 1, CurPos++;
     }
+    CurPos += EndP - CurP;
 
     if (LoopAgain) {
 	LoopAgain = 0;
@@ -6904,8 +9543,939 @@ DoRest:
 }
 
 // ******************************************************************************
-// ED_BufferCheckNameCol checks to see if any other Buffers have the same
-// FileName.  If so, it sets the BUFNAMECOLFLAG so the ModeLine in the Pane
+// LineIdx -- Line Index.
+//
+// Keeping track of Line numbers by counting Newline chars from Pos 0 is fine
+// for small files, but it is O(N) for every GotoLine or CursorInfo, and gets
+// painful as files get into the multi-MB range.  So each Buffer keeps a sparse
+// array of checkpoints, each recording the Pos of the first char of a Line and
+// the (0-based) Line number.  Entry [0] is always (0, 0), and the entries are
+// sorted by both Pos and Line.
+//
+// The array is allocated lazily, on the first lookup, and is extended lazily--
+// any lookup walking more than ED_LIDXSTEP lines past a checkpoint will leave
+// a new checkpoint behind.  So the first GotoLine to the end of a big file does
+// a full scan, the rest only scan from the nearest checkpoint.
+//
+// Every real edit goes through ED_BufferAddUndoBlock, which calls
+// ED_BufferLIdxUpdate with the added or deleted text, so checkpoints can be
+// adjusted arithmetically without ever re-scanning the buffer:
+//
+//	ADD Len chars at Pos:	Checkpoints AFTER Pos shift by (+Len, +NLCount).
+//	DEL [Pos, Pos+Len):	Checkpoints in (Pos, Pos+Len] are now invalid
+//				(their preceding Newline is gone), so drop them.
+//				Checkpoints after shift by (-Len, -NLCount).
+//
+// A checkpoint AT Pos is unaffected either way, as the char before it did not
+// change.  Edits that bypass the Undo system (ED_BufferReadFile,
+// ED_BufferDoFilter) must call ED_BufferLIdxReset or ED_BufferLIdxUpdate
+// themselves.
+
+// ******************************************************************************
+// ED_AuxCountNL returns the number of Newline chars in the contiguous run
+// of Len bytes starting at DataP.
+
+Int64	ED_AuxCountNL(char * DataP, Int64 Len)
+{
+    char	*EndP = DataP + Len;
+    Int32	Count = 0;
+
+    while ((DataP < EndP) && (DataP = memchr(DataP, '\n', EndP - DataP))) {
+	Count++;
+	DataP++;
+    }
+
+    return Count;
+}
+
+// ******************************************************************************
+// ED_BufferFindNextNL returns the Pos of the first Newline at or after Pos
+// and before EndPos.  Returns -1 if there is none.  Uses memchr on the two
+// sides of the Gap, rather than a char-by-char loop.
+
+Int64	ED_BufferFindNextNL(ED_BufferPointer BufP, Int64 Pos, Int64 EndPos)
+{
+    Int64	GapPos = BufP->GapStartP - BufP->BufStartP;
+    Int64	GapLen = BufP->GapEndP - BufP->GapStartP;
+    char	*CurP;
+
+    if (Pos >= EndPos) return -1;
+
+    if (Pos < GapPos) {
+	CurP = memchr(BufP->BufStartP + Pos, '\n', ((EndPos < GapPos) ? EndPos : GapPos) - Pos);
+	if (CurP) return CurP - BufP->BufStartP;
+	Pos = GapPos;
+    }
+
+    if (Pos < EndPos) {
+	CurP = memchr(BufP->BufStartP + Pos + GapLen, '\n', EndPos - Pos);
+	if (CurP) return CurP - BufP->BufStartP - GapLen;
+    }
+
+    return -1;
+}
+
+// ******************************************************************************
+// ED_BufferLIdxInit allocates the LineIdx array with its (0, 0) entry.
+
+void	ED_BufferLIdxInit(ED_BufferPointer BufP)
+{
+    BufP->LIdxArrP = malloc(ED_LIDXINITCOUNT * sizeof(ED_LIdxRecord));
+    if (! BufP->LIdxArrP) G_SETEXCEPTION("Malloc LineIdx Failed", 0);
+    BufP->LIdxMax = ED_LIDXINITCOUNT;
+    BufP->LIdxCount = 1;
+    BufP->LIdxArrP[0].Pos = 0;
+    BufP->LIdxArrP[0].Line = 0;
+}
+
+// ******************************************************************************
+// ED_BufferLIdxKill frees the LineIdx array, called when Buffer is killed.
+
+void	ED_BufferLIdxKill(ED_BufferPointer BufP)
+{
+    if (BufP->LIdxArrP) free(BufP->LIdxArrP);
+    BufP->LIdxArrP = NULL;
+    BufP->LIdxCount = BufP->LIdxMax = 0;
+}
+
+// ******************************************************************************
+// ED_BufferLIdxReset discards all checkpoints (except [0]), called when the
+// whole Buffer content is replaced without going through the Undo system.
+
+void	ED_BufferLIdxReset(ED_BufferPointer BufP)
+{
+    if (BufP->LIdxArrP) BufP->LIdxCount = 1;
+}
+
+// ******************************************************************************
+// ED_BufferLIdxInsert inserts a new checkpoint at Index, moving the rest up.
+
+void	ED_BufferLIdxInsert(ED_BufferPointer BufP, Int32 Index, Int64 Pos, Int64 Line)
+{
+    ED_LIdxPointer	LP;
+
+    if (BufP->LIdxCount == BufP->LIdxMax) {
+	LP = realloc(BufP->LIdxArrP, 2 * BufP->LIdxMax * sizeof(ED_LIdxRecord));
+	if (! LP) G_SETEXCEPTION("Realloc LineIdx Failed", BufP->LIdxMax);
+	BufP->LIdxArrP = LP;
+	BufP->LIdxMax *= 2;
+    }
+
+    LP = BufP->LIdxArrP + Index;
+    if (Index < BufP->LIdxCount)
+	memmove(LP + 1, LP, (BufP->LIdxCount - Index) * sizeof(ED_LIdxRecord));
+    LP->Pos = Pos;
+    LP->Line = Line;
+    BufP->LIdxCount += 1;
+}
+
+// ******************************************************************************
+// ED_BufferLIdxUpdate is called for each edit, Delta > 0 for ADD and < 0 for
+// DEL.  DataP points to the added (or deleted) text, contiguous, -Delta or
+// Delta bytes long.  Does nothing if the LineIdx was never used.
+
+void	ED_BufferLIdxUpdate(ED_BufferPointer BufP, Int64 Pos, Int64 Delta, char * DataP)
+{
+    ED_LIdxPointer	LP, EndLP, DestLP;
+    Int64		Len, NLCount;
+
+    if ((BufP->LIdxArrP == NULL) || (Delta == 0)) return;
+
+    Len = (Delta < 0) ? -Delta : Delta;
+    NLCount = ED_AuxCountNL(DataP, Len);
+
+    // [0] is (0, 0) and never moves, nothing can be added/deleted before Pos 0.
+    LP = BufP->LIdxArrP + 1;
+    EndLP = BufP->LIdxArrP + BufP->LIdxCount;
+    while ((LP < EndLP) && (LP->Pos <= Pos)) LP++;
+
+    if (Delta > 0) {
+	for (; LP < EndLP; LP++) {
+	    LP->Pos += Len;
+	    LP->Line += NLCount;
+	}
+    } else {
+	DestLP = LP;
+	while ((LP < EndLP) && (LP->Pos <= Pos + Len)) LP++;
+	for (; LP < EndLP; LP++, DestLP++) {
+	    DestLP->Pos = LP->Pos - Len;
+	    DestLP->Line = LP->Line - NLCount;
+	}
+	BufP->LIdxCount = DestLP - BufP->LIdxArrP;
+    }
+}
+
+// ******************************************************************************
+// ED_BufferLIdxFind returns the Index of the last checkpoint at or before the
+// given Pos (ByLine == 0) or Line (ByLine == 1).  Allocates the array if needed.
+
+Int32	ED_BufferLIdxFind(ED_BufferPointer BufP, Int64 Value, Int16 ByLine)
+{
+    ED_LIdxPointer	LP;
+    Int32		Low, High, Mid;
+
+    if (BufP->LIdxArrP == NULL) ED_BufferLIdxInit(BufP);
+
+    LP = BufP->LIdxArrP;
+    Low = 0;
+    High = BufP->LIdxCount - 1;
+    while (Low < High) {
+	Mid = (Low + High + 1) / 2;
+	if ((ByLine ? LP[Mid].Line : LP[Mid].Pos) <= Value)
+	    Low = Mid;
+	else
+	    High = Mid - 1;
+    }
+
+    return Low;
+}
+
+// ******************************************************************************
+// ED_BufferPosToLine returns the 0-based Line number containing Pos.  Leaves
+// new checkpoints behind every ED_LIDXSTEP lines it has to walk.
+
+Int64	ED_BufferPosToLine(ED_BufferPointer BufP, Int64 Pos)
+{
+    ED_PoolChunkPointer	CP;
+    Int32	Index, I;
+    Int64	Line, CPLine, CurPos, NLPos;
+
+    if (Pos > BufP->LastPos) Pos = BufP->LastPos;
+
+    Index = ED_BufferLIdxFind(BufP, Pos, 0);
+    CurPos = BufP->LIdxArrP[Index].Pos;
+    CPLine = Line = BufP->LIdxArrP[Index].Line;
+
+    // Far from a checkpoint, count on the scan pool, a checkpoint per chunk.
+    if (ED_PoolWanted(Pos - CurPos)) {
+	ED_PoolRun(BufP, CurPos, Pos, EDCB_PoolCountNL, ED_POOLALL);
+	for (I = 0, CP = ED_PoolArr; I < ED_PoolCount; I++, CP++) {
+	    if (CP->Count == 0) continue;
+	    Line += CP->Count;
+	    if (Line - CPLine >= ED_LIDXSTEP) {
+		ED_BufferLIdxInsert(BufP, ++Index, CP->LastNL + 1, Line);
+		CPLine = Line;
+	    }
+	}
+	return Line;
+    }
+
+    while ((NLPos = ED_BufferFindNextNL(BufP, CurPos, Pos)) >= 0) {
+	CurPos = NLPos + 1;
+	Line += 1;
+	if (Line - CPLine >= ED_LIDXSTEP) {
+	    ED_BufferLIdxInsert(BufP, ++Index, CurPos, Line);
+	    CPLine = Line;
+	}
+    }
+
+    return Line;
+}
+
+// ******************************************************************************
+// ED_BufferLineToPos returns the Pos of the first char of the given 0-based
+// Line.  Returns LastPos if Buffer has fewer lines.  Leaves new checkpoints
+// behind every ED_LIDXSTEP lines it has to walk.
+//
+// NOTE:	A far Line is not known to be in reach, so the scan pool counts
+//		a window that doubles each round, until the chunk with Line.
+
+Int64	ED_BufferLineToPos(ED_BufferPointer BufP, Int64 Line)
+{
+    ED_PoolChunkPointer	CP;
+    Int32	Index, I;
+    Int64	CurLine, CPLine, CurPos, NLPos, Window, ScanPos, EndPos;
+
+    if (Line <= 0) return 0;
+
+    Index = ED_BufferLIdxFind(BufP, Line, 1);
+    CurPos = BufP->LIdxArrP[Index].Pos;
+    CPLine = CurLine = BufP->LIdxArrP[Index].Line;
+
+    Window = ED_POOLMINLEN;
+    ScanPos = CurPos;
+    while ((Line - CurLine >= ED_POOLMINLINES) && ED_PoolWanted(BufP->LastPos - ScanPos)) {
+	EndPos = (BufP->LastPos - ScanPos > Window) ? ScanPos + Window : BufP->LastPos;
+	ED_PoolRun(BufP, ScanPos, EndPos, EDCB_PoolCountNL, ED_POOLALL);
+	for (I = 0, CP = ED_PoolArr; I < ED_PoolCount; I++, CP++) {
+	    if (CurLine + CP->Count >= Line) break;	// Line starts in this chunk
+	    if (CP->Count == 0) continue;
+	    CurLine += CP->Count;
+	    CurPos = CP->LastNL + 1;
+	    if (CurLine - CPLine >= ED_LIDXSTEP) {
+		ED_BufferLIdxInsert(BufP, ++Index, CurPos, CurLine);
+		CPLine = CurLine;
+	    }
+	}
+	if ((I < ED_PoolCount) || (EndPos == BufP->LastPos)) break;
+	ScanPos = EndPos;
+	Window *= 2;
+    }
+
+    while (CurLine < Line) {
+	NLPos = ED_BufferFindNextNL(BufP, CurPos, BufP->LastPos);
+	if (NLPos < 0) return BufP->LastPos;
+	CurPos = NLPos + 1;
+	CurLine += 1;
+	if (CurLine - CPLine >= ED_LIDXSTEP) {
+	    ED_BufferLIdxInsert(BufP, ++Index, CurPos, CurLine);
+	    CPLine = CurLine;
+	}
+    }
+
+    return CurPos;
+}
+
+// ******************************************************************************
+// RowIdx -- Row Index.
+//
+// Like the LineIdx, but for visual Rows (with line wrap), which is what
+// ED_PaneFindLoc deals with.  Every BufRowCount and StartRowCount is computed by
+// walking (through the wrap logic) from Pos 0 or PanePos... to LastPos!  So a
+// plain keystroke in a big file ends up scanning the rest of the file.
+//
+// Rows depend on the width of the Frame (RowChars), so there is a RowIdx for
+// each of the last ED_RIDXWIDTHS widths used on the Buffer, the least
+// recently used one is recycled.  Each one is a sorted array of (Pos, Row)
+// checkpoints, always at the start of a LINE (after a Newline), as wrapping is
+// line-local and a walk starting at a line start is the same as a walk from
+// Pos 0 that got there.  ED_PaneFindLoc starts from the nearest checkpoint,
+// and leaves new ones behind every ED_RIDXSTEP rows as it goes.
+//
+// Edits cannot be applied arithmetically (don't know how the edited line will
+// re-wrap), so each RowIdx keeps a Dirty range instead:
+//
+//	Checkpoints <= DirtyStart	Still valid.
+//	Checkpoints in the range	Dropped, when resolved.
+//	Checkpoints > DirtyEnd		Pos is shifted right away by the edit,
+//					Row is off by the same (unknown) Delta.
+//
+// The range is resolved lazily, on the next use, by re-counting the rows from
+// the checkpoint before DirtyStart to the first checkpoint after DirtyEnd--the
+// difference gives Delta for all the rest.  So only the edited lines are
+// re-scanned.
+//
+// A resize leaves the new width with no checkpoints, and counting the whole
+// Buffer there and then is what made dragging the Frame edge stutter.  Instead
+// ED_BufferRIdxReflow samples the Buffer for an estimate (EstRows per EstBytes)
+// and ED_PaneFindLoc jumps with it over anything more than ED_REFLOWNEAR past
+// the last checkpoint, so the visible Rows are wrapped and drawn right away.
+// The idle handler then extends the checkpoints, ED_REFLOWCHUNK at a time, and
+// the estimated StartRowCount/BufRowCount are replaced as it passes them.
+
+// ******************************************************************************
+// ED_AuxRIdxCountRows counts the Rows from StartPos to EndPos, both MUST be
+// at the start of a line.  Wrap logic ***MUST*** match ED_PaneFindLoc.
+
+Int64	ED_AuxRIdxCountRows(ED_BufferPointer BufP, Int32 ColLimit, Int64 StartPos, Int64 EndPos)
+{
+    char	*CurP, *EndP, *StopP;
+    Int32	CurCol;
+    Int64	CurRow, GapPos;
+    Int16	Pass;
+
+    CurRow = CurCol = 0;
+    GapPos = BufP->GapStartP - BufP->BufStartP;
+
+    // Before the Gap, then after the Gap.
+    for (Pass = 0; Pass < 2; Pass++) {
+	if (Pass == 0) {
+	    if (StartPos >= GapPos) continue;
+	    CurP = BufP->BufStartP + StartPos;
+	    EndP = BufP->BufStartP + ((EndPos < GapPos) ? EndPos : GapPos);
+	} else {
+	    if (EndPos <= GapPos) break;
+	    CurP = ED_BufferPosToPtr(BufP, (StartPos > GapPos) ? StartPos : GapPos);
+	    EndP = BufP->GapEndP + (EndPos - GapPos);
+	}
+
+	while (CurP < EndP) {
+	    if (CurCol < ColLimit) {		// Skip plain ASCII, up to the wrap
+		StopP = (EndP - CurP > ColLimit - CurCol) ? CurP + (ColLimit - CurCol) : EndP;
+		StopP = ED_UtilScanPlain(CurP, StopP);
+		CurCol += StopP - CurP;
+		CurP = StopP;
+		if (CurP == EndP) continue;
+	    }
+
+	    CurCol++;				// CurCol is **1-Based**
+	    if (*CurP == '\n')
+		CurRow++, CurCol = 0;
+	    if (CurCol > ColLimit)
+		CurRow++, CurCol = 1;
+
+	    CurP += ED_BufferGetUTF8Len(*CurP);
+	}
+    }
+
+    return CurRow;
+}
+
+// ******************************************************************************
+// ED_AuxRIdxFind returns the Index of the last checkpoint at or before Pos.
+
+Int32	ED_AuxRIdxFind(ED_RIdxWidthPointer WP, Int64 Pos)
+{
+    Int32	Low, High, Mid;
+
+    Low = 0;
+    High = WP->Count - 1;
+    while (Low < High) {
+	Mid = (Low + High + 1) / 2;
+	if (WP->ArrP[Mid].Pos <= Pos)
+	    Low = Mid;
+	else
+	    High = Mid - 1;
+    }
+
+    return Low;
+}
+
+// ******************************************************************************
+// ED_AuxRIdxInsert inserts a new checkpoint at Index, moving the rest up.
+
+void	ED_AuxRIdxInsert(ED_RIdxWidthPointer WP, Int32 Index, Int64 Pos, Int64 Row)
+{
+    ED_RIdxPointer	RP;
+
+    if (WP->Count == WP->Max) {
+	RP = realloc(WP->ArrP, 2 * WP->Max * sizeof(ED_RIdxRecord));
+	if (! RP) G_SETEXCEPTION("Realloc RowIdx Failed", WP->Max);
+	WP->ArrP = RP;
+	WP->Max *= 2;
+    }
+
+    RP = WP->ArrP + Index;
+    if (Index < WP->Count)
+	memmove(RP + 1, RP, (WP->Count - Index) * sizeof(ED_RIdxRecord));
+    RP->Pos = Pos;
+    RP->Row = Row;
+    WP->Count += 1;
+}
+
+// ******************************************************************************
+// ED_AuxRIdxResolve re-counts the Dirty range, drops the checkpoints in it,
+// and fixes the Row for all those after it.
+
+void	ED_AuxRIdxResolve(ED_BufferPointer BufP, ED_RIdxWidthPointer WP)
+{
+    ED_RIdxPointer	RP = WP->ArrP;
+    Int32		First, Last, I;
+    Int64		Delta;
+
+    if (WP->DirtyStart < 0) return;
+
+    First = ED_AuxRIdxFind(WP, WP->DirtyStart);
+    Last = First + 1;
+    while ((Last < WP->Count) && (RP[Last].Pos <= WP->DirtyEnd)) Last++;
+
+    if (Last < WP->Count) {
+	Delta = RP[First].Row + ED_AuxRIdxCountRows(BufP, WP->RowChars, RP[First].Pos, RP[Last].Pos) - RP[Last].Row;
+	for (I = Last; I < WP->Count; I++) {
+	    RP[I - Last + First + 1].Pos = RP[I].Pos;
+	    RP[I - Last + First + 1].Row = RP[I].Row + Delta;
+	}
+	WP->Count -= Last - (First + 1);
+    } else
+	WP->Count = First + 1;
+
+    WP->DirtyStart = WP->DirtyEnd = -1;
+}
+
+// ******************************************************************************
+// ED_BufferRIdxGet returns the (resolved) RowIdx for RowChars, recycling the
+// least recently used one if needed.
+
+ED_RIdxWidthPointer	ED_BufferRIdxGet(ED_BufferPointer BufP, Int32 RowChars)
+{
+    ED_RIdxWidthPointer	WP, UseWP;
+    Int16		I;
+
+    UseWP = WP = BufP->RIdxWidthArr;
+    for (I = 0; I < ED_RIDXWIDTHS; I++, WP++) {
+	if (WP->RowChars == RowChars) {
+	    UseWP = WP;
+	    goto Found;
+	}
+	if (WP->LastUse < UseWP->LastUse) UseWP = WP;
+    }
+
+    // Not found, recycle UseWP
+    if (UseWP->ArrP == NULL) {
+	UseWP->ArrP = malloc(ED_RIDXINITCOUNT * sizeof(ED_RIdxRecord));
+	if (! UseWP->ArrP) G_SETEXCEPTION("Malloc RowIdx Failed", 0);
+	UseWP->Max = ED_RIDXINITCOUNT;
+    }
+    UseWP->RowChars = RowChars;
+    UseWP->Count = 1;
+    UseWP->ArrP[0].Pos = UseWP->ArrP[0].Row = 0;
+    UseWP->DirtyStart = UseWP->DirtyEnd = -1;
+    UseWP->EstBytes = UseWP->EstRows = 0;
+
+Found:
+    UseWP->LastUse = ++ED_RIdxUseCount;
+    ED_AuxRIdxResolve(BufP, UseWP);
+    return UseWP;
+}
+
+// ******************************************************************************
+// ED_BufferRIdxUpdate is called for each edit, Delta > 0 for ADD and < 0 for DEL.
+// Shifts the checkpoints after the edit and extends the Dirty range.
+
+void	ED_BufferRIdxUpdate(ED_BufferPointer BufP, Int64 Pos, Int64 Delta)
+{
+    ED_RIdxWidthPointer	WP = BufP->RIdxWidthArr;
+    ED_RIdxPointer	RP, EndRP, DestRP;
+    Int64		Len;
+    Int16		I;
+
+    if (Delta == 0) return;
+    Len = (Delta < 0) ? -Delta : Delta;
+
+    for (I = 0; I < ED_RIDXWIDTHS; I++, WP++) {
+	if (WP->RowChars == 0) continue;
+
+	RP = WP->ArrP + ED_AuxRIdxFind(WP, Pos) + 1;
+	EndRP = WP->ArrP + WP->Count;
+	if (Delta > 0) {
+	    for (; RP < EndRP; RP++) RP->Pos += Len;
+	    
+	    if (WP->DirtyStart < 0) {
+		WP->DirtyStart = Pos;
+		WP->DirtyEnd = Pos + Len;
+	    } else {
+		if (Pos < WP->DirtyStart) WP->DirtyStart = Pos;
+		WP->DirtyEnd = (WP->DirtyEnd >= Pos) ? WP->DirtyEnd + Len : Pos + Len;
+	    }
+	} else {
+	    // Those in (Pos, Pos+Len] have lost their Newline, drop them now.
+	    DestRP = RP;
+	    while ((RP < EndRP) && (RP->Pos <= Pos + Len)) RP++;
+	    for (; RP < EndRP; RP++, DestRP++) {
+		DestRP->Pos = RP->Pos - Len;
+		DestRP->Row = RP->Row;
+	    }
+	    WP->Count = DestRP - WP->ArrP;
+
+	    if (WP->DirtyStart < 0) {
+		WP->DirtyStart = WP->DirtyEnd = Pos;
+	    } else {
+		if (Pos < WP->DirtyStart) WP->DirtyStart = Pos;
+		WP->DirtyEnd = (WP->DirtyEnd > Pos + Len) ? WP->DirtyEnd - Len : Pos;
+	    }
+	}
+    }
+}
+
+// ******************************************************************************
+// ED_BufferRIdxReflow starts estimating the Rows for WP, unless the checkpoints
+// already come close enough to the end.  Samples are spread evenly past the last
+// checkpoint, each one starting and ending on a line start.
+
+void	ED_BufferRIdxReflow(ED_BufferPointer BufP, ED_RIdxWidthPointer WP)
+{
+    Int64	LastCPPos, Step, Pos, End;
+    Int64	Bytes = 0, Rows = 0;
+    Int16	I;
+
+    LastCPPos = WP->ArrP[WP->Count - 1].Pos;
+    if (WP->EstBytes || (BufP->LastPos - LastCPPos <= ED_REFLOWNEAR)) return;
+
+    Step = (BufP->LastPos - LastCPPos) / ED_REFLOWSAMPLES;
+    for (I = 0; I < ED_REFLOWSAMPLES; I++) {
+	Pos = ED_BufferFindNextNL(BufP, LastCPPos + (I * Step), BufP->LastPos);
+	if (Pos < 0) break;
+	End = ED_BufferFindNextNL(BufP, Pos + 1 + ED_REFLOWSAMPLELEN, BufP->LastPos);
+	if (End < 0) break;
+
+	Rows += ED_AuxRIdxCountRows(BufP, WP->RowChars, Pos + 1, End + 1);
+	Bytes += End - Pos;
+    }
+
+    if (Bytes == 0) Bytes = WP->RowChars, Rows = 1;	// No whole lines, all full Rows
+    WP->EstBytes = Bytes;
+    WP->EstRows = Rows;
+}
+
+// ED_BufferRIdxReflowStep counts the next ED_REFLOWCHUNK (or so, up to a line
+// start) past the last checkpoint and leaves a checkpoint there.  Returns 1 when
+// there is no line start left, WP is exact to the end.
+
+Int16	ED_BufferRIdxReflowStep(ED_BufferPointer BufP, ED_RIdxWidthPointer WP)
+{
+    ED_RIdxPointer	RP = WP->ArrP + WP->Count - 1;
+    Int64		Pos, Row;
+
+    Pos = ED_BufferFindNextNL(BufP, RP->Pos + ED_REFLOWCHUNK, BufP->LastPos);
+    if (Pos < 0) {
+	WP->EstBytes = WP->EstRows = 0;
+	return 1;
+    }
+
+    Row = RP->Row + ED_AuxRIdxCountRows(BufP, WP->RowChars, RP->Pos, Pos + 1);
+    ED_AuxRIdxInsert(WP, WP->Count, Pos + 1, Row);
+    return 0;
+}
+
+// Estimated Rows in Len bytes, in two parts so it cannot overflow.
+Int64	ED_AuxRIdxEstRows(ED_RIdxWidthPointer WP, Int64 Len)
+{
+    return ((Len / WP->EstBytes) * WP->EstRows) + (((Len % WP->EstBytes) * WP->EstRows) / WP->EstBytes);
+}
+
+// ******************************************************************************
+// ED_BufferRIdxReset discards all checkpoints, called when the whole Buffer
+// content is replaced without going through the Undo system.
+
+void	ED_BufferRIdxReset(ED_BufferPointer BufP)
+{
+    ED_RIdxWidthPointer	WP = BufP->RIdxWidthArr;
+    Int16		I;
+
+    for (I = 0; I < ED_RIDXWIDTHS; I++, WP++) {
+	if (WP->ArrP) WP->Count = 1;
+	WP->DirtyStart = WP->DirtyEnd = -1;
+	WP->EstBytes = WP->EstRows = 0;
+    }
+}
+
+// ******************************************************************************
+// ED_BufferRIdxKill frees all the RowIdx arrays, called when Buffer is killed.
+
+void	ED_BufferRIdxKill(ED_BufferPointer BufP)
+{
+    ED_RIdxWidthPointer	WP = BufP->RIdxWidthArr;
+    Int16		I;
+
+    for (I = 0; I < ED_RIDXWIDTHS; I++, WP++) {
+	if (WP->ArrP) free(WP->ArrP);
+	WP->ArrP = NULL;
+	WP->RowChars = WP->Count = WP->Max = WP->LastUse = 0;
+	WP->DirtyStart = WP->DirtyEnd = -1;
+	WP->EstBytes = WP->EstRows = 0;
+    }
+}
+
+// ******************************************************************************
+// ParenIdx -- Paren Index.
+//
+// ED_PaneShowOpenParen looks back from a typed Close paren for its Open.  A short
+// scan (ED_PIDXNEAR bytes) finds almost all of them, but in big generated files
+// (JSON dumps, minified code) the Open can be megabytes back.  So, the first time
+// a match is not near, the Buffer gets a sparse array of checkpoints, every
+// ED_PIDXSTEP bytes.  Each records, for each of the 3 kinds ( [ { ...
+//
+//	DepthArr	Opens minus Closes of that kind before Pos.
+//	MinArr		Lowest depth reached in the segment up to the next checkpoint.
+//
+// Depth before the Close at ParenPos is D, so its Open is the last Pos before it
+// where depth was down to D - 1.  Only a segment with (MinArr <= D - 1) can hold
+// it, so whole segments are skipped and only 2 segments are actually scanned.
+//
+// Like the LineIdx, the array is only counted as far as it was needed (PIdxEndPos)
+// and ED_BufferAddUndoBlock calls ED_BufferPIdxUpdate for every edit:
+//
+//	ADD Len chars at Pos:	Checkpoints AFTER Pos shift by (+Len, +Depth of text),
+//				both DepthArr and MinArr.
+//	DEL [Pos, Pos+Len):	Checkpoints in (Pos, Pos+Len] are dropped, the ones
+//				after shift by (-Len, -Depth of text).
+//
+// Only the segment holding Pos changes inside, so it is marked Dirty and counted
+// again (and split, if a paste made it long) when a lookup needs its MinArr.
+//
+// NOTE:	Parens are ASCII, never part of a UTF8 sequence.  So bytes are counted
+//		directly, without stepping over MidUTF8 chars.
+
+// ******************************************************************************
+// ED_AuxPIdxCount adds the depth changes in [CurP, EndP) to DepthArr, and lowers
+// MinArr (if not NULL) to the lowest depths reached.
+
+void	ED_AuxPIdxCount(char * CurP, char * EndP, Int64 * DepthArr, Int64 * MinArr)
+{
+    Int16	K;
+
+    for (; CurP < EndP; CurP++) {
+	switch (*CurP) {
+	case '(':	DepthArr[0] += 1; continue;
+	case '[':	DepthArr[1] += 1; continue;
+	case '{':	DepthArr[2] += 1; continue;
+	case ')':	K = 0; break;
+	case ']':	K = 1; break;
+	case '}':	K = 2; break;
+	default:	continue;
+	}
+
+	DepthArr[K] -= 1;
+	if (MinArr && (DepthArr[K] < MinArr[K])) MinArr[K] = DepthArr[K];
+    }
+}
+
+// ******************************************************************************
+// ED_AuxPIdxCountRange does ED_AuxPIdxCount for [Pos, EndPos) in BufP, one side
+// of the Gap at a time.
+
+void	ED_AuxPIdxCountRange(ED_BufferPointer BufP, Int64 Pos, Int64 EndPos, Int64 * DepthArr, Int64 * MinArr)
+{
+    Int64	GapPos = BufP->GapStartP - BufP->BufStartP;
+    Int64	GapLen = BufP->GapEndP - BufP->GapStartP;
+
+    if (Pos < GapPos) {
+	ED_AuxPIdxCount(BufP->BufStartP + Pos, BufP->BufStartP + ((EndPos < GapPos) ? EndPos : GapPos),
+			DepthArr, MinArr);
+	Pos = GapPos;
+    }
+    if (Pos < EndPos)
+	ED_AuxPIdxCount(BufP->BufStartP + GapLen + Pos, BufP->BufStartP + GapLen + EndPos, DepthArr, MinArr);
+}
+
+// ******************************************************************************
+// ED_AuxPIdxScanBack scans back from EndPos to Pos, counting *PCount up for each
+// CloseC and down for each OpenC.  Returns the Pos of the OpenC that brings it to
+// 0, or -1 if none did (*PCount then has the count at Pos).
+
+Int64	ED_AuxPIdxScanBack(ED_BufferPointer BufP, Int64 Pos, Int64 EndPos, char OpenC, char CloseC, Int64 * PCountP)
+{
+    Int64	GapPos = BufP->GapStartP - BufP->BufStartP;
+    Int64	GapLen = BufP->GapEndP - BufP->GapStartP;
+    Int64	PCount = *PCountP;
+    char	*CurP, *StartP, *BaseP;
+
+    while (EndPos > Pos) {
+	if (EndPos > GapPos) {				// After the Gap
+	    BaseP = BufP->BufStartP + GapLen;
+	    StartP = BaseP + ((Pos > GapPos) ? Pos : GapPos);
+	} else {
+	    BaseP = BufP->BufStartP;
+	    StartP = BaseP + Pos;
+	}
+	for (CurP = BaseP + EndPos; CurP > StartP; ) {
+	    if (*--CurP == CloseC) PCount++;
+	    else if ((*CurP == OpenC) && (--PCount == 0)) {
+		*PCountP = 0;
+		return CurP - BaseP;
+	    }
+	}
+	EndPos = StartP - BaseP;
+    }
+
+    *PCountP = PCount;
+    return -1;
+}
+
+// ******************************************************************************
+// ED_BufferPIdxInit allocates the ParenIdx array with its Pos 0 entry.
+
+void	ED_BufferPIdxInit(ED_BufferPointer BufP)
+{
+    BufP->PIdxArrP = malloc(ED_PIDXINITCOUNT * sizeof(ED_PIdxRecord));
+    if (! BufP->PIdxArrP) G_SETEXCEPTION("Malloc ParenIdx Failed", 0);
+    BufP->PIdxMax = ED_PIDXINITCOUNT;
+    ED_BufferPIdxReset(BufP);
+}
+
+// ******************************************************************************
+// ED_BufferPIdxKill frees the ParenIdx array, called when Buffer is killed.
+
+void	ED_BufferPIdxKill(ED_BufferPointer BufP)
+{
+    if (BufP->PIdxArrP) free(BufP->PIdxArrP);
+    BufP->PIdxArrP = NULL;
+    BufP->PIdxCount = BufP->PIdxMax = 0;
+    BufP->PIdxEndPos = 0;
+}
+
+// ******************************************************************************
+// ED_BufferPIdxReset discards all checkpoints (except [0]), called when the
+// whole Buffer content is replaced without going through the Undo system.
+
+void	ED_BufferPIdxReset(ED_BufferPointer BufP)
+{
+    if (BufP->PIdxArrP == NULL) return;
+
+    memset(BufP->PIdxArrP, 0, sizeof(ED_PIdxRecord));	// Pos 0, no depth
+    BufP->PIdxCount = 1;
+    BufP->PIdxEndPos = 0;
+}
+
+// ******************************************************************************
+// ED_AuxPIdxFind returns the Index of the last checkpoint at or before Pos.
+
+Int32	ED_AuxPIdxFind(ED_BufferPointer BufP, Int64 Pos)
+{
+    ED_PIdxPointer	PP = BufP->PIdxArrP;
+    Int32		Low, High, Mid;
+
+    Low = 0;
+    High = BufP->PIdxCount - 1;
+    while (Low < High) {
+	Mid = (Low + High + 1) / 2;
+	if (PP[Mid].Pos <= Pos) Low = Mid;
+	else High = Mid - 1;
+    }
+
+    return Low;
+}
+
+// ******************************************************************************
+// ED_AuxPIdxCountSeg counts the segment at Index again, from its checkpoint to
+// EndPos, leaving a new checkpoint every ED_PIDXSTEP bytes.  Returns the Index of
+// the last one.  Called for Dirty segments, and to extend the last one.
+
+Int32	ED_AuxPIdxCountSeg(ED_BufferPointer BufP, Int32 Index, Int64 EndPos)
+{
+    ED_PIdxPointer	PP;
+    Int64		DepthArr[ED_PIDXKINDS], MinArr[ED_PIDXKINDS];
+    Int64		Pos, NextPos;
+
+    PP = BufP->PIdxArrP + Index;
+    Pos = PP->Pos;
+    memcpy(DepthArr, PP->DepthArr, sizeof(DepthArr));
+    memcpy(MinArr, DepthArr, sizeof(MinArr));
+
+    while (1) {
+	NextPos = PP->Pos + ED_PIDXSTEP;
+	if (NextPos > EndPos) NextPos = EndPos;
+	ED_AuxPIdxCountRange(BufP, Pos, NextPos, DepthArr, MinArr);
+	memcpy(PP->MinArr, MinArr, sizeof(MinArr));
+	PP->Dirty = 0;
+	if ((Pos = NextPos) >= EndPos) break;
+
+	// New checkpoint after this one
+	if (BufP->PIdxCount == BufP->PIdxMax) {
+	    PP = realloc(BufP->PIdxArrP, 2 * BufP->PIdxMax * sizeof(ED_PIdxRecord));
+	    if (! PP) G_SETEXCEPTION("Realloc ParenIdx Failed", BufP->PIdxMax);
+	    BufP->PIdxArrP = PP;
+	    BufP->PIdxMax *= 2;
+	}
+	PP = BufP->PIdxArrP + ++Index;
+	if (Index < BufP->PIdxCount)
+	    memmove(PP + 1, PP, (BufP->PIdxCount - Index) * sizeof(ED_PIdxRecord));
+	BufP->PIdxCount += 1;
+	PP->Pos = Pos;
+	memcpy(PP->DepthArr, DepthArr, sizeof(DepthArr));
+	memcpy(MinArr, DepthArr, sizeof(MinArr));
+    }
+
+    return Index;
+}
+
+// ED_AuxPIdxClean re-counts the segment at Index if it is Dirty, returns the
+// Index of its last checkpoint.
+Int32	ED_AuxPIdxClean(ED_BufferPointer BufP, Int32 Index)
+{
+    if (! BufP->PIdxArrP[Index].Dirty) return Index;
+    return ED_AuxPIdxCountSeg(BufP, Index, (Index + 1 < BufP->PIdxCount) ?
+			      BufP->PIdxArrP[Index + 1].Pos : BufP->PIdxEndPos);
+}
+
+// ******************************************************************************
+// ED_BufferPIdxUpdate is called for each edit, Delta > 0 for ADD and < 0 for
+// DEL.  DataP points to the added (or deleted) text, contiguous, -Delta or
+// Delta bytes long.  Does nothing if the ParenIdx was never used.
+
+void	ED_BufferPIdxUpdate(ED_BufferPointer BufP, Int64 Pos, Int64 Delta, char * DataP)
+{
+    ED_PIdxPointer	PP, EndPP, DestPP;
+    Int64		DepthArr[ED_PIDXKINDS] = {0, 0, 0};
+    Int64		Len;
+    Int16		K;
+
+    if ((BufP->PIdxArrP == NULL) || (Delta == 0) || (Pos >= BufP->PIdxEndPos)) return;
+
+    Len = (Delta < 0) ? -Delta : Delta;
+    ED_AuxPIdxCount(DataP, DataP + Len, DepthArr, NULL);
+
+    // [0] is at Pos 0 and never moves, the segment holding Pos is now Dirty.
+    PP = BufP->PIdxArrP + 1;
+    EndPP = BufP->PIdxArrP + BufP->PIdxCount;
+    while ((PP < EndPP) && (PP->Pos <= Pos)) PP++;
+    (PP - 1)->Dirty = 1;
+
+    if (Delta > 0) {
+	for (; PP < EndPP; PP++) {
+	    PP->Pos += Len;
+	    for (K = 0; K < ED_PIDXKINDS; K++) {
+		PP->DepthArr[K] += DepthArr[K];
+		PP->MinArr[K] += DepthArr[K];
+	    }
+	}
+	BufP->PIdxEndPos += Len;
+    } else {
+	DestPP = PP;
+	while ((PP < EndPP) && (PP->Pos <= Pos + Len)) PP++;
+	for (; PP < EndPP; PP++, DestPP++) {
+	    *DestPP = *PP;
+	    DestPP->Pos -= Len;
+	    for (K = 0; K < ED_PIDXKINDS; K++) {
+		DestPP->DepthArr[K] -= DepthArr[K];
+		DestPP->MinArr[K] -= DepthArr[K];
+	    }
+	}
+	BufP->PIdxCount = (Int32)(DestPP - BufP->PIdxArrP);
+	BufP->PIdxEndPos = (BufP->PIdxEndPos > Pos + Len) ? BufP->PIdxEndPos - Len : Pos;
+    }
+}
+
+// ******************************************************************************
+// ED_BufferPIdxFindOpen returns the Pos of the Open paren matching the CloseC at
+// ParenPos, or -1 if there is none.
+
+Int64	ED_BufferPIdxFindOpen(ED_BufferPointer BufP, char CloseC, Int64 ParenPos)
+{
+    ED_PIdxPointer	PP;
+    Int64		DepthArr[ED_PIDXKINDS];
+    Int64		Pos, NearPos, Target, PCount;
+    Int32		I;
+    Int16		K;
+    char		OpenC;
+
+    if (CloseC == ')')
+	OpenC = CloseC - 1, K = 0;	// '(' + 1 == ')'
+    else
+	OpenC = CloseC - 2, K = (CloseC == ']') ? 1 : 2;	// '[' + 2 == ']' and '{' + 2 == '}'
+
+    // Most are near, do not bother with the ParenIdx
+    PCount = 1;
+    NearPos = (ParenPos > ED_PIDXNEAR) ? ParenPos - ED_PIDXNEAR : 0;
+    Pos = ED_AuxPIdxScanBack(BufP, NearPos, ParenPos, OpenC, CloseC, &PCount);
+    if ((Pos >= 0) || (NearPos == 0)) return Pos;
+
+    // Count up to ParenPos, if not there yet.
+    if (BufP->PIdxArrP == NULL) ED_BufferPIdxInit(BufP);
+    if (BufP->PIdxEndPos < ParenPos) {
+	ED_AuxPIdxCountSeg(BufP, BufP->PIdxCount - 1, ParenPos);
+	BufP->PIdxEndPos = ParenPos;
+    }
+    I = ED_AuxPIdxFind(BufP, NearPos);
+    if (BufP->PIdxArrP[I].Dirty) {
+	ED_AuxPIdxClean(BufP, I);
+	I = ED_AuxPIdxFind(BufP, NearPos);
+    }
+
+    // Rest of the segment holding NearPos.  Its depth at NearPos less PCount is
+    // the Target depth, the Open is the last Pos that got down to it.
+    PP = BufP->PIdxArrP + I;
+    memcpy(DepthArr, PP->DepthArr, sizeof(DepthArr));
+    ED_AuxPIdxCountRange(BufP, PP->Pos, NearPos, DepthArr, NULL);
+    Target = DepthArr[K] - PCount;
+    Pos = ED_AuxPIdxScanBack(BufP, PP->Pos, NearPos, OpenC, CloseC, &PCount);
+
+    // Skip the segments that never get down to Target.
+    while ((Pos < 0) && (I-- > 0)) {
+	I = ED_AuxPIdxClean(BufP, I);
+	PP = BufP->PIdxArrP + I;
+	if (PP->MinArr[K] > Target) continue;
+
+	PCount = (PP + 1)->DepthArr[K] - Target;
+	Pos = ED_AuxPIdxScanBack(BufP, PP->Pos, (PP + 1)->Pos, OpenC, CloseC, &PCount);
+    }
+
+    return Pos;
+}
+
+// ******************************************************************************
+// ED_BufferCheckNameCol checks to see if any other Buffers have the same
+// FileName.  If so, it sets the BUFNAMECOLFLAG so the ModeLine in the Pane
 // would also show the DirName containing the File.
 //
 // NOTE:	Currently no provisions to keep user opening/reading/writing
@@ -6930,49 +10500,656 @@ void	ED_BufferCheckNameCol(ED_BufferPointer BufP)
 // ED_BufferFindByName looks for a buffer with the matching Name and/or Path.
 // NameP or PathP can be NULL.
 
-ED_BufferPointer	ED_BufferFindByName(char * NameP, char * PathP)
+ED_BufferPointer	ED_BufferFindByName(char * NameP, char * PathP)
+{
+    ED_BufferPointer	BufP = ED_FirstBufP;
+
+    while (BufP) {
+	if (((NameP == NULL) || (0 == strcmp(BufP->FileName, NameP))) &&
+	    ((PathP == NULL) || (0 == strcmp(BufP->PathName, PathP))))
+	    return BufP;
+
+	BufP = BufP->NextBufP;
+    }
+
+    return NULL;
+}
+
+// ******************************************************************************
+// ED_BufferWriteFile write the entire buffer (excluding Gap) to the open file
+// specified with FD--assumes Write head is properly placed.
+//
+// Return 0 for success, 1 for failure.
+// If failure, check errno for details.
+
+Int16	ED_BufferWriteFile(ED_BufferPointer BufP, Int32 FD)
+{
+    struct iovec	IOVArr[2];
+
+    // Up to Gap, then after it.
+    IOVArr[0].iov_base = BufP->BufStartP;
+    IOVArr[0].iov_len = BufP->GapStartP - BufP->BufStartP;
+    IOVArr[1].iov_base = BufP->GapEndP;
+    IOVArr[1].iov_len = BufP->BufEndP - BufP->GapEndP;
+
+    if (ED_UtilWriteV(FD, IOVArr, 2)) return 1;
+
+    fsync(FD);		// Flush write buffer + update
+    return 0;
+}
+
+// ******************************************************************************
+// ED_UtilWriteV writes out all of IOVArr, picking up after short writes.
+// Return 0 for success, 1 for failure (check errno).
+//
+// NOTE:	Modifies IOVArr as it goes.  Called from Save workers too.
+
+Int16	ED_UtilWriteV(Int32 FD, struct iovec * IOVArr, Int32 Count)
+{
+    ssize_t		Len;
+
+    while (Count) {
+	if (IOVArr->iov_len == 0) {
+	    IOVArr++, Count--;
+	    continue;
+	}
+
+	Len = writev(FD, IOVArr, Count);
+	if (Len < 0) {
+	    if (errno == EINTR) continue;
+	    return 1;
+	}
+
+	while (Count && (Len >= (ssize_t)IOVArr->iov_len)) {
+	    Len -= IOVArr->iov_len;
+	    IOVArr++, Count--;
+	}
+	if (Count) {
+	    IOVArr->iov_base = (char *)IOVArr->iov_base + Len;
+	    IOVArr->iov_len -= Len;
+	}
+    }
+
+    return 0;
+}
+
+// ******************************************************************************
+// ******************************************************************************
+// ASYNCH SAVE
+//
+// Saving a big file (or a few of them, or over NFS) with write + fsync would
+// freeze the UI.  So ED_SaveQueueJob snapshots the two halves of the Buf (gap
+// excluded) into a Job, and a pool of worker threads writes them out--several
+// Bufs are saved in parallel.  Workers touch *ONLY* their Job, never a Buf.
+//
+// Each worker writes a temp file next to the (real) target, fsyncs, then
+// renames it over the target, so a crash or full disk never leaves a half
+// written file.  The original mode is kept.  But a rename cannot keep hard
+// links, another owner or group, or ACLs/xattrs, and needs a writable dir--
+// then the file is written in place (O_TRUNC) as before, after ED_SaveQueueJob
+// unmapped it (ED_AuxSaveInPlace).  Either way, a file the user may not write
+// is refused, as the open used to.  Then the Job pointer goes down
+// a pipe, and ED_SaveDoneHandler (an sc_FDAdd callback in the main loop) runs
+// ED_SaveFinish, which calls ED_BufferDidSave as before.
+//
+// ED_BUFSAVINGFLAG is set while a Job is in flight, one per Buf.  If the Buf
+// is edited meanwhile (EditSeq changed), the file is still written but the Buf
+// stays MOD.  If the Buf is killed, ED_SaveDetach orphans the Job.
+
+void *	ED_SaveWorkerFunc(void * ArgP)
+{
+    ED_SaveJobPointer	JobP;
+
+    while (1) {
+	pthread_mutex_lock(&ED_SaveMutex);
+	while ((ED_SaveQueueP == NULL) && ! ED_SaveQuit)
+	    pthread_cond_wait(&ED_SaveCond, &ED_SaveMutex);
+	JobP = ED_SaveQueueP;
+	if (JobP) ED_SaveQueueP = JobP->NextQueueP;
+	pthread_mutex_unlock(&ED_SaveMutex);
+
+	if (JobP == NULL) break;			// Quit + nothing left to do
+
+	JobP->Err = ED_SaveWriteJob(JobP);
+	while ((write(ED_SavePipeArr[1], &JobP, sizeof(JobP)) < 0) && (errno == EINTR));
+    }
+
+    return NULL;
+}
+
+// ED_SaveWriteJob runs on a worker, returns 0 or errno.
+
+Int32	ED_SaveWriteJob(ED_SaveJobPointer JobP)
+{
+    char		TempPath[PATH_MAX + 16];
+    char *		RealP;
+    char *		SlashP;
+    struct stat		StatR;
+    Int32		FD, Err;
+
+    // Follow symlinks, so the link survives the rename.
+    RealP = realpath(JobP->FullPath, NULL);
+    if (RealP == NULL) return errno;
+    if (stat(RealP, &StatR)) goto ErrFree;
+    if (access(RealP, W_OK)) goto ErrFree;		// As O_WRONLY would
+    if (JobP->InPlace) goto InPlace;
+
+    SlashP = strrchr(RealP, '/');
+    if ((SlashP == NULL) || (strlen(RealP) + 10 > sizeof(TempPath))) {
+	errno = ENAMETOOLONG;
+	goto ErrFree;
+    }
+    sprintf(TempPath, "%.*s/.%s.XXXXXX", (Int32)(SlashP - RealP), RealP, SlashP + 1);
+
+    FD = mkstemp(TempPath);
+    if (FD == -1) {
+	if (JobP->MapFree) goto InPlace;		// Dir went read-only?
+	goto ErrFree;
+    }
+    if (fchmod(FD, StatR.st_mode & 07777) ||
+	ED_UtilWriteV(FD, JobP->IOVArr, 2) || fsync(FD)) {
+	Err = errno;
+	close(FD);
+	goto ErrUnlink;
+    }
+    if (close(FD)) {
+	Err = errno;
+	goto ErrUnlink;
+    }
+    if (rename(TempPath, RealP)) {
+	Err = errno;
+	goto ErrUnlink;
+    }
+
+    free(RealP);
+    return 0;
+
+InPlace:
+    FD = open(RealP, O_TRUNC | O_WRONLY, 0);
+    if (FD == -1) goto ErrFree;
+    if (ED_UtilWriteV(FD, JobP->IOVArr, 2) || fsync(FD)) {
+	Err = errno;
+	close(FD);
+	free(RealP);
+	return Err;
+    }
+    if (close(FD)) goto ErrFree;
+
+    free(RealP);
+    return 0;
+
+ErrUnlink:
+    unlink(TempPath);
+    free(RealP);
+    return Err;
+
+ErrFree:
+    Err = errno;
+    free(RealP);
+    return Err;
+}
+
+// ******************************************************************************
+// ED_AuxSaveInPlace returns 1 if PathP has to be written in place: temp + rename
+// would lose its hard links, owner/group or ACLs/xattrs, or its dir is not
+// writable.  Main thread, so ED_SaveQueueJob can unmap it first.
+
+Int16	ED_AuxSaveInPlace(char * PathP)
+{
+    struct stat		StatR;
+    char *		RealP;
+    char *		SlashP;
+    Int16		InPlace = 0;
+
+    RealP = realpath(PathP, NULL);
+    if (RealP == NULL) return 0;			// Worker reports it
+
+    if (stat(RealP, &StatR) || access(RealP, W_OK))
+	InPlace = 0;					// Same
+    else if ((StatR.st_nlink > 1) || (StatR.st_uid != geteuid()) || (StatR.st_gid != getegid()))
+	InPlace = 1;
+    else if (listxattr(RealP, NULL, 0) > 0)		// ACLs are xattrs too
+	InPlace = 1;
+    else if ((SlashP = strrchr(RealP, '/'))) {
+	*SlashP = 0;
+	InPlace = (access((SlashP == RealP) ? "/" : RealP, W_OK | X_OK) != 0);
+    }
+
+    free(RealP);
+    return InPlace;
+}
+
+// ******************************************************************************
+// ED_SaveInit creates the done-pipe and workers--lazily, on the first save.
+
+void	ED_SaveInit(void)
+{
+    Int16	I;
+
+    if (ED_SaveWorkerCount) return;
+
+    if (pipe(ED_SavePipeArr)) G_SETEXCEPTION("Save pipe failed", errno);
+    fcntl(ED_SavePipeArr[0], F_SETFL, O_NONBLOCK);
+    sc_FDAdd(ED_SavePipeArr[0], POLLIN, ED_SaveDoneHandler, NULL);
+
+    ED_SaveQuit = 0;
+    for (I = 0; I < ED_SAVEWORKERCOUNT; I++) {
+	if (pthread_create(&ED_SaveWorkerArr[I], NULL, ED_SaveWorkerFunc, NULL))
+	    G_SETEXCEPTION("Save worker failed", I);
+	ED_SaveWorkerCount += 1;
+    }
+}
+
+// ******************************************************************************
+// ED_SaveKill lets the workers finish the queue, then joins them.  Called from
+// ED_EditorKill, so nothing is lost when quitting right after a save.
+
+void	ED_SaveKill(void)
+{
+    ED_SaveJobPointer	JobP;
+    Int16		I;
+
+    if (ED_SaveWorkerCount == 0) return;
+
+    pthread_mutex_lock(&ED_SaveMutex);
+    ED_SaveQuit = 1;
+    pthread_cond_broadcast(&ED_SaveCond);
+    pthread_mutex_unlock(&ED_SaveMutex);
+
+    for (I = 0; I < ED_SaveWorkerCount; I++)
+	pthread_join(ED_SaveWorkerArr[I], NULL);
+    ED_SaveWorkerCount = 0;
+
+    while ((JobP = ED_SavePendingP)) {		// Bufs are going away, just free
+	ED_SavePendingP = JobP->NextP;
+	free(JobP->DataP);
+	free(JobP);
+    }
+
+    sc_FDDel(ED_SavePipeArr[0]);
+    close(ED_SavePipeArr[0]);
+    close(ED_SavePipeArr[1]);
+}
+
+// ******************************************************************************
+// ED_SaveQueueJob snapshots BufP and hands it to the workers.  It relies on
+// global ED_FullPath.  Return 0 for success, else errno.
+
+Int32	ED_SaveQueueJob(ED_BufferPointer BufP)
+{
+    ED_SaveJobPointer	JobP;
+    ED_SaveJobPointer *	JPP;
+    Int64		Len1 = BufP->GapStartP - BufP->BufStartP;
+    Int64		Len2 = BufP->BufEndP - BufP->GapEndP;
+
+    ED_SaveInit();
+
+    JobP = malloc(sizeof(ED_SaveJobRecord));
+    if (JobP == NULL) return ENOMEM;
+    JobP->DataP = malloc(Len1 + Len2 + 1);
+    if (JobP->DataP == NULL) {
+	free(JobP);
+	return ENOMEM;
+    }
+
+    memcpy(JobP->DataP, BufP->BufStartP, Len1);
+    memcpy(JobP->DataP + Len1, BufP->GapEndP, Len2);
+    if (BufP->Flags & ED_BUFMAPPEDFLAG) ED_MapCheck();
+    if (BufP->Flags & ED_BUFDAMAGEDFLAG) {			// Would save NULs over the text
+	free(JobP->DataP);
+	free(JobP);
+	return EIO;
+    }
+    JobP->IOVArr[0].iov_base = JobP->DataP;
+    JobP->IOVArr[0].iov_len = Len1;
+    JobP->IOVArr[1].iov_base = JobP->DataP + Len1;
+    JobP->IOVArr[1].iov_len = Len2;
+
+    strcpy(JobP->FullPath, ED_FullPath);
+    JobP->BufP = BufP;
+    JobP->EditSeq = BufP->EditSeq;
+    JobP->Err = 0;
+    JobP->Batch = ED_SaveBatchTag;
+    JobP->NextQueueP = NULL;
+
+    // O_TRUNC would yank the pages from under a mapped Buf (this one or not).
+    JobP->InPlace = ED_AuxSaveInPlace(ED_FullPath);
+    if (JobP->InPlace) ED_BufferUnmapPath(ED_FullPath);
+    JobP->MapFree = JobP->InPlace || ! ED_BufferPathMapped(ED_FullPath);
+
+    BufP->Flags |= ED_BUFSAVINGFLAG;
+    JobP->NextP = ED_SavePendingP;
+    ED_SavePendingP = JobP;
+
+    // FIFO queue, so Bufs start in the order they were asked for.
+    pthread_mutex_lock(&ED_SaveMutex);
+    JPP = &ED_SaveQueueP;
+    while (*JPP) JPP = &(*JPP)->NextQueueP;
+    *JPP = JobP;
+    pthread_cond_signal(&ED_SaveCond);
+    pthread_mutex_unlock(&ED_SaveMutex);
+
+    return 0;
+}
+
+// ******************************************************************************
+// ED_SaveDoneHandler is the sc_FDAdd callback on the done-pipe.
+
+void	ED_SaveDoneHandler(Int32 FD, Int16 REvents, void * DataP)
+{
+    ED_SaveJobPointer	JobP;
+
+    while (read(FD, &JobP, sizeof(JobP)) == sizeof(JobP))
+	ED_SaveFinish(JobP);
+}
+
+// ED_SaveFinish does the (main thread) housekeeping for a finished Job.
+
+void	ED_SaveFinish(ED_SaveJobPointer JobP)
+{
+    ED_SaveJobPointer *	JPP = &ED_SavePendingP;
+    ED_BufferPointer	BufP = JobP->BufP;
+
+    while (*JPP != JobP) JPP = &(*JPP)->NextP;
+    *JPP = JobP->NextP;
+
+    if (BufP) {
+	BufP->Flags &= ~ED_BUFSAVINGFLAG;
+	if (JobP->Err)
+	    ED_FrameSetEchoError(ED_STR_EchoWriteFailed, JobP->Err);
+	else {
+	    // ED_BufferDidSave relies on these globals.
+	    strcpy(ED_Name, BufP->FileName);
+	    ED_FullPathLen = sprintf(ED_FullPath, "%s/%s", BufP->PathName, BufP->FileName);
+
+	    if (JobP->EditSeq == BufP->EditSeq)
+		ED_BufferDidSave(BufP, NULL);
+	    else
+		ED_FrameSPrintEchoS(ED_ECHOMSGMODE, ED_STR_EchoWroteEdited, ED_MSGSTRLEN - strlen(ED_STR_EchoWroteEdited), ED_Name);
+	}
+	if (ED_CurFrameP) ED_FrameDrawAll(ED_CurFrameP);
+    }
+
+    // Only writes that made it count as saved.
+    if (JobP->Batch && (JobP->Batch == ED_CmdSaveBatch)) {
+	ED_CmdSaveFileLeft -= 1;
+	if (! JobP->Err) ED_CmdSaveFileCount += 1;
+	ED_AuxSaveSomeReport();
+    }
+
+    free(JobP->DataP);
+    free(JobP);
+}
+
+// ED_SaveDetach orphans the in-flight Job of BufP, about to be killed.
+
+void	ED_SaveDetach(ED_BufferPointer BufP)
+{
+    ED_SaveJobPointer	JobP = ED_SavePendingP;
+
+    while (JobP) {
+	if (JobP->BufP == BufP) JobP->BufP = NULL;
+	JobP = JobP->NextP;
+    }
+}
+
+// ******************************************************************************
+// ******************************************************************************
+// SCAN POOL
+//
+// Whole-buffer scans (line and row counting, NeedsFilter, a search that runs
+// past the near chunk) are split into chunks and run on a pool of worker
+// threads, one per core.  ED_PoolRun blocks the UI thread until the scan is
+// done--and takes chunks itself meanwhile--so the Buf is two read-only spans
+// around the Gap, nobody can edit it.  Chunks never straddle the Gap.
+//
+// A scan function touches *ONLY* its chunk record, reading the Buf (and for
+// IS, the tables ED_ISPrepare set up).  The caller merges the results:
+// newline counts add up, rows are counted from the first to the last '\n' of
+// each chunk (then the wrap state is known), and the line spanning a chunk
+// boundary is counted on the UI thread.  For a search, chunks after (or
+// before, going back) the first hit are skipped.
+//
+// The pool is created lazily, and stays single threaded on a one core box.
+
+void *	ED_PoolWorkerFunc(void * ArgP)
+{
+    Uns32	Gen = 0;
+
+    pthread_mutex_lock(&ED_PoolMutex);
+    while (1) {
+	while ((Gen == ED_PoolGen) && ! ED_PoolQuit)
+	    pthread_cond_wait(&ED_PoolCond, &ED_PoolMutex);
+	if (ED_PoolQuit) break;
+
+	Gen = ED_PoolGen;
+	ED_AuxPoolTake(Gen);
+    }
+    pthread_mutex_unlock(&ED_PoolMutex);
+
+    return NULL;
+}
+
+// ED_AuxPoolTake runs chunks of scan Gen until none are left.  Called (and
+// returns) with ED_PoolMutex held, on workers and on the UI thread.  A worker
+// late for Gen must not take chunks (or Left) of the next scan.
+
+void	ED_AuxPoolTake(Uns32 Gen)
+{
+    ED_PoolChunkPointer	CP;
+    Int32		I;
+
+    while ((Gen == ED_PoolGen) && (ED_PoolNext < ED_PoolCount)) {
+	// Going back, hand out the last chunk first.
+	I = ED_PoolNext++;
+	if (ED_PoolModeNow == ED_POOLLAST) I = ED_PoolCount - 1 - I;
+	CP = &ED_PoolArr[I];
+
+	if ((I < ED_PoolLow) || (I > ED_PoolHigh))
+	    CP->Count = -1;				// Beyond a hit, not needed
+	else {
+	    pthread_mutex_unlock(&ED_PoolMutex);
+	    (*ED_PoolFunc)(ED_PoolBufP, CP);
+	    pthread_mutex_lock(&ED_PoolMutex);
+
+	    if (CP->Count >= 0) {
+		if ((ED_PoolModeNow == ED_POOLFIRST) && (I < ED_PoolHigh)) ED_PoolHigh = I;
+		if ((ED_PoolModeNow == ED_POOLLAST) && (I > ED_PoolLow)) ED_PoolLow = I;
+	    }
+	}
+
+	if (--ED_PoolLeft == 0) pthread_cond_signal(&ED_PoolDoneCond);
+    }
+}
+
+// ******************************************************************************
+// ED_PoolInit starts the workers, one per core (the UI thread is one of them).
+
+void	ED_PoolInit(void)
+{
+    Int64	Cores;
+
+    if (ED_PoolWorkerCount >= 0) return;
+
+    Cores = sysconf(_SC_NPROCESSORS_ONLN);
+    if (Cores > ED_POOLMAXWORKERS + 1) Cores = ED_POOLMAXWORKERS + 1;
+
+    ED_PoolQuit = 0;
+    ED_PoolWorkerCount = 0;
+    while (ED_PoolWorkerCount < Cores - 1) {
+	if (pthread_create(&ED_PoolWorkerArr[ED_PoolWorkerCount], NULL, ED_PoolWorkerFunc, NULL))
+	    break;					// Make do with fewer
+	ED_PoolWorkerCount += 1;
+    }
+}
+
+// ED_PoolKill stops and joins the workers.  Called from ED_EditorKill.
+
+void	ED_PoolKill(void)
+{
+    Int16	I;
+
+    if (ED_PoolWorkerCount <= 0) return;
+
+    pthread_mutex_lock(&ED_PoolMutex);
+    ED_PoolQuit = 1;
+    pthread_cond_broadcast(&ED_PoolCond);
+    pthread_mutex_unlock(&ED_PoolMutex);
+
+    for (I = 0; I < ED_PoolWorkerCount; I++)
+	pthread_join(ED_PoolWorkerArr[I], NULL);
+    ED_PoolWorkerCount = -1;
+}
+
+// ED_PoolWanted returns 1 if a scan of Len bytes is worth the pool.
+
+Int16	ED_PoolWanted(Int64 Len)
+{
+    if (Len < ED_POOLMINLEN) return 0;
+
+    ED_PoolInit();
+    return (ED_PoolWorkerCount > 0);
+}
+
+// ******************************************************************************
+// ED_AuxPoolSplit fills ED_PoolArr with the chunks for [StartPos, EndPos).
+// Called with ED_PoolMutex held.
+
+void	ED_AuxPoolSplit(ED_BufferPointer BufP, Int64 StartPos, Int64 EndPos)
+{
+    Int64	GapPos = BufP->GapStartP - BufP->BufStartP;
+    Int64	ChunkLen, Pos, End;
+
+    ChunkLen = (EndPos - StartPos) / ED_POOLMAXCHUNKS + 1;
+    if (ChunkLen < ED_POOLCHUNK) ChunkLen = ED_POOLCHUNK;
+
+    ED_PoolCount = 0;
+    for (Pos = StartPos; Pos < EndPos; Pos = End) {
+	End = (EndPos - Pos > ChunkLen) ? Pos + ChunkLen : EndPos;
+	if ((Pos < GapPos) && (End > GapPos)) End = GapPos;
+
+	ED_PoolArr[ED_PoolCount].StartPos = Pos;
+	ED_PoolArr[ED_PoolCount].EndPos = End;
+	ED_PoolCount += 1;
+    }
+}
+
+// ED_PoolRun splits [StartPos, EndPos) into chunks, runs FuncP on them all,
+// returns when done.  The results are in ED_PoolArr[0..ED_PoolCount).
+
+void	ED_PoolRun(ED_BufferPointer BufP, Int64 StartPos, Int64 EndPos, ED_PoolFuncP FuncP, ED_PoolMode Mode)
+{
+    Int64	StartNs = sc_ClockNSecs();
+
+    pthread_mutex_lock(&ED_PoolMutex);
+    ED_AuxPoolSplit(BufP, StartPos, EndPos);
+    ED_PoolBufP = BufP;
+    ED_PoolFunc = FuncP;
+    ED_PoolModeNow = Mode;
+    ED_PoolNext = 0;
+    ED_PoolLeft = ED_PoolCount;
+    ED_PoolLow = 0;
+    ED_PoolHigh = ED_PoolCount - 1;
+    ED_PoolGen += 1;
+    pthread_cond_broadcast(&ED_PoolCond);
+
+    ED_AuxPoolTake(ED_PoolGen);
+    while (ED_PoolLeft)
+	pthread_cond_wait(&ED_PoolDoneCond, &ED_PoolMutex);
+    pthread_mutex_unlock(&ED_PoolMutex);
+
+    ED_StatsHistAdd(ED_PoolHistId, sc_ClockNSecs() - StartNs);
+}
+
+// ******************************************************************************
+// Scan functions, these run on the workers.
+
+// Counts the newlines, notes the first and last.
+void	EDCB_PoolCountNL(ED_BufferPointer BufP, ED_PoolChunkPointer CP)
+{
+    char *	StartP = ED_BufferPosToPtr(BufP, CP->StartPos);
+    char *	EndP = StartP + (CP->EndPos - CP->StartPos);
+    char *	P;
+
+    CP->Count = ED_AuxCountNL(StartP, EndP - StartP);
+    CP->FirstNL = CP->LastNL = -1;
+    if (CP->Count == 0) return;
+
+    P = memchr(StartP, '\n', EndP - StartP);
+    CP->FirstNL = CP->StartPos + (P - StartP);
+    P = ED_UtilScanBackByte(StartP, EndP, '\n');
+    CP->LastNL = CP->StartPos + (P - StartP);
+}
+
+// Counts the Rows (for ED_PoolColLimit) between the first and last newlines.
+void	EDCB_PoolRows(ED_BufferPointer BufP, ED_PoolChunkPointer CP)
+{
+    char *	StartP = ED_BufferPosToPtr(BufP, CP->StartPos);
+    char *	EndP = StartP + (CP->EndPos - CP->StartPos);
+    char *	P;
+
+    CP->Count = 0;
+    CP->FirstNL = CP->LastNL = -1;
+
+    P = memchr(StartP, '\n', EndP - StartP);
+    if (P == NULL) return;
+    CP->FirstNL = CP->StartPos + (P - StartP);
+    P = ED_UtilScanBackByte(StartP, EndP, '\n');
+    CP->LastNL = CP->StartPos + (P - StartP);
+
+    CP->Count = ED_AuxRIdxCountRows(BufP, ED_PoolColLimit, CP->FirstNL + 1, CP->LastNL + 1);
+}
+
+// Finds a CR or Tab.
+void	EDCB_PoolFilter(ED_BufferPointer BufP, ED_PoolChunkPointer CP)
 {
-    ED_BufferPointer	BufP = ED_FirstBufP;
+    char *	StartP = ED_BufferPosToPtr(BufP, CP->StartPos);
+    char *	P;
 
-    while (BufP) {
-	if (((NameP == NULL) || (0 == strcmp(BufP->FileName, NameP))) &&
-	    ((PathP == NULL) || (0 == strcmp(BufP->PathName, PathP))))
-	    return BufP;
+    P = ED_UtilScanByte2(StartP, StartP + (CP->EndPos - CP->StartPos), 0x09, 0x0d);
+    CP->Count = (P) ? CP->StartPos + (P - StartP) : -1;
+}
 
-	BufP = BufP->NextBufP;
-    }
+// Chunk holds the match *STARTS*, a match can run past its end.
+void	EDCB_PoolISForward(ED_BufferPointer BufP, ED_PoolChunkPointer CP)
+{
+    CP->Count = ED_AuxISFindRange(BufP, CP->StartPos, CP->EndPos - 1);
+}
 
-    return NULL;
+void	EDCB_PoolISBackward(ED_BufferPointer BufP, ED_PoolChunkPointer CP)
+{
+    CP->Count = ED_AuxISFindRangeBack(BufP, CP->StartPos, CP->EndPos - 1);
 }
 
 // ******************************************************************************
-// ED_BufferWriteFile write the entire buffer (excluding Gap) to the open file
-// specified with FD--assumes Write head is properly placed.
-//
-// Return 0 for success, 1 for failure.
-// If failure, check errno for details.
+// ED_AuxPoolRows counts the Rows from Pos (a line start, on Row *RowP) up to
+// EndPos, leaving RowIdx checkpoints at *IndexP and after.  Returns the last
+// line start at or before EndPos, and its Row in *RowP.
 
-Int16	ED_BufferWriteFile(ED_BufferPointer BufP, Int32 FD)
+Int64	ED_AuxPoolRows(ED_BufferPointer BufP, ED_RIdxWidthPointer WP, Int32 *IndexP, Int64 Pos, Int64 EndPos, Int64 *RowP)
 {
-    Int32	Count;
+    ED_PoolChunkPointer	CP;
+    Int64		Row = *RowP;
+    Int64		CPRow = Row;
+    Int32		I;
 
-    // write up to Gap first
-    if (BufP->GapStartP > BufP->BufStartP) {
-	Count = write(FD, BufP->BufStartP, BufP->GapStartP - BufP->BufStartP);
-	if (Count < (BufP->GapStartP - BufP->BufStartP)) {
-	    return 1;
-	}
-    }
+    ED_PoolColLimit = WP->RowChars;
+    ED_PoolRun(BufP, Pos, EndPos, EDCB_PoolRows, ED_POOLALL);
 
-    if (BufP->GapEndP < BufP->BufEndP) {
-	Count = write(FD, BufP->GapEndP, BufP->BufEndP - BufP->GapEndP);
-	if (Count < (BufP->BufEndP - BufP->GapEndP)) {
-	    return 1;
+    for (I = 0, CP = ED_PoolArr; I < ED_PoolCount; I++, CP++) {
+	if (CP->FirstNL < 0) continue;			// All in one (long) line
+
+	// The line across the chunk boundary, then the chunk.
+	Row += ED_AuxRIdxCountRows(BufP, WP->RowChars, Pos, CP->FirstNL + 1) + CP->Count;
+	Pos = CP->LastNL + 1;
+	if (Row - CPRow >= ED_RIDXSTEP) {
+	    ED_AuxRIdxInsert(WP, ++(*IndexP), Pos, Row);
+	    CPRow = Row;
 	}
     }
 
-    fsync(FD);		// Flush write buffer + update
-    return 0;
+    *RowP = Row;
+    return Pos;
 }
 
 // ******************************************************************************
@@ -6984,23 +11161,18 @@ Int16	ED_BufferWriteFile(ED_BufferPointer BufP, Int32 FD)
 
 Int16	ED_BufferNeedsFilter(ED_BufferPointer BufP)
 {
-    char	*CurP, *EndP;
-
-    CurP = BufP->BufStartP;
-    EndP = BufP->GapStartP;
+    Int32	I;
 
-LoopAgain:
-    while (CurP < EndP) {
-	if ((*CurP == 0x09) || (*CurP == 0x0d))
-	    return 1;
-        CurP++;
+    if (ED_PoolWanted(BufP->LastPos)) {
+	ED_PoolRun(BufP, 0, BufP->LastPos, EDCB_PoolFilter, ED_POOLFIRST);
+	for (I = 0; I < ED_PoolCount; I++)
+	    if (ED_PoolArr[I].Count >= 0) return 1;
+	return 0;
     }
 
-    if (CurP < BufP->BufEndP) {
-	CurP = BufP->GapEndP;
-	EndP = BufP->BufEndP;
-	goto LoopAgain;
-    }
+    if (ED_UtilScanByte2(BufP->BufStartP, BufP->GapStartP, 0x09, 0x0d) ||
+	ED_UtilScanByte2(BufP->GapEndP, BufP->BufEndP, 0x09, 0x0d))
+	return 1;
 
     return 0;
 }
@@ -7010,61 +11182,85 @@ LoopAgain:
 // CR -> Replace with LF (or remove if already followed by LF).
 // Tab -> Replace by N spaces--enough to align with next tabstop.
 // (This requires tracking Col position wrt. hard newlines, not wraparounds!)
+//
+// The filter is one linear pass, from the old Buf memory into a new block that
+// is sized up front (Tabs are counted with memchr).  Plain runs are copied in
+// one go, only the tail of the run (after its last \n) is walked to get the Col
+// for the next Tab.  ED_AuxFilterCopy keeps its Col and a trailing CR between
+// calls, so text can also be filtered piece by piece, as it arrives.
 
-// if CRLF, just zap the CR.  If just CR, change it in place.
-Int32	ED_AuxReplaceCR(ED_BufferPointer BufP, Int32 CurPos)
+// Bytes needed to filter Len bytes at SrcP... +1 for a trailing CR.
+Int64	ED_AuxFilterSize(char * SrcP, Int64 Len)
 {
-    char	*CurP, *NextP;
+    char	*EndP = SrcP + Len;
+    Int32	Tabs = 0;
 
-    CurP = ED_BufferPosToPtr(BufP, CurPos);
-    NextP = ED_BufferPosToPtr(BufP, CurPos + 1);
-
-    if (*NextP == '\n') {		// Just zap the CR
-	ED_BufferPlaceGap(BufP, CurPos, 0);
-	BufP->GapEndP += 1;
-	BufP->LastPos -= 1;
-    } else
-	*CurP = '\n';			// Change in situ
+    while ((SrcP = memchr(SrcP, 0x09, EndP - SrcP)))
+	Tabs++, SrcP++;
 
-    // Either way, we end up at CurPos + 1
-    return (CurPos + 1);
+    return Len + (Tabs * (ED_TABSTOP - 1)) + 1;
 }
 
-// Replace the Tab char with 1..ED_TABSTOP spaces, inorder to align
-// with ED_TABSTOP Col increments.
-Int32	ED_AuxReplaceTab(ED_BufferPointer BufP, Int32 CurPos, Int32 *ColP)
+// Filter Len bytes from SrcP into DestP, return the number of bytes written.
+// *ColP is the Col (in UTF8 chars) and *CRP is 1 if the previous piece ended
+// in a CR--cannot tell yet whether a LF follows it.  Flush that CR with a \n
+// after the very last piece.
+Int64	ED_AuxFilterCopy(char * DestP, char * SrcP, Int64 Len, Int32 * ColP, Int16 * CRP)
 {
-    char	*CurP;
-    Int32	I, Len;
+    char	*StartP = DestP;
+    char	*EndP = SrcP + Len;
+    char	*StopP, *CP;
+    Int32	Col = *ColP;
+    Int64	N;
 
-    // How many spaces are needed?
-    Len = (((*ColP / ED_TABSTOP) + 1) * ED_TABSTOP) - *ColP;
-    if (Len == 0) Len = ED_TABSTOP;
+    if (*CRP && Len) {				// CR from previous piece
+	if (*SrcP != '\n') *DestP++ = '\n';
+	*CRP = 0;
+	Col = 0;
+    }
 
-    // If just 1 space, simply replace the Tab char in situ.
-    if (Len == 1) {
-	CurP = ED_BufferPosToPtr(BufP, CurPos);
-	*CurP = ' ';
-    } else {
-	// Place the gap just after it, replace the Tab and add in the rest.
-	ED_BufferPlaceGap(BufP, CurPos + 1, Len - 1);
-	CurP = BufP->GapStartP - 1;
-	for (I = 0; I < Len; I++)
-	    *CurP++ = ' ';
-        BufP->GapStartP += Len - 1;
-	BufP->LastPos += Len - 1;
+    while (SrcP < EndP) {
+	StopP = ED_UtilScanByte2(SrcP, EndP, 0x09, 0x0d);
+	if (StopP == NULL) StopP = EndP;
+
+	N = StopP - SrcP;
+	memcpy(DestP, SrcP, N);
+	DestP += N;
+
+	// Col for what follows, unless it is a CR (Col = 0 anyway)
+	if ((StopP == EndP) || (*StopP == 0x09)) {
+	    CP = StopP;
+	    while ((CP > SrcP) && (CP[-1] != '\n')) CP--;
+	    if (CP > SrcP) Col = 0;
+	    for (; CP < StopP; CP++)
+		if ((*CP & 0xC0) != 0x80) Col++;
+	}
+	if (StopP == EndP) break;
+
+	if (*StopP == 0x0d) {
+	    if (StopP + 1 == EndP)
+		*CRP = 1;
+	    else if (StopP[1] != '\n')
+		*DestP++ = '\n';
+	    Col = 0;
+	} else {
+	    N = ED_TABSTOP - (Col % ED_TABSTOP);
+	    Col += N;
+	    while (N--) *DestP++ = ' ';
+	}
+	SrcP = StopP + 1;
     }
 
-    *ColP += Len;
-    return (CurPos + Len - 1);
+    *ColP = Col;
+    return DestP - StartP;
 }
 
 void	ED_BufferDoFilter(ED_BufferPointer BufP, void (*UpdateFuncP)(Int16, void *), void * DataP)
 {
-    Int32	L, CurPos, Col;
-    Int32	NextUpdate;
-    Int16	Percent;
-    char	*CurP;
+    char	*MemP, *DestP, *SrcP, *SegEndP;
+    Int64	MemLen, Len, Done, Total;
+    Int32	Col;
+    Int16	Percent, CR, Seg;
 
     // NOTE:	Easy to strcat a ".sc" to the FileName, since it is being
     //		filtered and we don't want to accidentally overwrite the
@@ -7077,39 +11273,47 @@ void	ED_BufferDoFilter(ED_BufferPointer BufP, void (*UpdateFuncP)(Int16, void *)
 
     BufP->Flags |= ED_BUFFILTERFLAG;
     if (UpdateFuncP) (*UpdateFuncP)(-1, DataP);		// Initialize
-    
-    Percent = 10;
-    NextUpdate = ((Int64)Percent * (Int64)BufP->LastPos) / 100;
-    
-    Col = CurPos = 0;
-    while (CurPos < BufP->LastPos) {			// LastPos will change during loop!
-	CurP = ED_BufferPosToPtr(BufP, CurPos);
 
-	if (*CurP == '\n')
-	    Col = 0;
-	else if (*CurP == 0x0d) {
-	    CurPos = ED_AuxReplaceCR(BufP, CurPos);
-	    CurP = ED_BufferPosToPtr(BufP, CurPos);
-	    Col = 0;
-	} else if (*CurP == 0x09) {
-	    CurPos = ED_AuxReplaceTab(BufP, CurPos, &Col);
-	    CurP = ED_BufferPosToPtr(BufP, CurPos);
-	} else
-	    Col += 1;
+    MemLen = ED_AuxFilterSize(BufP->BufStartP, BufP->GapStartP - BufP->BufStartP) +
+	     ED_AuxFilterSize(BufP->GapEndP, BufP->BufEndP - BufP->GapEndP) + ED_GAPEXTRAEXPAND;
+    MemP = malloc(MemLen);
+    if (MemP == NULL) G_SETEXCEPTION_L("Malloc Filter Buf Failed", MemLen);
 
-	if (CurPos > NextUpdate) {
-	    if (UpdateFuncP) {
+    Percent = 10;
+    Total = BufP->LastPos;
+    Done = Col = CR = 0;
+    DestP = MemP;
+
+    // Before the Gap, then after it... in chunks, just for progress updates.
+    for (Seg = 0; Seg < 2; Seg++) {
+	SrcP = (Seg) ? BufP->GapEndP : BufP->BufStartP;
+	SegEndP = (Seg) ? BufP->BufEndP : BufP->GapStartP;
+	while (SrcP < SegEndP) {
+	    Len = (SegEndP - SrcP > ED_FILTERCHUNK) ? ED_FILTERCHUNK : SegEndP - SrcP;
+	    DestP += ED_AuxFilterCopy(DestP, SrcP, Len, &Col, &CR);
+	    SrcP += Len;
+	    Done += Len;
+
+	    while (UpdateFuncP && (Percent < 100) && (Done * 100 >= Percent * Total)) {
 		(*UpdateFuncP)(Percent, DataP);
-		usleep(50000);
+		Percent += 10;
 	    }
-	    Percent += 10;				// Re-calc NextUpdate, LastPos changes!
-	    NextUpdate = ((Int64)Percent * (Int64)BufP->LastPos) / 100;
 	}
-
-	L = ED_BufferGetUTF8Len(*CurP);
-	CurPos += L;
     }
+    if (CR) *DestP++ = '\n';				// CR at the very end
 
+    // Swap in the new memory, Gap at the end.
+    ED_BufferFreeMem(BufP);
+    BufP->Flags &= ~ED_BUFMAPPEDFLAG;
+    BufP->BufStartP = MemP;
+    BufP->GapStartP = DestP;
+    BufP->GapEndP = BufP->BufEndP = MemP + MemLen;
+    BufP->LastPos = DestP - MemP;
+
+    ED_BufferLIdxReset(BufP);				// CR replaced, bypassed Undo
+    ED_BufferRIdxReset(BufP);
+    ED_BufferPIdxReset(BufP);
+    ED_ISSetInvalidate(BufP);
     BufP->Flags |= ED_BUFMODFLAG;			// Changed!		
 }
 
@@ -7118,7 +11322,7 @@ void	ED_BufferDoFilter(ED_BufferPointer BufP, void (*UpdateFuncP)(Int16, void *)
 // etc.  This function is basically called to create RO information buffers, list
 // of commands, etc.
 
-Int32	ED_BufferInsertLine(ED_BufferPointer BufP, Int32 Pos, char * StrP)
+Int64	ED_BufferInsertLine(ED_BufferPointer BufP, Int64 Pos, char * StrP)
 {
     Int16	StrLen;
 
@@ -7128,6 +11332,10 @@ Int32	ED_BufferInsertLine(ED_BufferPointer BufP, Int32 Pos, char * StrP)
     memmove(BufP->GapStartP, StrP, StrLen);
     BufP->GapStartP += StrLen;
     *(BufP->GapStartP++) = '\n';
+    ED_BufferLIdxUpdate(BufP, Pos, StrLen + 1, BufP->GapStartP - (StrLen + 1));
+    ED_BufferRIdxUpdate(BufP, Pos, StrLen + 1);
+    ED_BufferPIdxUpdate(BufP, Pos, StrLen + 1, BufP->GapStartP - (StrLen + 1));
+    ED_ISSetInvalidate(BufP);
     
     BufP->LastPos += StrLen + 1;
     return Pos + StrLen + 1;
@@ -7135,6 +11343,8 @@ Int32	ED_BufferInsertLine(ED_BufferPointer BufP, Int32 Pos, char * StrP)
 
 Int16	ED_BufferReadOnly(ED_BufferPointer BufP)
 {
+    if (ED_BufferLoading(BufP)) return 1;
+
     if (BufP->Flags & ED_BUFREADONLYFLAG) {
 	ED_FrameSetEchoS(ED_ECHOMSGMODE, ED_STR_EchoReadOnly);
 	ED_FrameDrawEchoLine(ED_CurFrameP);
@@ -7214,7 +11424,7 @@ void	ED_AuxCmdDoShiftSel(ED_PanePointer PaneP)
 //
 // NOTE:	All parts of a UTF8 assembly (from First to last) have the high-bit set,
 //		so are numerically >= 128.  Therefore count as IsAlpha!
-Int16	ED_AuxCmdInWordScan(ED_PanePointer PaneP, Int16 InWord, Int32 Dir, Int32 PosLimit)
+Int16	ED_AuxCmdInWordScan(ED_PanePointer PaneP, Int16 InWord, Int32 Dir, Int64 PosLimit)
 {
     Int16	In;
     char	*CurP;
@@ -7366,7 +11576,8 @@ void	ED_AuxFillHelpBuf(ED_BufferPointer BufP)
     ED_FRegPointer	FRP;
     ED_FBindPointer	FBP;
     Int16		Count;
-    Int32		Pos, L, Len;
+    Int32		L, Len;
+    Int64		Pos;
     char		Str[512];
     char		KeyS[128];
 
@@ -7481,7 +11692,7 @@ void	ED_CmdQuitAction(ED_PanePointer PaneP)		// C-g (more like cancel/abort)
 void	ED_CmdSetMark(ED_PanePointer PaneP)
 {
     if (ED_CmdMult == 4) {				// "C-u C-spc" or "C-u 4 C-spc"
-	Int32		RowStartPos;
+	Int64		RowStartPos;
 
 	PaneP->CursorPos = ED_BufferGetMark(PaneP->BufP, 1);	// Pop the last Mark
 	RowStartPos = ED_PaneFindLoc(PaneP, PaneP->CursorPos, &PaneP->CursorRow, &PaneP->CursorCol, 0, 0);
@@ -7510,7 +11721,8 @@ void	ED_CmdGetCursorInfo(ED_PanePointer PaneP)
     if (PaneP->CursorPos == PaneP->BufP->LastPos) {		// EOB case
 	ED_FrameSPrintEchoS(ED_ECHOMSGMODE, ED_STR_EchoEOBCursorInfo, 
 		 PaneP->CursorPos + 1, PaneP->BufP->LastPos,
-		 PaneP->CursorCol, PaneP->CursorRow);
+		 PaneP->CursorCol, PaneP->CursorRow,
+		 ED_BufferPosToLine(PaneP->BufP, PaneP->CursorPos) + 1);
     } else {							// NOT EOB
 
 	CurP = ED_BufferPosToPtr(PaneP->BufP, PaneP->CursorPos);
@@ -7532,7 +11744,8 @@ void	ED_CmdGetCursorInfo(ED_PanePointer PaneP)
         ED_FrameSPrintEchoS(ED_ECHOMSGMODE, ED_STR_EchoCursorInfo, (L == 1) ? CharName : TheChar, CharNum,
 		 PaneP->CursorPos + 1, PaneP->BufP->LastPos,
 		 (PaneP->CursorPos * 100) / (PaneP->BufP->LastPos - 1),
-		 PaneP->CursorCol, PaneP->CursorRow);
+		 PaneP->CursorCol, PaneP->CursorRow,
+		 ED_BufferPosToLine(PaneP->BufP, PaneP->CursorPos) + 1);
     }
     
     ED_FrameDrawEchoLine(PaneP->FrameP);
@@ -7544,7 +11757,7 @@ void	ED_CmdGoNextChar(ED_PanePointer PaneP)
 {
     ED_BufferPointer	BufP = PaneP->BufP;
     char		*CurP;
-    Int32		RowStartPos = -1;
+    Int64		RowStartPos = -1;
 
     if (ED_CmdMultNeg) {
 	ED_CmdMultNeg = 0;
@@ -7571,8 +11784,8 @@ void	ED_CmdGoNextChar(ED_PanePointer PaneP)
 // ******************************************************************************
 void	ED_CmdGoNextWord(ED_PanePointer PaneP)
 {
-    Int32		LastPos = PaneP->BufP->LastPos;
-    Int32		RowStartPos = -1;
+    Int64		LastPos = PaneP->BufP->LastPos;
+    Int64		RowStartPos = -1;
     char		*CurP;
 
     if (ED_CmdMultNeg) {
@@ -7604,7 +11817,7 @@ DoneDone:
 void	ED_CmdGoPrevChar(ED_PanePointer PaneP)
 {
     char		*CurP;
-    Int32		RowStartPos = -1;
+    Int64		RowStartPos = -1;
 
     if (ED_CmdMultNeg) {
 	ED_CmdMultNeg = 0;
@@ -7636,7 +11849,7 @@ void	ED_CmdGoPrevChar(ED_PanePointer PaneP)
 void	ED_CmdGoPrevWord(ED_PanePointer PaneP)
 {
     char		*CurP;
-    Int32		RowStartPos = -1;
+    Int64		RowStartPos = -1;
 
     if (ED_CmdMultNeg) {
 	ED_CmdMultNeg = 0;
@@ -7678,7 +11891,7 @@ DoneDone:
 // of another long line.  Any intervening other command will re-set this.
 void	ED_CmdGoNextRow(ED_PanePointer PaneP)
 {
-    Int32	RowStartPos = -1;
+    Int64	RowStartPos = -1;
 
     if (ED_CmdMultNeg) {
 	ED_CmdMultNeg = 0;
@@ -7710,7 +11923,7 @@ void	ED_CmdGoNextRow(ED_PanePointer PaneP)
 // of another long line.  Any intervening other command will re-set this.
 void	ED_CmdGoPrevRow(ED_PanePointer PaneP)
 {
-    Int32	RowStartPos = -1;
+    Int64	RowStartPos = -1;
 
     if (ED_CmdMultNeg) {
 	ED_CmdMultNeg = 0;
@@ -7745,7 +11958,8 @@ void	ED_CmdGoPrevRow(ED_PanePointer PaneP)
 // Place cursor on same "relative" row as before.
 void	ED_CmdGoNextPage(ED_PanePointer PaneP)
 {
-    Int32	DeltaRow, Col;
+    Int64	DeltaRow;
+    Int32	Col;
 
     if (ED_CmdMultNeg) {
 	ED_CmdMultNeg = 0;
@@ -7777,7 +11991,8 @@ void	ED_CmdGoNextPage(ED_PanePointer PaneP)
 // Place cursor on same "relative" row as before.
 void	ED_CmdGoPrevPage(ED_PanePointer PaneP)
 {
-    Int32	DeltaRow, Col;
+    Int64	DeltaRow;
+    Int32	Col;
 
     if (ED_CmdMultNeg) {
 	ED_CmdMultNeg = 0;
@@ -7865,7 +12080,7 @@ DoItAgain:
 // ******************************************************************************
 void	ED_CmdGoBufEnd(ED_PanePointer PaneP)
 {
-    Int32	RowStartPos;
+    Int64	RowStartPos;
     
     if (ED_SelPaneP) ED_SelPaneP = NULL;
 
@@ -7945,7 +12160,7 @@ void	ED_CmdRecenterPage(ED_PanePointer PaneP)
 // Currently not BOUND to a key, invoked with a triple mouse click.
 void	ED_CmdSelectLine(ED_PanePointer PaneP)
 {
-    Int32		Pos;
+    Int64		Pos;
 
     ED_SelPaneP = PaneP;
     if (PaneP->CursorPos) {
@@ -7970,7 +12185,7 @@ void	ED_CmdSelectLine(ED_PanePointer PaneP)
 // ******************************************************************************
 void	ED_CmdSelectAll(ED_PanePointer PaneP)
 {
-    Int32	Pos;
+    Int64	Pos;
 
     Pos = PaneP->BufP->LastPos;
 
@@ -8001,10 +12216,10 @@ void	ED_CmdSelectAll(ED_PanePointer PaneP)
 typedef Int16 (*ED_SLPredP)(char A, char B);
 
 // AUX -- Selects a range, depending on the selection predicate function
-void	ED_AuxCmdSelectLike(ED_PanePointer PaneP, ED_SLPredP PredP, Int32 *StartPosP, Int32 *EndPosP)
+void	ED_AuxCmdSelectLike(ED_PanePointer PaneP, ED_SLPredP PredP, Int64 *StartPosP, Int64 *EndPosP)
 {
     ED_BufferPointer	BufP = PaneP->BufP;
-    Int32		S, E;
+    Int64		S, E;
     char		*CurP, C;
 
     S = PaneP->CursorPos;
@@ -8049,7 +12264,7 @@ Int16	EDCB_IdentPred(char A, char B)		// Must match first char!
 
 void	ED_CmdSelectArea(ED_PanePointer PaneP)
 {
-    Int32	StartPos, EndPos, RowStart;
+    Int64	StartPos, EndPos, RowStart;
     char	*CurP;
 
     ED_SelPaneP = NULL;
@@ -8081,13 +12296,13 @@ void	ED_CmdSelectArea(ED_PanePointer PaneP)
 // Set SelMark at Cursor, then pop the last Mark and move the cursor there.
 void	ED_CmdExchMark(ED_PanePointer PaneP)
 {
-    Int32	RowStartPos;
+    Int64	RowStartPos;
 
     if (ED_SelPaneP == PaneP) {
 	// Already have a selection going, switch Mark+Cursor
 
-	Int32	OldMarkPos = ED_SelMarkPos;
-	Int32	OldMarkRow = ED_SelMarkRow;
+	Int64	OldMarkPos = ED_SelMarkPos;
+	Int64	OldMarkRow = ED_SelMarkRow;
 	Int32	OldMarkCol = ED_SelMarkCol;
 
 	ED_SelMarkPos = PaneP->CursorPos;
@@ -8159,7 +12374,8 @@ void	ED_CmdInsertTab(ED_PanePointer PaneP)
 void	ED_CmdDelNextChar(ED_PanePointer PaneP)
 {
     ED_BufferPointer	BufP = PaneP->BufP;
-    Int32		Col, Total = 0;
+    Int32		Col;
+    Int64		Total = 0;
     Int16		L;
     char		*CurP;
 
@@ -8216,7 +12432,9 @@ void	ED_CmdDelNextChar(ED_PanePointer PaneP)
 void	ED_CmdDelNextWord(ED_PanePointer PaneP)
 {
     ED_BufferPointer	BufP = PaneP->BufP;
-    Int32		StartPos, Col, Total = 0;
+    Int32		Col;
+    Int64		Total = 0;
+    Int64		StartPos;
     char		*CurP;
 
     if (ED_BufferReadOnly(BufP)) return;
@@ -8282,7 +12500,9 @@ DoneDone:
 void	ED_CmdDelPrevChar(ED_PanePointer PaneP)
 {
     ED_BufferPointer	BufP = PaneP->BufP;
-    Int32		Col, RowStartPos, Total = 0;
+    Int32		Col;
+    Int64		Total = 0;
+    Int64		RowStartPos;
     Int16		L;
     char		*CurP;
 
@@ -8348,7 +12568,9 @@ void	ED_CmdDelPrevChar(ED_PanePointer PaneP)
 void	ED_CmdDelPrevWord(ED_PanePointer PaneP)
 {
     ED_BufferPointer	BufP = PaneP->BufP;
-    Int32		StartPos, Col, RowStartPos, Total = 0;
+    Int32		Col;
+    Int64		Total = 0;
+    Int64		StartPos, RowStartPos;
     char		*CurP;
 
     if (ED_BufferReadOnly(BufP)) return;    
@@ -8427,7 +12649,9 @@ DoneDone:
 void	ED_CmdDelHSpace(ED_PanePointer PaneP)
 {
     ED_BufferPointer	BufP = PaneP->BufP;
-    Int32		StartPos, EndPos, Len, RowStartPos, Col;
+    Int64		Len;
+    Int32		Col;
+    Int64		StartPos, EndPos, RowStartPos;
     char		*CurP;
 
     if (ED_BufferReadOnly(BufP)) return;	
@@ -8494,7 +12718,9 @@ void	ED_CmdDelHSpace(ED_PanePointer PaneP)
 void	ED_CmdJoinLines(ED_PanePointer PaneP)
 {
     ED_BufferPointer	BufP = PaneP->BufP;
-    Int32		StartPos, EndPos, Len, RowStartPos, Col;
+    Int64		Len;
+    Int32		Col;
+    Int64		StartPos, EndPos, RowStartPos;
     char		*CurP;
 
     if (ED_BufferReadOnly(BufP)) return;	
@@ -8525,7 +12751,7 @@ void	ED_CmdJoinLines(ED_PanePointer PaneP)
 	
 	*BufP->GapStartP++ = ' ';
 	BufP->LastPos -= Len - 1;
-	ED_BufferAddUndoBlock(BufP, StartPos, 1, ED_UB_ADD | ED_UB_CHAIN, NULL);
+	ED_BufferAddUndoBlock(BufP, StartPos, 1, ED_UB_ADD | ED_UB_CHAIN, BufP->GapStartP - 1);
 	
 	BufP->Flags |= ED_BUFMODFLAG;
 
@@ -8593,7 +12819,8 @@ void	ED_AuxDoCaseConvert(char *StartP, char *EndP, char Case)
 void	ED_AuxCaseConvertWord(ED_PanePointer PaneP, char Case)
 {
     ED_BufferPointer		BufP = PaneP->BufP;
-    Int32			StartPos, EndPos, Total, RowStartPos;
+    Int64			Total;
+    Int64			StartPos, EndPos, RowStartPos;
     char			*CurP;
 
     if (ED_BufferReadOnly(BufP)) return;
@@ -8667,7 +12894,7 @@ void	ED_CmdCapitalizeWord(ED_PanePointer PaneP)
 
 #define		ED_GOTOMAXLEN	9
 
-char	ED_AuxCharIsDigit(ED_BufferPointer BufP, Int32 Pos)
+char	ED_AuxCharIsDigit(ED_BufferPointer BufP, Int64 Pos)
 {
     char	*P;
     
@@ -8680,9 +12907,10 @@ char	ED_AuxCharIsDigit(ED_BufferPointer BufP, Int32 Pos)
 
 // Return 1 if done, 0 if failed.
 // Will NULL terminate StrP !
-Int16	ED_AuxCollectNumber(ED_BufferPointer BufP, Int32 Pos, char *StrP, Int32 MaxLen)
+Int16	ED_AuxCollectNumber(ED_BufferPointer BufP, Int64 Pos, char *StrP, Int32 MaxLen)
 {
-    Int32	Len, CurPos;
+    Int32	Len;
+    Int64	CurPos;
 
     if (ED_AuxCharIsDigit(BufP, Pos))
 	CurPos = Pos;
@@ -8710,15 +12938,10 @@ Int16	ED_AuxCollectNumber(ED_BufferPointer BufP, Int32 Pos, char *StrP, Int32 Ma
 
 void	ED_AuxGotoLine(ED_PanePointer PaneP, Int32 Numb)
 {
-    Int32	Pos;
+    Int64	Pos;
 
-    Pos = 0;
-    if (Numb > 1) {
-	Numb -= 1;		// Convert to 0-based
-	ED_BufferGetLineCount(PaneP->BufP, &Pos, &Numb);
-	if (Pos < PaneP->BufP->LastPos)
-	    Pos += 1;
-    }
+    // LineIdx is 0-based, returns LastPos if past the end.
+    Pos = ED_BufferLineToPos(PaneP->BufP, Numb - 1);
 
     ED_BufferPushMark(PaneP->BufP, Pos);
     PaneP->CursorPos = Pos;
@@ -8776,7 +12999,7 @@ void	ED_CmdGotoLine(ED_PanePointer PaneP)
 
 void	ED_AuxGotoChar(ED_PanePointer PaneP, Int32 Numb)
 {
-    Int32	Pos;
+    Int64	Pos;
 
     Pos = Numb - 1;		// 1-based for used, 0-based internally!
     if (Pos < 0) Pos = 0;
@@ -8843,8 +13066,8 @@ Int16	ED_YankIsExternal;
 void	ED_CmdYank(ED_PanePointer PaneP)
 {
     char	*DataP;
-    Int32	DataLen;
-    Int32	StartPos;
+    Int64	DataLen;
+    Int64	StartPos;
     Int32	PopCount;
 
     if (ED_BufferReadOnly(PaneP->BufP)) return;
@@ -8879,7 +13102,7 @@ void	ED_CmdYank(ED_PanePointer PaneP)
 void	ED_CmdYankPop(ED_PanePointer PaneP)
 {
     char	*DataP;
-    Int32	DataLen;
+    Int64	DataLen;
     Int32	PopCount;
 
     if (ED_BufferReadOnly(PaneP->BufP)) return;    
@@ -8914,7 +13137,9 @@ void	ED_CmdYankPop(ED_PanePointer PaneP)
 void	ED_CmdKillLine(ED_PanePointer PaneP)
 {
     ED_BufferPointer	BufP = PaneP->BufP;
-    Int32		StartPos, EndPos, Total, RowStartPos;
+    Int64		Total;
+    Int64		StartPos, EndPos, RowStartPos;
+    Int32		Ignore;
     char		*CurP;
     Int16		Forward;
 
@@ -8996,7 +13221,7 @@ void	ED_CmdKillLine(ED_PanePointer PaneP)
 
 	BufP->GapEndP += Total;
 	BufP->LastPos -= Total;
-	ED_PaneFindLoc(PaneP, BufP->LastPos, &PaneP->BufRowCount, &RowStartPos, 0, 0);	// Recycled RowStartPos
+	ED_PaneFindLoc(PaneP, BufP->LastPos, &PaneP->BufRowCount, &Ignore, 0, 0);
 	PaneP->BufRowCount += PaneP->StartRowCount;		// Need Abs not Pane-rel
 	ED_BufferUpdateMark(BufP, StartPos, - Total);
 
@@ -9040,10 +13265,11 @@ void	ED_CmdKillRegion(ED_PanePointer PaneP)
 // ******************************************************************************
 // ED_CmdCopyRegion
 
-Int32	ED_AuxCopySelRange(ED_PanePointer PaneP)
+Int64	ED_AuxCopySelRange(ED_PanePointer PaneP)
 {
     ED_BufferPointer	BufP = PaneP->BufP;
-    Int32		StartPos, EndPos, Total;
+    Int64		Total;
+    Int64		StartPos, EndPos;
 
     if ((ED_SelPaneP != PaneP) || (ED_SelMarkPos == PaneP->CursorPos))
 	return 0;
@@ -9066,6 +13292,12 @@ Int32	ED_AuxCopySelRange(ED_PanePointer PaneP)
 
 void	ED_CmdCopyRegion(ED_PanePointer PaneP)
 {
+    // The Gap is the loader's, see ED_BufferPlaceGap.
+    if (PaneP->BufP->Flags & ED_BUFLOADINGFLAG) {
+	ED_BufferLoading(PaneP->BufP);
+	return;
+    }
+
     // Set so KillRingAdd does the right thing
     ED_CmdThisId = ED_KillId;
 
@@ -9115,7 +13347,8 @@ void	ED_CmdModBuffer(ED_PanePointer PaneP)
 Int16	EDCB_PUMLDraw(ED_PUPointer PUP, Int32 CurEntry, Int32 StartX, Int32 CharLimit, Int32 StartY)
 {
     ED_BufferPointer	BufP = PUP->PaneP->BufP;
-    Int32		Pos, Col, DeltaRow, MarkRow, MarkCol, MarkPos, MarkIndex;
+    Int32		Col, MarkCol, MarkIndex;
+    Int64		Pos, MarkPos, DeltaRow, MarkRow;
     Int32		LineX, LineY, CharCount, LineCount;
     Int16		DrawFlags, LineWrap, Partial, Color;
     char		* CharP;
@@ -9153,7 +13386,7 @@ Int16	EDCB_PUMLDraw(ED_PUPointer PUP, Int32 CurEntry, Int32 StartX, Int32 CharLi
 	    if (Col + 1 > PUP->EntryCharMax) PUP->EntryCharMax = Col + 1;
 	    if ((Col + 1 - PUP->EntryCharScroll) > CharLimit) DrawFlags |= ED_PU_DRAWRSCROLLFLAG;
 	    if (CharCount) {
-		XftDrawStringUtf8(PUP->XftDP, &ED_XCArr[ED_Black], ED_XFP, LineX, LineY + ED_Ascent, (XftChar8 *)CharP, CharCount);
+		ED_GlyphDrawRun(PUP->XftDP, ED_Black, LineX, LineY + ED_Ascent, CharP, CharCount);
 		LineX += (Col * ED_Advance);
 		if (LineWrap || (Col > (CharLimit + PUP->EntryCharScroll))) break;
 	    }
@@ -9173,7 +13406,7 @@ void	EDCB_PUMLSelect(ED_PUPointer PUP)
 {
     ED_PanePointer		PaneP = PUP->PaneP;
     ED_BufferPointer		BufP = PaneP->BufP;
-    Int32			MarkPos, RowStartPos;
+    Int64			MarkPos, RowStartPos;
 
     BufP->MarkRingIndex = (BufP->MarkRingIndex - PUP->EntrySel) & ED_MARKRINGMASK;    
     MarkPos = BufP->MarkRingArr[BufP->MarkRingIndex];
@@ -9205,13 +13438,14 @@ Int16	EDCB_PUKLDraw(ED_PUPointer PUP, Int32 CurEntry, Int32 StartX, Int32 CharLi
 {
     Int16		CurI;
     char		*CurKillP, *TextP;
-    Int32		TextLen, ByteCount, CharCount, RowCount;
+    Int64		TextLen;
+    Int32		ByteCount, CharCount, RowCount;
     Int32		EmptyLen = strlen(ED_STR_PUEmptyList);
     Int16		DrawFlags;
 
     DrawFlags = 0;
     CurI = (ED_KillRing.TopI - CurEntry) & ED_KILLRINGMASK;
-    CurKillP = (CurI == ED_KillRing.TopI) ? ED_KillRing.TopP : ED_KillRing.RestP;
+    CurKillP = ED_KillRing.EltArr[CurI].MemP;
 
     StartY += ED_Ascent;
     StartX -= (PUP->EntryCharScroll * ED_Advance);
@@ -9223,12 +13457,13 @@ Int16	EDCB_PUKLDraw(ED_PUPointer PUP, Int32 CurEntry, Int32 StartX, Int32 CharLi
 	RowCount = 0;
 	TextP = CurKillP + ED_KillRing.EltArr[CurI].Pos;
 	
-	while ( (ByteCount = ED_UtilGetLineEnd(TextP, TextLen, &CharCount)) ) {
+	// Only EntryRows lines are shown, a (huge) entry is scanned 2GB at most.
+	while ( (ByteCount = ED_UtilGetLineEnd(TextP, (TextLen > INT32_MAX) ? INT32_MAX : (Int32)TextLen, &CharCount)) ) {
 	    if (CharCount > PUP->EntryCharMax) PUP->EntryCharMax = CharCount;
 	    if ((CharCount - PUP->EntryCharScroll) > CharLimit) DrawFlags |= ED_PU_DRAWRSCROLLFLAG;
 	    // Relies on the ClipRect, can start/stop OFF screen!
 	    if (CharCount)
-		XftDrawStringUtf8(PUP->XftDP, &ED_XCArr[ED_Black], ED_XFP, StartX, StartY, (XftChar8 *)TextP, ByteCount);
+		ED_GlyphDrawRun(PUP->XftDP, ED_Black, StartX, StartY, TextP, ByteCount);
 
 	    ByteCount += 1;		// To skip over the \n char!
 	    TextLen -= ByteCount;
@@ -9261,8 +13496,8 @@ void	EDCB_PUKLSelect(ED_PUPointer PUP)
 {
     ED_PanePointer	PaneP = PUP->PaneP;
     char		*DataP;
-    Int32		DataLen;
-    Int32		StartPos;
+    Int64		DataLen;
+    Int64		StartPos;
 
     if (ED_BufferReadOnly(PaneP->BufP)) return;
     
@@ -9419,12 +13654,14 @@ void	ED_FrameExecPUCmd()
 {
     ED_PanePointer	PaneP = ED_CLPUP->PaneP;
     ED_FRegFuncP	FuncP = ED_CLPUP->CLCmdFP;
+    ED_FRegPointer	FRegP = ED_FRegFindFunc(FuncP);
 
     ED_CmdMult = 1;
     ED_CmdThisId = (Uns64)FuncP;
 	ED_CLPUP->PaneP = NULL;		// Cleanup
 	ED_CLPUP->CLCmdFP = NULL;
-	(*FuncP)(PaneP);		// Exec
+	if (FRegP) ED_FRegExec(FRegP, PaneP);	// Exec
+	else (*FuncP)(PaneP);
     ED_CmdLastId = ED_CmdThisId;
 }
 
@@ -9600,6 +13837,7 @@ Int16	EDCB_OverwriteFunc(void)
 	if ((C == 'y') || (C == 'Y')) {
 	    // DO OVERWRITE the existing file!
 	    // Include O_TRUC so file can get smaller than before
+	    ED_BufferUnmapPath(ED_FullPath);
 	    ED_FD = open(ED_FullPath, O_TRUNC | O_WRONLY, 0);
 	    if (ED_FD == -1) {
 		ED_QRPaneP = NULL;
@@ -9684,6 +13922,7 @@ void	ED_CmdWriteFile(ED_PanePointer PaneP)
 {
     char	RespS[ED_RESPSTRLEN];
     
+    if (ED_BufferLoading(PaneP->BufP)) return;			// Would write a partial file
     sprintf(RespS, "%.*s/", ED_RESPSTRLEN - 16, PaneP->BufP->PathName);
     ED_FrameQRAsk(PaneP->FrameP, ED_STR_QueryWriteFile, RespS, ED_QRStringType, EDCB_WriteFileFunc, EDCB_QRAutoCompPathFunc);
 }
@@ -9696,27 +13935,23 @@ void	ED_CmdWriteFile(ED_PanePointer PaneP)
 // return 0 --> Failure
 Int16	ED_AuxSaveFunc(ED_BufferPointer BufP, ED_FramePointer ThisFrameP)
 {
-    Int16		WFail;
     Int32		WErr;
     
-    // File DOES need saving if we get here... Assemble the full path and open it
-    ED_FullPathLen = sprintf(ED_FullPath, "%s/%s", BufP->PathName, BufP->FileName);
-    ED_FD = open(ED_FullPath, O_TRUNC | O_WRONLY, 0);
-    if (ED_FD == -1) {
-	ED_FrameSetEchoError(ED_STR_EchoOpenFailed, errno);
+    if (BufP->Flags & ED_BUFSAVINGFLAG) {
+	ED_FrameSetEchoS(ED_ECHOMSGMODE, ED_STR_EchoSaveInFlight);
 	return 0;
     }
 
-    WFail = ED_BufferWriteFile(BufP, ED_FD);
-    WErr = errno;
-    close(ED_FD);
-
-    if (WFail) {
+    // File DOES need saving if we get here... Assemble the full path and queue it.
+    // ED_SaveFinish calls ED_BufferDidSave when the write is done.
+    ED_FullPathLen = sprintf(ED_FullPath, "%s/%s", BufP->PathName, BufP->FileName);
+    WErr = ED_SaveQueueJob(BufP);
+    if (WErr) {
 	ED_FrameSetEchoError(ED_STR_EchoWriteFailed, WErr);
 	return 0;
     }
 
-    ED_BufferDidSave(BufP, ThisFrameP);
+    ED_FrameSPrintEchoS(ED_ECHOMSGMODE, ED_STR_EchoSaving, NAME_MAX, BufP->FileName);
     return 1;
 }
 
@@ -9778,9 +14013,19 @@ DoneDone:
 // ******************************************************************************
 // Abort out of save sequence if C-g !!
 
-Int32	ED_CmdSaveFileCount;
 Int16	EDCB_SaveSomeFunc(void);
 
+// ED_AuxSaveSomeReport shows the count, once no more Bufs are asked about
+// and all their Jobs are done.
+void	ED_AuxSaveSomeReport(void)
+{
+    if (ED_CmdSaveAsking || ED_CmdSaveFileLeft) return;
+
+    if (ED_CmdSaveFileCount)
+	ED_FrameSPrintEchoS(ED_ECHOMSGMODE, ED_STR_EchoSavedNFiles, ED_CmdSaveFileCount);
+    ED_CmdSaveFileCount = 0;
+}
+
 // Return 1 --> Stop looping, waiting on QRAsk
 // Return 0 --> Keep looping.
 Int16	ED_AuxSaveSomeFiles(ED_PanePointer PaneP, ED_BufferPointer BP)
@@ -9794,8 +14039,10 @@ Int16	ED_AuxSaveSomeFiles(ED_PanePointer PaneP, ED_BufferPointer BP)
 	return 1;
     }
 
+    ED_SaveBatchTag = ED_CmdSaveBatch;
     if (ED_AuxSaveFunc(BP, PaneP->FrameP))
-	ED_CmdSaveFileCount += 1;	// Saved without having to ask!
+	ED_CmdSaveFileLeft += 1;	// Queued without having to ask!
+    ED_SaveBatchTag = 0;
     return 0;
 }
 
@@ -9820,8 +14067,10 @@ Int16	EDCB_SaveSomeFunc(void)
 	else
 	    return 1;			// bad response!  Get another one.
 
+	ED_SaveBatchTag = ED_CmdSaveBatch;
 	if (SaveIt && ED_AuxSaveFunc(ED_QRTempBufP, ED_QRPaneP->FrameP))
-	    ED_CmdSaveFileCount += 1;	// Saved after asking.
+	    ED_CmdSaveFileLeft += 1;	// Queued after asking.
+	ED_SaveBatchTag = 0;
 
 	// Now look at the other buffers, starting *AFTER* this one.
 	// Not recursive, as everything here is asynch... sets global and goes out to an event loop.
@@ -9838,8 +14087,8 @@ Int16	EDCB_SaveSomeFunc(void)
 	// All done with buffers if here!
 	PP = ED_QRPaneP;
 	ED_QRPaneP = NULL;
-	if (ED_CmdSaveFileCount)
-	    ED_FrameSPrintEchoS(ED_ECHOMSGMODE, ED_STR_EchoSavedNFiles, ED_CmdSaveFileCount);
+	ED_CmdSaveAsking = 0;
+	ED_AuxSaveSomeReport();
 
 	ED_FrameDrawAll(PP->FrameP);
 	return 0;
@@ -9853,7 +14102,9 @@ void	ED_CmdSaveSomeFiles(ED_PanePointer PaneP)
 {
     ED_BufferPointer	BP;
 
-    ED_CmdSaveFileCount = 0;
+    ED_CmdSaveFileCount = ED_CmdSaveFileLeft = 0;
+    ED_CmdSaveBatch += 1;			// Older Jobs no longer count
+    ED_CmdSaveAsking = 1;
     BP = ED_FirstBufP;
     while (BP) {
 	if ((BP->Flags & ED_BUFMODFLAG) && ! (BP->Flags & ED_BUFNOFILEFLAG))
@@ -9863,8 +14114,8 @@ void	ED_CmdSaveSomeFiles(ED_PanePointer PaneP)
         BP = BP->NextBufP;
     }
 
-    if (ED_CmdSaveFileCount)
-	ED_FrameSPrintEchoS(ED_ECHOMSGMODE, ED_STR_EchoSavedNFiles, ED_CmdSaveFileCount);
+    ED_CmdSaveAsking = 0;
+    ED_AuxSaveSomeReport();
 
     ED_FrameDrawAll(PaneP->FrameP);
 }
@@ -9931,10 +14182,11 @@ Exit:
 // Return -1 if launching QR query!
 Int16	ED_AuxCmdFindFile(ED_PanePointer PaneP, Int32 FD)
 {
-    ED_QRTempBufP = ED_BufferReadFile(FD, ED_Name, ED_Path);
+    ED_QRTempBufP = ED_BufferLoadFile(FD, ED_Name, ED_Path);
     if (ED_QRTempBufP == NULL) return 0;
 
-    if (ED_BufferNeedsFilter(ED_QRTempBufP)) {
+    // A background load filters (if need be) when it is done.
+    if (! (ED_QRTempBufP->Flags & ED_BUFLOADINGFLAG) && ED_BufferNeedsFilter(ED_QRTempBufP)) {
 	ED_FrameQRAsk(PaneP->FrameP, ED_STR_QueryFilterFile, NULL, ED_QRLetterType, EDCB_FindFileDoFilterFunc, NULL);
 	return -1;
     }else {
@@ -10463,55 +14715,34 @@ void	ED_CmdGetWorkingDir(ED_PanePointer PaneP)
 // Return 0 == Good response--i.e. DID complete
 // Return 1 == Bad response--i.e. cannot complete
 //
-// NOTE:	Our matching algorithm can be fooled
-//		if we have cmds named "ABC" and "ABCDE".  The
-//		matching algorithm thinks both are candidates when
-//		looking for "ABC", when in fact, the first is a
-//		perfect match.
+// The NameTrie Node for the Resp has the (sorted) range of matching commands,
+// so this costs the length of the Resp, not the number of commands.
 Int16	EDCB_AutoCompNamedCmdFunc(void)
 {
-    ED_FRegPointer	FRP, StartFRP, EndFRP;
+    ED_TrieNodePointer	NP;
+    ED_FRegPointer	StartFRP, EndFRP;
     char		StrP[ED_RESPSTRLEN];
-    Int16		Res;
-
-    // Search the function registry... can have a range of matches
-    FRP = ED_FirstFRegP;
-    StartFRP = EndFRP = NULL;
-    while (FRP) {
-	Res = strncmp(ED_QRRespS, FRP->NameP, ED_QRRespLen);
-	if (Res == 0) {
-	    // Found a match, but there may be others!!
-	    if (StartFRP == NULL)	// First in match range
-		StartFRP = FRP;
-	    EndFRP = FRP;		// Last in match range
-	} else if (Res < 0)
-	    break;
 
-	FRP = FRP->SortNextP;		// Sorted order, ESSENTIAL
-    }
+    if (ED_FRegStale) ED_FRegCompile();
 
-    if (StartFRP == NULL)		// Found nothing
+    NP = ED_TrieFind(&ED_NameTrie, ED_QRRespS, ED_QRRespLen);
+    if ((NP == NULL) || (NP->FirstP == NULL))	// Found nothing
 	return 1;
 
+    StartFRP = (ED_FRegPointer)NP->FirstP;
+    EndFRP = (ED_FRegPointer)NP->LastP;
+
     // Perfect match if StartFRP and EndFRP are the same.
-    // Also perfect match if StartFRP->NameP is exactly the same
-    // length as ED_QRRespS... since NameP CANNOT be shorter,
-    // we can test for that by checking that it is NOT LONGER!
-    if ((StartFRP == EndFRP) ||
-	(StartFRP->NameP[ED_QRRespLen] == 0)) {
-	ED_FrameQRSetResp(StartFRP->NameP);
+    // Also perfect match if a command ends right here.
+    if ((StartFRP == EndFRP) || NP->DataP) {
+	ED_FrameQRSetResp((NP->DataP) ? ((ED_FRegPointer)NP->DataP)->NameP : StartFRP->NameP);
 	return 0;
     }
 	
-    // Multiple matches, StartFRP != EndFRP.
-    // Do a string intersection to find longest matching substring!
+    // Multiple matches, StartFRP != EndFRP.  Names are sorted, so what
+    // they all have in common is what the first and last have in common.
     strcpy(StrP, StartFRP->NameP);
-    FRP = StartFRP->SortNextP;
-    while (FRP) {
-	ED_UtilIntersectStr(StrP, FRP->NameP);
-	if (FRP == EndFRP) break;
-	FRP = FRP->SortNextP;
-    }
+    ED_UtilIntersectStr(StrP, EndFRP->NameP);
     
     ED_FrameQRSetResp(StrP);
     return 0;
@@ -10522,23 +14753,16 @@ Int16	EDCB_AutoCompNamedCmdFunc(void)
 Int16	EDCB_ExecNamedCmdFunc(void)
 {
     ED_PanePointer	PaneP = ED_QRPaneP;
-    ED_FRegPointer	FRP = ED_FirstFRegP;
+    ED_TrieNodePointer	NP;
     ED_FRegPointer	MatchFRP = NULL;
-    Int16		Res;
 
-    while (FRP) {
-	Res = strncmp(ED_QRRespS, FRP->NameP, ED_QRRespLen);
-	if (Res == 0) {
-	    if (MatchFRP) return 1;	// Too many matches!
-	    else MatchFRP = FRP;
-	    // Check for perfect match--NameP is same Len as Resp!
-	    // (NameP cannot match and be shorter!)
-	    if (FRP->NameP[ED_QRRespLen] == 0)
-		break;
-	} else if (Res < 0)
-	    break;
+    if (ED_FRegStale) ED_FRegCompile();
 
-	FRP = FRP->SortNextP;
+    // A perfect match, or the only command with this prefix.
+    NP = ED_TrieFind(&ED_NameTrie, ED_QRRespS, ED_QRRespLen);
+    if (NP) {
+	if (NP->DataP) MatchFRP = (ED_FRegPointer)NP->DataP;
+	else if (NP->FirstP == NP->LastP) MatchFRP = (ED_FRegPointer)NP->FirstP;
     }
 
     // Found 1 good match: execute it, and get out of QR mode!
@@ -10552,7 +14776,7 @@ Int16	EDCB_ExecNamedCmdFunc(void)
 	}
 	
 	ED_CmdThisId = (Uns64)MatchFRP->FuncP;
-	    (*MatchFRP->FuncP)(PaneP);
+	    ED_FRegExec(MatchFRP, PaneP);
 	ED_CmdLastId = ED_CmdThisId;
 	ED_CmdMult = 1;
 	
@@ -10691,9 +14915,9 @@ void	ED_CmdDeleteOtherFrames(ED_PanePointer PaneP)
 // Return 0 -> No match
 // Return 1 -> *MATCH*
 // Uses *faster* ptr-based algorithm, skips over Gap.  (Instead of *simpler* Pos method.)
-Int16	ED_ISCheckMatch(ED_BufferPointer BufP, Int32 Pos)
+Int16	ED_ISCheckMatch(ED_BufferPointer BufP, Int64 Pos)
 {
-    Int32	CurPos = Pos;
+    Int64	CurPos = Pos;
     char	*CurP, *EndP, *MatchP;
     Int16	LoopBack;
     Int32	MatchLen;
@@ -10736,12 +14960,215 @@ DoRest:
     return 0;
 }
 
+// ******************************************************************************
+// IS search engine.
+//
+// ED_ISCheckMatch at every Pos restarts the compare each time, so a failing
+// search on a big Buf takes (BufLen * a few) steps.  Instead, use Horspool:
+// look at the LAST char of the window, and a precomputed table says how far
+// the window can jump if it is not a match.  Backward search is the mirror
+// image, keyed on the FIRST char of the window.  Single char searches just
+// use memchr (or ED_UtilScanByte2 for both cases of a letter) instead.
+//
+// Case folding is the same as ED_ISCheckMatch:  if not ED_ISCaseSen, ISStr
+// is all lowercase and only A-Z in the Buf are folded.  The tables are rebuilt
+// by ED_ISPrepare only when ISStr (or ISCaseSen) actually changed.
+//
+// Each side of the Gap is searched as one contiguous run, the (at most
+// ISStrLen - 1) windows straddling the Gap are left to ED_ISCheckMatch.
+
+char		ED_ISEngStr[ED_ISSTRLEN] = "";	// ISStr the tables were built for
+Int32		ED_ISEngStrLen = -1;
+Int16		ED_ISEngCaseSen = -1;
+Uns8		ED_ISEngFold[256];		// Fold table, identity if ISCaseSen
+Int32		ED_ISEngShift[256];		// Forward skip, keyed on last char
+Int32		ED_ISEngBackShift[256];		// Backward skip, keyed on first char
+
+void	ED_ISPrepare(void)
+{
+    Uns8	*PatP = (Uns8 *)ED_ISStr;
+    Int32	Len = ED_ISStrLen;
+    Int32	I;
+
+    if ((Len == ED_ISEngStrLen) && (ED_ISCaseSen == ED_ISEngCaseSen) &&
+	(0 == memcmp(ED_ISStr, ED_ISEngStr, Len)))
+	return;
+
+    for (I = 0; I < 256; I++) {
+	ED_ISEngFold[I] = I;
+	if (! ED_ISCaseSen && ('A' <= I) && (I <= 'Z'))
+	    ED_ISEngFold[I] = I + 'a' - 'A';
+	ED_ISEngShift[I] = ED_ISEngBackShift[I] = Len;
+    }
+
+    // Forward: distance from last occurrence (excluding last char) to the end.
+    for (I = 0; I < Len - 1; I++)
+	ED_ISEngShift[PatP[I]] = Len - 1 - I;
+
+    // Backward: distance from first occurrence (excluding first char) to the start.
+    for (I = Len - 1; I > 0; I--)
+	ED_ISEngBackShift[PatP[I]] = I;
+
+    memcpy(ED_ISEngStr, ED_ISStr, Len);
+    ED_ISEngStrLen = Len;
+    ED_ISEngCaseSen = ED_ISCaseSen;
+}
+
+// Compares window at TextP to ISStr, through the fold table.
+Int16	ED_ISEngCompare(Uns8 * TextP)
+{
+    Uns8	*PatP = (Uns8 *)ED_ISStr;
+    Int32	I;
+
+    if (ED_ISCaseSen) return (0 == memcmp(TextP, PatP, ED_ISStrLen));
+
+    for (I = 0; I < ED_ISStrLen; I++)
+	if (ED_ISEngFold[TextP[I]] != PatP[I]) return 0;
+
+    return 1;
+}
+
+// Searches a contiguous run at TextP for the first window starting in
+// [First, Last].  Caller guarantees Last + ISStrLen fits in the run.
+// Returns its offset, or -1.
+Int64	ED_ISEngForward(char * TextP, Int64 First, Int64 Last)
+{
+    Uns8	*TP = (Uns8 *)TextP;
+    Uns8	LastC = ED_ISStr[ED_ISStrLen - 1];
+    char	*P;
+    Int64	Offset;
+    Int32	C;
+
+    if (First > Last) return -1;
+
+    if (ED_ISStrLen == 1) {
+	if (ED_ISCaseSen || (LastC < 'a') || ('z' < LastC))
+	    P = memchr(TextP + First, LastC, Last - First + 1);
+	else
+	    P = ED_UtilScanByte2(TextP + First, TextP + Last + 1, LastC, LastC - 'a' + 'A');
+	return (P) ? P - TextP : -1;
+    }
+
+    Offset = First;
+    while (Offset <= Last) {
+	C = ED_ISEngFold[TP[Offset + ED_ISStrLen - 1]];
+	if ((C == LastC) && ED_ISEngCompare(TP + Offset))
+	    return Offset;
+	Offset += ED_ISEngShift[C];
+    }
+
+    return -1;
+}
+
+// Mirror image of ED_ISEngForward, returns the LAST window in [First, Last].
+Int64	ED_ISEngBackward(char * TextP, Int64 First, Int64 Last)
+{
+    Uns8	*TP = (Uns8 *)TextP;
+    Uns8	FirstC = ED_ISStr[0];
+    Int64	Offset;
+    Int32	C;
+
+    Offset = Last;
+    while (Offset >= First) {
+	C = ED_ISEngFold[TP[Offset]];
+	if ((C == FirstC) && ED_ISEngCompare(TP + Offset))
+	    return Offset;
+	Offset -= ED_ISEngBackShift[C];
+    }
+
+    return -1;
+}
+
+// Returns the FIRST Pos in [FirstPos, LastStart] that starts a full match, or -1.
+// Caller has done ED_ISPrepare, and LastStart is at most (LastPos - ISStrLen).
+// The near chunk is searched first, right here, the rest on the scan pool.
+Int64	ED_ISFindRange(ED_BufferPointer BufP, Int64 FirstPos, Int64 LastStart)
+{
+    Int64	Res, Near;
+    Int32	I;
+
+    Near = (LastStart - FirstPos >= ED_POOLCHUNK) ? FirstPos + ED_POOLCHUNK - 1 : LastStart;
+    Res = ED_AuxISFindRange(BufP, FirstPos, Near);
+    if ((Res >= 0) || (Near == LastStart)) return Res;
+
+    FirstPos = Near + 1;
+    if (! ED_PoolWanted(LastStart - FirstPos + 1)) return ED_AuxISFindRange(BufP, FirstPos, LastStart);
+
+    ED_PoolRun(BufP, FirstPos, LastStart + 1, EDCB_PoolISForward, ED_POOLFIRST);
+    for (I = 0; I < ED_PoolCount; I++)
+	if (ED_PoolArr[I].Count >= 0) return ED_PoolArr[I].Count;
+    return -1;
+}
+
+// Mirror image of ED_ISFindRange, returns the LAST match start in [FirstPos, LastStart].
+Int64	ED_ISFindRangeBack(ED_BufferPointer BufP, Int64 FirstPos, Int64 LastStart)
+{
+    Int64	Res, Near;
+    Int32	I;
+
+    Near = (LastStart - FirstPos >= ED_POOLCHUNK) ? LastStart - ED_POOLCHUNK + 1 : FirstPos;
+    Res = ED_AuxISFindRangeBack(BufP, Near, LastStart);
+    if ((Res >= 0) || (Near == FirstPos)) return Res;
+
+    LastStart = Near - 1;
+    if (! ED_PoolWanted(LastStart - FirstPos + 1)) return ED_AuxISFindRangeBack(BufP, FirstPos, LastStart);
+
+    ED_PoolRun(BufP, FirstPos, LastStart + 1, EDCB_PoolISBackward, ED_POOLLAST);
+    for (I = ED_PoolCount - 1; I >= 0; I--)
+	if (ED_PoolArr[I].Count >= 0) return ED_PoolArr[I].Count;
+    return -1;
+}
+
+// ED_AuxISFindRange and ED_AuxISFindRangeBack do the work, on just one thread.
+Int64	ED_AuxISFindRange(ED_BufferPointer BufP, Int64 FirstPos, Int64 LastStart)
+{
+    Int64	Res, GapPos;
+
+    GapPos = BufP->GapStartP - BufP->BufStartP;
+
+    // Before the Gap
+    Res = ED_ISEngForward(BufP->BufStartP, FirstPos, (LastStart < GapPos - ED_ISStrLen) ? LastStart : GapPos - ED_ISStrLen);
+    if (Res >= 0) return Res;
+
+    // Straddling the Gap
+    Res = (FirstPos > GapPos - ED_ISStrLen + 1) ? FirstPos : GapPos - ED_ISStrLen + 1;
+    for (; (Res < GapPos) && (Res <= LastStart); Res++)
+	if (ED_ISCheckMatch(BufP, Res)) return Res;
+
+    // After the Gap
+    Res = ED_ISEngForward(BufP->GapEndP, ((FirstPos > GapPos) ? FirstPos : GapPos) - GapPos, LastStart - GapPos);
+    if (Res >= 0) return Res + GapPos;
+
+    return -1;
+}
+
+Int64	ED_AuxISFindRangeBack(ED_BufferPointer BufP, Int64 FirstPos, Int64 LastStart)
+{
+    Int64	Res, GapPos;
+
+    GapPos = BufP->GapStartP - BufP->BufStartP;
+
+    // After the Gap
+    if (LastStart >= GapPos) {
+	Res = ED_ISEngBackward(BufP->GapEndP, ((FirstPos > GapPos) ? FirstPos : GapPos) - GapPos, LastStart - GapPos);
+	if (Res >= 0) return Res + GapPos;
+    }
+
+    // Straddling the Gap
+    Res = (LastStart < GapPos - 1) ? LastStart : GapPos - 1;
+    for (; (Res > GapPos - ED_ISStrLen) && (Res >= FirstPos); Res--)
+	if (ED_ISCheckMatch(BufP, Res)) return Res;
+
+    // Before the Gap
+    return ED_ISEngBackward(BufP->BufStartP, FirstPos, (LastStart < GapPos - ED_ISStrLen) ? LastStart : GapPos - ED_ISStrLen);
+}
+
 // Implements forward search.
 // Starts at StartPos, searches forward (to BufP->LastPos) to find a match.
 // Returns Pos that starts a full match, or -1 if it fails.
-Int32	ED_ISMatchForward(ED_BufferPointer BufP, Int32 StartPos)
+Int64	ED_ISMatchForward(ED_BufferPointer BufP, Int64 StartPos)
 {
-    Int32	CurPos = StartPos;
+    Int64	CurPos = StartPos;
 
     if (ED_ISDoWrap) {
 	ED_ISDoWrap = 0;
@@ -10753,23 +15180,19 @@ Int32	ED_ISMatchForward(ED_BufferPointer BufP, Int32 StartPos)
 	    return -1;
     }
 
-    while (CurPos < BufP->LastPos) {
-	if (ED_ISCheckMatch(BufP, CurPos)) {
-	    return CurPos;
-	}
-        CurPos++;
-    }
+    if (ED_ISStrLen == 0) return -1;
+    ED_ISPrepare();
 
-    return -1;
+    return ED_ISFindRange(BufP, CurPos, BufP->LastPos - ED_ISStrLen);
 }
 
 // Implements backwars search.
 // Starts just before StartPos (often called with BufP->LastPos) and
 // searches backwards for a Pos that starts a full match.  Return the
 // matching Pos location or -1 if it fails.
-Int32	ED_ISMatchBackward(ED_BufferPointer BufP, Int32 StartPos)
+Int64	ED_ISMatchBackward(ED_BufferPointer BufP, Int64 StartPos)
 {
-    Int32	CurPos = StartPos - 1;
+    Int64	CurPos = StartPos - 1;
 
     if (ED_ISDoWrap) {
 	ED_ISDoWrap = 0;
@@ -10781,21 +15204,207 @@ Int32	ED_ISMatchBackward(ED_BufferPointer BufP, Int32 StartPos)
 	} else if (CurPos > BufP->LastPos - ED_ISStrLen)
 	    return -1;
     }
-    
-    while (CurPos) {
-	if (ED_ISCheckMatch(BufP, CurPos))
-	    return CurPos;
-	CurPos--;
+
+    if ((ED_ISStrLen == 0) || (CurPos < 0)) return -1;
+    ED_ISPrepare();
+
+    return ED_ISFindRangeBack(BufP, 0, CurPos);
+}
+
+// ******************************************************************************
+// IS match set and match count.
+//
+// PaneDrawText wants to know, for every char it draws, whether a match starts
+// there.  Instead of ED_ISCheckMatch at each char on every redraw, the match set
+// holds ALL (overlapping) match starts in the visible window, found once with
+// ED_ISFindRange.  The window runs from ISSTRLEN before PanePos (for hanging
+// matches) to the end of the Pane, so it does not depend on the ISStr length.
+// The set is rebuilt only when the Pane scrolls, the Buf changes, or ISStr
+// changes.  If the user just typed more chars, the new matches are a subset of
+// the old ones, so the set is filtered rather than searched again.
+//
+// The total count (non-overlapping, same as repeated C-s) is done from the MAIN
+// loop when it is idle, ED_ISCOUNTCHUNK bytes at a time, and goes on the echo
+// line when finished.  Any edit to the Buf voids both via ED_ISSetInvalidate.
+
+ED_BufferPointer	ED_ISSetBufP = NULL;		// Match set is for this Buf, NULL if void
+char			ED_ISSetStr[ED_ISSTRLEN] = "";	// ... and this ISStr
+Int32			ED_ISSetStrLen = 0;
+Int16			ED_ISSetCaseSen = 0;
+Int64			ED_ISSetPanePos = 0;		// ... and this window
+Int32			ED_ISSetRowCount = 0;
+Int32			ED_ISSetRowChars = 0;
+Int64			ED_ISSetFirst = 0;		// Set has all match starts in [First, Last]
+Int64			ED_ISSetLast = -1;
+Int64 *			ED_ISSetArrP = NULL;		// Sorted match start Pos
+Int32			ED_ISSetCount = 0;
+Int32			ED_ISSetMax = 0;
+Int32			ED_ISSetCursor = 0;		// Lookups are mostly monotonic, start here
+
+ED_BufferPointer	ED_ISCountBufP = NULL;		// Count is for this Buf, NULL if void
+char			ED_ISCountStr[ED_ISSTRLEN] = "";	// ... and this ISStr
+Int32			ED_ISCountStrLen = 0;
+Int16			ED_ISCountCaseSen = 0;
+Int64			ED_ISCountPos = -1;		// Next Pos to count from, -1 when done
+Int64			ED_ISCount = 0;
+
+// Make sure the match set is good for PaneP, its Buf, and the current ISStr.
+void	ED_ISSetUpdate(ED_PanePointer PaneP)
+{
+    ED_BufferPointer	BufP = PaneP->BufP;
+    Int32		I, J;
+    Int64		Rows, LastStart, Pos;
+
+    if (ED_ISStrLen == 0) {
+	ED_ISSetBufP = NULL;
+	return;
     }
 
-    return -1;
+    if ((BufP == ED_ISSetBufP) && (PaneP->PanePos == ED_ISSetPanePos) &&
+	(PaneP->RowCount == ED_ISSetRowCount) && (PaneP->FrameP->RowChars == ED_ISSetRowChars)) {
+	if ((ED_ISStrLen == ED_ISSetStrLen) && (ED_ISCaseSen == ED_ISSetCaseSen) &&
+	    (0 == memcmp(ED_ISStr, ED_ISSetStr, ED_ISStrLen)))
+	    return;					// Nothing changed
+
+	// ISStr got longer (or turned CaseSen), keep only those that still match.
+	if ((ED_ISStrLen > ED_ISSetStrLen) && (ED_ISCaseSen >= ED_ISSetCaseSen) &&
+	    (0 == memcmp(ED_ISStr, ED_ISSetStr, ED_ISSetStrLen))) {
+	    for (I = J = 0; I < ED_ISSetCount; I++)
+		if (ED_ISCheckMatch(BufP, ED_ISSetArrP[I]))
+		    ED_ISSetArrP[J++] = ED_ISSetArrP[I];
+	    ED_ISSetCount = J;
+	    goto Stash;
+	}
+    }
+
+    // Search the whole window again.
+    ED_ISPrepare();
+    ED_ISSetFirst = (PaneP->PanePos > ED_ISSTRLEN) ? PaneP->PanePos - ED_ISSTRLEN : 0;
+    Rows = PaneP->RowCount;
+    ED_ISSetLast = ED_BufferGetPosPlusRows(BufP, PaneP->PanePos, &Rows, PaneP->FrameP->RowChars);
+    LastStart = BufP->LastPos - ED_ISStrLen;
+    if (LastStart > ED_ISSetLast) LastStart = ED_ISSetLast;
+
+    ED_ISSetCount = 0;
+    Pos = ED_ISSetFirst;
+    while ((Pos <= LastStart) && ((Pos = ED_ISFindRange(BufP, Pos, LastStart)) >= 0)) {
+	if (ED_ISSetCount == ED_ISSetMax) {
+	    ED_ISSetMax = (ED_ISSetMax) ? 2 * ED_ISSetMax : ED_ISSETINITCOUNT;
+	    ED_ISSetArrP = realloc(ED_ISSetArrP, ED_ISSetMax * sizeof(Int64));
+	    if (ED_ISSetArrP == NULL) G_SETEXCEPTION("Realloc ISSet Failed", ED_ISSetMax);
+	}
+	ED_ISSetArrP[ED_ISSetCount++] = Pos;
+	Pos += 1;					// Matches may overlap
+    }
+
+Stash:
+    ED_ISSetBufP = BufP;
+    ED_ISSetPanePos = PaneP->PanePos;
+    ED_ISSetRowCount = PaneP->RowCount;
+    ED_ISSetRowChars = PaneP->FrameP->RowChars;
+    memcpy(ED_ISSetStr, ED_ISStr, ED_ISStrLen);
+    ED_ISSetStrLen = ED_ISStrLen;
+    ED_ISSetCaseSen = ED_ISCaseSen;
+    ED_ISSetCursor = 0;
+}
+
+// BufP was altered, match set and count are no good for it any longer.
+void	ED_ISSetInvalidate(ED_BufferPointer BufP)
+{
+    if (BufP == ED_ISSetBufP) ED_ISSetBufP = NULL;
+    if (BufP == ED_ISCountBufP) ED_ISCountBufP = NULL;
+}
+
+// Same answer as ED_ISCheckMatch, but a lookup in the match set.  Falls back
+// on ED_ISCheckMatch if Pos is outside the set window.
+Int16	ED_ISSetIsMatch(ED_BufferPointer BufP, Int64 Pos)
+{
+    Int32	I, Lo, Hi, Mid;
+
+    if ((BufP != ED_ISSetBufP) || (Pos < ED_ISSetFirst) || (Pos > ED_ISSetLast))
+	return ED_ISCheckMatch(BufP, Pos);
+
+    I = ED_ISSetCursor;
+    if ((I > 0) && (ED_ISSetArrP[I - 1] >= Pos)) {	// Went backwards, bisect
+	Lo = 0, Hi = I;
+	while (Lo < Hi) {
+	    Mid = (Lo + Hi) / 2;
+	    if (ED_ISSetArrP[Mid] < Pos) Lo = Mid + 1;
+	    else Hi = Mid;
+	}
+	I = Lo;
+    }
+    while ((I < ED_ISSetCount) && (ED_ISSetArrP[I] < Pos)) I++;
+    ED_ISSetCursor = I;
+
+    return (I < ED_ISSetCount) && (ED_ISSetArrP[I] == Pos);
+}
+
+// Called from ED_IdleHandler, counts the next chunk of the Buf.  Restarts if
+// ISStr or the Buf changed.  Returns 1 if there is more counting to do.
+Int16	ED_ISCountStep(void)
+{
+    ED_BufferPointer	BufP;
+    Int64		ChunkLast, LastStart, Pos;
+
+    if ((ED_ISPaneP == NULL) || (ED_QREPPaneP) || (ED_ISStrLen == 0)) return 0;
+    BufP = ED_ISPaneP->BufP;
+
+    if ((BufP != ED_ISCountBufP) || (ED_ISStrLen != ED_ISCountStrLen) ||
+	(ED_ISCaseSen != ED_ISCountCaseSen) || memcmp(ED_ISStr, ED_ISCountStr, ED_ISStrLen)) {
+	ED_ISCountBufP = BufP;
+	memcpy(ED_ISCountStr, ED_ISStr, ED_ISStrLen);
+	ED_ISCountStrLen = ED_ISStrLen;
+	ED_ISCountCaseSen = ED_ISCaseSen;
+	ED_ISCountPos = 0;
+	ED_ISCount = 0;
+    }
+    if (ED_ISCountPos < 0) return 0;
+
+    ED_ISPrepare();
+    Pos = ED_ISCountPos;
+    LastStart = BufP->LastPos - ED_ISStrLen;
+    ChunkLast = (LastStart - Pos > ED_ISCOUNTCHUNK) ? Pos + ED_ISCOUNTCHUNK : LastStart;
+    while ((Pos <= ChunkLast) && ((Pos = ED_ISFindRange(BufP, Pos, ChunkLast)) >= 0)) {
+	ED_ISCount += 1;
+	Pos += ED_ISStrLen;
+    }
+    if ((Pos < 0) || (Pos <= ChunkLast)) Pos = ChunkLast + 1;
+
+    if (Pos <= LastStart) {
+	ED_ISCountPos = Pos;
+	return 1;
+    }
+
+    ED_ISCountPos = -1;					// Done, show it
+    ED_ISEcho();
+    ED_FrameDrawEchoLine(ED_ISPaneP->FrameP);
+    return 0;
+}
+
+// Sets the IS echo line, adds the match count if it is done.
+void	ED_ISEcho(void)
+{
+    char *	FormatP;
+
+    if (ED_ISDir > 0)
+	FormatP = (ED_ISDoWrap) ? ED_STR_EchoISFail : ED_STR_EchoIS;
+    else
+	FormatP = (ED_ISDoWrap) ? ED_STR_EchoISBackFail : ED_STR_EchoISBack;
+    ED_FrameSPrintEchoS(ED_ECHOMSGMODE, FormatP, ED_ISStrLen, ED_ISStr);
+
+    if (ED_ISStrLen && (ED_ISCountBufP == ED_ISPaneP->BufP) && (ED_ISCountPos < 0) &&
+	(ED_ISStrLen == ED_ISCountStrLen) && (ED_ISCaseSen == ED_ISCountCaseSen) &&
+	(0 == memcmp(ED_ISStr, ED_ISCountStr, ED_ISStrLen)))
+	ED_FrameEchoLen += snprintf(ED_FrameEchoS + ED_FrameEchoLen, ED_MSGSTRLEN - 1 - ED_FrameEchoLen,
+				    ED_STR_EchoISCount, ED_ISCount);
 }
 
 // Finds the next match, searches forward or backward.
 void	ED_ISNewMatch(Int16 GoAfter)
 {
     ED_BufferPointer	BufP = ED_ISPaneP->BufP;
-    Int32		NewMatchPos;
+    Int64		NewMatchPos;
 
     if (ED_ISSearchPos == -1) ED_ISSearchPos = ED_ISOriginPos;
     if (ED_ISDir > 0) {
@@ -10831,7 +15440,7 @@ void	ED_ISNewMatch(Int16 GoAfter)
 void	ED_ISUpdate(Int16 SetMark)
 {
     ED_PanePointer	PP;
-    Int32		RowStartPos;
+    Int64		RowStartPos;
 
     if (ED_ISDir == 0) {
 	PP = ED_ISPaneP;
@@ -10844,21 +15453,11 @@ void	ED_ISUpdate(Int16 SetMark)
 	}
 	
 	ED_FrameDrawAll(PP->FrameP);
-	return;
-    }
-    
-    if (ED_ISDoWrap) {
-	// ISMatchPos and CursorPos have NOT moved.
-	if (ED_ISDir > 0)
-	    ED_FrameSPrintEchoS(ED_ECHOMSGMODE, ED_STR_EchoISFail, ED_ISStrLen, ED_ISStr);
-	else
-	    ED_FrameSPrintEchoS(ED_ECHOMSGMODE, ED_STR_EchoISBackFail, ED_ISStrLen, ED_ISStr);
-    } else {
-	if (ED_ISDir > 0)
-	    ED_FrameSPrintEchoS(ED_ECHOMSGMODE, ED_STR_EchoIS, ED_ISStrLen, ED_ISStr);
-	else
-	    ED_FrameSPrintEchoS(ED_ECHOMSGMODE, ED_STR_EchoISBack, ED_ISStrLen, ED_ISStr);
-
+	return;
+    }
+    
+    ED_ISEcho();					// Fail msg if ISMatchPos has NOT moved
+    if (! ED_ISDoWrap) {
 	if (ED_ISMatchPos >= 0) {
 	    if (ED_ISDir > 0)
 		ED_ISPaneP->CursorPos = ED_ISMatchPos + ED_ISStrLen;
@@ -10887,7 +15486,8 @@ void	ED_ISUpdate(Int16 SetMark)
 void	ED_ISAddNextWord(void)
 {
     ED_BufferPointer		BufP = ED_ISPaneP->BufP;
-    Int32			CurPos, L;
+    Int32			L;
+    Int64			CurPos;
     Int16			InWord, InSpace;
     char			*CurP;
 
@@ -11108,7 +15708,7 @@ void	ED_QREPPaneUpdate(Int16 Incremental)
     if (Incremental)
 	PP->CursorPos += DeltaLen;
     else
-	PP->CursorPos = ED_ISSearchPos + DeltaLen;
+	PP->CursorPos = ED_ISSearchPos;		// Already past the last replacement
     ED_PaneUpdateAllPos(PP, 0);
     
     ED_PaneDrawText(PP);
@@ -11121,10 +15721,10 @@ void	ED_QREPPaneUpdate(Int16 Incremental)
 
 // Update the search.  MatchPos is the 'new' match-- or -1 if none were found.
 // The latter will exit QREP after telling user how many instances were replaced.
-void	ED_QREPSearchUpdate(Int32 MatchPos)
+void	ED_QREPSearchUpdate(Int64 MatchPos)
 {
     ED_PanePointer	PP = ED_QREPPaneP;
-    Int32		RowStartPos;
+    Int64		RowStartPos;
 
     if (MatchPos == -1) {
 	ED_FrameSPrintEchoS(ED_ECHOMSGMODE, ED_STR_EchoQueryReplaceDone, ED_QREPCount);
@@ -11157,7 +15757,8 @@ void	ED_QREPReplace(void)
 {
     ED_PanePointer	PP = ED_QREPPaneP;
     ED_BufferPointer	BufP = PP->BufP;
-    Int32		StartPos, DeltaLen;
+    Int32		DeltaLen;
+    Int64		StartPos;
 
     ED_QREPCount += 1;
 
@@ -11176,7 +15777,7 @@ void	ED_QREPReplace(void)
 
     // Now add new text.
     if (ED_QREPToLen) {
-	ED_BufferAddUndoBlock(BufP, StartPos, ED_QREPToLen, ED_UB_ADD | ED_UB_CHUNK | ED_UB_CHAIN, BufP->GapStartP);
+	ED_BufferAddUndoBlock(BufP, StartPos, ED_QREPToLen, ED_UB_ADD | ED_UB_CHUNK | ED_UB_CHAIN, ED_QREPToStr);
 	memcpy(BufP->GapStartP, ED_QREPToStr, ED_QREPToLen);
 	BufP->GapStartP += ED_QREPToLen;
 	BufP->LastPos += ED_QREPToLen;
@@ -11194,15 +15795,115 @@ void	ED_QREPReplace(void)
     }
 }
 
-#define		ED_QREPEventLoopInterval	75
+// Replace ALL remaining matches (starting with the current one) in one pass.
+// Finds them all first, then moves the Gap to the first one and streams the
+// text across it:  the rest of the old text is read from GapEndP and the new
+// text is written at GapStartP.  The Gap is pre-grown by the total growth, so
+// the writer can never catch up with the reader.  Undo gets a chained Del +
+// Add per match (only the matched text is stored), so a single Undo puts it
+// all back.  Matches closer than ED_QREPUNDOJOIN share one Del + Add, as the
+// run between them costs less than another pair of UBlocks.  The XSel and the
+// Idxs are updated ONCE for the whole span.
+//
+// NOTE:	The Del for a segment is recorded *BEFORE* streaming it, the
+//		writer may overwrite the old text once it has been read.
+#define		ED_QREPUNDOJOIN		(2 * (Int32)sizeof(ED_UBlockRecord))
+
+void	ED_QREPReplaceAll(void)
+{
+    ED_PanePointer	PP = ED_QREPPaneP;
+    ED_BufferPointer	BufP = PP->BufP;
+    Int64		*MatchArrP;
+    Int32		MatchCount, MatchMax, I, SegLast;
+    Int64		Span, NewSpan, DeltaLen, Len, Pos, FirstPos, SegPos;
+
+    if (ED_ISMatchPos < 0) return;
+    ED_ISPrepare();
+
+    MatchMax = ED_ISSETINITCOUNT;
+    MatchArrP = malloc(MatchMax * sizeof(Int64));
+    if (MatchArrP == NULL) G_SETEXCEPTION("Malloc QREP Matches Failed", MatchMax);
+
+    MatchCount = 0;
+    Pos = ED_ISMatchPos;
+    while ((Pos = ED_ISFindRange(BufP, Pos, BufP->LastPos - ED_QREPFromLen)) >= 0) {
+	if (MatchCount == MatchMax) {
+	    MatchMax *= 2;
+	    MatchArrP = realloc(MatchArrP, MatchMax * sizeof(Int64));
+	    if (MatchArrP == NULL) G_SETEXCEPTION("Realloc QREP Matches Failed", MatchMax);
+	}
+	MatchArrP[MatchCount++] = Pos;
+	Pos += ED_QREPFromLen;				// Do not match IN the old text
+    }
+    if (MatchCount == 0) {
+	free(MatchArrP);
+	return;
+    }
+
+    DeltaLen = ED_QREPToLen - ED_QREPFromLen;
+    FirstPos = MatchArrP[0];
+    Span = MatchArrP[MatchCount - 1] + ED_QREPFromLen - FirstPos;
+    NewSpan = Span + (MatchCount * DeltaLen);
+    ED_BufferPlaceGap(BufP, FirstPos, MatchCount * DeltaLen);
+
+    // Kill the old span.  KillRing gets the first match, only if first time.
+    ED_BufferEditUpdate(BufP, FirstPos, -Span, BufP->GapEndP);
+    BufP->Flags |= ED_BUFMODFLAG;
+    if (ED_QREPCount == 0)
+	ED_KillRingAdd(BufP->GapEndP, ED_QREPFromLen, 1);
+
+    // Stream: Copy the run before each match, then the replacement.
+    // Each segment is recorded at its new Pos, as if replaced one at a time.
+    SegLast = -1;
+    SegPos = 0;
+    for (I = 0; I < MatchCount; I++) {
+	if (I) {
+	    Len = MatchArrP[I] - (MatchArrP[I - 1] + ED_QREPFromLen);
+	    memmove(BufP->GapStartP, BufP->GapEndP, Len);
+	    BufP->GapStartP += Len;
+	    BufP->GapEndP += Len;
+	}
+	if (I > SegLast) {
+	    for (SegLast = I; (SegLast + 1 < MatchCount) &&
+		     (MatchArrP[SegLast + 1] - (MatchArrP[SegLast] + ED_QREPFromLen) < ED_QREPUNDOJOIN); SegLast++);
+	    SegPos = MatchArrP[I] + (I * DeltaLen);
+	    Len = MatchArrP[SegLast] + ED_QREPFromLen - MatchArrP[I];
+	    ED_BufferAddUndoBlock(BufP, SegPos, Len,
+				  ED_UB_DEL | ED_UB_CHUNK | ED_UB_NOIDX | (I ? ED_UB_CHAIN : 0), BufP->GapEndP);
+	}
+	memcpy(BufP->GapStartP, ED_QREPToStr, ED_QREPToLen);
+	BufP->GapStartP += ED_QREPToLen;
+	BufP->GapEndP += ED_QREPFromLen;
+	if ((I == SegLast) && (Len = (BufP->GapStartP - BufP->BufStartP) - SegPos))
+	    ED_BufferAddUndoBlock(BufP, SegPos, Len,
+				  ED_UB_ADD | ED_UB_CHUNK | ED_UB_CHAIN | ED_UB_NOIDX, BufP->GapStartP - Len);
+    }
+
+    // Now the new span... it is already in place, before the Gap.
+    if (NewSpan)
+	ED_BufferEditUpdate(BufP, FirstPos, NewSpan, BufP->GapStartP - NewSpan);
+    BufP->LastPos += NewSpan - Span;
+
+    // Other Panes see the same sequence of edits as one-at-a-time replacing.
+    if (BufP->PaneRefCount > 1)
+	for (I = 0; I < MatchCount; I++)
+	    ED_PaneUpdateOtherPanesIncrBasic(PP, MatchArrP[I] + (I * DeltaLen), DeltaLen);
+
+    ED_QREPCount += MatchCount;
+    ED_ISMatchPos = FirstPos + NewSpan - ED_QREPToLen;
+    ED_ISSearchPos = FirstPos + NewSpan;
+    free(MatchArrP);
+}
+
+#define		ED_QREPEVENTLOOPMSECS	25		// Service Main loop this often during 'i'
 
 // Handle all keyboard input while in QREP mode.
 // Return 1 if char is handled here--all cases.
 // Would return 0 for main loop to handle chars/cmds.
 Int16	ED_QREPHandleChars(ED_FramePointer FrameP, Uns16 SymChar, Int16 Mods)
 {
-    Int32		MatchPos;
-    Int32		Count;
+    Int64		MatchPos;
+    Int64		LoopTime;
 
     // Accept no Control/Meta/etc. Mods here.
     if (Mods & ED_COMMANDMODSMASK) {
@@ -11234,7 +15935,7 @@ Int16	ED_QREPHandleChars(ED_FramePointer FrameP, Uns16 SymChar, Int16 Mods)
 	    break;
 
         case 'i': case 'I':			// 'i' -> replace all (Show it)
-	    Count = 0;
+	    LoopTime = sc_ClockMSecs() + ED_QREPEVENTLOOPMSECS;
 	    do {
 		ED_QREPReplace();
 		MatchPos = ED_ISMatchForward(ED_QREPPaneP->BufP, ED_ISSearchPos);
@@ -11243,12 +15944,11 @@ Int16	ED_QREPHandleChars(ED_FramePointer FrameP, Uns16 SymChar, Int16 Mods)
 		// This loop *can* take some time, especially in degenerate test cases.
 		// But XSel clients may requests with a TEMPORARY Win which is deleted
 		// if response is delayed... and a late response sent to a deleted Win will
-		// error out the X-server!  (Service Main loop every 50-100 cycles,
-		// otherwise QREP becomes tooo slow!)
+		// error out the X-server!  (Service Main loop every ED_QREPEVENTLOOPMSECS,
+		// but not every cycle, otherwise QREP becomes tooo slow!)
 
-		Count += 1;
-		if (Count > ED_QREPEventLoopInterval) {
-		    Count = 0;
+		if (sc_ClockMSecs() >= LoopTime) {
+		    LoopTime = sc_ClockMSecs() + ED_QREPEVENTLOOPMSECS;
 		    sc_MainEventLoop();
 		    // May abort, click on other windows, etc.
 		    if (ED_QREPPaneP == NULL)
@@ -11258,12 +15958,9 @@ Int16	ED_QREPHandleChars(ED_FramePointer FrameP, Uns16 SymChar, Int16 Mods)
 	    break;
 
 	case '!':				// '!' -> Replace all (Don't show)
-	    do {
-		ED_QREPDoAll = 1;		// No updates until done!!
-		ED_QREPReplace();
-		MatchPos = ED_ISMatchForward(ED_QREPPaneP->BufP, ED_ISSearchPos);
-		ED_QREPSearchUpdate(MatchPos);
-	    } while (MatchPos > 0);
+	    ED_QREPDoAll = 1;			// No updates until done!!
+	    ED_QREPReplaceAll();
+	    ED_QREPSearchUpdate(-1);
 	    break;
 
 	default:				// OTHER -> Not acceptable
@@ -11295,7 +15992,7 @@ void	ED_QREPStart(void)
 {
     ED_PanePointer	PP = ED_QRPaneP;
     Int16		I;
-    Int32		MatchPos;
+    Int64		MatchPos;
 
     ED_QREPPaneP = PP;
     strcpy(ED_QREPPrevFromStr, ED_QREPFromStr);
@@ -11492,6 +16189,8 @@ void	ED_XWinCreate(ED_FramePointer FP)
     FP->HLBlinkerGC = XCreateGC(ED_XDP, FP->XWin, 0, NULL);
     XSetForeground(ED_XDP, FP->HLBlinkerGC, ED_XCArr[ED_SelOrange].pixel);
     XSetFunction(ED_XDP, FP->HLBlinkerGC, GXxor);
+    FP->CopyGC = XCreateGC(ED_XDP, FP->XWin, 0, NULL);	// GXcopy
+    XSetGraphicsExposures(ED_XDP, FP->CopyGC, False);	// Source is BackPM, never obscured
 
     XDefineCursor(ED_XDP, FP->XWin, ED_TextCursor);
 
@@ -11499,12 +16198,33 @@ void	ED_XWinCreate(ED_FramePointer FP)
     XMapWindow(ED_XDP, FP->XWin);
     XSync(ED_XDP, False);
 
+    // Not needed to paint, the first Frame gets it after (ED_StartupStep).
+    FP->XICP = NULL;
+    if (ED_XIMP) ED_AuxFrameXIC(FP);
+}
+
+// ******************************************************************************
+// ED_AuxFrameXIC returns the XIC of FP, creating it (and opening the input
+// method) if it is not there yet.
+
+XIC	ED_AuxFrameXIC(ED_FramePointer FP)
+{
+    if (FP->XICP) return FP->XICP;
+
+    if (ED_XIMP == NULL) {
+	ED_XIMP = XOpenIM(ED_XDP, NULL, NULL, NULL);
+	if (ED_XIMP == NULL) G_SETEXCEPTION("XOpenIM Failed", 0);
+	ED_XIMOwned = 1;
+	ED_StartupMark(ED_StartIM);
+    }
+
     FP->XICP = XCreateIC(ED_XIMP, XNInputStyle, XIMPreeditNothing | XIMStatusNothing,
 				  XNClientWindow, FP->XWin,
 				  NULL);
     if (FP->XICP == NULL) G_SETEXCEPTION("Cound not open XIC", 0);
-    
-    XSetICFocus(FP->XICP);
+
+    if (FP->Flags & ED_FRAMEFOCUSFLAG) XSetICFocus(FP->XICP);
+    return FP->XICP;
 }
 
 // ******************************************************************************
@@ -11570,7 +16290,10 @@ void	ED_EditorInit(Display * XDP, XftFont * XFP, XIM XIMP, Int32 WinWidth, Int32
 
     ED_XDP = XDP;
     ED_XFP = XFP;
-    ED_XIMP = XIMP;
+    ED_XIMP = XIMP;				// NULL, opened after the first paint
+    ED_XIMOwned = 0;
+    ED_SessPath[0] = 0;
+    ED_StatsStartNs = sc_ClockNSecs();
     ED_XWMDelAtom = XInternAtom(ED_XDP, "WM_DELETE_WINDOW", 0);
     ED_PUExecAtom = XInternAtom(ED_XDP, "EXECUTE", 0);
     ED_ClipAtom = XInternAtom(ED_XDP, "CLIPBOARD", 0);
@@ -11584,6 +16307,7 @@ void	ED_EditorInit(Display * XDP, XftFont * XFP, XIM XIMP, Int32 WinWidth, Int32
     ED_Height = ED_Ascent + ED_Descent;
     ED_Row = ED_Height + 1;
     ED_Advance = XFP->max_advance_width;
+    ED_GlyphCacheInit(XFP);
 
     ED_ColorArrCreate();
     ED_TextCursor = XCreateFontCursor(ED_XDP, XC_xterm);
@@ -11596,6 +16320,8 @@ void	ED_EditorInit(Display * XDP, XftFont * XFP, XIM XIMP, Int32 WinWidth, Int32
     sc_SAStoreOpen(&ED_FrameStore, sizeof(ED_FrameRecord), ED_FRAMEALLOCCOUNT);
     sc_SAStoreOpen(&ED_PaneStore, sizeof(ED_PaneRecord), ED_PANEALLOCCOUNT);
     sc_SAStoreOpen(&ED_BufferStore, sizeof(ED_BufferRecord), ED_BUFFERALLOCCOUNT);
+    sc_SAStoreOpen(&ED_UStubStore, sizeof(ED_USlabRecord), ED_USTUBALLOCCOUNT);
+    sc_SAPoolOpen(&ED_PayloadPool, ED_PAYLOADMINLEN, ED_PAYLOADMAXLEN, ED_PAYLOADRACKLEN);
 
     ED_BufferNew(0, NULL, NULL, 0);		// Create new buffer, default size, name, and path
     ED_FrameNew(WinWidth, WinHeight, NULL);	// Create a new Frame, it will create 1 Pane
@@ -11609,6 +16335,8 @@ void	ED_EditorInit(Display * XDP, XftFont * XFP, XIM XIMP, Int32 WinWidth, Int32
     ED_FRegNewFunction(ED_CmdGetWorkingDir,	"pwd");				// Not bound to keyboard
     ED_FRegNewFunction(ED_CmdResetUndo,		"reset-undo");			// Not bound to keyboard
     ED_FRegNewFunction(ED_CmdDisableUndo,	"disable-undo");		// Not bound to keyboard
+    ED_FRegNewFunction(ED_CmdShowStats,		"show-stats");			// Not bound to keyboard
+    ED_FRegNewFunction(ED_CmdDumpStats,		"dump-stats");			// Not bound to keyboard
 
     ED_DEFINECMD(ED_CmdSplitPane,		"split-pane",			"\x16\x78\x32");	// C-x 2
     ED_DEFINECMD(ED_CmdKillPane,		"kill-pane",			"\x16\x78\x30");	// C-x 0
@@ -11699,8 +16427,11 @@ void	ED_EditorInit(Display * XDP, XftFont * XFP, XIM XIMP, Int32 WinWidth, Int32
     ED_DEFINECMD(ED_CmdUndo,			"undo",				"\x16\x2f");		// C-/
     					    ED_DEFINEADDITIONALBND(		"\x16\x5f");		// C-_
 					    ED_DEFINEADDITIONALBND(		"\x16\x78\x75");	// C-x u
+
+    ED_FRegCompile();				// KeyTrie + NameTrie
     
     ED_CmdLastId = ED_StartId;
+    ED_StartupMark(ED_StartInit);
     
 #ifdef DEBUG    
     // TEST_StuffText();
@@ -11717,8 +16448,14 @@ void	ED_EditorInit(Display * XDP, XftFont * XFP, XIM XIMP, Int32 WinWidth, Int32
 void	ED_EditorKill(void)
 {
     ED_BufferPointer		BufP;
+    ED_StartFilePointer		SFP;
 
     ED_XSelKill();
+    ED_SaveKill();			// Finish writing queued saves
+    ED_SessionSave();			// Files are as saved now
+    ED_PoolKill();
+    ED_DirCacheKill();
+    while (ED_LoadFirstP) ED_LoadStop(ED_LoadFirstP->BufP);
     
     ED_ColorArrDestroy();
     XFreeCursor(ED_XDP, ED_TextCursor);
@@ -11727,17 +16464,30 @@ void	ED_EditorKill(void)
     
     ED_FRegKill();			// Closes FReg/FBind SA Stores.
     ED_KillRingFree();
+    ED_GlyphCacheFree();
 
     BufP = ED_FirstBufP;
     while (BufP) {
-	free(BufP->BufStartP);		// Just free the Malloc memory
+	ED_BufferFreeMem(BufP);		// Just free the Malloc (or mmap) memory
 	ED_BufferKillUndo(BufP);	// Get rid of Undo Slabs!
     	BufP = BufP->NextBufP;		// BufP will be purged by Store
     }
+    ED_UndoJournalKill();
     
     sc_SAStoreClose(&ED_FrameStore);
     sc_SAStoreClose(&ED_PaneStore);
     sc_SAStoreClose(&ED_BufferStore);
+    sc_SAStoreClose(&ED_UStubStore);
+    sc_SAPoolClose(&ED_PayloadPool);
+    while ((SFP = ED_StartFileFirstP)) {		// Never got to them
+	ED_StartFileFirstP = SFP->NextP;
+	free(SFP);
+    }
+    ED_StartFileLastP = NULL;
+    if (ED_SessMemP) free(ED_SessMemP);
+    ED_SessMemP = NULL;
+    if (ED_XIMOwned) XCloseIM(ED_XIMP);
+    ED_XIMP = NULL;
     sc_MainExit();
 }
 
@@ -11778,8 +16528,10 @@ void	ED_EditorOpenFile(char *PathP, Int16 NewFrame)
 	if (ED_FD == -1) goto ErrorOut;
 
 	CheckBuffer = 1;
-	BufP = ED_BufferReadFile(ED_FD, ED_Name, ED_Path);
+	BufP = ED_BufferLoadFile(ED_FD, ED_Name, ED_Path);
 	if (BufP == NULL) Res = 0;
+	else if (BufP->Flags & ED_BUFLOADINGFLAG) CheckBuffer = 0;	// Filters when done
+	if (BufP && ED_SessionApply(BufP, ED_FD, ED_FullPath)) CheckBuffer = 0;	// Known clean
     close(ED_FD);
 
     if (! Res) goto ErrorOut;
@@ -11799,6 +16551,327 @@ ErrorOut:
     return;
 }
 
+// ******************************************************************************
+// ******************************************************************************
+// STARTUP and SESSION
+//
+// Only what the first paint needs is done up front.  ED_StartupMark stamps each
+// phase (see ED_StatsReport), ED_StartupStep then does the rest from the idle
+// loop once the first Frame is drawn: the other command line files (one per call,
+// see ED_EditorQueueFile) and the input method with the XICs (ED_AuxFrameXIC,
+// or on the first KeyPress if that comes sooner).
+//
+// A session snapshot (main, -session File) lists the file Buffers at exit with
+// their positions.  If a Buffer was just the file (unmodified and fully loaded),
+// its LineIdx and RowIdx checkpoints are saved too.  On the next start, a file
+// whose size, mtime and inode still match gets them back (ED_SessionApply)--so
+// it paints and scrolls without a rescan, and is known not to need filtering.
+// With no files on the command line, the snapshot files are opened instead.
+
+void	ED_StartupMark(ED_StartPhase Phase)
+{
+    if (ED_StartupNsArr[Phase] == 0) ED_StartupNsArr[Phase] = sc_ClockNSecs();
+}
+
+// Opens PathP in a new Frame, after the first paint.
+void	ED_EditorQueueFile(char * PathP)
+{
+    ED_StartFilePointer	SFP;
+
+    SFP = malloc(sizeof(ED_StartFileRecord));
+    if (SFP == NULL) G_SETEXCEPTION("Malloc StartFile failed", 0);
+    strncpy(SFP->PathName, PathP, ED_FULLPATHLEN + 1);
+    SFP->PathName[ED_FULLPATHLEN] = 0;
+    SFP->NextP = NULL;
+
+    if (ED_StartFileLastP) ED_StartFileLastP->NextP = SFP;
+    else ED_StartFileFirstP = SFP;
+    ED_StartFileLastP = SFP;
+}
+
+// Called from ED_IdleHandler, returns 1 if it did something.
+Int16	ED_StartupStep(void)
+{
+    ED_StartFilePointer	SFP;
+    ED_FramePointer	FP;
+
+    if ((ED_StartupNsArr[ED_StartPaint] == 0) || (ED_FirstFrameP == NULL)) return 0;
+
+    if ((SFP = ED_StartFileFirstP)) {
+	ED_StartFileFirstP = SFP->NextP;
+	if (ED_StartFileFirstP == NULL) ED_StartFileLastP = NULL;
+	ED_EditorOpenFile(SFP->PathName, 1);
+	free(SFP);
+	return 1;
+    }
+
+    for (FP = ED_FirstFrameP; FP; FP = FP->NextFrameP)
+	if (! (FP->Flags & ED_FRAMENOWINFLAG) && (FP->XICP == NULL)) {
+	    ED_AuxFrameXIC(FP);
+	    return 1;
+	}
+
+    return 0;
+}
+
+// ******************************************************************************
+// ED_SessionLoad reads the snapshot at PathP (if it is there) and remembers
+// PathP, to write the new one at exit.
+
+void	ED_SessionLoad(char * PathP)
+{
+    ED_SessHeadPointer	HeadP;
+    struct stat		StatR;
+    Int32		FD, Len;
+
+    Len = (PathP[0] == '/') ? 0 : ((getcwd(ED_SessPath, ED_FULLPATHLEN + 1)) ? (Int32)strlen(ED_SessPath) : -1);
+    if ((Len < 0) || (Len + 1 + strlen(PathP) > ED_FULLPATHLEN)) {
+	ED_SessPath[0] = 0;
+	return;
+    }
+    if (Len) ED_SessPath[Len++] = '/';
+    strcpy(ED_SessPath + Len, PathP);
+
+    FD = open(ED_SessPath, O_RDONLY);
+    if (FD == -1) return;				// Written at exit
+    if ((fstat(FD, &StatR) == 0) && (StatR.st_size >= (Int64)sizeof(ED_SessHeadRecord))) {
+	ED_SessMemP = malloc(StatR.st_size);
+	if (ED_SessMemP && (read(FD, ED_SessMemP, StatR.st_size) == StatR.st_size))
+	    ED_SessLen = StatR.st_size;
+    }
+    close(FD);
+
+    HeadP = (ED_SessHeadPointer)ED_SessMemP;
+    if (ED_SessLen && (HeadP->Tag == *(Uns32 *)ED_SessTag) && (HeadP->Version == ED_SESSVERSION))
+	return;
+
+    free(ED_SessMemP);					// Not a snapshot (or an old one), ignore it
+    ED_SessMemP = NULL;
+    ED_SessLen = 0;
+}
+
+// ******************************************************************************
+// ED_SessionOpenFiles opens the snapshot files, the first one now.  Returns how many.
+
+Int32	ED_SessionOpenFiles(void)
+{
+    ED_SessEntryPointer	EP;
+    Int64		Off = sizeof(ED_SessHeadRecord);
+    Int32		Count = 0;
+
+    if (ED_SessMemP == NULL) return 0;
+    while ((EP = ED_AuxSessNext(&Off))) {
+	if (Count++ == 0) ED_EditorOpenFile((char *)(EP + 1), 0);
+	else ED_EditorQueueFile((char *)(EP + 1));
+    }
+
+    return Count;
+}
+
+// ******************************************************************************
+// ED_AuxSessNext returns the Entry at *OffP and moves *OffP past it.  NULL at the
+// end, or if the Entry does not fit in the snapshot.
+
+ED_SessEntryPointer	ED_AuxSessNext(Int64 * OffP)
+{
+    ED_SessEntryPointer	EP;
+    ED_SessRIdxPointer	RP;
+    Int64		Off = *OffP;
+    Int32		I;
+
+    if (Off + (Int64)sizeof(ED_SessEntryRecord) > ED_SessLen) return NULL;
+    EP = (ED_SessEntryPointer)(ED_SessMemP + Off);
+    if ((EP->PathLen < 2) || (EP->PathLen > ED_FULLPATHLEN + 1) ||
+	(EP->LIdxCount < 0) || (EP->RIdxCount < 0) || (EP->RIdxCount > ED_RIDXWIDTHS))
+	return NULL;
+
+    Off += sizeof(ED_SessEntryRecord) + ED_SESSALIGN(EP->PathLen) + (Int64)EP->LIdxCount * sizeof(ED_LIdxRecord);
+    for (I = 0; I < EP->RIdxCount; I++) {
+	if (Off + (Int64)sizeof(ED_SessRIdxRecord) > ED_SessLen) return NULL;
+	RP = (ED_SessRIdxPointer)(ED_SessMemP + Off);
+	if ((RP->Count < 1) || (RP->RowChars < 1)) return NULL;
+	Off += sizeof(ED_SessRIdxRecord) + (Int64)RP->Count * sizeof(ED_RIdxRecord);
+    }
+    if ((Off > ED_SessLen) || ((char *)(EP + 1))[EP->PathLen - 1]) return NULL;
+
+    *OffP = Off;
+    return EP;
+}
+
+// ED_AuxSessIdxCheck: Count (Pos, Line/Row) pairs, first is (0, 0), Pos goes up
+// (up to LastPos), Line/Row never goes down.  Returns 1 if so.
+Int16	ED_AuxSessIdxCheck(Int64 * ArrP, Int32 Count, Int64 LastPos)
+{
+    Int32	I;
+
+    if (Count == 0) return 1;
+    if (ArrP[0] || ArrP[1]) return 0;
+    for (I = 1; I < Count; I++, ArrP += 2)
+	if ((ArrP[2] <= ArrP[0]) || (ArrP[2] > LastPos) || (ArrP[3] < ArrP[1])) return 0;
+
+    return 1;
+}
+
+// ******************************************************************************
+// ED_SessionApply gives the newly read BufP (FD at FullPathP) what the snapshot
+// has for it.  Returns 1 if the file is unchanged (the indexes went in) and it
+// needed no filtering when saved (ED_SESSCLEANFLAG), so it need not be checked.
+
+Int16	ED_SessionApply(ED_BufferPointer BufP, Int32 FD, char * FullPathP)
+{
+    ED_SessEntryPointer	EP;
+    ED_SessRIdxPointer	RP;
+    ED_RIdxWidthPointer	WP;
+    ED_LIdxPointer	LP;
+    ED_LoadPointer	LoadP;
+    struct stat		StatR;
+    Int64		Off = sizeof(ED_SessHeadRecord);
+    Int32		I, Max;
+
+    if (ED_SessMemP == NULL) return 0;
+    while ((EP = ED_AuxSessNext(&Off)))
+	if (strcmp((char *)(EP + 1), FullPathP) == 0) break;
+    if (EP == NULL) return 0;
+
+    // Only hints, ED_PaneGetNewBuf checks them.  Still loading, those past the
+    // first chunk go in at ED_LoadEnd (ED_AuxLoadSessPos).
+    if ((EP->CursorPos >= 0) && (EP->CursorPos <= BufP->LastPos)) BufP->CursorPos = EP->CursorPos;
+    if ((EP->PanePos >= 0) && (EP->PanePos <= BufP->LastPos)) BufP->PanePos = EP->PanePos;
+    if ((EP->MarkPos >= -1) && (EP->MarkPos <= BufP->LastPos)) BufP->MarkPos = EP->MarkPos;
+    if ((BufP->Flags & ED_BUFLOADINGFLAG) && (LoadP = ED_LoadFind(BufP))) {
+	if (EP->CursorPos > BufP->LastPos) LoadP->SessCursorPos = EP->CursorPos;
+	if (EP->PanePos > BufP->LastPos) LoadP->SessPanePos = EP->PanePos;
+	if (EP->MarkPos > BufP->LastPos) LoadP->SessMarkPos = EP->MarkPos;
+    }
+
+    // Indexes only go in whole, for the very same file.
+    if (! (EP->Flags & ED_SESSEXACTFLAG) || (BufP->Flags & ED_BUFLOADINGFLAG)) return 0;
+    if (fstat(FD, &StatR) || (StatR.st_size != EP->Size) || (ED_SESSMTIME(StatR) != EP->MTime) ||
+	((Int64)StatR.st_dev != EP->Dev) || ((Int64)StatR.st_ino != EP->Ino) || (BufP->LastPos != EP->Size))
+	return 0;
+
+    LP = (ED_LIdxPointer)((char *)(EP + 1) + ED_SESSALIGN(EP->PathLen));
+    if (! ED_AuxSessIdxCheck((Int64 *)LP, EP->LIdxCount, BufP->LastPos)) return 0;
+    RP = (ED_SessRIdxPointer)(LP + EP->LIdxCount);
+    for (I = 0; I < EP->RIdxCount; I++) {
+	if (! ED_AuxSessIdxCheck((Int64 *)(RP + 1), RP->Count, BufP->LastPos)) return 0;
+	RP = (ED_SessRIdxPointer)((ED_RIdxPointer)(RP + 1) + RP->Count);
+    }
+
+    if (EP->LIdxCount) {
+	for (Max = ED_LIDXINITCOUNT; Max < EP->LIdxCount; Max *= 2);
+	ED_BufferLIdxKill(BufP);
+	BufP->LIdxArrP = malloc(Max * sizeof(ED_LIdxRecord));
+	if (! BufP->LIdxArrP) G_SETEXCEPTION("Malloc LineIdx Failed", 0);
+	memcpy(BufP->LIdxArrP, LP, EP->LIdxCount * sizeof(ED_LIdxRecord));
+	BufP->LIdxCount = EP->LIdxCount;
+	BufP->LIdxMax = Max;
+    }
+
+    RP = (ED_SessRIdxPointer)(LP + EP->LIdxCount);
+    for (I = 0, WP = BufP->RIdxWidthArr; I < EP->RIdxCount; I++, WP++) {
+	for (Max = ED_RIDXINITCOUNT; Max < RP->Count; Max *= 2);
+	free(WP->ArrP);
+	WP->ArrP = malloc(Max * sizeof(ED_RIdxRecord));
+	if (! WP->ArrP) G_SETEXCEPTION("Malloc RowIdx Failed", 0);
+	memcpy(WP->ArrP, RP + 1, RP->Count * sizeof(ED_RIdxRecord));
+	WP->RowChars = RP->RowChars;
+	WP->Count = RP->Count;
+	WP->Max = Max;
+	WP->LastUse = ++ED_RIdxUseCount;
+	WP->DirtyStart = WP->DirtyEnd = -1;
+	WP->EstBytes = WP->EstRows = 0;
+	RP = (ED_SessRIdxPointer)((ED_RIdxPointer)(RP + 1) + RP->Count);
+    }
+
+    return (EP->Flags & ED_SESSCLEANFLAG) ? 1 : 0;
+}
+
+// ******************************************************************************
+// ED_SessionSave writes the snapshot (next to it, then renamed over it), oldest
+// Buffer first--the order they were opened in.
+
+void	ED_SessionSave(void)
+{
+    ED_SessHeadRecord	Head;
+    ED_SessEntryRecord	Entry;
+    ED_SessRIdxRecord	RIdx;
+    ED_BufferPointer	BufP;
+    ED_FramePointer	FP;
+    ED_PanePointer	PaneP;
+    ED_RIdxWidthPointer	WP;
+    struct stat		StatR;
+    FILE *		FileP;
+    char		FullPath[ED_FULLPATHLEN + 1];
+    char		TempPath[ED_FULLPATHLEN + 8];
+    char		Pad[8] = {0};
+    Int16		I;
+
+    if (ED_SessPath[0] == 0) return;
+    sprintf(TempPath, "%s.new", ED_SessPath);
+    FileP = fopen(TempPath, "w");
+    if (FileP == NULL) return;
+
+    Head.Tag = *(Uns32 *)ED_SessTag;
+    Head.Version = ED_SESSVERSION;
+    Head.Count = 0;
+    Head.Pad = 0;
+    fwrite(&Head, sizeof(Head), 1, FileP);
+
+    // Stash Pane state into its Buf, the way ED_FrameKill does
+    for (FP = ED_FirstFrameP; FP; FP = FP->NextFrameP)
+	for (PaneP = FP->FirstPaneP; PaneP; PaneP = PaneP->NextPaneP) {
+	    PaneP->BufP->CursorPos = PaneP->CursorPos;
+	    PaneP->BufP->PanePos = PaneP->PanePos;
+	}
+
+    for (BufP = ED_FirstBufP; BufP && BufP->NextBufP; BufP = BufP->NextBufP);
+    for (; BufP; BufP = BufP->PrevBufP) {
+	if ((BufP->Flags & (ED_BUFNOFILEFLAG | ED_BUFINFOONLYFLAG)) || BufP->Ident) continue;
+	if (snprintf(FullPath, sizeof(FullPath), "%s/%s", BufP->PathName, BufP->FileName) >= (Int32)sizeof(FullPath))
+	    continue;
+	if (stat(FullPath, &StatR)) continue;		// Never saved, or gone
+
+	memset(&Entry, 0, sizeof(Entry));
+	Entry.Size = StatR.st_size;
+	Entry.MTime = ED_SESSMTIME(StatR);
+	Entry.Dev = StatR.st_dev;
+	Entry.Ino = StatR.st_ino;
+	Entry.CursorPos = BufP->CursorPos;
+	Entry.PanePos = BufP->PanePos;
+	Entry.MarkPos = BufP->MarkPos;
+	Entry.PathLen = (Int32)strlen(FullPath) + 1;
+	Entry.Flags = ED_SESSNOFLAG;
+	if (! (BufP->Flags & (ED_BUFMODFLAG | ED_BUFLOADINGFLAG | ED_BUFPASTINGFLAG)) &&
+	    (BufP->LastPos == StatR.st_size)) {
+	    Entry.Flags |= ED_SESSEXACTFLAG;
+	    if (! ED_BufferNeedsFilter(BufP)) Entry.Flags |= ED_SESSCLEANFLAG;
+	    Entry.LIdxCount = (BufP->LIdxArrP) ? BufP->LIdxCount : 0;
+	    for (I = 0, WP = BufP->RIdxWidthArr; I < ED_RIDXWIDTHS; I++, WP++)
+		if (WP->RowChars && WP->ArrP && ! WP->EstBytes) Entry.RIdxCount += 1;
+	}
+
+	fwrite(&Entry, sizeof(Entry), 1, FileP);
+	fwrite(FullPath, Entry.PathLen, 1, FileP);
+	fwrite(Pad, ED_SESSALIGN(Entry.PathLen) - Entry.PathLen, 1, FileP);
+	if (Entry.LIdxCount) fwrite(BufP->LIdxArrP, sizeof(ED_LIdxRecord), Entry.LIdxCount, FileP);
+	for (I = 0, WP = BufP->RIdxWidthArr; Entry.RIdxCount && (I < ED_RIDXWIDTHS); I++, WP++) {
+	    if (! (WP->RowChars && WP->ArrP) || WP->EstBytes) continue;	// Still reflowing
+	    ED_AuxRIdxResolve(BufP, WP);
+	    RIdx.RowChars = WP->RowChars;
+	    RIdx.Count = WP->Count;
+	    fwrite(&RIdx, sizeof(RIdx), 1, FileP);
+	    fwrite(WP->ArrP, sizeof(ED_RIdxRecord), WP->Count, FileP);
+	}
+	Head.Count += 1;
+    }
+
+    rewind(FileP);
+    fwrite(&Head, sizeof(Head), 1, FileP);
+    if (ferror(FileP) | fclose(FileP)) unlink(TempPath);
+    else rename(TempPath, ED_SessPath);
+}
+
 // ******************************************************************************
 // ******************************************************************************
 // The QueryResponse (QR) routines implement a tiny 1 line editor in the Echo
@@ -11883,7 +16956,7 @@ void	ED_AuxQRDrawScrollMark(ED_FramePointer FrameP, Int16 IsRight)
 //
 // NOTE:  X == (# of chars to draw) is returned.  *LenP gets # of bytes.
 
-Int16	ED_AuxQRSanitize(char ** DataPP, Int32 *LenP)
+Int16	ED_AuxQRSanitize(char ** DataPP, Int64 *LenP)
 {
     char	*E, *S = *DataPP;
     char	*EndP = *DataPP + *LenP;
@@ -11958,6 +17031,7 @@ void	ED_FrameQRAsk(ED_FramePointer FrameP, char * QueryP, char * RespP, Int16 QR
     ED_QRRes = 0;
     
     ED_FrameQRSetResp(RespP);
+    if (AutoCompFP == EDCB_QRAutoCompPathFunc) ED_DirPrefetchResp();
     ED_FrameQRDraw(FrameP);
 }
 
@@ -12315,7 +17389,7 @@ Int16	ED_FrameQRKill(void)
 Int16	ED_FrameQRYank(Int16 Pop)
 {
     char	*DataP;
-    Int32	DataLen;
+    Int64	DataLen;
     Int16	DataX;
 
     ED_KillRingYank(Pop, &DataP, &DataLen, 1);
@@ -12587,6 +17661,10 @@ void	ED_FrameQRHandleChars(ED_FramePointer FrameP, Uns16 SymChar, Int16 Mods, In
     ED_QRRespX += StrX;
     
     ED_QRRespS[ED_QRRespLen] = 0;			// Terminating Null
+
+    // Entering a new dir, start listing it for the TAB to come.
+    if ((ED_QRAutoCompFP == EDCB_QRAutoCompPathFunc) && (StrLen == 1) && (*StrP == '/'))
+	ED_DirPrefetchResp();
     
     ED_FrameQRDraw(FrameP);				// Will erase old blinker
     ED_FrameQRDrawBlinker(FrameP);
@@ -12625,55 +17703,428 @@ void	ED_FrameQRDrawBlinker(ED_FramePointer FrameP)
 }
 
 // ******************************************************************************
-// ED_FrameQRDrawCursor draws the actual cursor, Box or Solid, for the Response
-// in the Frame's Echo line.
+// ED_FrameQRDrawCursor draws the actual cursor, Box or Solid, for the Response
+// in the Frame's Echo line.
+
+void	ED_FrameQRDrawCursor(ED_FramePointer FrameP, Int16 Box)
+{
+    Int32	X, Y;
+
+    if (ED_QRStrikeOut) return;
+
+    X = ED_QRPromptX + ED_QRCursorX - ED_QRStartX;
+    if (X >= FrameP->RowChars) return;
+
+    X = ED_FRAMELMARGIN + (X * ED_Advance);
+    Y = (FrameP->RowCount - 1) * ED_Row;
+
+    if (Box) {
+	XDrawRectangle(ED_XDP, FrameP->XWin, FrameP->BlinkerGC, X, Y, ED_Advance-1, ED_Height-1);
+	FrameP->Flags ^= ED_FRAMEQRBOXCURSORFLAG;
+    } else {
+	XFillRectangle(ED_XDP, FrameP->XWin, FrameP->BlinkerGC, X, Y, ED_Advance, ED_Height);
+	FrameP->Flags ^= ED_FRAMEQRSOLIDCURSORFLAG;
+    }
+}
+
+
+// ******************************************************************************
+// ******************************************************************************
+// DIR CACHE
+//
+// Path completion used to scandir (and sort) the whole directory on every TAB,
+// hundreds of msecs for big build dirs or over NFS.  Now the last
+// ED_DIRCACHECOUNT directories keep their sorted listing.  Each gets an inotify
+// watch, ED_DirNotifyHandler (an sc_FDAdd callback) drops the listing as soon
+// as an entry is created, deleted or renamed.  As inotify does not see changes
+// made by other NFS clients, the dir mtime is also checked (one stat) on use.
+//
+// Typing a '/' in a path QR (or opening one) starts a prefetch: a worker thread
+// lists the dir, then sends the Job down a pipe to ED_DirDoneHandler.  A change
+// (Seq bump) while it was listing makes its result stale, and it is dropped.
+// No watch (out of inotify watches, say) means no caching--listed every time.
+//
+// The listing is sorted, so the names sharing a prefix are a range found by
+// binary search (ED_DirFindRange), and what they all share is what the first
+// and last share.
+
+Int32	ED_DirList(char * PathP, char *** NameArrPP, char ** MemPP, struct timespec * MTimeP);
+void *	ED_DirWorkerFunc(void * ArgP);
+void	ED_DirNotifyHandler(Int32 FD, Int16 REvents, void * DataP);
+void	ED_DirDoneHandler(Int32 FD, Int16 REvents, void * DataP);
+void	ED_DirFlush(ED_DirPointer DirP);
+ED_DirPointer	ED_DirFind(char * PathP);
+ED_DirPointer	ED_DirGet(char * PathP);
+void	ED_DirPrefetch(char * PathP);
+Int16	ED_DirFindRange(ED_DirPointer DirP, char * NameP, Int32 NameLen, Int32 * StartP, Int32 * EndP);
+
+// Used for qsort instead of alphasort--the latter DID NOT properly
+// compare with '_' in names... confused everything!
+Int32	EDCB_QRDirNameCmp(const void * AP, const void * BP)
+{
+    return strcmp(*(char **)AP, *(char **)BP);
+}
+
+// Return 0 to ignore file
+// Ignores "invisible" files, (Start with '.' or end with '~').
+Int32	EDCB_QRDirEntFilter(const struct dirent *DP)
+{
+    return ((DP->d_name[0] != '.') && (DP->d_name[strlen(DP->d_name) - 1] != '~'));
+}
+
+// ******************************************************************************
+// ED_DirList reads PathP into a sorted NameArr, all the names in one MemP block.
+// Returns the Count, or -1 if the dir cannot be read.  Runs on worker threads
+// too, so touches nothing global.
+
+Int32	ED_DirList(char * PathP, char *** NameArrPP, char ** MemPP, struct timespec * MTimeP)
+{
+    DIR *		DirP;
+    struct dirent *	DEP;
+    struct stat		StatR;
+    char **		NameArrP;
+    char *		MemP;
+    Int32		Count, MemLen, MemMax, Len, I;
+
+    if (stat(PathP, &StatR)) return -1;
+    *MTimeP = StatR.st_mtim;
+
+    DirP = opendir(PathP);
+    if (DirP == NULL) return -1;
+
+    MemMax = ED_DIRLISTINITLEN;
+    MemP = malloc(MemMax);
+    if (MemP == NULL) G_SETEXCEPTION("Malloc DirList failed", MemMax);
+    Count = MemLen = 0;
+
+    while ((DEP = readdir(DirP))) {
+	if (! EDCB_QRDirEntFilter(DEP)) continue;
+
+	Len = strlen(DEP->d_name) + 1;
+	if (MemLen + Len > MemMax) {
+	    MemMax *= 2;
+	    MemP = realloc(MemP, MemMax);
+	    if (MemP == NULL) G_SETEXCEPTION("Realloc DirList failed", MemMax);
+	}
+	memcpy(MemP + MemLen, DEP->d_name, Len);
+	MemLen += Len;
+	Count += 1;
+    }
+    closedir(DirP);
+
+    // MemP is final now, so the pointers can be set.
+    NameArrP = malloc((Count + 1) * sizeof(char *));
+    if (NameArrP == NULL) G_SETEXCEPTION("Malloc DirList failed", Count);
+    for (I = 0, Len = 0; I < Count; I++) {
+	NameArrP[I] = MemP + Len;
+	Len += strlen(MemP + Len) + 1;
+    }
+    qsort(NameArrP, Count, sizeof(char *), EDCB_QRDirNameCmp);
+
+    *NameArrPP = NameArrP;
+    *MemPP = MemP;
+    return Count;
+}
+
+void *	ED_DirWorkerFunc(void * ArgP)
+{
+    ED_DirJobPointer	JobP = (ED_DirJobPointer)ArgP;
+
+    JobP->Count = ED_DirList(JobP->Path, &JobP->NameArrP, &JobP->MemP, &JobP->MTime);
+    while ((write(ED_DirPipeArr[1], &JobP, sizeof(JobP)) < 0) && (errno == EINTR));
+    return NULL;
+}
+
+// ******************************************************************************
+// ED_DirNotifyHandler is the sc_FDAdd callback on the inotify FD.  Any event on
+// a watched dir drops its listing.  IN_IGNORED means the watch itself is gone
+// (dir deleted or unmounted).
+
+void	ED_DirNotifyHandler(Int32 FD, Int16 REvents, void * DataP)
+{
+    char		Buf[4096] __attribute__ ((aligned(__alignof__(struct inotify_event))));
+    struct inotify_event *	EvP;
+    ED_DirPointer	DirP;
+    ssize_t		Len;
+    char *		P;
+
+    while ((Len = read(FD, Buf, sizeof(Buf))) > 0) {
+	for (P = Buf; P < Buf + Len; P += sizeof(struct inotify_event) + EvP->len) {
+	    EvP = (struct inotify_event *)P;
+
+	    DirP = ED_DirFirstP;
+	    while (DirP && (DirP->WD != EvP->wd)) DirP = DirP->NextP;
+	    if (DirP == NULL) continue;
+
+	    ED_DirFlush(DirP);
+	    if (EvP->mask & IN_IGNORED) DirP->WD = -1;
+	}
+    }
+}
+
+// ******************************************************************************
+// ED_DirDoneHandler is the sc_FDAdd callback on the prefetch pipe.
+
+void	ED_DirDoneHandler(Int32 FD, Int16 REvents, void * DataP)
+{
+    ED_DirJobPointer	JobP;
+    ED_DirPointer	DirP;
+
+    while (read(FD, &JobP, sizeof(JobP)) == sizeof(JobP)) {
+	pthread_join(JobP->Thread, NULL);
+	ED_DirJobCount -= 1;
+
+	DirP = JobP->DirP;
+	DirP->Loading = 0;
+	if ((JobP->Count >= 0) && (DirP->NameArrP == NULL) && (DirP->Seq == JobP->Seq) && (DirP->WD != -1)) {
+	    DirP->NameArrP = JobP->NameArrP;
+	    DirP->MemP = JobP->MemP;
+	    DirP->Count = JobP->Count;
+	    DirP->MTime = JobP->MTime;
+	} else if (JobP->Count >= 0) {
+	    free(JobP->NameArrP);
+	    free(JobP->MemP);
+	}
+	free(JobP);
+    }
+}
+
+// ******************************************************************************
+// ED_DirFlush drops the listing of DirP (keeps the entry and its watch).
+
+void	ED_DirFlush(ED_DirPointer DirP)
+{
+    DirP->Seq += 1;
+    free(DirP->NameArrP);
+    free(DirP->MemP);
+    DirP->NameArrP = NULL;
+    DirP->MemP = NULL;
+    DirP->Count = 0;
+}
+
+// ******************************************************************************
+// ED_DirFind returns the cache entry for PathP, creating it if need be, and
+// moves it to the front.  Creating one past ED_DIRCACHECOUNT recycles the
+// oldest that is not being prefetched.  The inotify FD and pipe are created
+// on first use.
+
+ED_DirPointer	ED_DirFind(char * PathP)
+{
+    ED_DirPointer	DirP, PrevP, LastP, LastPrevP;
+    Int32		Count;
+
+    if (ED_DirNotifyFD == -1) {
+	ED_DirNotifyFD = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+	if (ED_DirNotifyFD != -1) sc_FDAdd(ED_DirNotifyFD, POLLIN, ED_DirNotifyHandler, NULL);
+    }
+
+    PrevP = LastP = LastPrevP = NULL;
+    DirP = ED_DirFirstP;
+    Count = 0;
+    while (DirP && strcmp(DirP->Path, PathP)) {
+	Count += 1;
+	if (! DirP->Loading) LastP = DirP, LastPrevP = PrevP;
+	PrevP = DirP;
+	DirP = DirP->NextP;
+    }
+
+    if (DirP) {
+	if (PrevP) {					// To the front
+	    PrevP->NextP = DirP->NextP;
+	    DirP->NextP = ED_DirFirstP;
+	    ED_DirFirstP = DirP;
+	}
+	return DirP;
+    }
+
+    if ((Count >= ED_DIRCACHECOUNT) && LastP) {	// Recycle the oldest
+	DirP = LastP;
+	if (LastPrevP) LastPrevP->NextP = DirP->NextP;
+	else ED_DirFirstP = DirP->NextP;
+	ED_DirFlush(DirP);
+	if (DirP->WD != -1) inotify_rm_watch(ED_DirNotifyFD, DirP->WD);
+    } else {
+	DirP = malloc(sizeof(ED_DirRecord));
+	if (DirP == NULL) G_SETEXCEPTION("Malloc Dir failed", 0);
+	DirP->NameArrP = NULL;
+	DirP->MemP = NULL;
+	DirP->Count = 0;
+	DirP->Seq = 0;
+	DirP->Loading = 0;
+    }
+
+    strncpy(DirP->Path, PathP, ED_BUFFERPATHLEN);
+    DirP->Path[ED_BUFFERPATHLEN] = 0;
+    DirP->WD = -1;
+    DirP->NextP = ED_DirFirstP;
+    ED_DirFirstP = DirP;
+    return DirP;
+}
+
+// ******************************************************************************
+// ED_DirGet returns the (cached) entry for PathP with a valid listing, listing
+// it right now if need be.  Returns NULL if the dir cannot be read.
+
+ED_DirPointer	ED_DirGet(char * PathP)
+{
+    ED_DirPointer	DirP = ED_DirFind(PathP);
+    struct stat		StatR;
+
+    // Watch first, then list--so no change can slip in between.
+    if ((DirP->WD == -1) && (ED_DirNotifyFD != -1)) {
+	DirP->WD = inotify_add_watch(ED_DirNotifyFD, DirP->Path,
+				     IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO |
+				     IN_DELETE_SELF | IN_MOVE_SELF | IN_ONLYDIR);
+	ED_DirFlush(DirP);
+    }
+
+    if (DirP->NameArrP) {
+	if (stat(DirP->Path, &StatR) ||
+	    (StatR.st_mtim.tv_sec != DirP->MTime.tv_sec) || (StatR.st_mtim.tv_nsec != DirP->MTime.tv_nsec))
+	    ED_DirFlush(DirP);
+    }
+
+    if (DirP->NameArrP == NULL) {
+	DirP->Count = ED_DirList(DirP->Path, &DirP->NameArrP, &DirP->MemP, &DirP->MTime);
+	if (DirP->Count < 0) {
+	    DirP->Count = 0;
+	    return NULL;
+	}
+    }
+
+    return DirP;
+}
+
+// ******************************************************************************
+// ED_DirPrefetch starts a worker listing PathP, unless it is already listed
+// (or being listed).  Only watched dirs are worth it.
 
-void	ED_FrameQRDrawCursor(ED_FramePointer FrameP, Int16 Box)
+void	ED_DirPrefetch(char * PathP)
 {
-    Int32	X, Y;
+    ED_DirPointer	DirP = ED_DirFind(PathP);
+    ED_DirJobPointer	JobP;
 
-    if (ED_QRStrikeOut) return;
+    if (DirP->NameArrP || DirP->Loading) return;
 
-    X = ED_QRPromptX + ED_QRCursorX - ED_QRStartX;
-    if (X >= FrameP->RowChars) return;
+    if (DirP->WD == -1) {
+	if (ED_DirNotifyFD == -1) return;
+	DirP->WD = inotify_add_watch(ED_DirNotifyFD, DirP->Path,
+				     IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO |
+				     IN_DELETE_SELF | IN_MOVE_SELF | IN_ONLYDIR);
+	if (DirP->WD == -1) return;
+    }
 
-    X = ED_FRAMELMARGIN + (X * ED_Advance);
-    Y = (FrameP->RowCount - 1) * ED_Row;
+    if (ED_DirPipeArr[0] == -1) {
+	if (pipe(ED_DirPipeArr)) G_SETEXCEPTION("Dir pipe failed", errno);
+	fcntl(ED_DirPipeArr[0], F_SETFL, O_NONBLOCK);
+	sc_FDAdd(ED_DirPipeArr[0], POLLIN, ED_DirDoneHandler, NULL);
+    }
 
-    if (Box) {
-	XDrawRectangle(ED_XDP, FrameP->XWin, FrameP->BlinkerGC, X, Y, ED_Advance-1, ED_Height-1);
-	FrameP->Flags ^= ED_FRAMEQRBOXCURSORFLAG;
-    } else {
-	XFillRectangle(ED_XDP, FrameP->XWin, FrameP->BlinkerGC, X, Y, ED_Advance, ED_Height);
-	FrameP->Flags ^= ED_FRAMEQRSOLIDCURSORFLAG;
+    JobP = malloc(sizeof(ED_DirJobRecord));
+    if (JobP == NULL) G_SETEXCEPTION("Malloc DirJob failed", 0);
+    JobP->DirP = DirP;
+    JobP->Seq = DirP->Seq;
+    strcpy(JobP->Path, DirP->Path);
+
+    if (pthread_create(&JobP->Thread, NULL, ED_DirWorkerFunc, JobP)) {
+	free(JobP);					// Just list it on TAB then
+	return;
     }
+    DirP->Loading = 1;
+    ED_DirJobCount += 1;
 }
 
+// ******************************************************************************
+// ED_DirPrefetchResp prefetches the dir of the (path) QR Resp up to the cursor.
+// Called when a '/' is typed, and when a path QR opens.
+
+void	ED_DirPrefetchResp(void)
+{
+    char	RespS[ED_RESPSTRLEN];
+    char	PathS[ED_BUFFERPATHLEN + 1];
+    char	NameS[NAME_MAX + 1];
+
+    memcpy(RespS, ED_QRRespS, ED_QRCursorPos);
+    RespS[ED_QRCursorPos] = 0;
+    if (ED_UtilNormalizePath(RespS, PathS, ED_BUFFERPATHLEN + 1, NameS, NAME_MAX + 1)) return;
+    if (PathS[0] == 0) return;
+
+    ED_DirPrefetch(PathS);
+}
 
 // ******************************************************************************
-// EDCB_QRAutoCompPathFunc is a callback to auto-complete file/dir names used
-// in QR.  It uses scandir with custom Cmp and Filter functions.
+// ED_DirFindRange finds the range [*StartP, *EndP] of names that start with the
+// NameLen bytes of NameP.  Returns 0 if there are none.
 
-// Used for scandir instead of alphasort--the latter DID NOT properly
-// compare with '_' in names... confused everything!
-Int32	EDCB_QRDirEntCmp(const struct dirent **APP, const struct dirent **BPP)
+Int16	ED_DirFindRange(ED_DirPointer DirP, char * NameP, Int32 NameLen, Int32 * StartP, Int32 * EndP)
 {
-    return strcmp((*APP)->d_name, (*BPP)->d_name);
+    char **	ArrP = DirP->NameArrP;
+    Int32	Lo, Hi, Mid;
+
+    Lo = 0, Hi = DirP->Count;		// First name NOT less than NameP
+    while (Lo < Hi) {
+	Mid = (Lo + Hi) / 2;
+	if (strncmp(ArrP[Mid], NameP, NameLen) < 0) Lo = Mid + 1;
+	else Hi = Mid;
+    }
+    if ((Lo == DirP->Count) || strncmp(ArrP[Lo], NameP, NameLen)) return 0;
+    *StartP = Lo;
+
+    Hi = DirP->Count;			// First name greater than NameP
+    while (Lo < Hi) {
+	Mid = (Lo + Hi) / 2;
+	if (strncmp(ArrP[Mid], NameP, NameLen) <= 0) Lo = Mid + 1;
+	else Hi = Mid;
+    }
+    *EndP = Lo - 1;
+    return 1;
 }
 
-// Return 0 to ignore file
-// Ignores "invisible" files, (Start with '.' or end with '~').
-Int32	EDCB_QRDirEntFilter(const struct dirent *DP)
+// ******************************************************************************
+// ED_DirCacheKill waits for prefetches, then frees all the listings.
+
+void	ED_DirCacheKill(void)
 {
-    return ((DP->d_name[0] != '.') && (DP->d_name[strlen(DP->d_name) - 1] != '~'));
+    ED_DirPointer	DirP;
+    struct pollfd	PFD;
+
+    while (ED_DirJobCount) {
+	PFD.fd = ED_DirPipeArr[0];
+	PFD.events = POLLIN;
+	poll(&PFD, 1, -1);
+	ED_DirDoneHandler(ED_DirPipeArr[0], POLLIN, NULL);
+    }
+
+    while ((DirP = ED_DirFirstP)) {
+	ED_DirFirstP = DirP->NextP;
+	ED_DirFlush(DirP);
+	free(DirP);
+    }
+
+    if (ED_DirNotifyFD != -1) {
+	sc_FDDel(ED_DirNotifyFD);
+	close(ED_DirNotifyFD);
+	ED_DirNotifyFD = -1;
+    }
+    if (ED_DirPipeArr[0] != -1) {
+	sc_FDDel(ED_DirPipeArr[0]);
+	close(ED_DirPipeArr[0]);
+	close(ED_DirPipeArr[1]);
+	ED_DirPipeArr[0] = ED_DirPipeArr[1] = -1;
+    }
 }
 
+// ******************************************************************************
+// EDCB_QRAutoCompPathFunc is a callback to auto-complete file/dir names used
+// in QR.  It gets the listing from the DIR CACHE.
+
 // Return 0 == Good response (DID complete)
 // Return 1 == Bad response (Cannot complete)
 Int16	EDCB_QRAutoCompPathFunc(void)
 {
-    struct dirent	**DEntPArr;
-    Int32		DCount, CurD, StartD, EndD, NameLen;
+    ED_DirPointer	DirP;
+    char **		ArrP;
+    Int32		StartD, EndD, NameLen;
     Int16		Res;
     Int32		HalfLen = (ED_RESPSTRLEN / 2) - 1;
     
@@ -12686,71 +18137,38 @@ Int16	EDCB_QRAutoCompPathFunc(void)
     NameLen = strlen(ED_Name);
     
     // ED_Path has the pathname, so far.
-    DCount = scandir(ED_Path, &DEntPArr, EDCB_QRDirEntFilter, EDCB_QRDirEntCmp);
-    if (DCount == 0) return 1;
+    DirP = ED_DirGet(ED_Path);
+    if (DirP == NULL) return 1;
+    ArrP = DirP->NameArrP;
 
 #ifdef DEBUG
     if (0) {
-	printf("AutoCompFile   Path:[%s]  Name:[%s]\n", ED_Path, ED_Name);
-
-	CurD = 0;
-	while (CurD < DCount) {
-	    printf("    Ent[%d] -> [%s]\n", CurD, DEntPArr[CurD]->d_name);
-	    CurD++;
-	}
+	printf("AutoCompFile   Path:[%s]  Name:[%s]  Count:%d\n", ED_Path, ED_Name, DirP->Count);
     }
 #endif
 
-    CurD = 0;
-    StartD = EndD = -1;
-    while (CurD < DCount) {
-	Res = strncmp(ED_Name, DEntPArr[CurD]->d_name, NameLen);
-	if (Res == 0) {
-	    // Found a match, but there may be others!!  Catch first and last
-	    if (StartD == -1) StartD = CurD;
-	    EndD = CurD;
-	} else if (Res < 0)
-	    break;
-
-	CurD++;
+    if (! ED_DirFindRange(DirP, ED_Name, NameLen, &StartD, &EndD)) {
+	Res = 1;			// Found nothing
+	goto Cleanup;
     }
 
-    if (StartD == -1)			// Found nothing
-	goto FailReturn;
-
     // Perfet match if StartD and EndD are the same!
-    // Also if d_name is exactly the same length as NameLen...
-    // By definition, d_name CANNOT be shorter, so if it is NOT
+    // Also if the name is exactly the same length as NameLen...
+    // By definition, it CANNOT be shorter, so if it is NOT
     // longer (easier test), then it *must* be the same length.
-    if ((StartD == EndD) ||
-	(DEntPArr[StartD]->d_name[NameLen] == 0)) {
-	sprintf(ED_FullPath, "%.*s/%.*s", HalfLen, ED_Path, HalfLen, DEntPArr[StartD]->d_name);
-	ED_FrameQRSetResp(ED_FullPath);
-	goto SuccessReturn;
-    }
-
-    // If we get here, we have multiple matches, from StartD to EndD.
-    // Must do a string intersection to find the longest matching substring!!
-    strcpy(ED_Name, DEntPArr[StartD]->d_name);	// Start here
-    CurD = StartD + 1;
-    while (CurD <= EndD) {
-	ED_UtilIntersectStr(ED_Name, DEntPArr[CurD]->d_name);
-	CurD++;
-    }
+    // Otherwise, multiple matches from StartD to EndD.  They are sorted,
+    // so the longest common prefix is that of the first and last.
+    strcpy(ED_Name, ArrP[StartD]);
+    if ((StartD != EndD) && (ArrP[StartD][NameLen] != 0))
+	ED_UtilIntersectStr(ED_Name, ArrP[EndD]);
     
-    // Report the result and fall through to Success!!
     sprintf(ED_FullPath, "%.*s/%.*s", HalfLen, ED_Path, HalfLen, ED_Name);
     ED_FrameQRSetResp(ED_FullPath);
-    
-SuccessReturn:
     Res = 0;
-    goto Cleanup;
-FailReturn:
-    Res = 1;
-    
+
 Cleanup:
-    while (DCount--) free(DEntPArr[DCount]);
-    free(DEntPArr);
+    // Without a watch, the listing cannot be trusted next time.
+    if (DirP->WD == -1) ED_DirFlush(DirP);
     return Res;
 }
 
@@ -13003,7 +18421,7 @@ void	ED_PUListDrawNumberFrame(ED_PUPointer PUP, Int16 LeftCol)
     
     if (PUP->TitleLen > PUP->RowChars - 3) PUP->TitleLen = PUP->RowChars - 3;
     LineY = ED_PU_YMARGIN + ED_Ascent - (ED_PU_YMARGIN / 2);
-    XftDrawStringUtf8(PUP->XftDP, &ED_XCArr[ED_White], ED_XFP, ED_PU_XMARGIN, LineY, (XftChar8 *)PUP->TitleStr, PUP->TitleLen);
+    ED_GlyphDrawRun(PUP->XftDP, ED_White, ED_PU_XMARGIN, LineY, PUP->TitleStr, PUP->TitleLen);
 
     // Draw the bottom margin
     LineY = ED_PU_YMARGIN + ((PUP->RowCount - 1) * ED_Row);
@@ -13283,7 +18701,7 @@ void	ED_PUListDestroy(ED_PUPointer PUP)
 	char		String1[255];
 	ED_FramePointer	FP;
 	ED_BufferPointer	BP;
-	Int32		Pos, StartingPos;
+	Int64		Pos, StartingPos;
 	char		HEllipses[] = {0xE2, 0x80, 0xA6, 0x00};
 
 
@@ -13352,28 +18770,29 @@ void	ED_PUListDestroy(ED_PUPointer PUP)
 	// But a good template for other tests, as needed.
 	if (0) {
 	    Int32		Count;
-	    Int32		Pos, Row, Col, MaxPos;
-	    Int32		StartPos1, StartPos2;
-	    Int32		TestPos;
+	    Int32		Col;
+	    Int64		Row, Pos, MaxPos;
+	    Int64		StartPos1, StartPos2;
+	    Int64		TestPos;
 
 	    Count = 500000;
 	    MaxPos = FP->CurPaneP->BufP->LastPos;
 	    while (Count--) {
-		Pos = (Int32)(((Int64)rand() * MaxPos) / (Int64)RAND_MAX);
+		Pos = ((Int64)rand() * MaxPos) / (Int64)RAND_MAX;
 
 		StartPos1 = ED_PaneFindLoc(FP->CurPaneP, Pos, &Row, &Col, 0, 0);
-		// printf("AbsLoc Pos:%d  --> Row:%d  Col:%d\n", Pos, Row, Col);
+		// printf("AbsLoc Pos:%ld  --> Row:%ld  Col:%d\n", Pos, Row, Col);
 		StartPos2 = ED_PaneFindPos(FP->CurPaneP, &TestPos, &Row, &Col, 0, 0);
-		// printf("AbsPos -> Pos:%d  <-- Row:%d  Col:%d\n", TestPos, Row, Col);
+		// printf("AbsPos -> Pos:%ld  <-- Row:%ld  Col:%d\n", TestPos, Row, Col);
 
 		if (StartPos1 != StartPos2) {
-		    printf("Test Mismatch!  POS=%d	--> Pos1:%d  Pos2:%d\n", Pos, StartPos1, StartPos2);
+		    printf("Test Mismatch!  POS=%ld	--> Pos1:%ld  Pos2:%ld\n", Pos, StartPos1, StartPos2);
 		    break;
 		} else if (TestPos != Pos) {
-		    printf("Test Mismatch!  Loc-Pos: %d --> Pos: %d\n", Pos, TestPos);
+		    printf("Test Mismatch!  Loc-Pos: %ld --> Pos: %ld\n", Pos, TestPos);
 		    break;
 		} else
-		    if (Pos < 10) printf("[%d] ", Pos);
+		    if (Pos < 10) printf("[%ld] ", Pos);
 	    }
 	    printf("Done \n");
 	}
@@ -13385,7 +18804,7 @@ void	ED_PUListDestroy(ED_PUPointer PUP)
 // ******************************************************************************
 // Undo
 //
-// Each Buffer has a doubly-linked list of UndoSlabs (malloc/free) hanging off
+// Each Buffer has a doubly-linked list of UndoSlabs (ED_PayloadPool) hanging off
 // of it.  The number (and total size) is managed by a GC function that can
 // free the oldest slabs to make room.  Each UndoSlab contains an array of
 // UndoBlocks, each of which records a Buffer operation.  As the user Edits,
@@ -13414,16 +18833,40 @@ void	ED_PUListDestroy(ED_PUPointer PUP)
 // NOTE:	RealEmacs allows numeric args for Undo, and appears to gang/chain
 //		them together (for the purpose of Undoing-the-undo).  This
 //		implementation does not accept numeric args for the Undo cmd.
+//
+// Old UndoSlabs are not dropped by the L0 GC, they are FROZEN instead.  Their
+// UBlocks are compressed (ED_UtilLZCompress) into the Undo journal, an unlinked
+// sparse temp file mapped into memory--the kernel can page it out.  A frozen
+// slab keeps just its header (ED_USlabRecord) on the chain, and is THAWED
+// (expanded back into a full slab) when Undo reaches it.  Old slabs never
+// change, so a thawed slab keeps its journal copy and refreezes for free.
+// The journal is a simple bump allocator, it resets when nothing in it is live.
+// If it is full (or cannot be created), the GC drops the oldest slabs as before.
+// The headers of frozen slabs come from ED_UStubStore.
 
 #define			ED_UNDO_DATASIZE	35	// Good size for an Undo block
 
-Int32			ED_UndoBlock;			// Read for Undoing...0 means start at head
+Int64			ED_UndoBlock;			// Read for Undoing...0 means start at head
 ED_USlabPointer		ED_UndoSlabP;			// Read for Undoing...NULL means Slab purged or start at head
 Int16			ED_UndoSeenSave;		// Read for Undoing...Seen a SAVE UBlock
 
+char *			ED_UJMemP = NULL;		// Undo journal mapping
+Int32			ED_UJFD = -1;			// Its (unlinked) file
+Int64			ED_UJTop = 0;			// Next free byte
+Int64			ED_UJLive = 0;			// Bytes still referenced by slabs
+Int16			ED_UJFailed = 0;		// Could not create, do not retry
+
 
-Int16	ED_BufferAddNewUndoSlab(ED_BufferPointer BufP, Int32 Payload);
-Int32	ED_BufferAllocUndoBlock(ED_BufferPointer BufP, Int32 DataLen, ED_UBlockPointer *UBlockPP);
+Int16	ED_BufferAddNewUndoSlab(ED_BufferPointer BufP, Int64 Payload);
+Int64	ED_BufferAllocUndoBlock(ED_BufferPointer BufP, Int64 DataLen, ED_UBlockPointer *UBlockPP);
+Int16	ED_UndoJournalOpen(void);
+void	ED_UndoJournalFree(ED_USlabPointer USP);
+void	ED_UndoSlabFree(ED_USlabPointer USP);
+Int64	ED_UndoSlabUsedLen(ED_USlabPointer USP);
+void	ED_UndoSlabRelink(ED_BufferPointer BufP, ED_USlabPointer OldUSP, ED_USlabPointer NewUSP);
+Int16	ED_BufferFreezeUndoSlab(ED_BufferPointer BufP, ED_USlabPointer USP);
+ED_USlabPointer	ED_BufferThawUndoSlab(ED_BufferPointer BufP, ED_USlabPointer USP);
+void	ED_BufferFreezeUndoSlabs(ED_BufferPointer BufP);
 
 
 // Initializes Undo memory for BufP.
@@ -13435,6 +18878,7 @@ void	ED_BufferInitUndo(ED_BufferPointer BufP)
     BufP->FirstUSP = BufP->LastUSP = NULL;
     BufP->USCount = 0;
     BufP->USTotalSize = 0;
+    BufP->USFrozenCount = 0;
     if (! ED_BufferAddNewUndoSlab(BufP, 0))
 	G_SETEXCEPTION("Malloc Undo Memory Failed", 0);
 }
@@ -13449,21 +18893,24 @@ void	ED_BufferKillUndo(ED_BufferPointer BufP)
     USP = BufP->FirstUSP;
     while (USP) {
 	NextUSP = USP->NextUSP;
-	free(USP);
+	ED_UndoJournalFree(USP);
+	ED_UndoSlabFree(USP);
 	USP = NextUSP;
     }
 
     BufP->FirstUSP = BufP->LastUSP = NULL;
     BufP->USCount = 0;
     BufP->USTotalSize = 0;
+    BufP->USFrozenCount = 0;
 }
 
 // Creates an UndoSlab large enough to handle Payload Bytes.  Attaches it
 // at the Last end of the doubly linked USlab chain--latest in time.
-Int16	ED_BufferAddNewUndoSlab(ED_BufferPointer BufP, Int32 Payload)
+// The slab takes all of its PayloadPool class.
+Int16	ED_BufferAddNewUndoSlab(ED_BufferPointer BufP, Int64 Payload)
 {
     ED_USlabPointer	USP;
-    Int32		Size;
+    Int64		Size;
 
     if (Payload == 0)
 	Size = ED_UNDOINITLEN;
@@ -13472,13 +18919,17 @@ Int16	ED_BufferAddNewUndoSlab(ED_BufferPointer BufP, Int32 Payload)
 	if (Size < ED_UNDOINITLEN) Size = ED_UNDOINITLEN;
     }
 
-    USP = malloc(Size);
+    Size = sc_SAPoolSize(&ED_PayloadPool, Size);
+    USP = sc_SAPoolAlloc(&ED_PayloadPool, Size);
     if (! USP) return 0;
     
     USP->Tag = *(Uns32 *)ED_UndoTag;
     USP->Flags = ED_US_NOFLAG;
     USP->SlabSize = Size;
     USP->LastUBlock = 0;			// No blocks for now!
+    USP->JournalOff = 0;
+    USP->JournalLen = 0;
+    USP->UsedLen = 0;
 
     USP->NextUSP = NULL;
     if (BufP->FirstUSP) {
@@ -13514,9 +18965,13 @@ void	ED_BufferKillUndoSlabs(ED_BufferPointer BufP, Int16 Count)
 	}
 
 	BufP->USCount -= 1;
-	BufP->USTotalSize -= USP->SlabSize;
+	if (USP->Flags & ED_US_FROZENFLAG)
+	    BufP->USFrozenCount -= 1;
+	else
+	    BufP->USTotalSize -= USP->SlabSize;
 
-	free(USP);
+	ED_UndoJournalFree(USP);
+	ED_UndoSlabFree(USP);
 	USP = NextUSP;
 	if (--Count <= 0) break;
     }
@@ -13532,9 +18987,10 @@ void	ED_BufferGCUndoSlabs(ED_BufferPointer BufP, Int16 Level)
 {
       switch (Level) {
 	case 0:
-	    // Does not look at Bytes, just number of Slabs.
-	    if (BufP->USCount > ED_UNDOGCSLABCOUNT)
-		ED_BufferKillUndoSlabs(BufP, BufP->USCount - ED_UNDOGCL0SLABCOUNT);
+	    // Freezes old Slabs to the journal, only drops them past ED_UNDOMAXSLABS.
+	    ED_BufferFreezeUndoSlabs(BufP);
+	    if (BufP->USCount > ED_UNDOMAXSLABS)
+		ED_BufferKillUndoSlabs(BufP, BufP->USCount - ED_UNDOMAXSLABS);
 	    break;
 
 	case 1:
@@ -13565,22 +19021,213 @@ void	ED_BufferGCUndoSlabs(ED_BufferPointer BufP, Int16 Level)
       }
 }
 
+// Creates the Undo journal on first use.  The file is unlinked right away, so
+// it vanishes with the process, and is sparse--only written pages use disk.
+// Returns 1 if the journal is usable.
+Int16	ED_UndoJournalOpen(void)
+{
+    char		PathS[ED_BUFFERPATHLEN];
+    char *		DirP;
+    void *		MemP;
+
+    if (ED_UJMemP) return 1;
+    if (ED_UJFailed) return 0;
+    ED_UJFailed = 1;
+
+    DirP = getenv("TMPDIR");
+    if ((DirP == NULL) || (*DirP == 0)) DirP = "/tmp";
+    if (snprintf(PathS, ED_BUFFERPATHLEN, "%s/.scEmacsUndo.XXXXXX", DirP) >= ED_BUFFERPATHLEN) return 0;
+
+    ED_UJFD = mkstemp(PathS);
+    if (ED_UJFD < 0) return 0;
+    unlink(PathS);
+
+    if (ftruncate(ED_UJFD, ED_UNDOJOURNALMAX) == 0) {
+	MemP = mmap(NULL, ED_UNDOJOURNALMAX, PROT_READ | PROT_WRITE, MAP_SHARED, ED_UJFD, 0);
+	if (MemP != MAP_FAILED) {
+	    ED_UJMemP = MemP;
+	    ED_UJTop = ED_UJLive = 0;
+	    ED_UJFailed = 0;
+	    return 1;
+	}
+    }
+
+    close(ED_UJFD);
+    ED_UJFD = -1;
+    return 0;
+}
+
+// Releases the journal copy of USP (if any).  The pages are punched out of the
+// file as best it can, and the whole journal is reused once nothing is live.
+void	ED_UndoJournalFree(ED_USlabPointer USP)
+{
+    Int64		Len, Start, End, PageMask;
+
+    if (!(USP->Flags & ED_US_JOURNALFLAG)) return;
+    USP->Flags &= ~ED_US_JOURNALFLAG;
+
+    Len = (USP->JournalLen + 7) & ~7;
+    ED_UJLive -= Len;
+    if (ED_UJLive <= 0) {
+	madvise(ED_UJMemP, ED_UJTop, MADV_REMOVE);
+	ED_UJTop = ED_UJLive = 0;
+	return;
+    }
+
+    // Only whole pages inside the record can go.
+    PageMask = sysconf(_SC_PAGESIZE) - 1;
+    Start = (USP->JournalOff + PageMask) & ~PageMask;
+    End = (USP->JournalOff + Len) & ~PageMask;
+    if (End > Start) madvise(ED_UJMemP + Start, End - Start, MADV_REMOVE);
+}
+
+// Gives back the memory of USP, a frozen stub or a full slab.
+void	ED_UndoSlabFree(ED_USlabPointer USP)
+{
+    if (USP->Flags & ED_US_FROZENFLAG)
+	sc_SAStoreFreeBlock(&ED_UStubStore, USP);
+    else
+	sc_SAPoolFree(&ED_PayloadPool, USP, USP->SlabSize);
+}
+
+void	ED_UndoJournalKill(void)
+{
+    if (ED_UJMemP) munmap(ED_UJMemP, ED_UNDOJOURNALMAX);
+    if (ED_UJFD >= 0) close(ED_UJFD);
+    ED_UJMemP = NULL;
+    ED_UJFD = -1;
+    ED_UJTop = ED_UJLive = 0;
+}
+
+// Bytes used on USP, header included.  Anything past the Last UBlock is unused.
+Int64	ED_UndoSlabUsedLen(ED_USlabPointer USP)
+{
+    ED_UBlockPointer	UBP;
+    Int64		Size;
+
+    if (USP->LastUBlock == 0) return sizeof(ED_USlabRecord);
+
+    UBP = (ED_UBlockPointer)((char *)USP + USP->LastUBlock);
+    Size = sizeof(ED_UBlockRecord);
+    if (UBP->Flags & ED_UB_DEL)
+	Size = (Size + UBP->DataLen) & ~0x00000007;
+    return USP->LastUBlock + Size;
+}
+
+// NewUSP takes the place of OldUSP on the chain (and for the Undo read head).
+void	ED_UndoSlabRelink(ED_BufferPointer BufP, ED_USlabPointer OldUSP, ED_USlabPointer NewUSP)
+{
+    if (NewUSP->PrevUSP) NewUSP->PrevUSP->NextUSP = NewUSP;
+    else BufP->FirstUSP = NewUSP;
+    if (NewUSP->NextUSP) NewUSP->NextUSP->PrevUSP = NewUSP;
+    else BufP->LastUSP = NewUSP;
+    if (ED_UndoSlabP == OldUSP) ED_UndoSlabP = NewUSP;
+}
+
+// Compresses USP into the journal and replaces it with a header-only stub.
+// Never called for LastUSP, the one being written.
+// Returns 0 if the journal has no room (or no memory for the stub).
+Int16	ED_BufferFreezeUndoSlab(ED_BufferPointer BufP, ED_USlabPointer USP)
+{
+    ED_USlabPointer	StubP;
+    Int64		UsedLen, Len;
+
+    if (!(USP->Flags & ED_US_JOURNALFLAG)) {
+	if (! ED_UndoJournalOpen()) return 0;
+
+	UsedLen = ED_UndoSlabUsedLen(USP);
+	Len = UsedLen - sizeof(ED_USlabRecord);
+	if (ED_UJTop + ED_LZBOUND(Len) > ED_UNDOJOURNALMAX) return 0;
+
+	USP->JournalOff = ED_UJTop;
+	USP->JournalLen = ED_UtilLZCompress((char *)(USP + 1), (Int32)Len, ED_UJMemP + ED_UJTop);
+	USP->UsedLen = UsedLen;
+	USP->Flags |= ED_US_JOURNALFLAG;
+	Len = (USP->JournalLen + 7) & ~7;
+	ED_UJTop += Len;
+	ED_UJLive += Len;
+    }
+
+    StubP = sc_SAStoreGetBlock(&ED_UStubStore);
+    if (! StubP) return 0;			// Journal copy stays, next try is cheap
+
+    *StubP = *USP;
+    StubP->Flags |= ED_US_FROZENFLAG;
+    ED_UndoSlabRelink(BufP, USP, StubP);
+    BufP->USTotalSize -= USP->SlabSize;
+    BufP->USFrozenCount += 1;
+    ED_UndoSlabFree(USP);
+    return 1;
+}
+
+// Expands the frozen StubP back into a full USlab, returns it (or NULL).
+ED_USlabPointer	ED_BufferThawUndoSlab(ED_BufferPointer BufP, ED_USlabPointer StubP)
+{
+    ED_USlabPointer	USP;
+    Int64		Len;
+
+    USP = sc_SAPoolAlloc(&ED_PayloadPool, StubP->SlabSize);
+    if (! USP) return NULL;
+
+    *USP = *StubP;
+    USP->Flags &= ~ED_US_FROZENFLAG;
+    Len = StubP->UsedLen - sizeof(ED_USlabRecord);
+    if (ED_UtilLZExpand(ED_UJMemP + StubP->JournalOff, StubP->JournalLen,
+			(char *)(USP + 1), (Int32)Len) != Len) {		// Journal is < 2GB
+	ED_UndoSlabFree(USP);
+	errno = EIO;
+	return NULL;
+    }
+
+    ED_UndoSlabRelink(BufP, StubP, USP);
+    BufP->USTotalSize += USP->SlabSize;
+    BufP->USFrozenCount -= 1;
+    ED_UndoSlabFree(StubP);
+    return USP;
+}
+
+// L0 GC.  Once more than ED_UNDOGCSLABCOUNT slabs (or ED_UNDORESIDENTMAX bytes)
+// are resident, freezes the oldest down to ED_UNDOGCL0SLABCOUNT.  A slab the
+// journal cannot take (full, none, or the slab is too big) just stays resident--
+// size alone never drops undo history.  Then the old count-only rule applies to
+// the resident ones: past ED_UNDOGCSLABCOUNT, the oldest slabs go.
+void	ED_BufferFreezeUndoSlabs(ED_BufferPointer BufP)
+{
+    ED_USlabPointer	USP, NextUSP;
+
+    if ((BufP->USCount - BufP->USFrozenCount <= ED_UNDOGCSLABCOUNT) &&
+	(BufP->USTotalSize <= ED_UNDORESIDENTMAX)) return;
+
+    USP = BufP->FirstUSP;
+    while (USP && (USP != BufP->LastUSP) &&
+	   ((BufP->USCount - BufP->USFrozenCount > ED_UNDOGCL0SLABCOUNT) ||
+	    (BufP->USTotalSize > ED_UNDORESIDENTMAX))) {
+	NextUSP = USP->NextUSP;			// USP is freed, if it was frozen
+	if (!(USP->Flags & ED_US_FROZENFLAG)) ED_BufferFreezeUndoSlab(BufP, USP);
+	USP = NextUSP;
+    }
+
+    while (BufP->USCount - BufP->USFrozenCount > ED_UNDOGCSLABCOUNT)
+	ED_BufferKillUndoSlabs(BufP, 1);
+}
+
 // Allocates a new UndoBlock to hold DataLen bytes, will create a new USlab if there is not enough room.
 // The new Slab will be LARGE ENOUGH to hold at least this UBlock.
 //
-// NOTE:	Block size is always multiple of 4--aligned.
-//		Size of a Block is ((SizeOfRecord - 3 + DataLen) + 3) & ~0x0003 (round to multiple of 4)
-//		But the -3 and +3 cancel out, so are left out.
+// NOTE:	Block size is always multiple of 8--aligned for the Int64 fields.
+//		Size of a Block is ((SizeOfRecord - 7 + DataLen) + 7) & ~0x0007 (round to multiple of 8)
+//		But the -7 and +7 cancel out, so are left out.
 //
 // NOTE:	ADD blocks have no Data, so are always allocated on 1 USlab.  But DEL blocks
 //		have Data... and long ones may not fit.  So it allocates as much as will fit,
 //		on THIS USlab, then creates another USlab and places the remainder in a CHAINed
-//		UBlock on the new USlab.
-Int32	ED_BufferAllocUndoBlock(ED_BufferPointer BufP, Int32 DataLen, ED_UBlockPointer *UBlockPP)
+//		UBlock on the new USlab.  DEL blocks of ED_UNDOINITLEN or more are never split,
+//		they start a new USlab, so a big kill freezes (and thaws) as one unit.
+Int64	ED_BufferAllocUndoBlock(ED_BufferPointer BufP, Int64 DataLen, ED_UBlockPointer *UBlockPP)
 {
     ED_USlabPointer		LastUSP = BufP->LastUSP;
     ED_UBlockPointer		UBP = NULL;
-    Int32			MaxData, Size, NewOffset;
+    Int64			MaxData, Size, NewOffset;
 
     do {
 	// If the LastUSP is empty, create the first UBlock.
@@ -13598,7 +19245,7 @@ Int32	ED_BufferAllocUndoBlock(ED_BufferPointer BufP, Int32 DataLen, ED_UBlockPoi
 	UBP = (ED_UBlockPointer)((char *)LastUSP + LastUSP->LastUBlock);
 	Size = sizeof (ED_UBlockRecord);
 	if (UBP->Flags & ED_UB_DEL)				// It has data!
-	    Size = (Size + UBP->DataLen) & ~0x00000003;		// Round to 32-bit boundary
+	    Size = (Size + UBP->DataLen) & ~0x00000007;		// Round to 64-bit boundary
 
 	// Room for a new block here?
 	NewOffset = LastUSP->LastUBlock + Size;
@@ -13606,7 +19253,7 @@ Int32	ED_BufferAllocUndoBlock(ED_BufferPointer BufP, Int32 DataLen, ED_UBlockPoi
 
 	// Happy to make *a* block here if have at least ED_UNDO_DATASIZE bytes for data.
 	// Anything extra, allocate another Slab and CHAIN the next UBlock to this one.
-	if ((MaxData >= DataLen) || (MaxData >= ED_UNDO_DATASIZE)) {
+	if ((MaxData >= DataLen) || ((MaxData >= ED_UNDO_DATASIZE) && (DataLen < ED_UNDOINITLEN))) {
 	    LastUSP->LastUBlock = NewOffset;
 	    UBP = (ED_UBlockPointer)((char *)LastUSP + NewOffset);
 	    UBP->PrevUBlock = UBP->DataPos = UBP->DataLen = -1;
@@ -13636,6 +19283,23 @@ Int32	ED_BufferAllocUndoBlock(ED_BufferPointer BufP, Int32 DataLen, ED_UBlockPoi
     return -1;							// Should never get here!
 }
 
+// BufP is altered... excellent place for ED_XSelAlterPrimary, in case BufP is PRIMARY!
+// This properly handles the case when BufP is altered by using the Undo cmd itself!!
+// Functionality is available even in ReadOnly buffers or when Undo is turned off.
+// Same for the LineIdx, RowIdx and ParenIdx, DataP is the deleted (or added) text.
+// Delta > 0 for ADD and < 0 for DEL.  Normally called by ED_BufferAddUndoBlock,
+// but a caller that records many small blocks for one big contiguous edit can
+// call it ONCE for the whole edit and pass ED_UB_NOIDX for each block.
+void	ED_BufferEditUpdate(ED_BufferPointer BufP, Int64 Pos, Int64 Delta, char * DataP)
+{
+    BufP->EditSeq += 1;
+    ED_XSelAlterPrimary(BufP, Pos, Delta);
+    ED_BufferLIdxUpdate(BufP, Pos, Delta, DataP);
+    ED_BufferRIdxUpdate(BufP, Pos, Delta);
+    ED_BufferPIdxUpdate(BufP, Pos, Delta, DataP);
+    ED_ISSetInvalidate(BufP);
+}
+
 // Main routine for adding Undo blocks--called by all Cmds that modify the Buffer.
 // Mode == ADD or DEL, but *NEVER* both!
 //
@@ -13674,9 +19338,9 @@ Int32	ED_BufferAllocUndoBlock(ED_BufferPointer BufP, Int32 DataLen, ED_UBlockPoi
 // are *ALWAYS* merged (easy since they have no Data) so when they are undone, they
 // don't lead to even more DEL blocks... on and on.  Since the ADD blocks are merged,
 // undoing them will *NEVER* request chained DEL blocks--although DEL blocks may end up
-// split and chained if they are long.  No other (normal) editor command will ever
-// explicitly ask for chained DEL blocks.  Therefore, there is no need to force merge
-// chained DEL blocks like the ADD blocks.
+// split and chained if they are long.  Only ED_QREPReplaceAll explicitly asks for
+// chained DEL blocks (one DEL-ADD pair per match), and it needs them kept apart.
+// Therefore, there is no need to force merge chained DEL blocks like the ADD blocks.
 //
 // Generally, a few chars (about 30) are merged, to cut down on the number of UBlocks
 // and their overhead memory.  Too many chars are not merged, as they would all have
@@ -13686,20 +19350,20 @@ Int32	ED_BufferAllocUndoBlock(ED_BufferPointer BufP, Int32 DataLen, ED_UBlockPoi
 // changes the base "notion" of what the unmodified buffer looks like.  After a SAVE
 // anything that restores the buffer to previous states (even its very original one)
 // will still render the Buf as MOD.  (The explicit UNMODIFY command is regarded as a SAVE.)
-void	ED_BufferAddUndoBlock(ED_BufferPointer BufP, Int32 Pos, Int32 Len, Uns8 Mode, char * DataP)
+void	ED_BufferAddUndoBlock(ED_BufferPointer BufP, Int64 Pos, Int64 Len, Uns8 Mode, char * DataP)
 {
     ED_USlabPointer		LastUSP = BufP->LastUSP;
     ED_UBlockPointer		UBP = NULL;
     Int16			FirstMod, DoDel, DoSave, Count;
-    Int32			PrevOffset, LenLeft, MaxLen;
+    Int64			PrevOffset, LenLeft, MaxLen;
 
-    // BufP is altered... excellent place for ED_XSelAlterPrimary, in case BufP is PRIMARY!
-    // This properly handles the case when BufP is altered by using the Undo cmd itself!!
-    // Functionality is available even in ReadOnly buffers or when Undo is turned off.
-    if (Mode & ED_UB_DEL)
-	ED_XSelAlterPrimary(BufP, Pos, -Len);
+    // Update the XSel and the Idxs first, see ED_BufferEditUpdate.
+    if (Mode & ED_UB_NOIDX)
+	;
+    else if (Mode & ED_UB_DEL)
+	ED_BufferEditUpdate(BufP, Pos, -Len, DataP);
     else if (Mode & ED_UB_ADD)
-	ED_XSelAlterPrimary(BufP, Pos, Len);
+	ED_BufferEditUpdate(BufP, Pos, Len, DataP);
 
     if (LastUSP == NULL) return;			// Undo is turned off!
     ED_BufferGCUndoSlabs(BufP, 0);			// Level 0, limits USlab count
@@ -13740,8 +19404,10 @@ void	ED_BufferAddUndoBlock(ED_BufferPointer BufP, Int32 Pos, Int32 Len, Uns8 Mod
 	    if (UBP->Flags & ED_UB_ADD) {				// Previous was ADD too!
 		// Very possible that a large (multi-part) CHAIN DEL is being UnDone.  This will request
 		// CHAINed ADD blocks (as the original DEL blocks are processed one at a time... These
-		// ADD blocks are force-merged.
-		if (Mode & ED_UB_CHAIN) {
+		// ADD blocks are force-merged.  All parts of a split DEL have the same Pos, each ADD
+		// goes in front of the last.  A chain of separate DELs (ED_QREPReplaceAll) has many
+		// Pos, so these ADD blocks must stay apart.
+		if ((Mode & ED_UB_CHAIN) && (UBP->DataPos == Pos)) {
 		    UBP->DataLen += Len;				// Simply add to the count
 		    return;
 		}
@@ -13760,7 +19426,7 @@ void	ED_BufferAddUndoBlock(ED_BufferPointer BufP, Int32 Pos, Int32 Len, Uns8 Mod
     }
 
     // No more merging if we get here.  Just add new blocks.
-    // Del always comes first, so no point checking for Chain!
+    // Del usually comes first, only ED_QREPReplaceAll chains it!
     // If the first block is too small (used up all Cur Slab), next iteration
     // will alloc a Slab that is big enough.  So at most, 2 blocks will contain it.
     //
@@ -13802,7 +19468,7 @@ void	ED_BufferAddUndoBlock(ED_BufferPointer BufP, Int32 Pos, Int32 Len, Uns8 Mod
 	    memcpy(UBP->Data, DataP, UBP->DataLen);		// Get the data
 	    DataP += UBP->DataLen;				// For next iteration!
 
-	    UBP->Flags = Mode & (ED_UB_CHUNK | ED_UB_DEL);
+	    UBP->Flags = Mode & (ED_UB_CHUNK | ED_UB_DEL | ED_UB_CHAIN);
 	    if (Count == 0) {					// First in Chain
 		if (FirstMod) UBP->Flags |= ED_UB_FIRSTMOD;	// This is the FirstMod, buffer was clean before this!!
 	    } else
@@ -13834,7 +19500,7 @@ void	ED_BufferAddUndoBlock(ED_BufferPointer BufP, Int32 Pos, Int32 Len, Uns8 Mod
 //		the latter can cause the Slab for the former to purge!
 //
 // NOTE:	Must call again if ED_UB_CHAIN
-Int16	ED_BufferUndo(ED_BufferPointer BufP, Uns8 * OpP, Int32 *PosP, Int32 *LenP, char **DataPP)
+Int16	ED_BufferUndo(ED_BufferPointer BufP, Uns8 * OpP, Int64 *PosP, Int64 *LenP, char **DataPP)
 {
     ED_UBlockPointer		UBP;
     
@@ -13846,6 +19512,8 @@ Int16	ED_BufferUndo(ED_BufferPointer BufP, Uns8 * OpP, Int32 *PosP, Int32 *LenP,
 
     if (ED_UndoBlock) {
 	if (ED_UndoSlabP == NULL) goto UndoNoMore;		// Cannot Undo any more!
+	if ((ED_UndoSlabP->Flags & ED_US_FROZENFLAG) &&
+	    ! ED_BufferThawUndoSlab(BufP, ED_UndoSlabP)) goto UndoThawFailed;
 	
 	// Undoing in sequence, so take 1 step further back!
 	UBP = (ED_UBlockPointer)((char *)ED_UndoSlabP + ED_UndoBlock);
@@ -13875,6 +19543,8 @@ Int16	ED_BufferUndo(ED_BufferPointer BufP, Uns8 * OpP, Int32 *PosP, Int32 *LenP,
     }
 
 DoUndo:
+    if ((ED_UndoSlabP->Flags & ED_US_FROZENFLAG) &&
+	! ED_BufferThawUndoSlab(BufP, ED_UndoSlabP)) goto UndoThawFailed;
     UBP = (ED_UBlockPointer)((char *)ED_UndoSlabP + ED_UndoBlock);
     *PosP = UBP->DataPos;
     *LenP = UBP->DataLen;
@@ -13885,6 +19555,10 @@ DoUndo:
 UndoNoMore:
     ED_FrameSetEchoS(ED_ECHOMSGMODE, ED_STR_EchoUndoNoMore);
     return 0;
+
+UndoThawFailed:
+    ED_FrameSetEchoError(ED_STR_EchoUndoLost, errno);
+    return 0;
 }
 
 // Main command.  If LastCmd was Undo, traverse farther back in time.
@@ -13893,7 +19567,9 @@ UndoNoMore:
 void	ED_CmdUndo(ED_PanePointer PaneP)
 {
     ED_BufferPointer	BufP = PaneP->BufP;
-    Int32		DataPos, DataLen, Total;
+    Int64		DataLen;
+    Int64		Total;
+    Int64		DataPos;
     char *		DataP;
     Int16		DidChain;
     Uns8		Op, NewOp;
@@ -13957,8 +19633,8 @@ GetAnother:
 	Total += DataLen;
 
 	// Adding a UBlock can purge the slab we were reading from,
-	// but it is OK, as have already copied the DataP.
-	ED_BufferAddUndoBlock(BufP, DataPos, DataLen, NewOp, NULL);
+	// but it is OK, as have already copied the DataP.  Pass the copy!
+	ED_BufferAddUndoBlock(BufP, DataPos, DataLen, NewOp, BufP->GapStartP - DataLen);
 
 	// Reset flags AFTER creating a new Undo block!
 	if ((ED_UndoSeenSave == 0) && (Op & ED_UB_FIRSTMOD)) {
@@ -14002,6 +19678,338 @@ void	ED_CmdDisableUndo(ED_PanePointer PaneP)
 }
 
 
+// ******************************************************************************
+// ******************************************************************************
+// STATS
+//
+// Where does keystroke latency go?  Every dispatched command is timed by
+// ED_FRegExec (CallCount, TotalNs, MaxNs in its FReg).  A few hot spots feed
+// histograms in ED_StatsHistArr: input event to drawn (ED_RenderHandler), each
+// ED_PaneRender, X requests issued per input, and the bytes ED_BufferPlaceGap
+// slides around.  Each costs a clock read or two, so they are always on.
+//
+// ED_StatsReport writes it all out one line at a time--along with what Undo,
+// the KillRing and the SA stores are holding.  "show-stats" puts the lines in a
+// RO Info buffer (just like help), "dump-stats" in a file for offline analysis.
+//
+// NOTE:	Drawn means the X requests are queued, Xlib may flush them later.
+//		Percentiles are the top of their bucket, so can be 25% high.
+
+char *		ED_StatsHistNameArr[ED_HistCount] = {
+		    "Input to drawn (usecs)",
+		    "Pane render (usecs)",
+		    "X requests per input",
+		    "Gap bytes moved",
+		    "Parallel scan (usecs)",
+		};
+Int32		ED_StatsHistDivArr[ED_HistCount] = { 1000, 1000, 1, 1, 1000 };
+char *		ED_StartNameArr[ED_StartCount] = {"main", "display", "font", "init", "files", "paint", "im"};
+
+Uns64	ED_StatsHistPercentile(ED_HistPointer HP, Int32 Percent);
+void	EDCB_StatsBufLine(char * StrP, void * DataP);
+void	EDCB_StatsFileLine(char * StrP, void * DataP);
+
+
+// Value goes in bucket Value (if small), else its top ED_HISTSUBBITS (after the
+// leading 1) pick one of ED_HISTSUBCOUNT buckets for that power of 2.
+void	ED_StatsHistAdd(ED_HistId Id, Uns64 Value)
+{
+    ED_HistPointer	HP = &ED_StatsHistArr[Id];
+    Int32		Lg, I;
+
+    if (Value < ED_HISTSUBCOUNT)
+	I = Value;
+    else {
+	Lg = ED_HISTSUBBITS;
+	while (Value >> (Lg + 1)) Lg += 1;
+	I = ((Lg - ED_HISTSUBBITS + 1) << ED_HISTSUBBITS) + ((Value >> (Lg - ED_HISTSUBBITS)) & (ED_HISTSUBCOUNT - 1));
+	if (I >= ED_HISTBUCKETS) I = ED_HISTBUCKETS - 1;
+    }
+
+    HP->BucketArr[I] += 1;
+    HP->Count += 1;
+    HP->Sum += Value;
+    if (Value > HP->Max) HP->Max = Value;
+}
+
+// Returns the top of the bucket holding the Percent ranked value (capped by Max).
+Uns64	ED_StatsHistPercentile(ED_HistPointer HP, Int32 Percent)
+{
+    Uns64	Rank, Seen, Top;
+    Int32	Lg, I;
+
+    if (HP->Count == 0) return 0;
+
+    Rank = (HP->Count * Percent + 99) / 100;
+    Seen = 0;
+    for (I = 0; I < ED_HISTBUCKETS - 1; I++) {
+	Seen += HP->BucketArr[I];
+	if (Seen >= Rank) break;
+    }
+
+    if (I < ED_HISTSUBCOUNT)
+	Top = I;
+    else {
+	Lg = (I >> ED_HISTSUBBITS) + ED_HISTSUBBITS - 1;
+	Top = ((Uns64)(ED_HISTSUBCOUNT + (I & (ED_HISTSUBCOUNT - 1)) + 1) << (Lg - ED_HISTSUBBITS)) - 1;
+    }
+    return (Top < HP->Max) ? Top : HP->Max;
+}
+
+// Called on each KeyPress/ButtonPress (or drag), only the first one since the
+// last render starts the clock--a burst of keys is drawn once.
+void	ED_StatsMarkInput(void)
+{
+    if (ED_StatsInputNs) return;
+
+    ED_StatsInputNs = sc_ClockNSecs();
+    ED_StatsInputReq = NextRequest(ED_XDP);
+}
+
+// ******************************************************************************
+// ED_StatsReport hands LineFP each line of the report, no newline.
+
+void	ED_StatsReport(void (*LineFP)(char *, void *), void * DataP)
+{
+    ED_HistPointer	HP;
+    ED_FRegPointer	FRP;
+    ED_BufferPointer	BufP;
+    ED_KEPointer	KEP;
+    sc_SAStorePointer	StoreArr[6] = {&ED_FrameStore, &ED_PaneStore, &ED_BufferStore, &ED_FRegStore, &ED_FBindStore,
+				       &ED_UStubStore};
+    char *		StoreNameArr[6] = {"Frame", "Pane", "Buffer", "FReg", "FBind", "UndoStub"};
+    sc_SAStorePointer	SP;
+    sc_SAStatsRecord	SAS;
+    sc_WERegStatsRecord	WES;
+    Int64		Div, TextLen, MemLen, GapLen, UndoLen;
+    Int32		BufCount, USCount, FrozenCount, KRCount, I, Len;
+    char		Str[256];
+
+    sprintf(Str, "scEmacs V%d.%d stats, pid %d, up %ld secs", ED_VERSIONMAJOR, ED_VERSIONMINOR,
+	    getpid(), (sc_ClockNSecs() - ED_StatsStartNs) / 1000000000);
+    (*LineFP)(Str, DataP);
+
+    // Startup phases, ms since main
+    Len = sprintf(Str, "  Startup ms:");
+    for (I = 0; I < ED_StartCount; I++) {
+	if (ED_StartupNsArr[I] && ED_StartupNsArr[ED_StartMain])
+	    Len += sprintf(Str + Len, " %s %.1f", ED_StartNameArr[I],
+			   (ED_StartupNsArr[I] - ED_StartupNsArr[ED_StartMain]) / 1000000.0);
+	else
+	    Len += sprintf(Str + Len, " %s -", ED_StartNameArr[I]);
+    }
+    (*LineFP)(Str, DataP);
+    (*LineFP)("", DataP);
+
+    // Histograms
+    sprintf(Str, "  %-24s %10s %10s %10s %10s %10s %10s", "Histogram", "Count", "Mean", "p50", "p90", "p99", "Max");
+    (*LineFP)(Str, DataP);
+    for (I = 0; I < ED_HistCount; I++) {
+	HP = &ED_StatsHistArr[I];
+	Div = ED_StatsHistDivArr[I];
+	sprintf(Str, "  %-24s %10lu %10lu %10lu %10lu %10lu %10lu", ED_StatsHistNameArr[I], HP->Count,
+		(HP->Count) ? (HP->Sum / HP->Count) / Div : 0,
+		ED_StatsHistPercentile(HP, 50) / Div, ED_StatsHistPercentile(HP, 90) / Div,
+		ED_StatsHistPercentile(HP, 99) / Div, HP->Max / Div);
+	(*LineFP)(Str, DataP);
+    }
+    sprintf(Str, "  %-24s %10lu", "X requests (all)", NextRequest(ED_XDP) - 1);
+    (*LineFP)(Str, DataP);
+    (*LineFP)("", DataP);
+
+    // Commands, only the ones that ran
+    sprintf(Str, "  %-24s %10s %10s %10s %10s", "Command", "Calls", "Total ms", "Mean us", "Max us");
+    (*LineFP)(Str, DataP);
+    FRP = ED_FirstFRegP;
+    while (FRP) {
+	if (FRP->CallCount) {
+	    sprintf(Str, "  %-24s %10u %10ld %10ld %10ld", FRP->NameP, FRP->CallCount, FRP->TotalNs / 1000000,
+		    (FRP->TotalNs / FRP->CallCount) / 1000, FRP->MaxNs / 1000);
+	    (*LineFP)(Str, DataP);
+	}
+	FRP = FRP->SortNextP;
+    }
+    (*LineFP)("", DataP);
+
+    // Memory
+    BufCount = USCount = FrozenCount = 0;
+    TextLen = MemLen = GapLen = UndoLen = 0;
+    BufP = ED_FirstBufP;
+    while (BufP) {
+	BufCount += 1;
+	TextLen += BufP->LastPos;
+	MemLen += BufP->BufEndP - BufP->BufStartP;
+	GapLen += BufP->GapEndP - BufP->GapStartP;
+	USCount += BufP->USCount;
+	FrozenCount += BufP->USFrozenCount;
+	UndoLen += BufP->USTotalSize;
+	BufP = BufP->NextBufP;
+    }
+    sprintf(Str, "  Buffers: %d, %ld bytes of text in %ld bytes (%ld in gaps)", BufCount, TextLen, MemLen, GapLen);
+    (*LineFP)(Str, DataP);
+    sprintf(Str, "  Undo: %d slabs (%d frozen), %ld bytes resident, journal %ld bytes (%ld live)",
+	    USCount, FrozenCount, UndoLen, ED_UJTop, ED_UJLive);
+    (*LineFP)(Str, DataP);
+
+    KRCount = 0;
+    TextLen = MemLen = 0;
+    for (I = 0, KEP = ED_KillRing.EltArr; I < ED_KILLRINGCOUNT; I++, KEP++) {
+	if (KEP->MemP == NULL) continue;
+	KRCount += 1;
+	TextLen += KEP->Len;
+	MemLen += KEP->MemLen;
+    }
+    sprintf(Str, "  Kill ring: %d entries, %ld bytes killed in %ld bytes", KRCount, TextLen, MemLen);
+    (*LineFP)(Str, DataP);
+    (*LineFP)("", DataP);
+
+    sprintf(Str, "  %-24s %10s %10s %10s %10s %10s %10s %10s", "Store", "Block", "Used", "Free",
+	    "Racks", "Peak", "Freed", "Bytes");
+    (*LineFP)(Str, DataP);
+    for (I = 0; I < 6; I++) {
+	SP = StoreArr[I];
+	sc_SAStoreGetStats(SP, &SAS);
+	sprintf(Str, "  %-24s %10u %10lu %10lu %10lu %10lu %10lu %10lu", StoreNameArr[I], SP->BytesPerBlock,
+		SAS.UsedBlocks, SAS.FreeBlocks, SAS.RackCount, SAS.PeakRacks, SAS.FreedRacks, SAS.HeldBytes);
+	(*LineFP)(Str, DataP);
+    }
+
+    // PayloadPool, only the classes ever used
+    for (I = 0; I <= (Int32)(ED_PayloadPool.MaxShift - ED_PayloadPool.MinShift); I++) {
+	SP = ED_PayloadPool.ClassArr + I;
+	if (SP->PeakRacks == 0) continue;
+	sc_SAStoreGetStats(SP, &SAS);
+	sprintf(Str, "  %-24s %10u %10lu %10lu %10lu %10lu %10lu %10lu", "Payload", SP->BytesPerBlock,
+		SAS.UsedBlocks, SAS.FreeBlocks, SAS.RackCount, SAS.PeakRacks, SAS.FreedRacks, SAS.HeldBytes);
+	(*LineFP)(Str, DataP);
+    }
+    sc_SAPoolGetStats(&ED_PayloadPool, &SAS);
+    sprintf(Str, "  Payload pool: %lu bytes used, %lu held, %lu large blocks of %lu bytes (malloc)",
+	    SAS.UsedBytes, SAS.HeldBytes, SAS.LargeCount, SAS.LargeBytes);
+    (*LineFP)(Str, DataP);
+
+    sc_WERegGetStats(&WES);
+    sprintf(Str, "  Event dispatch: %lu lookups, %lu cache hits, %lu probes, %lu misses, %u of %u slots",
+	    WES.Lookups, WES.CacheHits, WES.Probes, WES.Misses, WES.Entries, WES.Slots);
+    (*LineFP)(Str, DataP);
+}
+
+void	EDCB_StatsBufLine(char * StrP, void * DataP)
+{
+    ED_BufferPointer	BufP = DataP;
+
+    ED_BufferInsertLine(BufP, BufP->LastPos, StrP);
+}
+
+void	EDCB_StatsFileLine(char * StrP, void * DataP)
+{
+    fprintf((FILE *)DataP, "%s\n", StrP);
+}
+
+// ******************************************************************************
+// ED_CmdShowStats puts the report in the STATS Info buffer, in the bottom Pane
+// (like ED_CmdHelp).  An existing STATS buffer is emptied and refilled, and any
+// Pane showing it goes back to the top.
+
+void	ED_CmdShowStats(ED_PanePointer PaneP)
+{
+    ED_FramePointer	FP = PaneP->FrameP;
+    ED_FramePointer	FrameP;
+    ED_BufferPointer	NewBufP;
+    ED_PanePointer	PP;
+
+    NewBufP = ED_FirstBufP;
+    while (NewBufP && (NewBufP->Ident != ED_BUFSTATSIDENT))
+	NewBufP = NewBufP->NextBufP;
+
+    if (NewBufP == NULL) {
+	NewBufP = ED_BufferNew(0, ED_STR_StatsBufName, NULL, 1);
+	NewBufP->Ident = ED_BUFSTATSIDENT;
+    } else {
+	ED_BufferPlaceGap(NewBufP, 0, 0);		// All Gap again, no Undo to keep
+	NewBufP->GapEndP = NewBufP->BufEndP;
+	NewBufP->LastPos = 0;
+	ED_BufferLIdxReset(NewBufP);
+	ED_BufferRIdxReset(NewBufP);
+	ED_BufferPIdxReset(NewBufP);
+    }
+    NewBufP->CursorPos = NewBufP->PanePos = 0;
+    ED_StatsReport(EDCB_StatsBufLine, NewBufP);
+
+    FrameP = ED_FirstFrameP;
+    while (FrameP) {
+	PP = FrameP->FirstPaneP;
+	while (PP) {
+	    if (PP->BufP == NewBufP) {
+		PP->CursorPos = PP->PanePos = 0;
+		ED_PaneUpdateAllPos(PP, 1);
+		ED_PaneDrawText(PP);
+	    }
+	    PP = PP->NextPaneP;
+	}
+	FrameP = FrameP->NextFrameP;
+    }
+
+    // Find the bottom Pane on this Frame... if only 1 Pane, then split it!
+    if (FP->PaneCount == 1) {
+	ED_PaneSplit(PaneP);
+	PP = PaneP->NextPaneP;
+    } else {
+	PP = FP->FirstPaneP;
+	while (PP->NextPaneP) PP = PP->NextPaneP;
+    }
+
+    if (PP->BufP != NewBufP)
+	ED_PaneGetNewBuf(PP, NewBufP);
+
+    ED_FrameDrawAll(FP);
+}
+
+// ******************************************************************************
+// ED_CmdDumpStats writes the report to a new ED_STATSDUMPPATH file.  It is
+// made by mkstemp (0600, never an existing file or symlink), as /tmp is shared.
+
+void	ED_CmdDumpStats(ED_PanePointer PaneP)
+{
+    char	PathS[ED_BUFFERPATHLEN];
+    char *	DirP;
+    FILE *	FileP;
+    Int32	MaxLen;
+    Int32	FD;
+
+    DirP = getenv("TMPDIR");
+    if ((DirP == NULL) || (*DirP == 0)) DirP = "/tmp";
+    if (snprintf(PathS, ED_BUFFERPATHLEN, ED_STATSDUMPPATH, DirP, (int)getpid()) >= ED_BUFFERPATHLEN) {
+	ED_FrameSetEchoError(ED_STR_EchoWriteFailed, ENAMETOOLONG);
+	ED_FrameDrawEchoLine(PaneP->FrameP);
+	return;
+    }
+
+    FD = mkstemp(PathS);
+    FileP = (FD < 0) ? NULL : fdopen(FD, "w");
+    if (FileP == NULL) {
+	ED_FrameSetEchoError(ED_STR_EchoWriteFailed, errno);
+	if (FD >= 0) {
+	    close(FD);
+	    unlink(PathS);
+	}
+	ED_FrameDrawEchoLine(PaneP->FrameP);
+	return;
+    }
+
+    ED_StatsReport(EDCB_StatsFileLine, FileP);
+    if (fclose(FileP)) {
+	ED_FrameSetEchoError(ED_STR_EchoWriteFailed, errno);
+	ED_FrameDrawEchoLine(PaneP->FrameP);
+	return;
+    }
+
+    MaxLen = ED_MSGSTRLEN - (1 + strlen(ED_STR_EchoWrotePath));
+    ED_FrameSPrintEchoS(ED_ECHOMSGMODE, ED_STR_EchoWrotePath, MaxLen, PathS);
+    ED_FrameDrawEchoLine(PaneP->FrameP);
+}
+
+
 #ifdef DEBUG
     // Prints out the Undo memory... debugging aid.
     // Function is currently attached to [C-U C-x =].
@@ -14010,7 +20018,7 @@ void	ED_CmdDisableUndo(ED_PanePointer PaneP)
 	ED_USlabPointer		USP;
 	ED_UBlockPointer	UBP;
 	Int16			Count;
-	Int32			Offset, Size;
+	Int64			Offset, Size;
 	char			AddOp[] = "Add";
 	char			DelOp[] = "Del";
 	char			SaveMark[] = "Save!\n";
@@ -14018,13 +20026,15 @@ void	ED_CmdDisableUndo(ED_PanePointer PaneP)
 	char *			OpP;
 	char *			EndP;
 
-	printf("Buffer Undo Memory  Slabs:%d  Bytes:%d\n", BufP->USCount, BufP->USTotalSize);
+	printf("Buffer Undo Memory  Slabs:%d  Bytes:%ld\n", BufP->USCount, BufP->USTotalSize);
 
 	USP = BufP->FirstUSP;
 	Count = 1;
 	while (USP) {
-	    printf("    Slab: %d     %d Bytes\n", Count, USP->SlabSize);
-	    if (USP->LastUBlock == 0)
+	    printf("    Slab: %d     %ld Bytes\n", Count, USP->SlabSize);
+	    if (USP->Flags & ED_US_FROZENFLAG)
+		printf("        Frozen, %d Bytes in journal\n", USP->JournalLen);
+	    else if (USP->LastUBlock == 0)
 		printf("        No Blocks\n");
 	    else {
 		Offset = sizeof(ED_USlabRecord);
@@ -14034,12 +20044,12 @@ void	ED_CmdDisableUndo(ED_PanePointer PaneP)
 		    Size = (UBP->Flags & ED_UB_DEL) ? UBP->DataLen : 0;
 		    if (Size > 50) Size = 50;
 		    EndP = (UBP->Flags & ED_UB_SAVE) ? SaveMark : EndMark;
-		    printf("        Block->%4d %s:0x%02x   Pos:%d Len:%d:[%.*s]%s",
-			    Offset, OpP, UBP->Flags, UBP->DataPos, UBP->DataLen, Size, UBP->Data, EndP);
+		    printf("        Block->%4ld %s:0x%02x   Pos:%ld Len:%ld:[%.*s]%s",
+			    Offset, OpP, UBP->Flags, UBP->DataPos, UBP->DataLen, (Int32)Size, UBP->Data, EndP);
 
 		    Size = sizeof(ED_UBlockRecord);
 		    if (UBP->Flags & ED_UB_DEL)
-			Size = (Size + UBP->DataLen) & ~0x00000003;
+			Size = (Size + UBP->DataLen) & ~0x00000007;
 
 		    Offset += Size;
 		    if (Offset > USP->LastUBlock) break; 
@@ -22,9 +22,27 @@
 // Editor headors for scEmacs
 // ***********************************************************************
 
+    typedef enum {					// Startup phases, see ED_StartupMark
+	ED_StartMain		= 0,			// main() entered
+	ED_StartDisplay,				// X connection is open
+	ED_StartFont,					// Xft font is open
+	ED_StartInit,					// ED_EditorInit done
+	ED_StartFiles,					// Files (the first one) opened
+	ED_StartPaint,					// First Frame drawn
+	ED_StartIM,					// Input method opened (deferred)
+	ED_StartCount
+    } ED_StartPhase;
+
 void	ED_EditorInit(Display * XDP, XftFont * XFP, XIM XIMP, Int32 WinWidth, Int32 WinHeight);
 void	ED_EditorKill(void);
 void	ED_EditorOpenFile(char *PathP, Int16 NewFrame);
+void	ED_EditorQueueFile(char *PathP);
+void	ED_StartupMark(ED_StartPhase Phase);
+void	ED_SessionLoad(char * PathP);
+Int32	ED_SessionOpenFiles(void);
 
 void	ED_BlinkHandler(void);
+Int16	ED_IdleHandler(void);
+Int16	ED_WorkPending(void);
+void	ED_RenderHandler(void);
 
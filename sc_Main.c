@@ -27,7 +27,6 @@
 #include	<X11/Xutil.h>
 #include	<X11/Xatom.h>
 #include	<poll.h>
-#include	<sys/time.h>
 
 #include	<X11/Xft/Xft.h>
 #include	<X11/extensions/Xrender.h>	// XRenderColor
@@ -39,22 +38,28 @@
 
 // ***********************************************************************
 
-typedef struct _sc_TimerRecord {			// For BlinkTimer
-    struct pollfd		PollEvent;
-    struct timeval		SetTime;
+typedef struct _sc_TimerRecord {			// For the Scheduler
+    Int64			DueTime;		// sc_ClockMSecs when it fires
+    sc_TimerFPointer		TimerFP;		// NULL if slot is free
+    void *			DataP;			// Extra arg
+    Int16			Armed;			// Only fires if Armed
 } sc_TimerRecord, *sc_TimerPointer;
 
+typedef struct _sc_FDRecord {				// Extra FD for the Scheduler
+    Int32			FD;			// -1 if slot is free
+    Int16			Events;			// For poll
+    sc_FDFPointer		FDFP;			// Called with revents
+    void *			DataP;			// Extra arg
+} sc_FDRecord, *sc_FDPointer;
+
 typedef void (*sc_EventFPointer)(XEvent *, void *);
 
 
-#define	_sc_WEREGPOINTER struct _sc_WERegRecord *
     typedef struct _sc_WERegRecord {
-	Uns64			Ident;			// Window Ident
-	_sc_WEREGPOINTER	NextP;			// Chain
+	Uns64			Ident;			// Window Ident, 0 == empty slot
 	sc_EventFPointer	EventFP;		// Event handler
 	void *			DataP;			// Extra arg
     } sc_WERegRecord, *sc_WERegPointer;
-#undef _sc_WEREGPOINTER
 
 // ***********************************************************************
 
@@ -67,35 +72,44 @@ Uns16		XDispHeight, XDispWidth;	// Size of main screen
 XftFont *	XftFontP;
 char *		XftFontName = "Ubuntu mono-13:weight=medium:slant=roman";
 XftDraw *	XftDrawP;
-XIM		XIMP;
-XIC		XICP;
 
-#define		sc_WEREGCOUNT		(1 << 7)
-#define		sc_WEREGMASK		(sc_WEREGCOUNT - 1)
+#define		sc_WEREGMINSLOTS	(1 << 6)	// Initial table size, power of 2
+#define		sc_WEREGCACHECOUNT	(1 << 3)	// Last-hit cache, power of 2
+#define		sc_WEREGCACHEMASK	(sc_WEREGCACHECOUNT - 1)
 
-sc_WERegPointer	sc_WERegArr[sc_WEREGCOUNT];
-sc_SAStore	sc_WERegStore;
+sc_WERegPointer		sc_WERegArrP;			// Open addressed table
+Uns32			sc_WERegSlots;			// Power of 2
+Uns16			sc_WERegShift;			// 64 - log2(Slots)
+sc_WERegRecord		sc_WERegCacheArr[sc_WEREGCACHECOUNT];
+sc_WERegStatsRecord	sc_WERegStats;
 
 #define		sc_BLINKINTERVAL	500	// Millisec
-sc_TimerRecord	sc_BlinkTimerR;
-Int16		sc_BlinkerOn;
-Int16		sc_DoBlink;
+#define		sc_TIMERCOUNT		16	// Max timers
+#define		sc_FDCOUNT		8	// Max extra FDs (X connection is always polled)
+
+sc_TimerRecord	sc_TimerArr[sc_TIMERCOUNT];
+sc_FDRecord	sc_FDArr[sc_FDCOUNT];
+struct pollfd	sc_PollArr[1 + sc_FDCOUNT];
+Int16		sc_BlinkTimerId;
 
 Int16		sc_MainContinue;
 
 // ***********************************************************************
 
-void		sc_SAStoreAddRack(sc_SAStorePointer StoreP);
+void		sc_SAStoreInit(sc_SAStorePointer StoreP, Uns32 BytesPerBlock, Uns32 BlocksPerRack);
+Int16		sc_SAStoreAddRack(sc_SAStorePointer StoreP);
+void		sc_SARackUnlink(sc_SAStorePointer StoreP, sc_SARackPointer RackP);
+void		sc_SARackLinkFirst(sc_SAStorePointer StoreP, sc_SARackPointer RackP);
+void		sc_SARackLinkLast(sc_SAStorePointer StoreP, sc_SARackPointer RackP);
+Int32		sc_SAPoolClass(sc_SAPoolPointer PoolP, Int64 Len);
 
-void		sc_InitBlinkTimer(void);
-void		sc_ResetBlinkTimer(void);
-Uns16		sc_DoBlinkTimer(Int32 MilliSecs);
+void		sc_BlinkTimerFunc(void * DataP);
 
-void		sc_WERegInit(void);
-void		sc_WERegKill(void);
 void		sc_WERegAdd(Uns64 Id, void * FP, void * DataP);
 void		sc_WERegDel(Uns64 Id);
 void		sc_WERegDispatch(Uns64 Id, XEvent * EventP);
+void		sc_WERegAlloc(Uns32 Slots);
+Uns32		sc_WERegFindSlot(Uns64 Id);
 
 
 // ******************************************************************************
@@ -114,22 +128,70 @@ void		sc_WERegDispatch(Uns64 Id, XEvent * EventP);
 // initialized independently).  A single Rack is initially allocated for the
 // Store, more are added as needed.
 //
+// Each Rack keeps its own list of empty Blocks and a count of used ones.  Every
+// Block is preceded by a pointer back to its Rack, so freeing finds it at once.
+// Racks with empty Blocks are kept at the front of the Store list, full Racks at
+// the back--so allocating just looks at the first Rack.  When a Rack empties out
+// and the Store still has a whole Rack worth of empty Blocks elsewhere, the Rack
+// is freed.  (Keeping one spare stops a Store that hovers at a Rack boundary from
+// adding and freeing the same Rack over and over.)
+//
 // Everything works better if BytesPerBlock is factor of 8 (longlong aligned).
 
-void		sc_SAStoreOpen(sc_SAStorePointer StoreP, Uns32 BytesPerBlock, Uns32 BlocksPerRack)
+#define		sc_SASLOTLEN(SP)	((SP)->BytesPerBlock + sizeof(sc_SARackPointer))
+#define		sc_SARACKLEN(SP)	(sizeof(sc_SARack) + (Uns64)(SP)->BlocksPerRack * sc_SASLOTLEN(SP))
+
+void		sc_SAStoreInit(sc_SAStorePointer StoreP, Uns32 BytesPerBlock, Uns32 BlocksPerRack)
 {
     BytesPerBlock = (BytesPerBlock + 7) & ~7L;
 
     StoreP->FirstRackP = NULL;
-    StoreP->EmptyBlockP = NULL;
+    StoreP->LastRackP = NULL;
     StoreP->BytesPerBlock = BytesPerBlock;
     StoreP->BlocksPerRack = BlocksPerRack;
     StoreP->UsedBlocks = 0L;
     StoreP->FreeBlocks = 0L;
     StoreP->RackCount = 0L;
+    StoreP->PeakRacks = 0L;
+    StoreP->FreedRacks = 0L;
     StoreP->Flags = sc_SASTORENOFLAG;
+}
 
-    sc_SAStoreAddRack(StoreP);
+void		sc_SAStoreOpen(sc_SAStorePointer StoreP, Uns32 BytesPerBlock, Uns32 BlocksPerRack)
+{
+    sc_SAStoreInit(StoreP, BytesPerBlock, BlocksPerRack);
+    if (! sc_SAStoreAddRack(StoreP))
+	G_SETEXCEPTION("SA Store AddRack failed", StoreP->RackCount + 1);
+}
+
+// ******************************************************************************
+// Rack list upkeep.  Unlink takes RackP off the Store list, LinkFirst and LinkLast
+// put it back on at either end.
+
+void		sc_SARackUnlink(sc_SAStorePointer StoreP, sc_SARackPointer RackP)
+{
+    if (RackP->PrevP) RackP->PrevP->NextP = RackP->NextP;
+    else StoreP->FirstRackP = RackP->NextP;
+    if (RackP->NextP) RackP->NextP->PrevP = RackP->PrevP;
+    else StoreP->LastRackP = RackP->PrevP;
+}
+
+void		sc_SARackLinkFirst(sc_SAStorePointer StoreP, sc_SARackPointer RackP)
+{
+    RackP->PrevP = NULL;
+    RackP->NextP = StoreP->FirstRackP;
+    if (StoreP->FirstRackP) StoreP->FirstRackP->PrevP = RackP;
+    else StoreP->LastRackP = RackP;
+    StoreP->FirstRackP = RackP;
+}
+
+void		sc_SARackLinkLast(sc_SAStorePointer StoreP, sc_SARackPointer RackP)
+{
+    RackP->NextP = NULL;
+    RackP->PrevP = StoreP->LastRackP;
+    if (StoreP->LastRackP) StoreP->LastRackP->NextP = RackP;
+    else StoreP->FirstRackP = RackP;
+    StoreP->LastRackP = RackP;
 }
 
 // ******************************************************************************
@@ -137,35 +199,40 @@ void		sc_SAStoreOpen(sc_SAStorePointer StoreP, Uns32 BytesPerBlock, Uns32 Blocks
 // This function is called to initialize the store and automatically if more
 // racks are needed when allocating blocks.  There is really no need to call
 // this explicitly from client code.
+//
+// Return 1 == Success
+// Return 0 == Malloc failed
 
-void		sc_SAStoreAddRack(sc_SAStorePointer StoreP)
+Int16		sc_SAStoreAddRack(sc_SAStorePointer StoreP)
 {
     sc_SARackPointer	RackP;
+    char *		SlotP;
     void **		BPP;
     Uns32		I;
 
-    RackP = (sc_SARack *)malloc((StoreP->BytesPerBlock * StoreP->BlocksPerRack) + sizeof(sc_SARack));
-    if (RackP == NULL) G_SETEXCEPTION("SA Store AddRack failed", StoreP->RackCount + 1);
+    RackP = (sc_SARack *)malloc(sc_SARACKLEN(StoreP));
+    if (RackP == NULL) return 0;
 
-    if (StoreP->FirstRackP) StoreP->FirstRackP->PrevP = RackP;
-    RackP->NextP = StoreP->FirstRackP;
-    RackP->PrevP = NULL;
-    StoreP->FirstRackP = RackP;
+    sc_SARackLinkFirst(StoreP, RackP);
+    RackP->UsedBlocks = 0;
 
     StoreP->FreeBlocks += StoreP->BlocksPerRack;
     StoreP->RackCount += 1L;
+    if (StoreP->RackCount > StoreP->PeakRacks) StoreP->PeakRacks = StoreP->RackCount;
 
-    // First fill Rack with empty blocks, chained together.
+    // Fill Rack with empty blocks, chained together, each one pointing back at the Rack.
 
     I = 0;
-    BPP = (void *)(RackP + 1);
+    BPP = &RackP->EmptyBlockP;
+    SlotP = (char *)(RackP + 1);
     while (I++ < StoreP->BlocksPerRack) {
-	*BPP = (void *)((char *)BPP + StoreP->BytesPerBlock);
+	*(sc_SARackPointer *)SlotP = RackP;
+	*BPP = SlotP + sizeof(sc_SARackPointer);
 	BPP = *BPP;
+	SlotP += sc_SASLOTLEN(StoreP);
     }
-    BPP = (void *)((char *)BPP - StoreP->BytesPerBlock);	// Overshot, go back one block
-    *BPP = StoreP->EmptyBlockP;					// Chain to existing list, if any
-    StoreP->EmptyBlockP = (void *)(RackP + 1);			// Empty blocks on this rack come first
+    *BPP = NULL;
+    return 1;
 }
 
 
@@ -185,7 +252,7 @@ void		sc_SAStoreClose(sc_SAStorePointer StoreP)
     }
 
     StoreP->FirstRackP = NULL;
-    StoreP->EmptyBlockP = NULL;
+    StoreP->LastRackP = NULL;
     StoreP->UsedBlocks = 0L;
     StoreP->FreeBlocks = 0L;
     StoreP->RackCount = 0L;
@@ -193,39 +260,214 @@ void		sc_SAStoreClose(sc_SAStorePointer StoreP)
 }
 
 // ******************************************************************************
-// sc_SAStoreAllocBlock suballocates and returns a data block from the Store.  It
-// will create and add a new Rack if necessary.
+// sc_SAStoreGetBlock suballocates and returns a data block from the Store.  It
+// will create and add a new Rack if necessary, returns NULL if that fails.
+// A Rack that fills up moves to the back of the list.
 
-void *		sc_SAStoreAllocBlock(sc_SAStorePointer StoreP)
+void *		sc_SAStoreGetBlock(sc_SAStorePointer StoreP)
 {
-    void *	BlockP;
+    sc_SARackPointer	RackP;
+    void *		BlockP;
 
-    if (StoreP->EmptyBlockP == NULL)
-	sc_SAStoreAddRack(StoreP);
+    RackP = StoreP->FirstRackP;
+    if ((RackP == NULL) || (RackP->EmptyBlockP == NULL)) {
+	if (! sc_SAStoreAddRack(StoreP)) return NULL;
+	RackP = StoreP->FirstRackP;
+    }
 
-    BlockP = StoreP->EmptyBlockP;
-    StoreP->EmptyBlockP = (*(void **)BlockP);
+    BlockP = RackP->EmptyBlockP;
+    RackP->EmptyBlockP = (*(void **)BlockP);
+    RackP->UsedBlocks += 1;
     StoreP->UsedBlocks += 1;
     StoreP->FreeBlocks -= 1;
 
+    if ((RackP->EmptyBlockP == NULL) && (RackP != StoreP->LastRackP)) {
+	sc_SARackUnlink(StoreP, RackP);
+	sc_SARackLinkLast(StoreP, RackP);
+    }
+
+    return BlockP;
+}
+
+// ******************************************************************************
+// sc_SAStoreAllocBlock is sc_SAStoreGetBlock, but running out of memory is fatal.
+
+void *		sc_SAStoreAllocBlock(sc_SAStorePointer StoreP)
+{
+    void *	BlockP;
+
+    BlockP = sc_SAStoreGetBlock(StoreP);
+    if (BlockP == NULL) G_SETEXCEPTION("SA Store AddRack failed", StoreP->RackCount + 1);
+
     return BlockP;
 }
 
 // ******************************************************************************
-// sc_SAStoreFreeBlock returns the BlockP back to the free state.
+// sc_SAStoreFreeBlock returns the BlockP back to the free state.  A full Rack
+// that gets a free Block moves to the front, an empty one may be freed.
 //
 // WARNING:	Crash and burn if BlockP did NOT come from StoreP!
 
 void		sc_SAStoreFreeBlock(sc_SAStorePointer StoreP, void * BlockP)
 {
-    void **	BPP;
+    sc_SARackPointer	RackP;
+    void **		BPP;
+    Int16		WasFull;
+
+    RackP = *((sc_SARackPointer *)BlockP - 1);
+    WasFull = (RackP->EmptyBlockP == NULL);
 
     BPP = BlockP;
-    *BPP = StoreP->EmptyBlockP;
-    StoreP->EmptyBlockP = BPP;
+    *BPP = RackP->EmptyBlockP;
+    RackP->EmptyBlockP = BPP;
+    RackP->UsedBlocks -= 1;
 
     StoreP->FreeBlocks += 1;
     StoreP->UsedBlocks -= 1;
+
+    if ((RackP->UsedBlocks == 0) &&
+	(StoreP->FreeBlocks - StoreP->BlocksPerRack >= StoreP->BlocksPerRack)) {
+	sc_SARackUnlink(StoreP, RackP);
+	free(RackP);
+	StoreP->FreeBlocks -= StoreP->BlocksPerRack;
+	StoreP->RackCount -= 1L;
+	StoreP->FreedRacks += 1L;
+
+    } else if (WasFull && (RackP != StoreP->FirstRackP)) {
+	sc_SARackUnlink(StoreP, RackP);
+	sc_SARackLinkFirst(StoreP, RackP);
+    }
+}
+
+// ******************************************************************************
+// sc_SAStoreGetStats fills in the counters for StoreP.
+
+void		sc_SAStoreGetStats(sc_SAStorePointer StoreP, sc_SAStatsPointer StatsP)
+{
+    memset(StatsP, 0, sizeof(sc_SAStatsRecord));
+    StatsP->UsedBlocks = StoreP->UsedBlocks;
+    StatsP->FreeBlocks = StoreP->FreeBlocks;
+    StatsP->UsedBytes = (Uns64)StoreP->UsedBlocks * StoreP->BytesPerBlock;
+    StatsP->HeldBytes = (Uns64)StoreP->RackCount * sc_SARACKLEN(StoreP);
+    StatsP->RackCount = StoreP->RackCount;
+    StatsP->PeakRacks = StoreP->PeakRacks;
+    StatsP->FreedRacks = StoreP->FreedRacks;
+}
+
+// ******************************************************************************
+// ******************************************************************************
+// SA POOL
+//
+// Variable length data (undo slabs, kill ring chunks...) is allocated from a POOL,
+// a set of Stores for power-of-2 size classes from MinBytes up to MaxBytes.  A
+// request is rounded up to its class (sc_SAPoolSize tells the caller, who may as
+// well use all of it), bigger ones are simply malloced.  Each class gets about
+// RackBytes per Rack, and its Store is only given a Rack once it is first used.
+//
+// The caller hands the Len back when freeing, it picks the class.
+
+void		sc_SAPoolOpen(sc_SAPoolPointer PoolP, Uns32 MinBytes, Uns32 MaxBytes, Uns32 RackBytes)
+{
+    Uns32		I, Count;
+
+    PoolP->MinShift = 3;
+    while ((1UL << PoolP->MinShift) < MinBytes) PoolP->MinShift += 1;
+    PoolP->MaxShift = PoolP->MinShift;
+    while (((1UL << PoolP->MaxShift) < MaxBytes) && (PoolP->MaxShift - PoolP->MinShift < sc_SAPOOLCLASSES - 1))
+	PoolP->MaxShift += 1;
+    PoolP->LargeCount = 0;
+    PoolP->LargeBytes = 0;
+
+    for (I = 0; I <= PoolP->MaxShift - PoolP->MinShift; I++) {
+	Count = RackBytes >> (PoolP->MinShift + I);
+	sc_SAStoreInit(PoolP->ClassArr + I, 1UL << (PoolP->MinShift + I), (Count < 4) ? 4 : Count);
+    }
+}
+
+void		sc_SAPoolClose(sc_SAPoolPointer PoolP)
+{
+    Uns32		I;
+
+    for (I = 0; I <= PoolP->MaxShift - PoolP->MinShift; I++)
+	sc_SAStoreClose(PoolP->ClassArr + I);
+}
+
+// ******************************************************************************
+// sc_SAPoolClass returns the class index for Len, or -1 if it is too big.
+
+Int32		sc_SAPoolClass(sc_SAPoolPointer PoolP, Int64 Len)
+{
+    Uns32		Shift = PoolP->MinShift;
+
+    if (Len > (1LL << PoolP->MaxShift)) return -1;
+    while ((1LL << Shift) < Len) Shift += 1;
+    return Shift - PoolP->MinShift;
+}
+
+// Returns the size actually allocated for Len.
+Int64		sc_SAPoolSize(sc_SAPoolPointer PoolP, Int64 Len)
+{
+    Int32		I = sc_SAPoolClass(PoolP, Len);
+
+    return (I < 0) ? Len : PoolP->ClassArr[I].BytesPerBlock;
+}
+
+// Returns NULL if out of memory, like malloc.
+void *		sc_SAPoolAlloc(sc_SAPoolPointer PoolP, Int64 Len)
+{
+    Int32		I = sc_SAPoolClass(PoolP, Len);
+    void *		BlockP;
+
+    if (I >= 0) return sc_SAStoreGetBlock(PoolP->ClassArr + I);
+
+    BlockP = malloc(Len);
+    if (BlockP) {
+	PoolP->LargeCount += 1;
+	PoolP->LargeBytes += Len;
+    }
+    return BlockP;
+}
+
+// Len *MUST* be what BlockP was allocated with (or its sc_SAPoolSize).  NULL is ignored.
+void		sc_SAPoolFree(sc_SAPoolPointer PoolP, void * BlockP, Int64 Len)
+{
+    Int32		I;
+
+    if (BlockP == NULL) return;
+    I = sc_SAPoolClass(PoolP, Len);
+    if (I >= 0) {
+	sc_SAStoreFreeBlock(PoolP->ClassArr + I, BlockP);
+	return;
+    }
+
+    free(BlockP);
+    PoolP->LargeCount -= 1;
+    PoolP->LargeBytes -= Len;
+}
+
+// ******************************************************************************
+// sc_SAPoolGetStats sums up the counters of all the classes, plus the malloced ones.
+
+void		sc_SAPoolGetStats(sc_SAPoolPointer PoolP, sc_SAStatsPointer StatsP)
+{
+    sc_SAStatsRecord	ClassStats;
+    Uns32		I;
+
+    memset(StatsP, 0, sizeof(sc_SAStatsRecord));
+    for (I = 0; I <= PoolP->MaxShift - PoolP->MinShift; I++) {
+	sc_SAStoreGetStats(PoolP->ClassArr + I, &ClassStats);
+	StatsP->UsedBlocks += ClassStats.UsedBlocks;
+	StatsP->FreeBlocks += ClassStats.FreeBlocks;
+	StatsP->UsedBytes += ClassStats.UsedBytes;
+	StatsP->HeldBytes += ClassStats.HeldBytes;
+	StatsP->RackCount += ClassStats.RackCount;
+	StatsP->PeakRacks += ClassStats.PeakRacks;
+	StatsP->FreedRacks += ClassStats.FreedRacks;
+    }
+    StatsP->LargeCount = PoolP->LargeCount;
+    StatsP->LargeBytes = PoolP->LargeBytes;
+    StatsP->UsedBytes += PoolP->LargeBytes;
+    StatsP->HeldBytes += PoolP->LargeBytes;
 }
 
 // ******************************************************************************
@@ -238,18 +480,31 @@ void		sc_SAStoreFreeBlock(sc_SAStorePointer StoreP, void * BlockP)
 // every registered window.  (XLib can associate any data with a Win, but
 // access is cumbersome, espcially in an event loop.)
 
+// The table is open addressed with linear probing, and is kept at most half
+// full so a lookup is 1 or 2 probes.  XIDs are allocated sequentially from a
+// client base, so Ids are spread with a Fibonacci multiply and the TOP bits
+// index the table.  Deletes shift later entries of the run back, so there are
+// no tombstones and probe runs never degrade.
+//
+// Most events in a burst go to the windows of the current frame (XWin, its
+// mode line and scroll windows), whose XIDs are consecutive.  So a small
+// direct-mapped cache, indexed by the LOW bits of the Id, catches them before
+// the table is probed at all.
+//
+// sc_WERegStats counts lookups, cache hits, probes and misses so dispatch cost
+// can be checked, see sc_WERegGetStats.
+
 // sc_WERegInit initializes everything.
 
 void	sc_WERegInit(void)
 {
+    sc_WERegPointer	CP = sc_WERegCacheArr;
     Uns16		I = 0;
-    sc_WERegPointer *	P = sc_WERegArr;
 
-    // Init the Store to sub-allocate the blocks.
-    sc_SAStoreOpen(&sc_WERegStore, sizeof(sc_WERegRecord), sc_WEREGCOUNT / 2);
-
-    // Init the Hash array
-    while (I++ < sc_WEREGCOUNT) *P++ = NULL;
+    sc_WERegArrP = NULL;
+    memset(&sc_WERegStats, 0, sizeof(sc_WERegStatsRecord));
+    sc_WERegAlloc(sc_WEREGMINSLOTS);
+    while (I++ < sc_WEREGCACHECOUNT) (CP++)->Ident = 0;
 }
 
 // ******************************************************************************
@@ -257,47 +512,113 @@ void	sc_WERegInit(void)
 
 void	sc_WERegKill(void)
 {
+    sc_WERegPointer	CP = sc_WERegCacheArr;
     Uns16		I = 0;
-    sc_WERegPointer *	P = sc_WERegArr;    
 
-    sc_SAStoreClose(&sc_WERegStore);	// Frees the Racks holding the blocks
-    while (I++ < sc_WEREGCOUNT) *P++ = NULL;
+    free(sc_WERegArrP);
+    sc_WERegArrP = NULL;
+    sc_WERegSlots = 0;
+    sc_WERegStats.Entries = 0;
+    while (I++ < sc_WEREGCACHECOUNT) (CP++)->Ident = 0;
 }
 
 // ******************************************************************************
-// sc_WERegAdd creates an entry for each new Win Id.
+// sc_WERegAlloc (re)allocates the table with Slots entries (power of 2) and
+// re-inserts any existing entries.
 
-void	sc_WERegAdd(Uns64 Id, void * FP, void * DataP)
+void	sc_WERegAlloc(Uns32 Slots)
 {
-    Uns16		I = (Uns16)(Id && sc_WEREGMASK);
-    sc_WERegPointer	NewP = sc_SAStoreAllocBlock(&sc_WERegStore);
+    sc_WERegPointer	OldP = sc_WERegArrP;
+    sc_WERegPointer	P;
+    Uns32		OldSlots = sc_WERegSlots;
+    Uns32		I;
+    Uns16		Bits = 0;
+
+    P = (sc_WERegPointer)calloc(Slots, sizeof(sc_WERegRecord));
+    if (P == NULL) G_SETEXCEPTION("WEReg Alloc failed", Slots);
+
+    while ((1UL << Bits) < Slots) Bits++;
+    sc_WERegArrP = P;
+    sc_WERegSlots = Slots;
+    sc_WERegShift = 64 - Bits;
+    sc_WERegStats.Slots = Slots;
+
+    if (OldP == NULL) return;
 
-    NewP->Ident = Id;
-    NewP->EventFP = (sc_EventFPointer)FP;
-    NewP->DataP = DataP;
-    NewP->NextP = sc_WERegArr[I];
-    sc_WERegArr[I] = NewP;
+    for (I = 0; I < OldSlots; I++)
+	if (OldP[I].Ident)
+	    sc_WERegArrP[sc_WERegFindSlot(OldP[I].Ident)] = OldP[I];
+    free(OldP);
 }
 
 // ******************************************************************************
-// sc_WERegDel removes the entry for the given Win Id.
+// sc_WERegFindSlot returns the slot holding Id, or the empty slot that ends
+// its probe run.  There is always an empty slot, the table is at most half full.
 
-void	sc_WERegDel(Uns64 Id)
+Uns32	sc_WERegFindSlot(Uns64 Id)
 {
-    Uns16		I = (Uns16)(Id && sc_WEREGMASK);
-    sc_WERegPointer	CurP = sc_WERegArr[I];
-    sc_WERegPointer	LastP = NULL;
+    Uns32		Mask = sc_WERegSlots - 1;
+    Uns32		I = (Uns32)((Id * 0x9E3779B97F4A7C15ULL) >> sc_WERegShift);
 
-    while (CurP && CurP->Ident != Id) {
-	LastP = CurP;
-	CurP = CurP->NextP;
+    sc_WERegStats.Probes += 1;
+    while (sc_WERegArrP[I].Ident && sc_WERegArrP[I].Ident != Id) {
+	I = (I + 1) & Mask;
+	sc_WERegStats.Probes += 1;
     }
-    if (CurP == NULL) return;			// Did not find Id
+    return I;
+}
+
+// ******************************************************************************
+// sc_WERegAdd creates an entry for each new Win Id.  Re-adding an Id simply
+// replaces its handler.
+
+void	sc_WERegAdd(Uns64 Id, void * FP, void * DataP)
+{
+    sc_WERegPointer	P;
+
+    if ((sc_WERegStats.Entries + 1) * 2 > sc_WERegSlots)
+	sc_WERegAlloc(sc_WERegSlots * 2);
 
-    if (LastP) LastP->NextP = CurP->NextP;
-    else sc_WERegArr[I] = CurP->NextP;
+    P = &sc_WERegArrP[sc_WERegFindSlot(Id)];
+    if (P->Ident == 0) sc_WERegStats.Entries += 1;
+    P->Ident = Id;
+    P->EventFP = (sc_EventFPointer)FP;
+    P->DataP = DataP;
 
-    sc_SAStoreFreeBlock(&sc_WERegStore, CurP);
+    P = &sc_WERegCacheArr[Id & sc_WEREGCACHEMASK];
+    if (P->Ident == Id) P->Ident = 0;
+}
+
+// ******************************************************************************
+// sc_WERegDel removes the entry for the given Win Id.  Later entries in the
+// same probe run are shifted back into the hole, if their home slot allows.
+
+void	sc_WERegDel(Uns64 Id)
+{
+    Uns32		Mask = sc_WERegSlots - 1;
+    Uns32		I = sc_WERegFindSlot(Id);
+    Uns32		J = I;
+    Uns32		Home;
+    sc_WERegPointer	P;
+
+    if (sc_WERegArrP[I].Ident == 0) return;	// Did not find Id
+
+    P = &sc_WERegCacheArr[Id & sc_WEREGCACHEMASK];
+    if (P->Ident == Id) P->Ident = 0;
+
+    while (1) {
+	J = (J + 1) & Mask;
+	if (sc_WERegArrP[J].Ident == 0) break;
+
+	// Entry at J may move to the hole at I only if its Home is NOT in (I, J].
+	Home = (Uns32)((sc_WERegArrP[J].Ident * 0x9E3779B97F4A7C15ULL) >> sc_WERegShift);
+	if (((J - Home) & Mask) >= ((J - I) & Mask)) {
+	    sc_WERegArrP[I] = sc_WERegArrP[J];
+	    I = J;
+	}
+    }
+    sc_WERegArrP[I].Ident = 0;
+    sc_WERegStats.Entries -= 1;
 }
 
 // ******************************************************************************
@@ -306,67 +627,215 @@ void	sc_WERegDel(Uns64 Id)
 
 void	sc_WERegDispatch(Uns64 Id, XEvent * EventP)
 {
-    Uns16		I = (Uns16)(Id && sc_WEREGMASK);
-    sc_WERegPointer	CurP = sc_WERegArr[I];
+    sc_WERegPointer	CP = &sc_WERegCacheArr[Id & sc_WEREGCACHEMASK];
+    sc_WERegPointer	P;
+
+    sc_WERegStats.Lookups += 1;
+    if (Id && CP->Ident == Id) {
+	sc_WERegStats.CacheHits += 1;
+	(*CP->EventFP)(EventP, CP->DataP);
+	return;
+    }
+
+    P = &sc_WERegArrP[sc_WERegFindSlot(Id)];
+    if (P->Ident == 0) {
+	sc_WERegStats.Misses += 1;
+	return;
+    }
 
-    while (CurP && CurP->Ident != Id)
-	CurP = CurP->NextP;
+    *CP = *P;
+    (*P->EventFP)(EventP, P->DataP);
+}
+
+// ******************************************************************************
+// sc_WERegGetStats copies out the dispatch counters.
 
-    if (CurP) (*CurP->EventFP)(EventP, CurP->DataP);
+void	sc_WERegGetStats(sc_WERegStatsPointer StatsP)
+{
+    *StatsP = sc_WERegStats;
 }
 
 // ******************************************************************************
 // ******************************************************************************
-// Blink Timer
+// Scheduler
+//
+// XLib does not support asynch alarm interrupts, so everything is Polled.  MAIN
+// calls XNextEvent only if there are pending events, and will never sit and wait
+// in XNextEvent.  Instead sc_SchedWait sits in poll on the XServer connection
+// plus any extra FDs (background work), until the earliest Armed timer is due.
+// All times are MilliSecs on the monotonic clock, so changing the wall clock
+// does not stop (or race) the Blinker.
 //
-// The cursor/blinker in an active window has to wink on/off.  XLib does not
-// support asynch alarm interrups, so must used a Polled approach. So XNextEvent
-// is called only if there are pending events, will never sit and wait in XNextEvent.
-// Poll is called to wait on a "file descriptor" representing the connection to the
-// XServer--it will kick out when the connection gets a new event or allocated time
-// expires... the allocated time is whatever is left from the desired Blink interval
-// since the last SetTime.
+// Timers are one-shot, a TimerFP can re-arm itself with sc_TimerSet.
 
-// sc_BlinkTimerInit gets the FD and establishes first SetTime.
+Int64	sc_ClockMSecs(void)
+{
+    struct timespec	TS;
+
+    clock_gettime(CLOCK_MONOTONIC, &TS);
+    return ((Int64)TS.tv_sec * 1000) + (TS.tv_nsec / 1000000);
+}
 
-void	sc_BlinkTimerInit()
+// NanoSecs on the same clock, for timing (not scheduling) short operations.
+
+Int64	sc_ClockNSecs(void)
 {
-    sc_BlinkTimerR.PollEvent.fd = ConnectionNumber(XDispP);
-    sc_BlinkTimerR.PollEvent.events = POLLIN;
-    gettimeofday(&sc_BlinkTimerR.SetTime, NULL);
+    struct timespec	TS;
+
+    clock_gettime(CLOCK_MONOTONIC, &TS);
+    return ((Int64)TS.tv_sec * 1000000000) + TS.tv_nsec;
 }
 
-// sc_BlinkTimerReset rests the SetTime--Blinker should stay on
-// for N millisecs each time user types a character, switches
-// windows, panes, etc.
+void	sc_SchedInit(void)
+{
+    Int16	I;
+
+    for (I = 0; I < sc_TIMERCOUNT; I++) {
+	sc_TimerArr[I].TimerFP = NULL;
+	sc_TimerArr[I].Armed = 0;
+    }
+    for (I = 0; I < sc_FDCOUNT; I++)
+	sc_FDArr[I].FD = -1;
+}
 
-void	sc_BlinkTimerReset()
+// Returns Id for a new (unarmed) timer.
+Int16	sc_TimerNew(sc_TimerFPointer TimerFP, void * DataP)
 {
-    gettimeofday(&sc_BlinkTimerR.SetTime, NULL);
+    Int16	I;
+
+    for (I = 0; I < sc_TIMERCOUNT; I++)
+	if (sc_TimerArr[I].TimerFP == NULL) break;
+    if (I == sc_TIMERCOUNT) G_SETEXCEPTION("Out of Timers", I);
+
+    sc_TimerArr[I].TimerFP = TimerFP;
+    sc_TimerArr[I].DataP = DataP;
+    sc_TimerArr[I].Armed = 0;
+    return I;
 }
 
-// sc_BlinkTimerDo is called after XLib runs out of window events.  It
-// spins (in POLL function) until interval passes, resets the SetTime
-// for another cycle and returns 1.  If the FD registers more data, i.e.
-// XLib has a new event, the function just returns 0.
-//
-// Time computation is in MilliSec... using 1024 instead of 1000 for
-// conversion factor--cannot help myself!
+// (Re)arm the timer to fire MSecs from NOW.
+void	sc_TimerSet(Int16 Id, Int32 MSecs)
+{
+    sc_TimerArr[Id].DueTime = sc_ClockMSecs() + MSecs;
+    sc_TimerArr[Id].Armed = 1;
+}
+
+void	sc_TimerCancel(Int16 Id)
+{
+    sc_TimerArr[Id].Armed = 0;
+}
+
+void	sc_TimerFree(Int16 Id)
+{
+    sc_TimerArr[Id].Armed = 0;
+    sc_TimerArr[Id].TimerFP = NULL;
+}
+
+// FDFP is called with poll revents whenever FD is ready.  Events is for poll (POLLIN, etc.)
+void	sc_FDAdd(Int32 FD, Int16 Events, sc_FDFPointer FDFP, void * DataP)
+{
+    Int16	I;
+
+    for (I = 0; I < sc_FDCOUNT; I++)
+	if (sc_FDArr[I].FD < 0) break;
+    if (I == sc_FDCOUNT) G_SETEXCEPTION("Out of FD slots", FD);
+
+    sc_FDArr[I].FD = FD;
+    sc_FDArr[I].Events = Events;
+    sc_FDArr[I].FDFP = FDFP;
+    sc_FDArr[I].DataP = DataP;
+}
+
+void	sc_FDDel(Int32 FD)
+{
+    Int16	I;
+
+    for (I = 0; I < sc_FDCOUNT; I++)
+	if (sc_FDArr[I].FD == FD) sc_FDArr[I].FD = -1;
+}
+
+// sc_SchedWait sleeps up to MaxMSecs (-1 is forever, 0 just checks), but not
+// past the earliest Armed timer.  Then calls back any ready FDs and fires due
+// timers.  Returns 1 if the XServer connection has data.
 
-Uns16	sc_BlinkTimerDo(Int32 MilliSecs)
+Int16	sc_SchedWait(Int32 MaxMSecs)
 {
-    struct timeval	CurTime;
-    Int32		DeltaT;
+    sc_TimerPointer	TP;
+    Int64		Now, Wait;
+    Int16		I, N, SlotArr[sc_FDCOUNT];
+    Int16		XReady;
+
+    // Poll will NOT kick out for events XLib has already queued... and timers
+    // may have drawn, so Flush first.
+    XFlush(XDispP);
+    if (XEventsQueued(XDispP, QueuedAlready)) MaxMSecs = 0;
+
+    Now = sc_ClockMSecs();
+    Wait = MaxMSecs;
+    for (I = 0; I < sc_TIMERCOUNT; I++) {
+	TP = &sc_TimerArr[I];
+	if (! (TP->TimerFP && TP->Armed)) continue;
+	if (TP->DueTime <= Now) Wait = 0;
+	else if ((Wait < 0) || (TP->DueTime - Now < Wait)) Wait = TP->DueTime - Now;
+    }
+
+    sc_PollArr[0].fd = ConnectionNumber(XDispP);
+    sc_PollArr[0].events = POLLIN;
+    sc_PollArr[0].revents = 0;
+    N = 1;
+    for (I = 0; I < sc_FDCOUNT; I++) {
+	if (sc_FDArr[I].FD < 0) continue;
+	sc_PollArr[N].fd = sc_FDArr[I].FD;
+	sc_PollArr[N].events = sc_FDArr[I].Events;
+	sc_PollArr[N].revents = 0;
+	SlotArr[N - 1] = I;
+	N += 1;
+    }
+
+    if (poll(sc_PollArr, N, (int)Wait) < 0) N = 0;		// EINTR, just check timers
+    XReady = (N > 0) && (sc_PollArr[0].revents != 0);
+
+    for (I = 1; I < N; I++) {
+	sc_FDPointer	FDP = &sc_FDArr[SlotArr[I - 1]];
+
+	if (sc_PollArr[I].revents && (FDP->FD == sc_PollArr[I].fd))	// May be deleted by earlier FDFP
+	    (*FDP->FDFP)(FDP->FD, sc_PollArr[I].revents, FDP->DataP);
+    }
 
-    gettimeofday(&CurTime, NULL);
-    DeltaT = (1024 * (CurTime.tv_sec - sc_BlinkTimerR.SetTime.tv_sec)) +
-	     ((CurTime.tv_usec - sc_BlinkTimerR.SetTime.tv_usec) / 1024);
-    if (DeltaT >= MilliSecs || 0 == poll(&sc_BlinkTimerR.PollEvent, 1, MilliSecs - DeltaT)) {
-	gettimeofday(&sc_BlinkTimerR.SetTime, NULL);
-	return 1;
+    Now = sc_ClockMSecs();
+    for (I = 0; I < sc_TIMERCOUNT; I++) {
+	TP = &sc_TimerArr[I];
+	if (TP->TimerFP && TP->Armed && (TP->DueTime <= Now)) {
+	    TP->Armed = 0;					// One-shot, FP may re-arm
+	    (*TP->TimerFP)(TP->DataP);
+	}
     }
 
-    return 0;
+    return XReady;
+}
+
+// ******************************************************************************
+// Blink Timer
+//
+// The cursor/blinker in an active window has to wink on/off.  It fires only
+// once the interval passes without a Reset... so Blinker should stay on for
+// N millisecs each time user types a character, switches windows, panes, etc.
+
+void	sc_BlinkTimerFunc(void * DataP)
+{
+    ED_BlinkHandler();
+    sc_TimerSet(sc_BlinkTimerId, sc_BLINKINTERVAL);
+}
+
+void	sc_BlinkTimerInit(void)
+{
+    sc_BlinkTimerId = sc_TimerNew(sc_BlinkTimerFunc, NULL);
+    sc_TimerSet(sc_BlinkTimerId, sc_BLINKINTERVAL);
+}
+
+void	sc_BlinkTimerReset(void)
+{
+    sc_TimerSet(sc_BlinkTimerId, sc_BLINKINTERVAL);
 }
 
 // ******************************************************************************
@@ -380,6 +849,25 @@ void	sc_MainExit(void)
 }
 
 
+// sc_MainCoalesce replaces *EventP with the last of any events of the same type,
+// for the same window, queued *right* behind it.  Only the latest mouse position,
+// window size or expose (Count == 0) matters.
+
+void	sc_MainCoalesce(XEvent * EventP)
+{
+    XEvent	NextEvent;
+
+    while (XEventsQueued(XDispP, QueuedAlready)) {
+	XPeekEvent(XDispP, &NextEvent);
+	if ((NextEvent.type != EventP->type) || (NextEvent.xany.window != EventP->xany.window))
+	    break;
+	XNextEvent(XDispP, EventP);
+    }
+}
+
+// sc_MainEventLoop handles all pending events, then has the editor draw
+// whatever they changed--just once for the whole batch.
+
 void	sc_MainEventLoop(void)
 {
     XEvent	XWinEvent;
@@ -391,10 +879,12 @@ void	sc_MainEventLoop(void)
 	    case PropertyNotify:
 		// printf("Prop Notify!  Win:%ld Atom:%ld State:%d\n",
 		//        XWinEvent.xproperty.window, XWinEvent.xproperty.atom, XWinEvent.xproperty.state);
+		sc_WERegDispatch(XWinEvent.xproperty.window, &XWinEvent);
 		break;
 
 	    case MotionNotify:
 		// printf("Motion\n");
+		sc_MainCoalesce(&XWinEvent);
 		sc_WERegDispatch(XWinEvent.xmotion.window, &XWinEvent);
 		break;
 
@@ -405,11 +895,13 @@ void	sc_MainEventLoop(void)
 
 	    case Expose:
 		// printf("Expose\n");
+		sc_MainCoalesce(&XWinEvent);
 		sc_WERegDispatch(XWinEvent.xexpose.window, &XWinEvent);
 		break;
 
 	    case ConfigureNotify:
 		// printf("Configure\n");
+		sc_MainCoalesce(&XWinEvent);
 		sc_WERegDispatch(XWinEvent.xconfigure.window, &XWinEvent);
 		break;
 
@@ -470,15 +962,22 @@ void	sc_MainEventLoop(void)
 
 	} // Switch
     } // while (Event)
+
+    if (sc_MainContinue) ED_RenderHandler();
 }
 
+// scBench (sc_Bench.c) brings its own main, and drives sc_MainEventLoop itself.
+#ifndef sc_BENCH
+
 int	main(int ArgC, char* ArgV[])
 {
-    Int16	OpenInitCount;
+    Int16	OpenInitCount, FileCount;
     char	*CP;
     
+    ED_StartupMark(ED_StartMain);
     G_MAINFILEERROR_INIT;			// For error reporting/debugging
     sc_WERegInit();				// Init window handler registry
+    sc_SchedInit();				// Timers + FDs, Editor may add some
 
     if ((NULL == setlocale(LC_ALL, "")) ||
 	(! XSupportsLocale()) ||
@@ -488,6 +987,7 @@ int	main(int ArgC, char* ArgV[])
 
     XDispP = XOpenDisplay(getenv("DISPLAY"));
     if (! XDispP) G_SETEXCEPTION("Cannot connext to X server", 0);
+    ED_StartupMark(ED_StartDisplay);
 
     // XSynchronize(XDispP, True);		// Debugging AID !!
 
@@ -497,37 +997,52 @@ int	main(int ArgC, char* ArgV[])
 
     XftFontP = XftFontOpenName(XDispP, XScreenN, XftFontName);
     if (! XftFontP) G_SETEXCEPTION("Xft failed to get FontP", 0);
+    ED_StartupMark(ED_StartFont);
 
-    XIMP = XOpenIM(XDispP, NULL, NULL, NULL);
-    if (XIMP == NULL) G_SETEXCEPTION("XOpenIM Failed", 0);
+    // The XIM is opened by the Editor, after the first paint
+    ED_EditorInit(XDispP, XftFontP, NULL, XDispWidth / 3, XDispHeight / 2);
 
-    ED_EditorInit(XDispP, XftFontP, XIMP, XDispWidth / 3, XDispHeight / 2);
+    // -session File, before any file is read
+    for (OpenInitCount = 1; OpenInitCount + 1 < ArgC; OpenInitCount++)
+	if (strcmp(ArgV[OpenInitCount], "-session") == 0)
+	    ED_SessionLoad(ArgV[OpenInitCount + 1]);
 
+    // Only the first file is read before the first paint, the rest are queued
+    FileCount = 0;
     OpenInitCount = 1;
     while (OpenInitCount < ArgC) {
 	CP = ArgV[OpenInitCount];
 	// printf("Arg%d -> [%s]\n", OpenInitCount, CP);
-	if (*CP && (*CP != '-'))
-	    ED_EditorOpenFile(CP, OpenInitCount > 1);	// NewFrame after first
+	if (strcmp(CP, "-session") == 0)
+	    OpenInitCount += 1;				// Skip its File
+	else if (*CP && (*CP != '-')) {
+	    if (FileCount++ == 0) ED_EditorOpenFile(CP, 0);
+	    else ED_EditorQueueFile(CP);		// NewFrame after first
+	}
 	OpenInitCount += 1;
     }
+    if (FileCount == 0) ED_SessionOpenFiles();		// Last working set
+    ED_StartupMark(ED_StartFiles);
 
     sc_MainContinue = 1;
     sc_BlinkTimerInit();					// Blinker
-    while (sc_MainContinue) {					// Timer
+    while (sc_MainContinue) {
     
 	sc_MainEventLoop();
-	if (sc_MainContinue && sc_BlinkTimerDo(sc_BLINKINTERVAL))
-	    ED_BlinkHandler();
-	    
+	if (! sc_MainContinue) break;
+	if (ED_IdleHandler())					// Background work, do not wait
+	    sc_SchedWait(0);
+	else
+	    sc_SchedWait(-1);					// Sleep until event, FD or timer
     }
 
     sc_WERegKill();
     XftFontClose(XDispP, XftFontP);
-    XCloseIM(XIMP);
     XCloseDisplay(XDispP);
     exit(0);
 }
 
+#endif	// sc_BENCH
+
 
 
@@ -28,34 +28,96 @@
     #define sc_SASTORENOFLAG	0L
 
     typedef struct _sc_SAStore {
-	_sc_SARACKPOINTER	FirstRackP;			// First allocated Block
-	void *			EmptyBlockP;			// First Empty Data Block
+	_sc_SARACKPOINTER	FirstRackP;			// Racks with free Blocks come first
+	_sc_SARACKPOINTER	LastRackP;			// Full Racks go last
 	Uns32			BytesPerBlock;			// Size of Data Blocks
 	Uns32			BlocksPerRack;			// How many blocks in 1 Rack
 	Uns32			UsedBlocks;			// Data blocks in use
 	Uns32			FreeBlocks;			// Data blocks still free
 	Uns32			RackCount;			// Racks in this store
+	Uns32			PeakRacks;			// Most Racks ever held
+	Uns32			FreedRacks;			// Empty Racks given back
 	Uns32			Flags;
     } sc_SAStore, *sc_SAStorePointer;
 
     typedef struct _sc_SARack {
 	_sc_SARACKPOINTER	NextP;				// Next Rack in Store
 	_sc_SARACKPOINTER	PrevP;				// Prev Rack in Store
-	// Followed by N Data Blocks
+	void *			EmptyBlockP;			// First Empty Data Block on this Rack
+	Uns32			UsedBlocks;			// Data blocks in use on this Rack
+	Uns32			Pad;
+	// Followed by N Data Blocks, each after a pointer back to its Rack
     } sc_SARack, * sc_SARackPointer;
 
 #undef _sc_SARACKPOINTER
 #undef _sc_SASTOREPOINTER
 
+    #define sc_SAPOOLCLASSES	16				// Max size classes in a Pool
+
+    typedef struct {
+	sc_SAStore		ClassArr[sc_SAPOOLCLASSES];	// Class I holds (1 << (MinShift + I)) Blocks
+	Uns32			MinShift;			// Smallest class
+	Uns32			MaxShift;			// Largest class, bigger goes to malloc
+	Uns64			LargeCount;			// Malloced (past MaxShift) and still live
+	Uns64			LargeBytes;
+    } sc_SAPool, *sc_SAPoolPointer;
+
+    typedef struct {
+	Uns64			UsedBlocks;			// Blocks handed out
+	Uns64			FreeBlocks;			// Blocks free on held Racks
+	Uns64			UsedBytes;			// Bytes in Blocks handed out
+	Uns64			HeldBytes;			// Bytes in held Racks (+ Large)
+	Uns64			RackCount;
+	Uns64			PeakRacks;
+	Uns64			FreedRacks;
+	Uns64			LargeCount;			// Pool only, malloced past MaxShift
+	Uns64			LargeBytes;
+    } sc_SAStatsRecord, *sc_SAStatsPointer;
 
 void	sc_SAStoreOpen(sc_SAStorePointer StoreP, Uns32 BytesPerBlock, Uns32 BlocksPerRack);
 void	sc_SAStoreClose(sc_SAStorePointer StoreP);
 void *	sc_SAStoreAllocBlock(sc_SAStorePointer StoreP);
+void *	sc_SAStoreGetBlock(sc_SAStorePointer StoreP);
 void	sc_SAStoreFreeBlock(sc_SAStorePointer StoreP, void * BlockP);
+void	sc_SAStoreGetStats(sc_SAStorePointer StoreP, sc_SAStatsPointer StatsP);
+
+void	sc_SAPoolOpen(sc_SAPoolPointer PoolP, Uns32 MinBytes, Uns32 MaxBytes, Uns32 RackBytes);
+void	sc_SAPoolClose(sc_SAPoolPointer PoolP);
+Int64	sc_SAPoolSize(sc_SAPoolPointer PoolP, Int64 Len);
+void *	sc_SAPoolAlloc(sc_SAPoolPointer PoolP, Int64 Len);
+void	sc_SAPoolFree(sc_SAPoolPointer PoolP, void * BlockP, Int64 Len);
+void	sc_SAPoolGetStats(sc_SAPoolPointer PoolP, sc_SAStatsPointer StatsP);
 
+    typedef struct {
+	Uns64			Lookups;			// Dispatch calls
+	Uns64			CacheHits;			// Found in last-hit cache
+	Uns64			Probes;				// Table slots examined
+	Uns64			Misses;				// Unregistered windows
+	Uns32			Entries;			// Registered windows
+	Uns32			Slots;				// Table size
+    } sc_WERegStatsRecord, *sc_WERegStatsPointer;
+
+void	sc_WERegInit(void);
+void	sc_WERegKill(void);
 void	sc_WERegAdd(Uns64 Id, void * FP, void * DataP);
 void	sc_WERegDel(Uns64 Id);
+void	sc_WERegGetStats(sc_WERegStatsPointer StatsP);
+
+typedef void (*sc_TimerFPointer)(void *);
+typedef void (*sc_FDFPointer)(Int32, Int16, void *);
+
+Int64	sc_ClockMSecs(void);
+Int64	sc_ClockNSecs(void);
+void	sc_SchedInit(void);
+Int16	sc_SchedWait(Int32 MaxMSecs);
+Int16	sc_TimerNew(sc_TimerFPointer TimerFP, void * DataP);
+void	sc_TimerSet(Int16 Id, Int32 MSecs);
+void	sc_TimerCancel(Int16 Id);
+void	sc_TimerFree(Int16 Id);
+void	sc_FDAdd(Int32 FD, Int16 Events, sc_FDFPointer FDFP, void * DataP);
+void	sc_FDDel(Int32 FD);
 
+void	sc_BlinkTimerInit(void);
 void	sc_BlinkTimerReset(void);
 
 void	sc_MainExit(void);